@@ -0,0 +1,8 @@
+-- loaded from script archive by TestScriptArchive
+local ArchiveModule = {}
+
+function ArchiveModule.source()
+    return debug.getinfo(1, "S").source
+end
+
+return ArchiveModule
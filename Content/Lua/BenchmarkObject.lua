@@ -0,0 +1,17 @@
+-- lua module of SluaBenchmarkObject, used by TestBenchmark
+local BenchmarkObject = {}
+
+-- empty override, dispatch cost of it is measured by Override.ProcessEvent of TestBenchmark
+function BenchmarkObject:OnBenchmarkEvent()
+end
+
+-- compared and serialized by Replication.PrepareReplication of TestBenchmark
+function BenchmarkObject:GetLifetimeReplicatedProps()
+    local ELifetimeCondition = import("ELifetimeCondition")
+    return {
+        { "HP", ELifetimeCondition.COND_None, EPropertyClass.Float},
+        { "Position", ELifetimeCondition.COND_None, import("Vector")},
+    }
+end
+
+return Class(nil, nil, BenchmarkObject)
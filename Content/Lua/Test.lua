@@ -46,12 +46,22 @@ end
 
 function testcase()
     -- require 'TestPerf'
+    -- profiler transport test need a free local port, uncomment to run it
+    -- TestProfileTransport = require 'TestProfileTransport'
+    -- TestProfileTransport.start()
     require('TestUI')
     require('TestCase')
     require('TestStruct')
     require('TestInterface')
     require('TestCppBinding')
     require('TestGCOptimise')
+    require('TestScriptArchive')
+    require('TestFrameBudget')
+    require('TestMemorySample')
+    require('TestAllocator')
+    require('TestInstanceCache')
+    require('TestImportAsync')
+    require('TestPreload')
     TestBp=require 'TestBlueprint'
     TestBp:test(gworld,gactor)
 
@@ -76,6 +86,7 @@ function update(dt)
     TestArray.update(tt)
     TestMap.update(tt)
     TestBp:update(tt)
+    if TestProfileTransport then TestProfileTransport.update(tt) end
 
     -- test weak ptr is alive?
     if slua.isValid(weakptr) then
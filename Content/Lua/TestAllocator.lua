@@ -0,0 +1,62 @@
+-- small block allocator stats come back to baseline after alloc/realloc/free churn and state close
+if not slua.runWithSmallBlockAllocator then
+    print("skip allocator test")
+    return
+end
+
+-- tables and strings of every size class, tables grow by realloc, long strings are large blocks
+local churn = [[
+local keep = {}
+for round = 1, 20 do
+    local t = {}
+    for i = 1, 2000 do
+        local v = { i, tostring(i) .. string.rep("x", i % 700) }
+        for j = 1, i % 40 do v[#v + 1] = j end
+        t[i] = v
+    end
+    -- free some rounds and keep others, so pages are partially used
+    keep[round % 3] = t
+    if round % 5 == 0 then collectgarbage("collect") end
+end
+return keep
+]]
+
+local function assertNear(after, base, field, slack)
+    local diff = after[field] - base[field]
+    assert(diff <= slack, string.format("%s should come back to baseline, %d more than baseline", field, diff))
+end
+
+-- churn in this state, everything is freed after full gc
+if slua.getAllocatorStats() then
+    collectgarbage("collect")
+    collectgarbage("collect")
+    local base = slua.getAllocatorStats()
+    local kept = load(churn, "=TestAllocatorChurn")()
+    local peak = slua.getAllocatorStats()
+    assert(peak.requestedBytes - base.requestedBytes > 1024 * 1024, "churn should allocate")
+    assert(peak.largeBlockCount > base.largeBlockCount)
+    kept = nil
+    -- string table shrinks by half every full gc
+    for _ = 1, 4 do collectgarbage("collect") end
+    local after = slua.getAllocatorStats()
+    -- stats tables of this test are still alive, string table may not be back to its size
+    assertNear(after, base, "requestedBytes", 128 * 1024)
+    assertNear(after, base, "smallBlockCount", 256)
+    assertNear(after, base, "largeBlockCount", 4)
+    assert(kept == nil)
+end
+
+-- bare state with its own allocator, closing it frees every block
+local before, after = slua.runWithSmallBlockAllocator(churn)
+assert(before, after)
+assert(before.smallBlockCount > 0 and before.largeBlockCount > 0)
+assert(after.requestedBytes == 0 and after.smallBlockBytes == 0 and after.largeBlockBytes == 0)
+assert(after.smallBlockCount == 0 and after.largeBlockCount == 0)
+-- empty pages are cached up to a limit, the rest go back to system
+assert(after.pageCount == after.cachedPageCount)
+assert(after.releasedPageCount > 0)
+
+-- errors are returned after state closed
+local ok, err = slua.runWithSmallBlockAllocator("error('boom')")
+assert(ok == nil and err:find("boom"))
+print("allocator test passed")
@@ -97,6 +97,75 @@ for k, v in arrUserInfo:PairsLessGC() do
     print("arr item less gc UserInfo", k, v.others.p2:Get(0), v.others.p3)
 end
 
+-- bulk convert between table and array
+local nums = slua.Array(EPropertyClass.Float)
+nums:FromTable({1.5, 2.5, 3.5})
+assert(nums:Num()==3 and nums:Get(2)==3.5)
+local numTable = nums:ToTable()
+assert(#numTable==3 and numTable[1]==1.5)
+
+local names = slua.Array(EPropertyClass.Name)
+names:FromTable({"a", "b"})
+assert(names:ToTable()[2]=="b")
+
+local vectors = slua.Array(EPropertyClass.Struct, import("Vector"))
+vectors:FromTable({FVector(1,2,3), FVector(4,5,6)})
+assert(vectors:ToTable()[2].Z==6)
+
+-- batch accessors
+local range = nums:GetRange(1, 2)
+assert(#range==2 and range[1]==2.5)
+local reused = {0, 0, 0, 0}
+nums:GetRange(nil, nil, reused)
+assert(#reused==3 and reused[3]==3.5)
+nums:SetRange(2, {4.5, 5.5})
+assert(nums:Num()==4 and nums:Get(3)==5.5)
+local zs = vectors:Project("Z")
+assert(#zs==2 and zs[1]==3 and zs[2]==6)
+local ys = vectors:Project("Y", 1, 1, reused)
+assert(#reused==1 and ys[1]==5)
+-- range is checked before narrowing to int, so huge values can't wrap into range
+assert(not pcall(nums.GetRange, nums, 4294967296, 1))
+assert(not pcall(nums.GetRange, nums, 1, 4294967295))
+assert(not pcall(nums.GetRange, nums, 2, math.maxinteger))
+assert(not pcall(nums.GetRange, nums, -1))
+assert(not pcall(nums.SetRange, nums, 4294967296, {1}))
+assert(#nums:GetRange(nums:Num(), 0)==0)
+
+-- nil of table is skipped and values after it are packed, as iterating table did
+local holes = {1.5, 2.5, 3.5, 4.5}
+holes[2] = nil
+local packed = slua.Array(EPropertyClass.Float)
+packed:FromTable(holes)
+assert(packed:Num()==3 and packed:Get(0)==1.5 and packed:Get(1)==3.5 and packed:Get(2)==4.5)
+-- SetRange writes table index i+1 to start+i, nil in the middle is an error and array is unchanged
+assert(not pcall(packed.SetRange, packed, 2, holes))
+assert(packed:Num()==3 and packed:Get(2)==4.5)
+assert(packed:SetRange(2, {5.5, 6.5})==4)
+assert(packed:Get(2)==5.5 and packed:Get(3)==6.5)
+local strHoles = {"a", "b", "c"}
+strHoles[2] = nil
+t.strs = strHoles
+assert(t.strs:Num()==2 and t.strs:Get(1)=="c")
+
+-- bulk math
+local ArrayMath = slua.ArrayMath
+local points = slua.Array(EPropertyClass.Struct, import("Vector"))
+points:FromTable({FVector(3,0,0), FVector(1,0,0), FVector(2,0,0)})
+ArrayMath.Add(points, FVector(0,1,0))
+ArrayMath.Scale(points, 2)
+assert(points:Get(0).X==6 and points:Get(0).Y==2)
+local nearest = ArrayMath.SortByDistance(points, FVector(0,0,0), 2)
+assert(#nearest==2 and nearest[1]==1 and nearest[2]==2)
+local dists = ArrayMath.Distance(points, FVector(0,2,0))
+assert(dists[2]==2)
+local lo, hi = ArrayMath.MinMax(points)
+assert(lo.X==2 and hi.X==6)
+ArrayMath.Lerp(points, FVector(0,0,0), 0.5)
+assert(points:Get(1).X==1)
+ArrayMath.Add(nums, 1)
+assert(nums:Get(0)==2.5)
+
 local TestArray={}
 
 function TestArray.update()
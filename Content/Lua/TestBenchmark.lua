@@ -0,0 +1,248 @@
+-- benchmark cases of binding paths, run by LuaBenchmark
+-- headless: -run=SluaBenchmark -Module=TestBenchmark -Out=Saved/Benchmark.json [-Baseline=<json>]
+-- in game: slua.RunBenchmark TestBenchmark Saved/Benchmark.json
+-- every run passes arguments of same types on every iteration, so a case always measures one path.
+-- Replication case needs a LuaGameState in world and is skipped headless.
+
+local Benchmark = slua.Benchmark
+local SluaTestCase = import('SluaTestCase')
+local FUserInfo = import('UserInfo')
+
+local function newTestCase()
+    return SluaTestCase()
+end
+
+local cases = {
+    -- UFunction called through LuaFunctionAccelerator
+    {
+        name = "UFunction.EmptyFunc",
+        iterations = 200000,
+        setup = newTestCase,
+        run = function(t, n)
+            for i = 1, n do
+                t:EmptyFunc()
+            end
+        end,
+    },
+    {
+        name = "UFunction.ReturnIntWithInt",
+        iterations = 200000,
+        setup = newTestCase,
+        run = function(t, n)
+            for i = 1, n do
+                t:ReturnIntWithInt(i)
+            end
+        end,
+    },
+    {
+        name = "UFunction.FuncWithStr",
+        iterations = 200000,
+        setup = newTestCase,
+        run = function(t, n)
+            for i = 1, n do
+                t:FuncWithStr("hello world")
+            end
+        end,
+    },
+
+    -- CppBinding
+    {
+        name = "CppBinding.EmptyFunc",
+        iterations = 200000,
+        setup = function() return PerfTest(0) end,
+        run = function(t, n)
+            for i = 1, n do
+                t:EmptyFunc(t)
+            end
+        end,
+    },
+    {
+        name = "CppBinding.ReturnIntWithInt",
+        iterations = 200000,
+        setup = function() return PerfTest(0) end,
+        run = function(t, n)
+            for i = 1, n do
+                t:ReturnIntWithInt(i)
+            end
+        end,
+    },
+    {
+        name = "CppBinding.FuncWithStr",
+        iterations = 200000,
+        setup = function() return PerfTest(0) end,
+        run = function(t, n)
+            for i = 1, n do
+                t:FuncWithStr("hello world")
+            end
+        end,
+    },
+
+    -- UProperty through fastIndex
+    {
+        name = "Property.GetInt",
+        iterations = 500000,
+        setup = newTestCase,
+        run = function(t, n)
+            local sum = 0
+            for i = 1, n do
+                sum = sum + t.Value
+            end
+        end,
+    },
+    {
+        name = "Property.SetInt",
+        iterations = 500000,
+        setup = newTestCase,
+        run = function(t, n)
+            for i = 1, n do
+                t.Value = i
+            end
+        end,
+    },
+    {
+        name = "Property.GetStructField",
+        iterations = 200000,
+        setup = newTestCase,
+        run = function(t, n)
+            local sum = 0
+            for i = 1, n do
+                sum = sum + t.info.id
+            end
+        end,
+    },
+
+    {
+        name = "Property.FirstGetNewStruct",
+        iterations = 100000,
+        run = function(_, n)
+            local sum = 0
+            for i = 1, n do
+                sum = sum + FUserInfo().id
+            end
+        end,
+    },
+
+    -- struct creation
+    {
+        name = "Struct.NewUStruct",
+        iterations = 100000,
+        run = function(_, n)
+            for i = 1, n do
+                FUserInfo()
+            end
+        end,
+    },
+    {
+        name = "Struct.NewVector",
+        iterations = 200000,
+        run = function(_, n)
+            for i = 1, n do
+                FVector(i, i, i)
+            end
+        end,
+    },
+
+    -- containers
+    {
+        name = "Container.ArrayGet",
+        iterations = 500000,
+        setup = function()
+            local arr = slua.Array(EPropertyClass.Int)
+            for i = 1, 64 do
+                arr:Add(i)
+            end
+            return arr
+        end,
+        run = function(arr, n)
+            local sum = 0
+            for i = 1, n do
+                sum = sum + arr:Get(i % 64)
+            end
+        end,
+    },
+    {
+        name = "Container.ArrayAddRemove",
+        iterations = 200000,
+        setup = function() return slua.Array(EPropertyClass.Int) end,
+        run = function(arr, n)
+            for i = 1, n do
+                arr:Add(i)
+                arr:Remove(0)
+            end
+        end,
+    },
+    {
+        name = "Container.MapGet",
+        iterations = 500000,
+        setup = function()
+            local map = slua.Map(EPropertyClass.Int, EPropertyClass.Str)
+            for i = 0, 63 do
+                map:Add(i, "value")
+            end
+            return map
+        end,
+        run = function(map, n)
+            for i = 1, n do
+                map:Get(i % 64)
+            end
+        end,
+    },
+
+    -- multicast delegate broadcast from c++ to a lua function
+    {
+        name = "Delegate.Broadcast",
+        iterations = 100000,
+        setup = function()
+            local t = newTestCase()
+            t.OnTestAAA:Add(function(s) end)
+            return t
+        end,
+        run = function(t, n)
+            for i = 1, n do
+                t:TestAAA("hello world")
+            end
+        end,
+    },
+
+    -- UFunction called from c++ and dispatched to lua by luaOverrideFunc
+    {
+        name = "Override.ProcessEvent",
+        iterations = 100000,
+        setup = function()
+            if not Benchmark then
+                return nil, "slua.Benchmark isn't available in shipping"
+            end
+            -- bound to BenchmarkObject.lua when created
+            return import('SluaBenchmarkObject')()
+        end,
+        run = function(obj, n)
+            Benchmark.ProcessEvent(obj, "OnBenchmarkEvent", n)
+        end,
+    },
+
+    -- write of lua replicated property, then compare and serialize of it as one replication frame does
+    {
+        name = "Replication.PrepareReplication",
+        iterations = 100000,
+        setup = function()
+            if not Benchmark then
+                return nil, "slua.Benchmark isn't available in shipping"
+            end
+            -- replicated props are declared by GetLifetimeReplicatedProps of BenchmarkObject.lua
+            local obj = import('SluaBenchmarkObject')()
+            obj.HP = 0.5
+            if not Benchmark.PrepareReplication(obj) then
+                return nil, "SluaBenchmarkObject has no lua replicated props"
+            end
+            return obj
+        end,
+        run = function(obj, n)
+            for i = 1, n do
+                obj.HP = i + 0.5
+                Benchmark.PrepareReplication(obj)
+            end
+        end,
+    },
+}
+
+return cases
@@ -7,6 +7,10 @@ local HitResult = import('HitResult');
 
 function testcase:test(uworld,uactor)
     print("=====Begin test blueprint")
+    -- loaded already, callback is called at once
+    importAsync("/Game/TestActor.TestActor_C", function(cls)
+        print("importAsync", cls)
+    end)
     local bpClass = import("/Game/TestActor.TestActor_C")
     -- get out TArray for actors
     local arr=GameplayStatics.GetAllActorsOfClass(uactor,bpClass,nil)
@@ -77,4 +77,34 @@ req:OnProcessRequestComplete():Bind(function(req,resp,ret)
     print("http complete",req,resp,ret)
 end)
 ]]
-req:ProcessRequest()
\ No newline at end of file
+req:ProcessRequest()
+-- values kept by LuaVar survive reuse of pooled ref blocks and registry slots,
+-- more than slua.MaxFreeRegistryRefs are released at once so some slots go back to lua
+local holder = RefHolder()
+local count = 5000
+local tables = {}
+local function str(i) return "long string kept by RefStr " .. string.rep("#", i % 64) .. i end
+for round = 1, 3 do
+    for i = 0, count - 1 do
+        if i % 2 == 0 then
+            tables[i] = { round = round, index = i }
+            holder:set(i, tables[i])
+        else
+            holder:set(i, str(i + round))
+        end
+    end
+    for i = 0, count - 1 do
+        local v = holder:get(i)
+        if i % 2 == 0 then
+            assert(v == tables[i] and v.round == round and v.index == i)
+        else
+            assert(v == str(i + round))
+        end
+    end
+    -- release all refs of odd then even index, next round reuses them in other order
+    for i = 1, count - 1, 2 do holder:clear(i) end
+    for i = 0, count - 1, 2 do holder:clear(i) end
+    assert(holder:get(0) == nil and holder:get(count - 1) == nil)
+end
+collectgarbage("collect")
+assert(holder:num() == count)
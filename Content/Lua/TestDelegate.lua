@@ -10,4 +10,128 @@ local co = coroutine.create( function()
     
 end )
 coroutine.resume( co )
-co = nil
\ No newline at end of file
+co = nil
+
+-- test coroutine scheduler
+do
+    local Coroutine = slua.Coroutine
+    local order = {}
+
+    Coroutine.Start(function(msg)
+        Coroutine.WaitFrame()
+        Coroutine.WaitFrame(2)
+        Coroutine.WaitSeconds(0.1)
+        print("coroutine resumed by scheduler", msg)
+    end, "after 3 frames and 0.1s")
+
+    -- waits are resumed by due frame, coroutines of same frame by order of waiting
+    Coroutine.Start(function()
+        Coroutine.WaitFrame(2)
+        order[#order + 1] = "frame2"
+    end)
+    Coroutine.Start(function()
+        Coroutine.WaitFrame(1)
+        order[#order + 1] = "frame1.a"
+    end)
+
+    -- cancelled coroutine is never resumed, its waiter slot is reused by next wait
+    local cancelled = Coroutine.Start(function()
+        Coroutine.WaitFrame(1)
+        order[#order + 1] = "cancelled"
+    end)
+    assert(Coroutine.IsWaiting(cancelled), "coroutine should be waiting")
+    assert(Coroutine.Cancel(cancelled), "waiting coroutine should be cancelled")
+    assert(not Coroutine.IsWaiting(cancelled), "cancelled coroutine should not be waiting")
+    assert(not Coroutine.Cancel(cancelled), "coroutine should be cancelled once")
+
+    Coroutine.Start(function()
+        Coroutine.WaitFrame(1)
+        order[#order + 1] = "frame1.b"
+    end)
+
+    -- thread of finished coroutine is reused by next Start
+    local finished = Coroutine.Start(function() end)
+    assert(not Coroutine.IsWaiting(finished), "finished coroutine should not be waiting")
+    local reused = Coroutine.Start(function() end)
+    assert(reused == finished, "thread of finished coroutine should be reused")
+
+    Coroutine.Start(function()
+        Coroutine.WaitFrame(3)
+        local result = table.concat(order, ",")
+        assert(result == "frame1.a,frame1.b,frame2", "unexpected resume order " .. result)
+        print("coroutine scheduler order", result)
+    end)
+end
+
+-- test lua functions bound by Add/Remove/Clear, every binding takes a pooled proxy
+do
+    local t = Test()
+    local calls = {}
+    local h1 = t.OnTestAAA:Add(function(str) calls[#calls + 1] = "a" .. str end)
+    local h2 = t.OnTestAAA:Add(function(str) calls[#calls + 1] = "b" .. str end)
+    assert(h1 ~= h2, "every binding should have its own handle")
+
+    t:TestAAA("1")
+    table.sort(calls)
+    assert(#calls == 2 and calls[1] == "a1" and calls[2] == "b1", "both bindings should be called")
+
+    t.OnTestAAA:Remove(h1)
+    t:TestAAA("2")
+    assert(#calls == 3 and calls[3] == "b2", "removed binding should not be called")
+
+    -- proxy of removed binding is reused and must not call old function
+    t.OnTestAAA:Add(function(str) calls[#calls + 1] = "c" .. str end)
+    t:TestAAA("3")
+    assert(#calls == 5, "new binding and remaining binding should be called")
+
+    t.OnTestAAA:Clear()
+    t:TestAAA("4")
+    assert(#calls == 5, "cleared bindings should not be called")
+end
+
+-- test binding removed by handle is unbound from owner, and a copy of owner made before
+-- calls nothing, even after the released proxy is reused by another binding
+if slua.getDelegateSlots then
+    local t = Test()
+    local calls = {}
+    local h = t.OnTestAAA:Add(function(str) calls[#calls + 1] = "old" .. str end)
+    t:CopyTestAAA()
+    assert(slua.removeDelegate(h), "binding should be removed by handle")
+    t:TestAAA("1")
+    assert(#calls == 0, "removed binding should be unbound from owner")
+    t:TestCopiedAAA("1")
+    assert(#calls == 0, "copy of removed binding should call nothing")
+    local _, freeBefore = slua.getDelegateSlots()
+
+    slua.Coroutine.Start(function()
+        -- released proxy is reused after a frame
+        slua.Coroutine.WaitFrame(1)
+        t.OnTestAAA:Add(function(str) calls[#calls + 1] = "new" .. str end)
+        local _, free = slua.getDelegateSlots()
+        assert(free == freeBefore - 1, "released proxy should be reused")
+        t:TestCopiedAAA("2")
+        assert(#calls == 0, "copy of old binding should not call function of reused proxy")
+        t:TestAAA("3")
+        assert(#calls == 1 and calls[1] == "new3", "new binding should be called")
+        t.OnTestAAA:Clear()
+        print("delegate removed by handle", free)
+    end)
+end
+
+-- test bindings are released after owner object is destroyed
+if slua.getDelegateSlots then
+    local boundBefore = slua.getDelegateSlots()
+    local t = Test()
+    t.OnTestAAA:Add(function(str) end)
+    assert(slua.getDelegateSlots() == boundBefore + 1, "binding should take a proxy")
+    t = nil
+    collectgarbage("collect")
+
+    slua.Coroutine.Start(function()
+        import("KismetSystemLibrary").CollectGarbage()
+        slua.Coroutine.WaitFrame(2)
+        local bound = slua.getDelegateSlots()
+        assert(bound == boundBefore, "binding of destroyed owner should be released")
+        print("delegate proxy released with owner", bound)
+    end)
+end
@@ -0,0 +1,33 @@
+-- frame costing more than slua.FrameBudgetWarnMs is reported when it's finished
+local budget = slua.getFrameBudget()
+if budget.mode == 0 then
+    print("skip frame budget test, slua.FrameBudget is off")
+    return
+end
+
+local KismetSystemLibrary = import("KismetSystemLibrary")
+local world = slua.getWorld()
+local oldWarnMs = KismetSystemLibrary.GetConsoleVariableFloatValue("slua.FrameBudgetWarnMs")
+KismetSystemLibrary.ExecuteConsoleCommand(world, "slua.FrameBudgetWarnMs 1")
+
+local Coroutine = slua.Coroutine
+Coroutine.Start(function()
+    Coroutine.WaitFrame(1)
+    -- busy inside Latent entry point for 5 ms, over 1 ms budget
+    local overruns = slua.getFrameBudget().overruns
+    local frame = slua.getFrameBudget(true).frame
+    local start = slua.getMicroseconds()
+    while slua.getMicroseconds() - start < 5000 do end
+
+    Coroutine.WaitFrame(1)
+    local last = slua.getFrameBudget()
+    KismetSystemLibrary.ExecuteConsoleCommand(world, "slua.FrameBudgetWarnMs " .. oldWarnMs)
+
+    assert(last.frame == frame, "last frame should be the busy one")
+    assert(last.overrun, "frame over budget should be reported")
+    assert(last.overruns > overruns, "overrun frames should be counted")
+    assert(last.total.ms >= 5 and last.entries.Latent.calls >= 1)
+    -- resumed frame is cheap, it isn't reported when it's finished
+    assert(not slua.getFrameBudget(true).overrun)
+    print("frame budget test passed")
+end)
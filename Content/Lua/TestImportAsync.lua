@@ -0,0 +1,65 @@
+-- importAsync and prefetchImports call back in order of requests and fill import cache
+if not slua.findImported then
+    print("skip import async test")
+    return
+end
+
+local Coroutine = slua.Coroutine
+
+-- loaded type is passed to callback before importAsync returns
+do
+    local path = "/Game/TestActor.TestActor_C"
+    local cls = import(path)
+    local called = false
+    importAsync(path, function(imported)
+        assert(imported == cls, "callback should get imported class")
+        called = true
+    end)
+    assert(called, "callback of loaded class should be called at once")
+    local found, pending = slua.findImported(path)
+    assert(found == cls and not pending, "loaded class should be found")
+end
+
+-- path that isn't an object path is an error, so is callback that isn't a function
+assert(not pcall(importAsync, "NotAnObjectPath", function() end))
+assert(not pcall(importAsync, "/Game/Item.Item_C", 1))
+
+-- callbacks of a path are called in order of requests, then coroutines waiting on it are resumed,
+-- whether its package is loading or loaded already
+local function testOrder(path, prefetch)
+    local order = {}
+    local loaded = slua.findImported(path) ~= nil
+    if prefetch then
+        slua.prefetchImports({ path })
+    end
+    importAsync(path, function(cls)
+        assert(cls, path .. " should be imported")
+        order[#order + 1] = "first"
+    end)
+    importAsync(path, function(cls)
+        assert(cls == slua.findImported(path), "callbacks should get same class")
+        order[#order + 1] = "second"
+    end)
+    assert(#order == (loaded and 2 or 0), "unexpected callbacks before loading " .. table.concat(order, ","))
+    if not loaded then
+        local found, pending = slua.findImported(path)
+        assert(found == nil and pending, path .. " should be loading")
+    end
+
+    Coroutine.Start(function()
+        local cls = importAsync(path)
+        order[#order + 1] = "waiter"
+        local result = table.concat(order, ",")
+        assert(result == "first,second,waiter", "unexpected import order of " .. path .. " " .. result)
+
+        -- completed import is cached and no longer pending
+        local found, pending = slua.findImported(path)
+        assert(found == cls and not pending, path .. " should be cached after loading")
+        assert(import(path) == cls, "import should return cached class")
+        print("importAsync order", path, loaded and "loaded" or "loading", result)
+    end)
+end
+
+testOrder("/Game/Item.Item_C", false)
+-- prefetched path shares its loading with importAsync
+testOrder("/Game/BallActor.BallActor_C", true)
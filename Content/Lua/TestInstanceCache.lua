@@ -0,0 +1,43 @@
+-- values cached by one object stay its own, new objects of the class share accessors only
+local SluaTestCase = import('SluaTestCase')
+
+-- struct and container references are cached per object
+local a = SluaTestCase()
+local b = SluaTestCase()
+a.info.id = 1
+b.info.id = 2
+assert(a.info == a.info)
+assert(a.info ~= b.info)
+assert(a.info.id == 1 and b.info.id == 2)
+a.strs:Add("a")
+assert(a.strs == a.strs)
+assert(a.strs ~= b.strs)
+assert(a.strs:Num() == 1 and b.strs:Num() == 0)
+
+-- an object created after others cached values starts from class accessors
+local c = SluaTestCase()
+assert(c.info ~= a.info and c.info ~= b.info)
+assert(c.info.id == 1001001)
+assert(c.strs:Num() == 0)
+a.info.id = 3
+assert(a.info.id == 3 and b.info.id == 2 and c.info.id == 1001001)
+
+-- lua functions of an overridden object are cached as closures bound to its own self table
+local BenchmarkObject = import('SluaBenchmarkObject')
+local o1 = BenchmarkObject()
+local o2 = BenchmarkObject()
+local o3 = BenchmarkObject()
+o1.Who = function() return "o1" end
+o2.Who = function() return "o2" end
+assert(o1:Who() == "o1")
+assert(o1.Who == o1.Who)
+assert(o2:Who() == "o2")
+assert(o1.Who ~= o2.Who)
+assert(o3.Who == nil)
+assert(o1:Who() == "o1")
+
+-- a later function of another object doesn't see closures cached before it
+o3.Who = function() return "o3" end
+assert(o3:Who() == "o3" and o1:Who() == "o1" and o2:Who() == "o2")
+
+print("instance cache test ok")
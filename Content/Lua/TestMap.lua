@@ -56,6 +56,36 @@ local function test()
 	assert(t.maps:Get("age")=="12")
 	mm:Clear()
 	assert(t.maps:Num()==0)
+
+	-- bulk convert between table and map
+	mm:FromTable({name="bill", age="12"})
+	assert(mm:Num()==2 and mm:Get("age")=="12")
+	local mapTable = mm:ToTable()
+	assert(mapTable.name=="bill")
+	mm:Clear()
+
+	-- keys hashed and compared by their own type
+	local names = slua.Map(EPropertyClass.Name, EPropertyClass.Int)
+	names:Add("a", 1)
+	names:Add("b", 2)
+	assert(names:Get("b")==2 and names:Get("c")==nil)
+	assert(names:Remove("a") and names:Num()==1)
+	local bigs = slua.Map(EPropertyClass.Int64, EPropertyClass.Str)
+	bigs:Add(1 << 40, "big")
+	assert(bigs:Get(1 << 40)=="big" and bigs:Get(1)==nil)
+	local floats = slua.Map(EPropertyClass.Float, EPropertyClass.Int)
+	floats:Add(1.5, 15)
+	assert(floats:Get(1.5)==15 and floats:Get(2.5)==nil)
+	local objects = slua.Map(EPropertyClass.Object, EPropertyClass.Int, Test)
+	local other = Test()
+	objects:Add(t, 1)
+	objects:Add(other, 2)
+	assert(objects:Get(t)==1 and objects:Get(other)==2 and objects:Num()==2)
+	assert(objects:Remove(t) and objects:Get(t)==nil)
+	-- string keys are looked up from lua string without conversion, ignoring case as FString
+	mm:Add("Key", "value")
+	assert(mm:Get("key")=="value" and mm:Get("nokey")==nil)
+	mm:Clear()
 end
 
 local TestMap={}
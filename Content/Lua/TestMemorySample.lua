@@ -0,0 +1,57 @@
+-- memory track in sampling mode, frames are keyed by source of chunk and line
+if not slua_profile or not slua_profile.getMemoryDetail then
+    print("skip memory sample test")
+    return
+end
+
+local chunkSource = [[
+return function(n)
+    local t = {}
+    for i = 1, n do t[i] = i end
+    return t
+end
+]]
+-- long names aren't interned by lua, every load gets its own source string
+local nameA = "=MemorySampleChunkA" .. string.rep("_", 48)
+local nameB = "=MemorySampleChunkB" .. string.rep("_", 48)
+local allocA = load(chunkSource, nameA)()
+local allocB = load(chunkSource, nameB)()
+local allocA2 = load(chunkSource, nameA)()
+
+-- interval 1 samples every allocation
+slua_profile.startMemoryTrack(1)
+local kept = { allocA(1000), allocB(1000), allocA2(1000) }
+local detail = slua_profile.getMemoryDetail()
+
+local keyA = nameA:sub(2) .. ":3"
+local keyB = nameB:sub(2) .. ":3"
+local function find(name)
+    for k, size in pairs(detail) do
+        if k:find(name, 1, true) then return size end
+    end
+    return 0
+end
+local sizeA, sizeB = find(keyA), find(keyB)
+assert(sizeA > 0 and sizeB > 0, "both chunks should have samples at line 3")
+-- same source loaded twice is grouped together, chunk A allocated twice as much as chunk B
+assert(sizeA > sizeB * 1.5, string.format("unexpected sampled sizes %d, %d", sizeA, sizeB))
+
+-- restarting drops samples of this state from total
+local total = slua_profile.getMemoryTotal()
+slua_profile.startMemoryTrack(1)
+assert(slua_profile.getMemoryTotal() <= total - sizeA - sizeB, "total should drop samples of restarted track")
+
+-- stack table is compacted when it grows too large, live samples keep their frames
+local lines = {}
+for i = 1, 20000 do lines[i] = string.format("t[%d] = {}", i) end
+local manyLines = load("local t = ...\n" .. table.concat(lines, "\n"), "=MemorySampleManyLines")
+kept.first = {}
+manyLines(kept.first)
+for _ = 1, 2 do manyLines({}) end
+detail = slua_profile.getMemoryDetail()
+assert(find("MemorySampleManyLines:2") > 0 and find("MemorySampleManyLines:20001") > 0, "live samples should keep frames after compaction")
+
+-- back to full tracking started by TestProfile
+slua_profile.startMemoryTrack()
+assert(#kept == 3)
+print("memory sample test passed")
@@ -0,0 +1,40 @@
+-- modules preloaded by worker threads are taken once by require, a module required before
+-- it's compiled loads source and its late bytecode is dropped, so reloading never gets old code
+if not slua.getPreloadStats then
+    print("skip preload test")
+    return
+end
+
+local Coroutine = slua.Coroutine
+
+Coroutine.Start(function()
+    local function waitCompiled()
+        for _ = 1, 300 do
+            local _, pending = slua.getPreloadStats()
+            if pending == 0 then
+                return
+            end
+            Coroutine.WaitFrame(1)
+        end
+        error("preloading modules should finish")
+    end
+
+    local readyBefore = slua.getPreloadStats()
+    package.loaded["TestModule"] = nil
+    slua.preloadModules({ "TestModule", "NotExistModule" })
+    waitCompiled()
+    assert(slua.getPreloadStats() == readyBefore + 1, "module should be compiled and missing module skipped")
+    local m = require("TestModule")
+    assert(m.foo() == "foo", "preloaded module should work")
+    assert(slua.getPreloadStats() == readyBefore, "required module should be taken")
+
+    package.loaded["Archive.ArchiveModule"] = nil
+    slua.preloadModules({ "Archive.ArchiveModule" })
+    local early = require("Archive.ArchiveModule")
+    waitCompiled()
+    assert(slua.getPreloadStats() == readyBefore, "bytecode of module required while compiling should be dropped")
+    package.loaded["Archive.ArchiveModule"] = nil
+    local reloaded = require("Archive.ArchiveModule")
+    assert(reloaded ~= early and reloaded.source() == early.source(), "reloaded module should load source")
+    print("preload modules test passed")
+end)
@@ -0,0 +1,117 @@
+-- test profiler transport with a local tcp receiver
+-- viewer reads normally at first, then stops reading to simulate a slow viewer,
+-- packages should be dropped instead of blocking game thread, and stream should keep framed.
+local socket = require("socket.core")
+
+local TestProfileTransport = {}
+
+local server
+local client
+local received = 0
+local pending = ""
+local packages = 0
+local drainTarget
+local phase = "throughput"
+local phaseFrames = 0
+local maxFrameCost = 0
+
+local function workload()
+    local function leaf(i) return i * 2 end
+    local sum = 0
+    for i = 1, 20000 do
+        sum = sum + leaf(i)
+    end
+    return sum
+end
+
+local function readAll()
+    while true do
+        local data, err, partial = client:receive(65536)
+        data = data or partial
+        if data and #data > 0 then
+            received = received + #data
+            pending = pending .. data
+        end
+        if err then break end
+    end
+
+    -- every package starts with uint32 size of left bytes
+    local pos = 1
+    while #pending - pos + 1 >= 4 do
+        local size = string.unpack("<I4", pending, pos)
+        if #pending - pos + 1 < size + 4 then break end
+        local event = string.unpack("<i4", pending, pos + 4)
+        assert(event >= -2 and event <= 8, "profiler stream broken, unknown event " .. tostring(event))
+        pos = pos + size + 4
+        packages = packages + 1
+    end
+    pending = string.sub(pending, pos)
+end
+
+function TestProfileTransport.start()
+    if not slua_profile then
+        print("slua_profile not found, skip profiler transport test")
+        return
+    end
+    slua_profile.stopLocalRecord()
+
+    server = assert(socket.tcp())
+    assert(server:bind("127.0.0.1", 0))
+    assert(server:listen(1))
+    local _, port = server:getsockname()
+
+    slua_profile.resetTransportStats()
+    slua_profile.start("127.0.0.1", port)
+    server:settimeout(1)
+    client = assert(server:accept())
+    client:settimeout(0)
+end
+
+function TestProfileTransport.update(tt)
+    if not client then return end
+
+    local start = os.clock()
+    workload()
+    local cost = os.clock() - start
+    maxFrameCost = math.max(maxFrameCost, cost)
+    phaseFrames = phaseFrames + 1
+
+    if phase == "throughput" then
+        readAll()
+        if phaseFrames >= 60 then
+            local stats = slua_profile.getTransportStats()
+            print("[TestProfileTransport] throughput phase, sent", stats.sentBytes, "received", received,
+                "packages", packages, "dropped", stats.droppedPackages)
+            assert(stats.queuedBytes > 0)
+            phase = "slowviewer"
+            phaseFrames = 0
+        end
+    elseif phase == "slowviewer" then
+        -- don't read anything, send thread will be blocked by socket
+        if phaseFrames >= 120 then
+            local stats = slua_profile.getTransportStats()
+            print("[TestProfileTransport] slow viewer phase, dropped", stats.droppedPackages, stats.droppedBytes,
+                "high water", stats.highWaterBytes, "/", stats.capacity, "max frame cost", maxFrameCost)
+            assert(stats.droppedPackages > 0, "slow viewer should cause dropping")
+            phase = "drain"
+            phaseFrames = 0
+        end
+    elseif phase == "drain" then
+        -- bytes reported sent before this frame must all arrive
+        local stats = slua_profile.getTransportStats()
+        drainTarget = drainTarget or stats.sentBytes
+        readAll()
+        if received >= drainTarget then
+            print("[TestProfileTransport] drained, received", received, "packages", packages, "dropped", stats.droppedPackages)
+            slua_profile.stop()
+            client:close()
+            server:close()
+            client = nil
+            phase = "done"
+        else
+            assert(phaseFrames < 600, "profiler transport doesn't drain in time")
+        end
+    end
+end
+
+return TestProfileTransport
@@ -0,0 +1,26 @@
+-- build script archive from script dir, then require module from archive
+-- script dir is found by source of this file, so skip if it's loaded from archive already
+local scriptDir = debug.getinfo(1, "S").source:match("^@(.*)[/\\]TestScriptArchive%.lua$")
+if not scriptDir or not slua.buildScriptArchive then
+    print("skip script archive test")
+    return
+end
+
+local archivePath = scriptDir .. "/../../Saved/TestScriptArchive.slbc"
+assert(slua.buildScriptArchive(scriptDir, archivePath), "all scripts should compile")
+assert(slua.setScriptArchive(archivePath), "archive should open")
+
+-- chunk name is module relative path, source loaded by loader has full path instead
+package.loaded["Archive.ArchiveModule"] = nil
+local m = require("Archive.ArchiveModule")
+assert(m.source() == "@Archive/ArchiveModule.lua", "unexpected chunk name " .. m.source())
+
+-- "a/b" finds same entry as "a.b"
+local same = require("Archive/ArchiveModule")
+assert(same ~= m and same.source() == m.source())
+
+assert(not slua.setScriptArchive(""), "empty path stops using archive")
+package.loaded["Archive.ArchiveModule"] = nil
+local fromSource = require("Archive.ArchiveModule")
+assert(fromSource.source() ~= m.source(), "module should load from source again")
+print("script archive test passed")
@@ -12,4 +12,10 @@ end
 
 for k, v in set:Pairs(true) do
     print("test set iterate reverse:", k, v)
-end
\ No newline at end of file
+end
+
+-- bulk convert between table and set
+set:FromTable({7, 8, 8, 9})
+assert(set:Num()==3)
+local setTable = set:ToTable()
+assert(#setTable==3)
@@ -12,6 +12,30 @@ if string.sub(EngineVersion, 1, 1) == "4" then
     assert(c==d)
 end
 
+-- math structs are stored inside their userdata, copies must stay independent
+local v = FVector(1,2,3)
+local v2 = v:clone()
+v2.X = 10
+assert(v.X == 1 and v2.X == 10)
+for i = 1, 1000 do
+    v2 = FVector(i, i, i)
+end
+collectgarbage("collect")
+assert(v2.X == 1000 and v.Z == 3)
+
+-- in-place operators write to self and return it, no new value is created
+local acc = FVector(0,0,0)
+local step = FVector(1,2,3)
+for i = 1, 10 do
+    assert(acc:AddInPlace(step) == acc)
+end
+acc:SubInPlace(FVector(10,10,10)):MulInPlace(2)
+assert(acc.X == 0 and acc.Y == 20 and acc.Z == 40)
+local p = FIntPoint(1,2)
+p:AddInPlace(FIntPoint(2,2)):MulInPlace(3)
+assert(p.X == 9 and p.Y == 12)
+assert(not pcall(acc.AddInPlace, acc, p))
+
 if FLinkStruct then
     st = FLinkStruct()
     b2d = st.b2d
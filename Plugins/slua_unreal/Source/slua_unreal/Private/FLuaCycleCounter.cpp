@@ -12,69 +12,92 @@
 // Tencent is pleased to support the open source community by making sluaunreal available.
 
 #include "FLuaCycleCounter.h"
+#include "SluaMicro.h"
 
 #if STATS
 #include "Stats/Stats.h"
 DECLARE_STATS_GROUP(TEXT("LuaCounterGroup"), STATGROUP_LuaCouter, STATCAT_Advanced);
 
-static TArray<FCycleCounter*> counterStack;
-static TArray<FString> counterFunction;
+static TArray<FCycleCounter> counterStack;
+static TArray<int32> counterFunction;
+
+// stat id and name of every counter handle, never shrink so handle keep valid
+static TArray<TStatId> counterStatIds;
+static TArray<FString> counterNames;
+static TMap<FString, int32> counterHandles;
 
 bool FLuaCycleCounter::bOpenLog;
 
-void FLuaCycleCounter::counterStart(const FString& CounterName,int Type,int Level)
+int32 FLuaCycleCounter::getCounterHandle(const FString& CounterName)
 {
-    FCycleCounter* counter = new FCycleCounter();
-    static TMap<FString, TStatId> luaFunctionStatIdMap;
-    auto statIdPtr = luaFunctionStatIdMap.Find(CounterName);
-    if (statIdPtr)
-    {
-        counter->Start(*statIdPtr);
-    }
-    else
+    if (int32* handlePtr = counterHandles.Find(CounterName))
     {
-        TStatId statId = FDynamicStats::CreateStatId<FStatGroup_STATGROUP_LuaCouter>(CounterName);
-        counter->Start(statId);
-        luaFunctionStatIdMap.Add(CounterName, statId);
+        return *handlePtr;
     }
-    
-    counterStack.Push(counter);
-    counterFunction.Push(CounterName);
+
+    int32 handle = counterStatIds.Add(FDynamicStats::CreateStatId<FStatGroup_STATGROUP_LuaCouter>(CounterName));
+    counterNames.Add(CounterName);
+    counterHandles.Add(CounterName, handle);
+    return handle;
+}
+
+void FLuaCycleCounter::counterStartByHandle(int32 handle, int Type, int Level)
+{
+    FCycleCounter& counter = counterStack.AddDefaulted_GetRef();
+    counter.Start(counterStatIds[handle]);
+    counterFunction.Push(handle);
 
     if (bOpenLog)
     {
-        UE_LOG(LogTemp, Log, TEXT("[FLuaCycleCounter_Record] FLuaCycleCounterStart CouterName %s, StartType is %d, Level is %d"), *CounterName, Type,Level);
+        UE_LOG(LogTemp, Log, TEXT("[FLuaCycleCounter_Record] FLuaCycleCounterStart CouterName %s, StartType is %d, Level is %d"), *counterNames[handle], Type,Level);
     }
 }
 
-void FLuaCycleCounter::counterStop(int Type, int Level, const FString& CounterName)
+void FLuaCycleCounter::counterStopByHandle(int32 handle, int Type, int Level)
 {
     if (counterStack.Num() > 0)
     {
-        FCycleCounter* counter = counterStack.Pop();
-        FString functionName = counterFunction.Pop();
-        counter->Stop();
+        counterStack.Last().Stop();
+#if UE_5_5_OR_LATER
+        int32 functionHandle = counterFunction.Pop(EAllowShrinking::No);
+        counterStack.Pop(EAllowShrinking::No);
+#else
+        int32 functionHandle = counterFunction.Pop(false);
+        counterStack.Pop(false);
+#endif
 
         if (bOpenLog)
         {
-            UE_LOG(LogTemp, Log, TEXT("[FLuaCycleCounter_Record] counterStop pop CouterName %s. stop CouterName %s. Type is %d, Level is %d,Stack Num is %d"), *functionName, *CounterName, Type, Level, counterStack.Num());
+            const FString& stopName = handle != INDEX_NONE ? counterNames[handle] : FString();
+            UE_LOG(LogTemp, Log, TEXT("[FLuaCycleCounter_Record] counterStop pop CouterName %s. stop CouterName %s. Type is %d, Level is %d,Stack Num is %d"), *counterNames[functionHandle], *stopName, Type, Level, counterStack.Num());
             if (counterStack.Num() == 0)
             {
-                UE_LOG(LogTemp, Log, TEXT("[FLuaCycleCounter_Record] counterStop lastone CouterName %s"), *functionName);
+                UE_LOG(LogTemp, Log, TEXT("[FLuaCycleCounter_Record] counterStop lastone CouterName %s"), *counterNames[functionHandle]);
             }
         }
-        delete counter;
     }
     else
     {
         if (bOpenLog)
         {
-            UE_LOG(LogTemp, Log, TEXT("[FLuaCycleCounter_Record] stop CouterName %s. Type is %d, Level is %d"), *CounterName, Type, Level);
+            const FString& stopName = handle != INDEX_NONE ? counterNames[handle] : FString();
+            UE_LOG(LogTemp, Log, TEXT("[FLuaCycleCounter_Record] stop CouterName %s. Type is %d, Level is %d"), *stopName, Type, Level);
             UE_LOG(LogTemp, Log, TEXT("[FLuaCycleCounter_Record] counterStop overflow "));
         }
     }
 }
 
+void FLuaCycleCounter::counterStart(const FString& CounterName,int Type,int Level)
+{
+    counterStartByHandle(getCounterHandle(CounterName), Type, Level);
+}
+
+void FLuaCycleCounter::counterStop(int Type, int Level, const FString& CounterName)
+{
+    int32* handlePtr = counterHandles.Find(CounterName);
+    counterStopByHandle(handlePtr ? *handlePtr : INDEX_NONE, Type, Level);
+}
+
 void FLuaCycleCounter::clearCounter()
 {
     while (counterStack.Num()>0)
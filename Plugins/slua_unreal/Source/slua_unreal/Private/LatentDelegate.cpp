@@ -15,8 +15,10 @@
 #include "lua.h"
 #include "lstate.h"
 #include "LuaState.h"
+#include "LuaCoroutineScheduler.h"
 
-const FString ULatentDelegate::NAME_LatentCallback = TEXT("OnLatentCallback");
+const FName ULatentDelegate::LatentCallbackName(TEXT("OnLatentCallback"));
+const FString ULatentDelegate::NAME_LatentCallback(TEXT("OnLatentCallback"));
 
 ULatentDelegate::ULatentDelegate(const FObjectInitializer& ObjectInitializer)
     : Super(ObjectInitializer)
@@ -26,7 +28,10 @@ ULatentDelegate::ULatentDelegate(const FObjectInitializer& ObjectInitializer)
 
 void ULatentDelegate::OnLatentCallback(int32 threadRef)
 {
-    luaState->resumeThread(threadRef);
+    if (luaState && luaState->getCoroutineScheduler())
+    {
+        luaState->getCoroutineScheduler()->resume(threadRef);
+    }
 }
 
 void ULatentDelegate::bindLuaState(NS_SLUA::LuaState *_luaState)
@@ -38,10 +43,6 @@ int ULatentDelegate::getThreadRef(NS_SLUA::lua_State *L)
 {
     ensure(L);
 
-    int threadRef = luaState->findThread(L);
-    if (threadRef == LUA_REFNIL)
-    {
-        threadRef = luaState->addThread(L);
-    }
-    return threadRef;
+    // every latent call waits on its own handle, it's passed back by OnLatentCallback
+    return luaState->getCoroutineScheduler()->waitHandle(L);
 }
\ No newline at end of file
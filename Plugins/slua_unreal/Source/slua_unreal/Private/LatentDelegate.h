@@ -27,6 +27,9 @@ UCLASS()
 class SLUA_UNREAL_API ULatentDelegate : public UObject {
     GENERATED_UCLASS_BODY()
 public:
+    // name of OnLatentCallback, set as ExecutionFunction of FLatentActionInfo
+    static const FName LatentCallbackName;
+    // kept for code using it as string, use LatentCallbackName instead
     static const FString NAME_LatentCallback;
 
     UFUNCTION(BlueprintCallable, Category = "Lua|LatentDelegate")
@@ -23,8 +23,45 @@
 #include "LuaState.h"
 #include "LuaReference.h"
 #include "LuaNetSerialization.h"
+#include "LuaContainerConvert.h"
 
 namespace NS_SLUA {
+    namespace {
+        // check [start, start + count) is in array, count default to the rest
+        // check range as lua integer before narrowing, so huge start or count can't wrap into range
+        void checkRange(lua_State* L, int num, int startArg, int& start, int& count) {
+            lua_Integer s = luaL_optinteger(L, startArg, 0);
+            if (s < 0 || s > num) {
+                luaL_error(L, "Array range start %I out of range [0, %d]", s, num);
+            }
+            lua_Integer c = luaL_optinteger(L, startArg + 1, num - s);
+            if (c < 0 || c > num - s) {
+                luaL_error(L, "Array range count %I out of range [0, %d]", c, (int)(num - s));
+            }
+            start = (int)s;
+            count = (int)c;
+        }
+
+        // fill table at outIndex if it's a table, or a new table, stale tail of reused table is cleared
+        int pushRangeTable(lua_State* L, int outIndex, FProperty* prop, const uint8* src, int32 count, int32 stride) {
+            int oldLen = 0;
+            if (lua_istable(L, outIndex)) {
+                lua_pushvalue(L, outIndex);
+                oldLen = (int)lua_rawlen(L, -1);
+            }
+            else {
+                lua_createtable(L, count, 0);
+            }
+
+            LuaContainerConvert::writeTable(L, prop, src, count, stride);
+            for (int i = count + 1; i <= oldLen; i++) {
+                lua_pushnil(L);
+                lua_rawseti(L, -2, i);
+            }
+            return 1;
+        }
+    }
+
     void LuaArray::reg(lua_State* L) {
         SluaUtil::reg(L,"Array",__ctor);
     }
@@ -197,14 +234,14 @@ namespace NS_SLUA {
         return array->Num();
     }
 
-    uint8* LuaArray::add() {
+    uint8* LuaArray::add(int count) {
 #if ENGINE_MAJOR_VERSION==5
-        const int index = array->Add(1, getPropertySize(inner), getPropertyAlignment(inner));
+        const int index = array->Add(count, getPropertySize(inner), getPropertyAlignment(inner));
 #else
-        const int index = array->Add(1, getPropertySize(inner));
+        const int index = array->Add(count, getPropertySize(inner));
 #endif
         
-        constructItems(index, 1);
+        constructItems(index, count);
         return getRawPtr(index);
     }
 
@@ -717,6 +754,100 @@ namespace NS_SLUA {
         return 0;
     }
 
+    int LuaArray::ToTable(lua_State* L) {
+        CheckUD(LuaArray, L, 1);
+        if (!UD) {
+            luaL_error(L, "arg 1 expect LuaArray, but got nil!");
+        }
+        return LuaContainerConvert::pushArray(L, UD->inner, UD->getRawPtr(0), UD->num());
+    }
+
+    int LuaArray::FromTable(lua_State* L) {
+        CheckUD(LuaArray, L, 1);
+        if (!UD) {
+            luaL_error(L, "arg 1 expect LuaArray, but got nil!");
+        }
+        luaL_checktype(L, 2, LUA_TTABLE);
+
+        UD->clear();
+        int count = (int)lua_rawlen(L, 2);
+        if (count > 0) {
+            int num = LuaContainerConvert::readArray(L, 2, UD->inner, UD->add(count), count, true);
+            // drop elements left by holes of table
+            while (UD->num() > num) {
+                UD->remove(UD->num() - 1);
+            }
+        }
+
+        markDirty(UD);
+        return 0;
+    }
+
+    int LuaArray::GetRange(lua_State* L) {
+        CheckUD(LuaArray, L, 1);
+        if (!UD) {
+            luaL_error(L, "arg 1 expect LuaArray, but got nil!");
+        }
+        int start, count;
+        checkRange(L, UD->num(), 2, start, count);
+        return pushRangeTable(L, 4, UD->inner, UD->getRawPtr(start), count, getPropertySize(UD->inner));
+    }
+
+    int LuaArray::SetRange(lua_State* L) {
+        CheckUD(LuaArray, L, 1);
+        if (!UD) {
+            luaL_error(L, "arg 1 expect LuaArray, but got nil!");
+        }
+        lua_Integer start = luaL_checkinteger(L, 2);
+        luaL_checktype(L, 3, LUA_TTABLE);
+        if (start < 0 || start > UD->num()) {
+            luaL_error(L, "Array set range start %I out of range", start);
+        }
+
+        // grow array if table is longer than the rest
+        lua_Integer count = (lua_Integer)lua_rawlen(L, 3);
+        if (start + count > MAX_int32) {
+            luaL_error(L, "Array set range count %I too large", count);
+        }
+        // table index i + 1 is written to start + i, a hole can't be skipped without shifting the rest
+        for (lua_Integer i = 1; i <= count; i++) {
+            int type = lua_rawgeti(L, 3, i);
+            lua_pop(L, 1);
+            if (type == LUA_TNIL) {
+                luaL_error(L, "Array set range table has nil at %I", i);
+            }
+        }
+        int grow = (int)(start + count - UD->num());
+        if (grow > 0) {
+            UD->add(grow);
+        }
+        LuaContainerConvert::readArray(L, 3, UD->inner, UD->getRawPtr((int)start), (int)count, true);
+
+        markDirty(UD);
+        return LuaObject::push(L, UD->num());
+    }
+
+    int LuaArray::Project(lua_State* L) {
+        CheckUD(LuaArray, L, 1);
+        if (!UD) {
+            luaL_error(L, "arg 1 expect LuaArray, but got nil!");
+        }
+        auto structProp = CastField<FStructProperty>(UD->inner);
+        if (!structProp) {
+            luaL_error(L, "Project only support array of struct");
+        }
+        const char* name = luaL_checkstring(L, 2);
+        auto field = LuaObject::findCacheProperty(L, structProp->Struct, name);
+        if (!field) {
+            luaL_error(L, "%s of %s's member not found.", name, TCHAR_TO_UTF8(*structProp->Struct->GetName()));
+        }
+
+        int start, count;
+        checkRange(L, UD->num(), 3, start, count);
+        const uint8* src = count > 0 ? field->ContainerPtrToValuePtr<uint8>(UD->getRawPtr(start)) : nullptr;
+        return pushRangeTable(L, 5, field, src, count, getPropertySize(UD->inner));
+    }
+
     int LuaArray::setupMT(lua_State* L) {
         LuaObject::setupMTSelfSearch(L);
 
@@ -731,6 +862,11 @@ namespace NS_SLUA {
         RegMetaMethod(L,Remove);
         RegMetaMethod(L,Clear);
         RegMetaMethod(L,CreateValueTypeObject);
+        RegMetaMethod(L,ToTable);
+        RegMetaMethod(L,FromTable);
+        RegMetaMethod(L,GetRange);
+        RegMetaMethod(L,SetRange);
+        RegMetaMethod(L,Project);
 
         RegMetaMethodByName(L, "__pairs", Pairs);
 
@@ -0,0 +1,416 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "LuaArrayMath.h"
+#include "LuaObject.h"
+#include "LuaArray.h"
+
+namespace NS_SLUA {
+
+    namespace {
+#if ENGINE_MAJOR_VERSION >= 5
+        typedef FVector::FReal Real;
+        typedef TVectorRegisterType<FVector::FReal> RealRegister;
+#else
+        typedef float Real;
+        typedef VectorRegister RealRegister;
+#endif
+        // FVector and FRotator are both packed 3 reals, share the same kernels
+        static_assert(sizeof(FVector) == sizeof(Real) * 3 && sizeof(FRotator) == sizeof(Real) * 3, "unexpected layout of FVector or FRotator");
+
+        enum class EMathElement : uint8 {
+            Unsupported,
+            Float,
+            Double,
+            Vector,
+            Rotator,
+            Transform,
+        };
+
+        struct MathArray {
+            LuaArray* array;
+            EMathElement type;
+            uint8* data;
+            int32 num;
+        };
+
+        EMathElement getElementType(FProperty* inner) {
+            if (inner->IsA<FFloatProperty>()) return EMathElement::Float;
+            if (inner->IsA<FDoubleProperty>()) return EMathElement::Double;
+            if (auto structProp = CastField<FStructProperty>(inner)) {
+                if (structProp->Struct == TBaseStructure<FVector>::Get()) return EMathElement::Vector;
+                if (structProp->Struct == TBaseStructure<FRotator>::Get()) return EMathElement::Rotator;
+                if (structProp->Struct == TBaseStructure<FTransform>::Get()) return EMathElement::Transform;
+            }
+            return EMathElement::Unsupported;
+        }
+
+        bool testMathArray(lua_State* L, int p, MathArray& out) {
+            if (!LuaObject::matchType(L, p, "LuaArray")) return false;
+            LuaArray* array = LuaObject::checkUD<LuaArray>(L, p);
+            if (!array) return false;
+            out.array = array;
+            out.type = getElementType(array->getInnerProp());
+            if (out.type == EMathElement::Unsupported) {
+                luaL_error(L, "arg %d expect Array of float, double, FVector, FRotator or FTransform", p);
+            }
+            out.data = (uint8*)array->get()->GetData();
+            out.num = array->get()->Num();
+            return true;
+        }
+
+        MathArray checkMathArray(lua_State* L, int p) {
+            MathArray ret;
+            if (!testMathArray(L, p, ret)) {
+                luaL_error(L, "arg %d expect Array", p);
+            }
+            return ret;
+        }
+
+        MathArray checkVectorArray(lua_State* L, int p) {
+            MathArray ret = checkMathArray(L, p);
+            if (ret.type != EMathElement::Vector) {
+                luaL_error(L, "arg %d expect Array of FVector", p);
+            }
+            return ret;
+        }
+
+        template<typename T>
+        T* checkStruct(lua_State* L, int p, const char* name) {
+            T* v = LuaObject::checkUD<T>(L, p);
+            if (!v) luaL_error(L, "arg %d expect %s, but got nil!", p, name);
+            return v;
+        }
+
+        // other of Add/Lerp, srcStride is 0 for single value
+        const uint8* checkOperand(lua_State* L, int p, const MathArray& dst, int32& srcStride, lua_Number& scalar) {
+            MathArray src;
+            if (testMathArray(L, p, src)) {
+                if (src.type != dst.type || src.num != dst.num) {
+                    luaL_error(L, "arg %d expect Array of same type and length", p);
+                }
+                srcStride = 1;
+                return src.data;
+            }
+
+            srcStride = 0;
+            switch (dst.type) {
+            case EMathElement::Float:
+            case EMathElement::Double:
+                scalar = luaL_checknumber(L, p);
+                return nullptr;
+            case EMathElement::Vector:
+                return (const uint8*)checkStruct<FVector>(L, p, "FVector");
+            case EMathElement::Rotator:
+                return (const uint8*)checkStruct<FRotator>(L, p, "FRotator");
+            case EMathElement::Transform:
+                return (const uint8*)checkStruct<FTransform>(L, p, "FTransform");
+            default:
+                return nullptr;
+            }
+        }
+
+        // dst[i] += src[i * srcStride]
+        void addTriples(Real* dst, const Real* src, int32 srcStride, int32 num) {
+            for (int32 i = 0; i < num; i++, dst += 3, src += srcStride * 3) {
+                VectorStoreFloat3(VectorAdd(VectorLoadFloat3_W0(dst), VectorLoadFloat3_W0(src)), dst);
+            }
+        }
+
+        void scaleTriples(Real* dst, Real scale, int32 num) {
+            RealRegister s = VectorSetFloat1(scale);
+            for (int32 i = 0; i < num; i++, dst += 3) {
+                VectorStoreFloat3(VectorMultiply(VectorLoadFloat3_W0(dst), s), dst);
+            }
+        }
+
+        void lerpTriples(Real* dst, const Real* target, int32 targetStride, Real alpha, int32 num) {
+            RealRegister a = VectorSetFloat1(alpha);
+            for (int32 i = 0; i < num; i++, dst += 3, target += targetStride * 3) {
+                RealRegister d = VectorLoadFloat3_W0(dst);
+                VectorStoreFloat3(VectorMultiplyAdd(VectorSubtract(VectorLoadFloat3_W0(target), d), a, d), dst);
+            }
+        }
+
+        void minMaxTriples(const Real* src, int32 num, Real* outMin, Real* outMax) {
+            RealRegister vmin = VectorLoadFloat3_W0(src);
+            RealRegister vmax = vmin;
+            for (int32 i = 1; i < num; i++) {
+                RealRegister v = VectorLoadFloat3_W0(src + i * 3);
+                vmin = VectorMin(vmin, v);
+                vmax = VectorMax(vmax, v);
+            }
+            VectorStoreFloat3(vmin, outMin);
+            VectorStoreFloat3(vmax, outMax);
+        }
+
+        FORCEINLINE Real distSquared(const Real* v, const RealRegister& point) {
+            RealRegister d = VectorSubtract(VectorLoadFloat3_W0(v), point);
+            return VectorGetComponent(VectorDot3(d, d), 0);
+        }
+
+        // plain loops over float/double, compiler vectorizes them
+        template<typename T>
+        void addScalars(T* dst, const T* src, int32 srcStride, T scalar, int32 num) {
+            if (src) {
+                for (int32 i = 0; i < num; i++) dst[i] += src[i * srcStride];
+            }
+            else {
+                for (int32 i = 0; i < num; i++) dst[i] += scalar;
+            }
+        }
+
+        template<typename T>
+        void scaleScalars(T* dst, T scale, int32 num) {
+            for (int32 i = 0; i < num; i++) dst[i] *= scale;
+        }
+
+        template<typename T>
+        void lerpScalars(T* dst, const T* target, int32 targetStride, T scalar, T alpha, int32 num) {
+            for (int32 i = 0; i < num; i++) {
+                T t = target ? target[i * targetStride] : scalar;
+                dst[i] += (t - dst[i]) * alpha;
+            }
+        }
+
+        template<typename T>
+        int pushMinMaxScalars(lua_State* L, const T* src, int32 num) {
+            T vmin = src[0], vmax = src[0];
+            for (int32 i = 1; i < num; i++) {
+                vmin = FMath::Min(vmin, src[i]);
+                vmax = FMath::Max(vmax, src[i]);
+            }
+            lua_pushnumber(L, vmin);
+            lua_pushnumber(L, vmax);
+            return 2;
+        }
+
+        // result table at outIndex if it's a table, or a new table
+        int beginOutTable(lua_State* L, int outIndex, int32 count) {
+            if (lua_istable(L, outIndex)) {
+                lua_pushvalue(L, outIndex);
+                return (int)lua_rawlen(L, -1);
+            }
+            lua_createtable(L, count, 0);
+            return 0;
+        }
+
+        // clear stale tail of reused table
+        int endOutTable(lua_State* L, int32 count, int oldLen) {
+            for (int i = count + 1; i <= oldLen; i++) {
+                lua_pushnil(L);
+                lua_rawseti(L, -2, i);
+            }
+            return 1;
+        }
+    }
+
+    void LuaArrayMath::reg(lua_State* L) {
+        lua_getglobal(L, "slua");
+        lua_newtable(L);
+        RegMetaMethod(L, Add);
+        RegMetaMethod(L, Scale);
+        RegMetaMethod(L, Lerp);
+        RegMetaMethod(L, Dot);
+        RegMetaMethod(L, Distance);
+        RegMetaMethod(L, TransformPoints);
+        RegMetaMethod(L, MinMax);
+        RegMetaMethod(L, SortByDistance);
+        lua_setfield(L, -2, "ArrayMath");
+        lua_pop(L, 1);
+    }
+
+    int LuaArrayMath::Add(lua_State* L) {
+        MathArray dst = checkMathArray(L, 1);
+        int32 srcStride;
+        lua_Number scalar = 0;
+        const uint8* src = checkOperand(L, 2, dst, srcStride, scalar);
+        switch (dst.type) {
+        case EMathElement::Float:
+            addScalars((float*)dst.data, (const float*)src, srcStride, (float)scalar, dst.num);
+            break;
+        case EMathElement::Double:
+            addScalars((double*)dst.data, (const double*)src, srcStride, (double)scalar, dst.num);
+            break;
+        case EMathElement::Vector:
+        case EMathElement::Rotator:
+            addTriples((Real*)dst.data, (const Real*)src, srcStride, dst.num);
+            break;
+        default:
+            luaL_error(L, "Add doesn't support Array of FTransform");
+        }
+        LuaArray::markDirty(dst.array);
+        return 0;
+    }
+
+    int LuaArrayMath::Scale(lua_State* L) {
+        MathArray dst = checkMathArray(L, 1);
+        lua_Number scale = luaL_checknumber(L, 2);
+        switch (dst.type) {
+        case EMathElement::Float:
+            scaleScalars((float*)dst.data, (float)scale, dst.num);
+            break;
+        case EMathElement::Double:
+            scaleScalars((double*)dst.data, (double)scale, dst.num);
+            break;
+        case EMathElement::Vector:
+        case EMathElement::Rotator:
+            scaleTriples((Real*)dst.data, (Real)scale, dst.num);
+            break;
+        default:
+            luaL_error(L, "Scale doesn't support Array of FTransform");
+        }
+        LuaArray::markDirty(dst.array);
+        return 0;
+    }
+
+    int LuaArrayMath::Lerp(lua_State* L) {
+        MathArray dst = checkMathArray(L, 1);
+        int32 srcStride;
+        lua_Number scalar = 0;
+        const uint8* src = checkOperand(L, 2, dst, srcStride, scalar);
+        lua_Number alpha = luaL_checknumber(L, 3);
+        switch (dst.type) {
+        case EMathElement::Float:
+            lerpScalars((float*)dst.data, (const float*)src, srcStride, (float)scalar, (float)alpha, dst.num);
+            break;
+        case EMathElement::Double:
+            lerpScalars((double*)dst.data, (const double*)src, srcStride, (double)scalar, (double)alpha, dst.num);
+            break;
+        case EMathElement::Vector:
+            lerpTriples((Real*)dst.data, (const Real*)src, srcStride, (Real)alpha, dst.num);
+            break;
+        case EMathElement::Rotator: {
+            // take the shortest path like FMath::Lerp of FRotator
+            FRotator* rotators = (FRotator*)dst.data;
+            const FRotator* targets = (const FRotator*)src;
+            for (int32 i = 0; i < dst.num; i++) {
+                rotators[i] = FMath::Lerp(rotators[i], targets[i * srcStride], (float)alpha);
+            }
+            break;
+        }
+        case EMathElement::Transform: {
+            FTransform* transforms = (FTransform*)dst.data;
+            const FTransform* targets = (const FTransform*)src;
+            for (int32 i = 0; i < dst.num; i++) {
+                FTransform from = transforms[i];
+                transforms[i].Blend(from, targets[i * srcStride], (float)alpha);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+        LuaArray::markDirty(dst.array);
+        return 0;
+    }
+
+    int LuaArrayMath::Dot(lua_State* L) {
+        MathArray vectors = checkVectorArray(L, 1);
+        FVector* v = checkStruct<FVector>(L, 2, "FVector");
+        RealRegister dir = VectorLoadFloat3_W0(&v->X);
+        const Real* src = (const Real*)vectors.data;
+
+        int oldLen = beginOutTable(L, 3, vectors.num);
+        for (int32 i = 0; i < vectors.num; i++, src += 3) {
+            lua_pushnumber(L, VectorGetComponent(VectorDot3(VectorLoadFloat3_W0(src), dir), 0));
+            lua_rawseti(L, -2, i + 1);
+        }
+        return endOutTable(L, vectors.num, oldLen);
+    }
+
+    int LuaArrayMath::Distance(lua_State* L) {
+        MathArray vectors = checkVectorArray(L, 1);
+        FVector* point = checkStruct<FVector>(L, 2, "FVector");
+        RealRegister p = VectorLoadFloat3_W0(&point->X);
+        const Real* src = (const Real*)vectors.data;
+
+        int oldLen = beginOutTable(L, 3, vectors.num);
+        for (int32 i = 0; i < vectors.num; i++, src += 3) {
+            lua_pushnumber(L, FMath::Sqrt(distSquared(src, p)));
+            lua_rawseti(L, -2, i + 1);
+        }
+        return endOutTable(L, vectors.num, oldLen);
+    }
+
+    int LuaArrayMath::TransformPoints(lua_State* L) {
+        MathArray vectors = checkVectorArray(L, 1);
+        FTransform* transform = checkStruct<FTransform>(L, 2, "FTransform");
+        bool inverse = !!lua_toboolean(L, 3);
+
+        // FTransform is vectorized, TransformPosition works on its registers
+        FVector* points = (FVector*)vectors.data;
+        if (inverse) {
+            for (int32 i = 0; i < vectors.num; i++) points[i] = transform->InverseTransformPosition(points[i]);
+        }
+        else {
+            for (int32 i = 0; i < vectors.num; i++) points[i] = transform->TransformPosition(points[i]);
+        }
+        LuaArray::markDirty(vectors.array);
+        return 0;
+    }
+
+    int LuaArrayMath::MinMax(lua_State* L) {
+        MathArray src = checkMathArray(L, 1);
+        if (src.num == 0) return 0;
+
+        switch (src.type) {
+        case EMathElement::Float:
+            return pushMinMaxScalars(L, (const float*)src.data, src.num);
+        case EMathElement::Double:
+            return pushMinMaxScalars(L, (const double*)src.data, src.num);
+        case EMathElement::Vector: {
+            FVector vmin, vmax;
+            minMaxTriples((const Real*)src.data, src.num, &vmin.X, &vmax.X);
+            LuaObject::pushInline<FVector>(L, "FVector", vmin);
+            LuaObject::pushInline<FVector>(L, "FVector", vmax);
+            return 2;
+        }
+        case EMathElement::Rotator: {
+            FRotator vmin, vmax;
+            minMaxTriples((const Real*)src.data, src.num, &vmin.Pitch, &vmax.Pitch);
+            LuaObject::pushInline<FRotator>(L, "FRotator", vmin);
+            LuaObject::pushInline<FRotator>(L, "FRotator", vmax);
+            return 2;
+        }
+        default:
+            luaL_error(L, "MinMax doesn't support Array of FTransform");
+            return 0;
+        }
+    }
+
+    int LuaArrayMath::SortByDistance(lua_State* L) {
+        MathArray vectors = checkVectorArray(L, 1);
+        FVector* point = checkStruct<FVector>(L, 2, "FVector");
+        int32 count = (int32)luaL_optinteger(L, 3, vectors.num);
+        count = FMath::Clamp(count, 0, vectors.num);
+
+        RealRegister p = VectorLoadFloat3_W0(&point->X);
+        const Real* src = (const Real*)vectors.data;
+        TArray<TPair<Real, int32>> keys;
+        keys.SetNumUninitialized(vectors.num);
+        for (int32 i = 0; i < vectors.num; i++, src += 3) {
+            keys[i] = TPair<Real, int32>(distSquared(src, p), i);
+        }
+        keys.Sort([](const TPair<Real, int32>& a, const TPair<Real, int32>& b) {
+            return a.Key < b.Key || (a.Key == b.Key && a.Value < b.Value);
+        });
+
+        int oldLen = beginOutTable(L, 4, count);
+        for (int32 i = 0; i < count; i++) {
+            lua_pushinteger(L, keys[i].Value);
+            lua_rawseti(L, -2, i + 1);
+        }
+        return endOutTable(L, count, oldLen);
+    }
+}
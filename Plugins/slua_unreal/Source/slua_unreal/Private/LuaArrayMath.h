@@ -0,0 +1,43 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+#include "lua.h"
+
+namespace NS_SLUA {
+
+    // slua.ArrayMath, math kernels over whole Array of float, double, FVector, FRotator or FTransform,
+    // one call from lua instead of one per element. indexes are 0 based like Array.
+    class LuaArrayMath {
+    public:
+        static void reg(lua_State* L);
+
+    private:
+        // Add(array, other), other is an array of same type and length, a number or a single value
+        static int Add(lua_State* L);
+        // Scale(array, number)
+        static int Scale(lua_State* L);
+        // Lerp(array, target, alpha), target is an array of same type and length or a single value
+        static int Lerp(lua_State* L);
+        // Dot(vectors, vector[, out]) return table of dot products
+        static int Dot(lua_State* L);
+        // Distance(vectors, point[, out]) return table of distances
+        static int Distance(lua_State* L);
+        // TransformPoints(vectors, transform[, inverse]) transform positions in place
+        static int TransformPoints(lua_State* L);
+        // MinMax(array) return component-wise min and max, nothing if empty
+        static int MinMax(lua_State* L);
+        // SortByDistance(vectors, point[, count[, out]]) return indexes of nearest count elements, nearest first
+        static int SortByDistance(lua_State* L);
+    };
+}
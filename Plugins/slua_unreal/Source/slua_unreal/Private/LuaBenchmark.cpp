@@ -0,0 +1,360 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "LuaBenchmark.h"
+#include "LuaState.h"
+#include "LuaObject.h"
+#include "LuaOverrider.h"
+#include "LuaNet.h"
+#include "Log.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+
+namespace NS_SLUA {
+
+    namespace {
+        FString escapeJson(const FString& str)
+        {
+            FString out;
+            out.Reserve(str.Len());
+            for (TCHAR c : str) {
+                if (c == '"' || c == '\\')
+                    out.AppendChar('\\');
+                if (c < 0x20)
+                    continue;
+                out.AppendChar(c);
+            }
+            return out;
+        }
+
+        // nearest rank percentile of sorted samples
+        double percentile(const TArray<double>& sorted, double p)
+        {
+            int32 rank = FMath::CeilToInt(p * sorted.Num());
+            return sorted[FMath::Clamp(rank - 1, 0, sorted.Num() - 1)];
+        }
+
+        bool callRun(lua_State* L, int runIndex, int ctxIndex, int64 iterations, FString& outError)
+        {
+            int errIndex = LuaState::pushErrorHandler(L);
+            lua_pushvalue(L, runIndex);
+            lua_pushvalue(L, ctxIndex);
+            lua_pushinteger(L, iterations);
+            bool bOk = lua_pcall(L, 2, 0, errIndex) == LUA_OK;
+            if (!bOk) {
+                outError = UTF8_TO_TCHAR(lua_tostring(L, -1));
+                lua_pop(L, 1);
+            }
+            lua_pop(L, 1);
+            return bOk;
+        }
+
+        // call setup of case table at index, push context or nil
+        bool callSetup(lua_State* L, int caseIndex, FString& outReason)
+        {
+            int errIndex = LuaState::pushErrorHandler(L);
+            if (lua_getfield(L, caseIndex, "setup") != LUA_TFUNCTION) {
+                lua_pop(L, 2);
+                lua_pushnil(L);
+                return true;
+            }
+
+            if (lua_pcall(L, 0, 2, errIndex) != LUA_OK) {
+                outReason = FString::Printf(TEXT("setup failed: %s"), UTF8_TO_TCHAR(lua_tostring(L, -1)));
+                lua_pop(L, 2);
+                return false;
+            }
+            lua_remove(L, errIndex);
+
+            bool bSkip = lua_isnil(L, -2) && lua_isstring(L, -1);
+            if (bSkip)
+                outReason = UTF8_TO_TCHAR(lua_tostring(L, -1));
+            lua_pop(L, 1);
+            if (bSkip) {
+                lua_pop(L, 1);
+                return false;
+            }
+            return true;
+        }
+
+        void runCase(lua_State* L, int caseIndex, const LuaBenchmark::Options& options, LuaBenchmark::CaseResult& result)
+        {
+            lua_getfield(L, caseIndex, "iterations");
+            result.iterations = FMath::Max<int64>(lua_isinteger(L, -1) ? lua_tointeger(L, -1) : 100000, 1);
+            lua_pop(L, 1);
+
+            if (lua_getfield(L, caseIndex, "run") != LUA_TFUNCTION) {
+                lua_pop(L, 1);
+                result.skipReason = TEXT("no run function");
+                return;
+            }
+            int runIndex = lua_gettop(L);
+
+            if (!callSetup(L, caseIndex, result.skipReason)) {
+                lua_pop(L, 1);
+                return;
+            }
+            int ctxIndex = lua_gettop(L);
+
+            // start every case from a collected heap so garbage of last case isn't collected in this one
+            lua_gc(L, LUA_GCCOLLECT, 0);
+
+            FString error;
+            for (int32 i = 0; i < options.warmupRuns; i++) {
+                if (!callRun(L, runIndex, ctxIndex, result.iterations, error)) {
+                    result.skipReason = FString::Printf(TEXT("run failed: %s"), *error);
+                    lua_pop(L, 2);
+                    return;
+                }
+            }
+
+            TArray<double> samples;
+            samples.Reserve(options.runs);
+            double nsPerCycle = FPlatformTime::GetSecondsPerCycle64() * 1e9;
+            for (int32 i = 0; i < options.runs; i++) {
+                uint64 start = FPlatformTime::Cycles64();
+                bool bOk = callRun(L, runIndex, ctxIndex, result.iterations, error);
+                uint64 cycles = FPlatformTime::Cycles64() - start;
+                if (!bOk) {
+                    result.skipReason = FString::Printf(TEXT("run failed: %s"), *error);
+                    lua_pop(L, 2);
+                    return;
+                }
+                samples.Add(cycles * nsPerCycle / result.iterations);
+            }
+            lua_pop(L, 2);
+
+            if (samples.Num() == 0) {
+                result.skipReason = TEXT("no timed runs");
+                return;
+            }
+
+            samples.Sort();
+            double sum = 0;
+            for (double sample : samples)
+                sum += sample;
+            result.runs = samples.Num();
+            result.minNs = samples[0];
+            result.medianNs = samples.Num() % 2 ? samples[samples.Num() / 2]
+                : (samples[samples.Num() / 2 - 1] + samples[samples.Num() / 2]) * 0.5;
+            result.p99Ns = percentile(samples, 0.99);
+            result.meanNs = sum / samples.Num();
+        }
+    }
+
+    void LuaBenchmark::reg(lua_State* L)
+    {
+#if !UE_BUILD_SHIPPING
+        lua_getglobal(L, "slua");
+        lua_newtable(L);
+        RegMetaMethod(L, PrepareReplication);
+        RegMetaMethod(L, ProcessEvent);
+        lua_setfield(L, -2, "Benchmark");
+        lua_pop(L, 1);
+#endif
+    }
+
+#if !UE_BUILD_SHIPPING
+    // PrepareReplication(obj), compare and serialize lua replicated props of obj as one replication frame does,
+    // every call is a new frame, true if any prop changed since last call
+    int LuaBenchmark::PrepareReplication(lua_State* L)
+    {
+        static uint32 replicationFrame = 0;
+        UObject* obj = LuaObject::checkValue<UObject*>(L, 1);
+        if (!IsValid(obj))
+            luaL_error(L, "PrepareReplication of invalid object");
+
+        lua_pushboolean(L, LuaNet::prepareReplication(obj, ++replicationFrame));
+        return 1;
+    }
+
+    // ProcessEvent(obj, funcName, n), call UFunction of obj n times from c++ with zeroed parameters,
+    // so lua override of it is dispatched by luaOverrideFunc like a call from blueprint or engine
+    int LuaBenchmark::ProcessEvent(lua_State* L)
+    {
+        UObject* obj = LuaObject::checkValue<UObject*>(L, 1);
+        const char* funcName = luaL_checkstring(L, 2);
+        lua_Integer n = luaL_checkinteger(L, 3);
+        if (!IsValid(obj))
+            luaL_error(L, "ProcessEvent of invalid object");
+
+        UFunction* func = obj->FindFunction(FName(UTF8_TO_TCHAR(funcName)));
+        if (!func)
+            luaL_error(L, "Can't find function %s of %s", funcName, TCHAR_TO_UTF8(*obj->GetName()));
+        if (!ULuaOverrider::isUFunctionHooked(func))
+            luaL_error(L, "Function %s of %s isn't overridden by lua", funcName, TCHAR_TO_UTF8(*obj->GetName()));
+
+        uint8* params = func->ParmsSize > 0 ? (uint8*)FMemory_Alloca_Aligned(func->ParmsSize, func->GetMinAlignment()) : nullptr;
+        if (params) {
+            FMemory::Memzero(params, func->ParmsSize);
+            for (TFieldIterator<FProperty> it(func); it && it->HasAnyPropertyFlags(CPF_Parm); ++it)
+                it->InitializeValue_InContainer(params);
+        }
+        for (lua_Integer i = 0; i < n; i++)
+            obj->ProcessEvent(func, params);
+        if (params) {
+            for (TFieldIterator<FProperty> it(func); it && it->HasAnyPropertyFlags(CPF_Parm); ++it)
+                it->DestroyValue_InContainer(params);
+        }
+        return 0;
+    }
+#endif
+
+    bool LuaBenchmark::run(LuaState* state, const Options& options, TArray<CaseResult>& outResults)
+    {
+        lua_State* L = state ? state->getLuaState() : nullptr;
+        if (!L) {
+            UE_LOG(Slua, Error, TEXT("LuaBenchmark: lua state isn't initialized"));
+            return false;
+        }
+
+        reg(L);
+        LuaVar cases = state->requireModule(TCHAR_TO_UTF8(*options.module));
+        if (!cases.isTable()) {
+            UE_LOG(Slua, Error, TEXT("LuaBenchmark: module %s doesn't return a case array"), *options.module);
+            return false;
+        }
+
+        int top = lua_gettop(L);
+        cases.push(L);
+        int casesIndex = lua_gettop(L);
+        int numCases = (int)lua_rawlen(L, casesIndex);
+        for (int i = 1; i <= numCases; i++) {
+            if (lua_rawgeti(L, casesIndex, i) != LUA_TTABLE) {
+                lua_pop(L, 1);
+                continue;
+            }
+            int caseIndex = lua_gettop(L);
+
+            CaseResult result;
+            lua_getfield(L, caseIndex, "name");
+            result.name = lua_isstring(L, -1) ? UTF8_TO_TCHAR(lua_tostring(L, -1)) : FString::Printf(TEXT("case%d"), i);
+            lua_pop(L, 1);
+
+            if (options.filter.IsEmpty() || result.name.Contains(options.filter)) {
+                runCase(L, caseIndex, options, result);
+                if (!result.skipReason.IsEmpty())
+                    UE_LOG(Slua, Display, TEXT("LuaBenchmark: skip %s, %s"), *result.name, *result.skipReason);
+                outResults.Add(MoveTemp(result));
+            }
+            lua_settop(L, casesIndex);
+        }
+        lua_settop(L, top);
+        return true;
+    }
+
+    void LuaBenchmark::print(const TArray<CaseResult>& results)
+    {
+        UE_LOG(Slua, Display, TEXT("%-40s %12s %6s %10s %10s %10s %10s"),
+            TEXT("Case"), TEXT("Iterations"), TEXT("Runs"), TEXT("Min(ns)"), TEXT("Median(ns)"), TEXT("P99(ns)"), TEXT("Mean(ns)"));
+        for (const CaseResult& result : results) {
+            if (!result.skipReason.IsEmpty()) {
+                UE_LOG(Slua, Display, TEXT("%-40s skipped: %s"), *result.name, *result.skipReason);
+                continue;
+            }
+            UE_LOG(Slua, Display, TEXT("%-40s %12lld %6d %10.2f %10.2f %10.2f %10.2f"),
+                *result.name, result.iterations, result.runs, result.minNs, result.medianNs, result.p99Ns, result.meanNs);
+        }
+    }
+
+    bool LuaBenchmark::writeJson(const FString& path, const Options& options, const TArray<CaseResult>& results)
+    {
+        FString text = FString::Printf(TEXT("{\n\"module\":\"%s\",\n\"warmup_runs\":%d,\n\"runs\":%d,\n\"platform\":\"%s\",\n\"cases\":[\n"),
+            *escapeJson(options.module), options.warmupRuns, options.runs, *escapeJson(FPlatformProperties::IniPlatformName()));
+        for (int32 i = 0; i < results.Num(); i++) {
+            const CaseResult& result = results[i];
+            if (result.skipReason.IsEmpty()) {
+                text += FString::Printf(TEXT("{\"name\":\"%s\",\"iterations\":%lld,\"runs\":%d,\"min_ns\":%.3f,\"median_ns\":%.3f,\"p99_ns\":%.3f,\"mean_ns\":%.3f}"),
+                    *escapeJson(result.name), result.iterations, result.runs, result.minNs, result.medianNs, result.p99Ns, result.meanNs);
+            }
+            else {
+                text += FString::Printf(TEXT("{\"name\":\"%s\",\"skipped\":\"%s\"}"), *escapeJson(result.name), *escapeJson(result.skipReason));
+            }
+            text += i + 1 < results.Num() ? TEXT(",\n") : TEXT("\n");
+        }
+        text += TEXT("]\n}\n");
+
+        if (!FFileHelper::SaveStringToFile(text, *path, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM)) {
+            UE_LOG(Slua, Error, TEXT("LuaBenchmark: can't write %s"), *path);
+            return false;
+        }
+        UE_LOG(Slua, Display, TEXT("LuaBenchmark: results written to %s"), *path);
+        return true;
+    }
+
+    bool LuaBenchmark::readBaseline(const FString& path, TMap<FString, double>& outMedians)
+    {
+        TArray<FString> lines;
+        if (!FFileHelper::LoadFileToStringArray(lines, *path)) {
+            UE_LOG(Slua, Error, TEXT("LuaBenchmark: can't read baseline %s"), *path);
+            return false;
+        }
+
+        for (const FString& line : lines) {
+            FString name;
+            double median;
+            if (FParse::Value(*line, TEXT("\"name\":"), name) && FParse::Value(*line, TEXT("\"median_ns\":"), median))
+                outMedians.Add(name, median);
+        }
+        return true;
+    }
+
+    int32 LuaBenchmark::compare(const TArray<CaseResult>& results, const TMap<FString, double>& baseline, double threshold)
+    {
+        int32 numRegressed = 0;
+        for (const CaseResult& result : results) {
+            const double* baseMedian = baseline.Find(result.name);
+            if (!baseMedian || *baseMedian <= 0 || !result.skipReason.IsEmpty())
+                continue;
+
+            double ratio = result.medianNs / *baseMedian;
+            if (ratio > 1 + threshold) {
+                UE_LOG(Slua, Error, TEXT("LuaBenchmark: %s regressed, median %.2fns, baseline %.2fns (+%.1f%%)"),
+                    *result.name, result.medianNs, *baseMedian, (ratio - 1) * 100);
+                numRegressed++;
+            }
+        }
+        return numRegressed;
+    }
+
+#if !UE_BUILD_SHIPPING
+    static void runBenchmark(const TArray<FString>& args)
+    {
+        if (args.Num() < 1) {
+            UE_LOG(Slua, Display, TEXT("usage: slua.RunBenchmark <module> [OutPath] [Runs] [Filter]"));
+            return;
+        }
+
+        LuaBenchmark::Options options;
+        options.module = args[0];
+        if (args.Num() > 2)
+            options.runs = FMath::Max(FCString::Atoi(*args[2]), 1);
+        if (args.Num() > 3)
+            options.filter = args[3];
+
+        TArray<LuaBenchmark::CaseResult> results;
+        if (!LuaBenchmark::run(LuaState::get(), options, results))
+            return;
+        LuaBenchmark::print(results);
+        if (args.Num() > 1)
+            LuaBenchmark::writeJson(args[1], options, results);
+    }
+
+    static FAutoConsoleCommand CVarRunBenchmark(
+        TEXT("slua.RunBenchmark"),
+        TEXT("Run benchmark cases of a lua module in main lua state, slua.RunBenchmark <module> [OutPath] [Runs] [Filter]"),
+        FConsoleCommandWithArgsDelegate::CreateStatic(runBenchmark),
+        ECVF_Default);
+#endif
+}
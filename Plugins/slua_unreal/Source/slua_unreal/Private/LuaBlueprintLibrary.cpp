@@ -20,12 +20,14 @@
 #include "Kismet/KismetArrayLibrary.h"
 #include "Blueprint/BlueprintSupport.h"
 #include "LuaState.h"
+#include "LuaObject.h"
 #include "Internationalization/Internationalization.h"
 #include "Kismet/GameplayStatics.h"
 
 namespace {
     const FName GetVarOutOfBoundsWarning = FName("GetVarOutOfBoundsWarning");    
     const FName GetVarTypeErrorWarning = FName("GetVarTypeErrorWarning");    
+    const FName CallLuaHandleWarning = FName("CallLuaHandleWarning");
 }
 
 #define LOCTEXT_NAMESPACE "ULuaBlueprintLibrary"
@@ -45,31 +47,52 @@ ULuaBlueprintLibrary::ULuaBlueprintLibrary(const FObjectInitializer& ObjectIniti
             LOCTEXT("GetVarTypeErrorWarning", "BpVar is not speicified type")
         )
     );
+    FBlueprintSupport::RegisterBlueprintWarning(
+        FBlueprintWarningDeclaration (
+            CallLuaHandleWarning,
+            LOCTEXT("CallLuaHandleWarning", "Lua function handle is invalid")
+        )
+    );
 
 }
 
-FLuaBPVar ULuaBlueprintLibrary::CallToLuaWithArgs(UObject* WorldContextObject, FString funcname,const TArray<FLuaBPVar>& args,FString StateName) {
-    using namespace NS_SLUA;
-    // get main state
-    auto gameInstance = UGameplayStatics::GetGameInstance(WorldContextObject);
-    if (!gameInstance)
-    {
-        return LuaVar();
+namespace {
+    NS_SLUA::LuaState* findState(UObject* WorldContextObject, const FString& StateName) {
+        using namespace NS_SLUA;
+        // named state doesn't need a game instance
+        if (StateName.Len() != 0) return LuaState::get(StateName);
+
+        // get main state
+        auto gameInstance = UGameplayStatics::GetGameInstance(WorldContextObject);
+        if (!gameInstance)
+        {
+            return nullptr;
+        }
+        return LuaState::get(gameInstance);
     }
-    
-    auto ls = LuaState::get(gameInstance);
-    if (StateName.Len() != 0) ls = LuaState::get(StateName);
-    if (!ls) return FLuaBPVar();
-    LuaVar f = ls->get(TCHAR_TO_UTF8(*funcname));
-    if (!f.isFunction()) {
-        Log::Error("Can't find lua member function named %s to call", TCHAR_TO_UTF8(*funcname));
-        return LuaVar();
+
+    NS_SLUA::LuaVar findFunction(UObject* WorldContextObject, const FString& funcname, const FString& StateName) {
+        using namespace NS_SLUA;
+        auto ls = findState(WorldContextObject, StateName);
+        if (!ls) return LuaVar();
+        LuaVar f = ls->get(TCHAR_TO_UTF8(*funcname));
+        if (!f.isFunction()) {
+            Log::Error("Can't find lua member function named %s to call", TCHAR_TO_UTF8(*funcname));
+            return LuaVar();
+        }
+        return f;
     }
+}
+
+FLuaBPVar ULuaBlueprintLibrary::CallToLuaWithArgs(UObject* WorldContextObject, FString funcname,const TArray<FLuaBPVar>& args,FString StateName) {
+    using namespace NS_SLUA;
+    LuaVar f = findFunction(WorldContextObject, funcname, StateName);
+    if (!f.isFunction()) return FLuaBPVar();
 
     auto fillParam = [&]
     {
         for (auto& arg : args) {
-            arg.value.push(ls->getLuaState());
+            arg.value.push(f.getState());
         }
         return args.Num();
     };
@@ -78,24 +101,20 @@ FLuaBPVar ULuaBlueprintLibrary::CallToLuaWithArgs(UObject* WorldContextObject, F
 
 FLuaBPVar ULuaBlueprintLibrary::CallToLua(UObject* WorldContextObject, FString funcname,FString StateName) {
     using namespace NS_SLUA;
-    // get main state
-    auto gameInstance = UGameplayStatics::GetGameInstance(WorldContextObject);
-    if (!gameInstance)
-    {
-        return LuaVar();
-    }
-    
-    auto ls = LuaState::get(gameInstance);
-    if(StateName.Len()!=0) ls = LuaState::get(StateName);
-    if(!ls) return FLuaBPVar();
-    LuaVar f = ls->get(TCHAR_TO_UTF8(*funcname));
-    if (!f.isFunction()) {
-        Log::Error("Can't find lua member function named %s to call", TCHAR_TO_UTF8(*funcname));
-        return LuaVar();
-    }
+    LuaVar f = findFunction(WorldContextObject, funcname, StateName);
+    if (!f.isFunction()) return FLuaBPVar();
     return f.callWithNArg(nullptr);
 }
 
+FLuaFunctionHandle ULuaBlueprintLibrary::ResolveLuaFunction(UObject* WorldContextObject, FString FunctionName, FString StateName) {
+    FLuaFunctionHandle handle;
+    handle.func = findFunction(WorldContextObject, FunctionName, StateName);
+    return handle;
+}
+
+bool ULuaBlueprintLibrary::IsValidLuaHandle(const FLuaFunctionHandle& Handle) {
+    return Handle.func.isFunction() && Handle.func.isValid();
+}
 
 FLuaBPVar ULuaBlueprintLibrary::CreateVarFromInt(int i) {
     FLuaBPVar v;
@@ -236,6 +255,137 @@ namespace {
 
 
 
+namespace {
+    using namespace NS_SLUA;
+
+    // call function of handle and leave its first result on top of stack, return nullptr if failed
+    lua_State* callHandle(const FLuaFunctionHandle& Handle, const TArray<FLuaBPVar>& Args, int& outTop) {
+        if (!ULuaBlueprintLibrary::IsValidLuaHandle(Handle)) {
+            FFrame::KismetExecutionMessage(TEXT("Attempted to call an invalid lua function handle!"),
+                ELogVerbosity::Warning, CallLuaHandleWarning);
+            return nullptr;
+        }
+        lua_State* L = Handle.func.getState();
+        outTop = lua_gettop(L);
+        int errhandle = LuaState::pushErrorHandler(L);
+        Handle.func.push(L);
+        for (auto& arg : Args) {
+            arg.value.push(L);
+        }
+        {
+#if WITH_EDITOR
+            LuaScriptCallGuard g(L);
+#endif
+            if (lua_pcall(L, Args.Num(), 1, errhandle)) {
+                lua_settop(L, outTop);
+                return nullptr;
+            }
+        }
+        return L;
+    }
+
+    bool readResult(lua_State* L, int& value) {
+        if (lua_isinteger(L, -1)) {
+            value = (int)lua_tointeger(L, -1);
+            return true;
+        }
+        return false;
+    }
+
+    bool readResult(lua_State* L, float& value) {
+        if (lua_type(L, -1) == LUA_TNUMBER) {
+            value = (float)lua_tonumber(L, -1);
+            return true;
+        }
+        return false;
+    }
+
+    bool readResult(lua_State* L, bool& value) {
+        if (lua_isboolean(L, -1)) {
+            value = !!lua_toboolean(L, -1);
+            return true;
+        }
+        return false;
+    }
+
+    bool readResult(lua_State* L, FString& value) {
+        if (lua_type(L, -1) == LUA_TSTRING) {
+            value = UTF8_TO_TCHAR(lua_tostring(L, -1));
+            return true;
+        }
+        return false;
+    }
+
+    bool readResult(lua_State* L, UObject*& value) {
+        if (lua_type(L, -1) == LUA_TUSERDATA && strcmp(LuaObject::getType(L, -1), "UObject") == 0) {
+            UserData<UObject*>* ud = reinterpret_cast<UserData<UObject*>*>(lua_touserdata(L, -1));
+            // don't raise lua error here, we are out of pcall
+            if (!ud || (ud->flag & UD_HADFREE) || !LuaObject::isUObjectValid(ud->ud)) {
+                value = nullptr;
+                return false;
+            }
+            value = ud->ud;
+            return true;
+        }
+        return false;
+    }
+
+    // read result on lua stack directly, no LuaVar is created
+    template<class T>
+    T callHandleTyped(const FLuaFunctionHandle& Handle, const TArray<FLuaBPVar>& Args) {
+        int top;
+        lua_State* L = callHandle(Handle, Args, top);
+        T v = T();
+        if (!L) {
+            return v;
+        }
+        if (!readResult(L, v) && !lua_isnil(L, -1)) {
+            FFrame::KismetExecutionMessage(TEXT("Lua function returned an invalid type!"),
+                ELogVerbosity::Warning, GetVarTypeErrorWarning);
+        }
+        lua_settop(L, top);
+        return v;
+    }
+}
+
+void ULuaBlueprintLibrary::CallLuaHandle(const FLuaFunctionHandle& Handle, const TArray<FLuaBPVar>& Args) {
+    int top;
+    if (lua_State* L = callHandle(Handle, Args, top)) {
+        lua_settop(L, top);
+    }
+}
+
+FLuaBPVar ULuaBlueprintLibrary::CallLuaHandleReturnVar(const FLuaFunctionHandle& Handle, const TArray<FLuaBPVar>& Args) {
+    int top;
+    lua_State* L = callHandle(Handle, Args, top);
+    if (!L) {
+        return FLuaBPVar();
+    }
+    FLuaBPVar ret(LuaVar(L, -1));
+    lua_settop(L, top);
+    return ret;
+}
+
+int ULuaBlueprintLibrary::CallLuaHandleReturnInt(const FLuaFunctionHandle& Handle, const TArray<FLuaBPVar>& Args) {
+    return callHandleTyped<int>(Handle, Args);
+}
+
+float ULuaBlueprintLibrary::CallLuaHandleReturnNumber(const FLuaFunctionHandle& Handle, const TArray<FLuaBPVar>& Args) {
+    return callHandleTyped<float>(Handle, Args);
+}
+
+bool ULuaBlueprintLibrary::CallLuaHandleReturnBool(const FLuaFunctionHandle& Handle, const TArray<FLuaBPVar>& Args) {
+    return callHandleTyped<bool>(Handle, Args);
+}
+
+FString ULuaBlueprintLibrary::CallLuaHandleReturnString(const FLuaFunctionHandle& Handle, const TArray<FLuaBPVar>& Args) {
+    return callHandleTyped<FString>(Handle, Args);
+}
+
+UObject* ULuaBlueprintLibrary::CallLuaHandleReturnObject(const FLuaFunctionHandle& Handle, const TArray<FLuaBPVar>& Args) {
+    return callHandleTyped<UObject*>(Handle, Args);
+}
+
 int ULuaBlueprintLibrary::GetIntFromVar(FLuaBPVar Value,int Index) {
     return getValueFromVar<int>(Value,Index);
 }
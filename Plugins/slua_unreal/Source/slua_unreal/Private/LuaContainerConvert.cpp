@@ -0,0 +1,280 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "LuaContainerConvert.h"
+#include "LuaObject.h"
+#include "LuaContainerKey.h"
+#include "PropertyUtil.h"
+
+namespace NS_SLUA {
+
+    namespace {
+        // nil of table is skipped, following values are packed, return count of values read
+        template<typename T>
+        int32 readIntegers(lua_State* L, int index, uint8* dest, int32 num) {
+            T* values = (T*)dest;
+            int32 n = 0;
+            for (int32 i = 0; i < num; i++) {
+                if (lua_rawgeti(L, index, i + 1) != LUA_TNIL)
+                    values[n++] = (T)luaL_checkinteger(L, -1);
+                lua_pop(L, 1);
+            }
+            return n;
+        }
+
+        template<typename T>
+        int32 readNumbers(lua_State* L, int index, uint8* dest, int32 num) {
+            T* values = (T*)dest;
+            int32 n = 0;
+            for (int32 i = 0; i < num; i++) {
+                if (lua_rawgeti(L, index, i + 1) != LUA_TNIL)
+                    values[n++] = (T)luaL_checknumber(L, -1);
+                lua_pop(L, 1);
+            }
+            return n;
+        }
+
+        int32 readBools(lua_State* L, int index, uint8* dest, int32 num) {
+            bool* values = (bool*)dest;
+            int32 n = 0;
+            for (int32 i = 0; i < num; i++) {
+                if (lua_rawgeti(L, index, i + 1) != LUA_TNIL) {
+                    luaL_checktype(L, -1, LUA_TBOOLEAN);
+                    values[n++] = !!lua_toboolean(L, -1);
+                }
+                lua_pop(L, 1);
+            }
+            return n;
+        }
+
+        int32 readStrings(lua_State* L, int index, uint8* dest, int32 num) {
+            FString* values = (FString*)dest;
+            int32 n = 0;
+            for (int32 i = 0; i < num; i++) {
+                if (lua_rawgeti(L, index, i + 1) != LUA_TNIL)
+                    values[n++] = UTF8_TO_TCHAR(luaL_checkstring(L, -1));
+                lua_pop(L, 1);
+            }
+            return n;
+        }
+
+        int32 readNames(lua_State* L, int index, uint8* dest, int32 num) {
+            FName* values = (FName*)dest;
+            int32 n = 0;
+            for (int32 i = 0; i < num; i++) {
+                if (lua_rawgeti(L, index, i + 1) != LUA_TNIL)
+                    values[n++] = FName(UTF8_TO_TCHAR(luaL_checkstring(L, -1)));
+                lua_pop(L, 1);
+            }
+            return n;
+        }
+
+        template<typename T>
+        void pushIntegers(lua_State* L, const uint8* src, int32 num, int32 stride) {
+            for (int32 i = 0; i < num; i++, src += stride) {
+                lua_pushinteger(L, (lua_Integer)*(const T*)src);
+                lua_rawseti(L, -2, i + 1);
+            }
+        }
+
+        template<typename T>
+        void pushNumbers(lua_State* L, const uint8* src, int32 num, int32 stride) {
+            for (int32 i = 0; i < num; i++, src += stride) {
+                lua_pushnumber(L, (lua_Number)*(const T*)src);
+                lua_rawseti(L, -2, i + 1);
+            }
+        }
+
+        void pushBools(lua_State* L, const uint8* src, int32 num, int32 stride) {
+            for (int32 i = 0; i < num; i++, src += stride) {
+                lua_pushboolean(L, *(const bool*)src);
+                lua_rawseti(L, -2, i + 1);
+            }
+        }
+
+        void pushStrings(lua_State* L, const uint8* src, int32 num, int32 stride) {
+            for (int32 i = 0; i < num; i++, src += stride) {
+                lua_pushstring(L, TCHAR_TO_UTF8(**(const FString*)src));
+                lua_rawseti(L, -2, i + 1);
+            }
+        }
+
+        void pushNames(lua_State* L, const uint8* src, int32 num, int32 stride) {
+            // reuse one buffer for all names
+            FString str;
+            for (int32 i = 0; i < num; i++, src += stride) {
+                ((const FName*)src)->ToString(str);
+                lua_pushstring(L, TCHAR_TO_UTF8(*str));
+                lua_rawseti(L, -2, i + 1);
+            }
+        }
+
+        bool isNativeBool(FProperty* prop) {
+            auto p = CastField<FBoolProperty>(prop);
+            return p && p->IsNativeBool();
+        }
+    }
+
+#define BULK_READ_CASE(PropType, Func) \
+    if (cls == PropType::StaticClass()) { return Func; }
+
+    int32 LuaContainerConvert::readArray(lua_State* L, int index, FProperty* inner, uint8* dest, int32 num, bool bForceCopy) {
+        index = lua_absindex(L, index);
+        auto cls = inner->GetClass();
+        BULK_READ_CASE(FIntProperty, readIntegers<int32>(L, index, dest, num));
+        BULK_READ_CASE(FInt64Property, readIntegers<int64>(L, index, dest, num));
+        BULK_READ_CASE(FUInt32Property, readIntegers<uint32>(L, index, dest, num));
+        BULK_READ_CASE(FUInt64Property, readIntegers<uint64>(L, index, dest, num));
+        BULK_READ_CASE(FInt16Property, readIntegers<int16>(L, index, dest, num));
+        BULK_READ_CASE(FUInt16Property, readIntegers<uint16>(L, index, dest, num));
+        BULK_READ_CASE(FInt8Property, readIntegers<int8>(L, index, dest, num));
+        BULK_READ_CASE(FByteProperty, readIntegers<uint8>(L, index, dest, num));
+        BULK_READ_CASE(FFloatProperty, readNumbers<float>(L, index, dest, num));
+        BULK_READ_CASE(FDoubleProperty, readNumbers<double>(L, index, dest, num));
+        BULK_READ_CASE(FStrProperty, readStrings(L, index, dest, num));
+        BULK_READ_CASE(FNameProperty, readNames(L, index, dest, num));
+#undef BULK_READ_CASE
+        if (isNativeBool(inner)) {
+            return readBools(L, index, dest, num);
+        }
+
+        // struct and others, checker is resolved once
+        auto checker = LuaObject::getChecker(inner);
+        if (!checker) {
+            luaL_error(L, "unsupport type %s to convert from table", TCHAR_TO_UTF8(*inner->GetClass()->GetName()));
+            return 0;
+        }
+        int32 elementSize = getPropertySize(inner);
+        int32 n = 0;
+        for (int32 i = 0; i < num; i++) {
+            if (lua_rawgeti(L, index, i + 1) != LUA_TNIL) {
+                checker(L, inner, dest, -1, bForceCopy);
+                dest += elementSize;
+                n++;
+            }
+            lua_pop(L, 1);
+        }
+        return n;
+    }
+
+#define BULK_CASE(PropType, Func) \
+    if (cls == PropType::StaticClass()) { Func; return; }
+
+    int LuaContainerConvert::pushArray(lua_State* L, FProperty* inner, const uint8* src, int32 num) {
+        lua_createtable(L, num, 0);
+        writeTable(L, inner, src, num, getPropertySize(inner));
+        return 1;
+    }
+
+    void LuaContainerConvert::writeTable(lua_State* L, FProperty* prop, const uint8* src, int32 num, int32 stride) {
+        auto cls = prop->GetClass();
+        BULK_CASE(FIntProperty, pushIntegers<int32>(L, src, num, stride));
+        BULK_CASE(FInt64Property, pushIntegers<int64>(L, src, num, stride));
+        BULK_CASE(FUInt32Property, pushIntegers<uint32>(L, src, num, stride));
+        BULK_CASE(FUInt64Property, pushIntegers<uint64>(L, src, num, stride));
+        BULK_CASE(FInt16Property, pushIntegers<int16>(L, src, num, stride));
+        BULK_CASE(FUInt16Property, pushIntegers<uint16>(L, src, num, stride));
+        BULK_CASE(FInt8Property, pushIntegers<int8>(L, src, num, stride));
+        BULK_CASE(FByteProperty, pushIntegers<uint8>(L, src, num, stride));
+        BULK_CASE(FFloatProperty, pushNumbers<float>(L, src, num, stride));
+        BULK_CASE(FDoubleProperty, pushNumbers<double>(L, src, num, stride));
+        BULK_CASE(FStrProperty, pushStrings(L, src, num, stride));
+        BULK_CASE(FNameProperty, pushNames(L, src, num, stride));
+        if (isNativeBool(prop)) {
+            pushBools(L, src, num, stride);
+            return;
+        }
+#undef BULK_CASE
+
+        auto pusher = LuaObject::getPusher(prop);
+        if (!pusher) {
+            luaL_error(L, "unsupport type %s to convert to table", TCHAR_TO_UTF8(*prop->GetClass()->GetName()));
+            return;
+        }
+        for (int32 i = 0; i < num; i++, src += stride) {
+            pusher(L, prop, (uint8*)src, 0, nullptr);
+            lua_rawseti(L, -2, i + 1);
+        }
+    }
+
+    void LuaContainerConvert::readMap(lua_State* L, int index, FProperty* keyProp, FProperty* valueProp, FScriptMapHelper& helper) {
+        index = lua_absindex(L, index);
+        auto keyChecker = LuaObject::getChecker(keyProp);
+        auto valueChecker = LuaObject::getChecker(valueProp);
+        if (!keyChecker || !valueChecker) {
+            luaL_error(L, "unsupport map type to convert from table");
+            return;
+        }
+
+        lua_pushnil(L);
+        while (lua_next(L, index) != 0) {
+            LuaContainerKey tempKey(L, keyProp, keyChecker, -2, false);
+            LuaContainerKey tempValue(L, valueProp, valueChecker, -1, false);
+            helper.AddPair(tempKey.getObjAddress(), tempValue.getObjAddress());
+            lua_pop(L, 1);
+        }
+    }
+
+    int LuaContainerConvert::pushMap(lua_State* L, FProperty* keyProp, FProperty* valueProp, FScriptMapHelper& helper) {
+        auto keyPusher = LuaObject::getPusher(keyProp);
+        auto valuePusher = LuaObject::getPusher(valueProp);
+        if (!keyPusher || !valuePusher) {
+            luaL_error(L, "unsupport map type to convert to table");
+            return 0;
+        }
+
+        lua_createtable(L, 0, helper.Num());
+        for (int32 i = 0, maxIndex = helper.GetMaxIndex(); i < maxIndex; i++) {
+            if (!helper.IsValidIndex(i))
+                continue;
+            keyPusher(L, keyProp, helper.GetKeyPtr(i), 0, nullptr);
+            valuePusher(L, valueProp, helper.GetValuePtr(i), 0, nullptr);
+            lua_rawset(L, -3);
+        }
+        return 1;
+    }
+
+    void LuaContainerConvert::readSet(lua_State* L, int index, FProperty* elementProp, FScriptSetHelper& helper) {
+        index = lua_absindex(L, index);
+        auto checker = LuaObject::getChecker(elementProp);
+        if (!checker) {
+            luaL_error(L, "unsupport set type to convert from table");
+            return;
+        }
+
+        lua_pushnil(L);
+        while (lua_next(L, index) != 0) {
+            LuaContainerKey tempElement(L, elementProp, checker, -1, false);
+            helper.AddElement(tempElement.getObjAddress());
+            lua_pop(L, 1);
+        }
+    }
+
+    int LuaContainerConvert::pushSet(lua_State* L, FProperty* elementProp, FScriptSetHelper& helper) {
+        auto pusher = LuaObject::getPusher(elementProp);
+        if (!pusher) {
+            luaL_error(L, "unsupport set type to convert to table");
+            return 0;
+        }
+
+        lua_createtable(L, helper.Num(), 0);
+        int n = 0;
+        for (int32 i = 0, maxIndex = helper.GetMaxIndex(); i < maxIndex; i++) {
+            if (!helper.IsValidIndex(i))
+                continue;
+            pusher(L, elementProp, helper.GetElementPtr(i), 0, nullptr);
+            lua_rawseti(L, -2, ++n);
+        }
+        return 1;
+    }
+}
@@ -0,0 +1,41 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "lua.h"
+
+namespace NS_SLUA {
+
+    // bulk conversion between lua table and TArray/TMap/TSet,
+    // numeric, bool, FString and FName elements use typed loops instead of per element checker/pusher
+    namespace LuaContainerConvert {
+        // fill constructed elements at dest from non-nil values of table[1..num] in order,
+        // return count of elements filled, it's less than num if table has holes
+        int32 readArray(lua_State* L, int index, FProperty* inner, uint8* dest, int32 num, bool bForceCopy);
+        // push num elements at src as a new sequence table
+        int pushArray(lua_State* L, FProperty* inner, const uint8* src, int32 num);
+        // set table on top of stack [1..num] from values of prop at src, src + stride...
+        void writeTable(lua_State* L, FProperty* prop, const uint8* src, int32 num, int32 stride);
+
+        // add all pairs of table into map, keys and values are always copied since they're read into temporaries
+        void readMap(lua_State* L, int index, FProperty* keyProp, FProperty* valueProp, FScriptMapHelper& helper);
+        // push map as a new key-value table
+        int pushMap(lua_State* L, FProperty* keyProp, FProperty* valueProp, FScriptMapHelper& helper);
+
+        // add all values of table into set, values are always copied
+        void readSet(lua_State* L, int index, FProperty* elementProp, FScriptSetHelper& helper);
+        // push set as a new sequence table
+        int pushSet(lua_State* L, FProperty* elementProp, FScriptSetHelper& helper);
+    }
+}
@@ -0,0 +1,138 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "LuaContainerKey.h"
+
+namespace NS_SLUA {
+
+    namespace {
+        // same hash and compare as TMap/TSet of T
+        template<typename T>
+        struct TKeyOps {
+            static uint32 hash(const void* key) { return GetTypeHash(*(const T*)key); }
+            static bool equals(const void* key, const void* element) { return *(const T*)key == *(const T*)element; }
+        };
+
+        template<typename PropertyType, typename T>
+        bool getKeyOps(FProperty* prop, uint32 (*&hashFunc)(const void*), bool (*&equalsFunc)(const void*, const void*)) {
+            if (!prop->IsA<PropertyType>())
+                return false;
+            hashFunc = &TKeyOps<T>::hash;
+            equalsFunc = &TKeyOps<T>::equals;
+            return true;
+        }
+    }
+
+    LuaContainerKey::LuaContainerKey(lua_State* L, FProperty* inProp, LuaObject::CheckPropertyFunction checker, int p, bool bLookupOnly)
+        : prop(inProp)
+        , hashFunc(nullptr)
+        , equalsFunc(nullptr)
+        , ptr(nullptr)
+        , str(nullptr)
+    {
+        // enum is hashed and compared as its underlying integer
+        FProperty* keyProp = prop;
+        if (auto enumProp = CastField<FEnumProperty>(keyProp))
+            keyProp = enumProp->GetUnderlyingProperty();
+        bool bTypedKey = getKeyOps<FIntProperty, int32>(keyProp, hashFunc, equalsFunc)
+            || getKeyOps<FInt64Property, int64>(keyProp, hashFunc, equalsFunc)
+            || getKeyOps<FByteProperty, uint8>(keyProp, hashFunc, equalsFunc)
+            || getKeyOps<FInt8Property, int8>(keyProp, hashFunc, equalsFunc)
+            || getKeyOps<FInt16Property, int16>(keyProp, hashFunc, equalsFunc)
+            || getKeyOps<FUInt16Property, uint16>(keyProp, hashFunc, equalsFunc)
+            || getKeyOps<FUInt32Property, uint32>(keyProp, hashFunc, equalsFunc)
+            || getKeyOps<FUInt64Property, uint64>(keyProp, hashFunc, equalsFunc)
+            || getKeyOps<FFloatProperty, float>(keyProp, hashFunc, equalsFunc)
+            || getKeyOps<FDoubleProperty, double>(keyProp, hashFunc, equalsFunc)
+            || getKeyOps<FNameProperty, FName>(keyProp, hashFunc, equalsFunc);
+        if (!bTypedKey && keyProp->IsA<FObjectProperty>()) {
+            // hash of object pointer differs between engine versions, leave it to prop
+            equalsFunc = &TKeyOps<UObject*>::equals;
+        }
+
+        if (bLookupOnly && prop->IsA<FStrProperty>() && lua_type(L, p) == LUA_TSTRING) {
+            // same conversion as FString checker, but no FString allocated
+            strConv.Emplace(lua_tostring(L, p));
+            str = strConv->Get();
+            return;
+        }
+
+        if (prop->ElementSize <= InlineSize && prop->GetMinAlignment() <= 16) {
+            ptr = inlineBuffer;
+        }
+        else {
+            ptr = FMemory::Malloc(prop->ElementSize, prop->GetMinAlignment());
+        }
+        prop->InitializeValue(ptr);
+        checker(L, prop, (uint8*)ptr, p, true);
+    }
+
+    LuaContainerKey::~LuaContainerKey()
+    {
+        if (!ptr)
+            return;
+
+        if (!(prop->PropertyFlags & (CPF_IsPlainOldData | CPF_NoDestructor))) {
+            prop->DestroyValue(ptr);
+        }
+        if (ptr != inlineBuffer) {
+            FMemory::Free(ptr);
+        }
+    }
+
+    void* LuaContainerKey::getObjAddress() const
+    {
+        check(ptr);
+        return ptr;
+    }
+
+    uint32 LuaContainerKey::hash() const
+    {
+        if (str) {
+            // GetTypeHash(FString)
+            return FCrc::Strihash_DEPRECATED(str);
+        }
+        if (hashFunc) {
+            return hashFunc(ptr);
+        }
+        return prop->GetValueTypeHash(ptr);
+    }
+
+    bool LuaContainerKey::equals(const void* element) const
+    {
+        if (str) {
+            // FString compare ignore case
+            return FCString::Stricmp(**(const FString*)element, str) == 0;
+        }
+        if (equalsFunc) {
+            return equalsFunc(ptr, element);
+        }
+        return prop->Identical(ptr, element);
+    }
+
+    uint8* LuaContainerKey::findMapValue(FScriptMap* map, const FScriptMapLayout& layout) const
+    {
+        return map->FindValue(this, layout,
+            [this](const void*) { return hash(); },
+            [this](const void*, const void* elementKey) { return equals(elementKey); }
+        );
+    }
+
+    int32 LuaContainerKey::findSetIndex(FScriptSet* set, const FScriptSetLayout& layout) const
+    {
+        return set->FindIndex(this, layout,
+            [this](const void*) { return hash(); },
+            [this](const void*, const void* element) { return equals(element); }
+        );
+    }
+}
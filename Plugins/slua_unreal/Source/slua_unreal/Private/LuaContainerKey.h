@@ -0,0 +1,60 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "LuaObject.h"
+
+namespace NS_SLUA {
+
+    // key of TMap/TSet read from lua without heap allocation.
+    // small keys(integer, enum, FName, object, small struct) are converted into a stack buffer,
+    // FString keys used for lookup are hashed and compared from the lua string directly.
+    // numeric, enum and FName keys are hashed and compared by their type instead of FProperty,
+    // object keys are compared by pointer.
+    class LuaContainerKey
+    {
+    public:
+        static const int32 InlineSize = 64;
+
+        // bLookupOnly allows FString key not to be materialized, getObjAddress can't be used then
+        LuaContainerKey(lua_State* L, FProperty* inProp, LuaObject::CheckPropertyFunction checker, int p, bool bLookupOnly = true);
+        ~LuaContainerKey();
+
+        LuaContainerKey(const LuaContainerKey&) = delete;
+        LuaContainerKey& operator=(const LuaContainerKey&) = delete;
+
+        void* getObjAddress() const;
+
+        // value address of key in map, nullptr if not found
+        uint8* findMapValue(FScriptMap* map, const FScriptMapLayout& layout) const;
+        // element index in set, INDEX_NONE if not found
+        int32 findSetIndex(FScriptSet* set, const FScriptSetLayout& layout) const;
+
+    private:
+        uint32 hash() const;
+        bool equals(const void* element) const;
+
+        typedef uint32 (*HashFunction)(const void* key);
+        typedef bool (*EqualsFunction)(const void* key, const void* element);
+
+        FProperty* prop;
+        // null if key is hashed or compared by prop
+        HashFunction hashFunc;
+        EqualsFunction equalsFunc;
+        void* ptr;
+        const TCHAR* str;
+        TOptional<FUTF8ToTCHAR> strConv;
+        alignas(16) uint8 inlineBuffer[InlineSize];
+    };
+}
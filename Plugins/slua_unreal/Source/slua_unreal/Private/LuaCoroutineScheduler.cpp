@@ -0,0 +1,529 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "LuaCoroutineScheduler.h"
+#include "LuaState.h"
+#include "LuaObject.h"
+#include "LuaFrameBudget.h"
+#include "Log.h"
+#include "Misc/PackageName.h"
+#include "UObject/UObjectGlobals.h"
+#include "HAL/IConsoleManager.h"
+
+namespace NS_SLUA {
+
+    namespace {
+        // handle is serial << WaiterIndexBits | index, always positive
+        const int32 WaiterIndexBits = 20;
+        const int32 MaxWaiters = 1 << WaiterIndexBits;
+        const uint16 MaxSerial = (1 << 11) - 1;
+
+        FORCEINLINE int32 makeHandle(int32 index, uint16 serial) {
+            return ((int32)serial << WaiterIndexBits) | index;
+        }
+    }
+
+    static int32 CoroutinePoolSize = 1024;
+    FAutoConsoleVariableRef CVarSluaCoroutinePoolSize(
+        TEXT("slua.CoroutinePoolSize"),
+        CoroutinePoolSize,
+        TEXT("Max finished coroutine threads kept for reuse by slua.Coroutine.Start.\n"),
+        ECVF_Default);
+
+    void LuaCoroutineScheduler::WaitHeap::place(TArray<Waiter>& waiters, int32 pos, int32 index)
+    {
+        items[pos] = index;
+        waiters[index].heapIndex = pos;
+    }
+
+    void LuaCoroutineScheduler::WaitHeap::siftUp(TArray<Waiter>& waiters, int32 pos)
+    {
+        int32 index = items[pos];
+        double key = waiters[index].wakeAt;
+        while (pos > 0) {
+            int32 parent = (pos - 1) / 2;
+            if (waiters[items[parent]].wakeAt <= key)
+                break;
+            place(waiters, pos, items[parent]);
+            pos = parent;
+        }
+        place(waiters, pos, index);
+    }
+
+    void LuaCoroutineScheduler::WaitHeap::siftDown(TArray<Waiter>& waiters, int32 pos)
+    {
+        int32 num = items.Num();
+        int32 index = items[pos];
+        double key = waiters[index].wakeAt;
+        for (;;) {
+            int32 child = pos * 2 + 1;
+            if (child >= num)
+                break;
+            if (child + 1 < num && waiters[items[child + 1]].wakeAt < waiters[items[child]].wakeAt)
+                child++;
+            if (waiters[items[child]].wakeAt >= key)
+                break;
+            place(waiters, pos, items[child]);
+            pos = child;
+        }
+        place(waiters, pos, index);
+    }
+
+    void LuaCoroutineScheduler::WaitHeap::push(TArray<Waiter>& waiters, int32 index)
+    {
+        int32 pos = items.Add(index);
+        waiters[index].heapIndex = pos;
+        siftUp(waiters, pos);
+    }
+
+    void LuaCoroutineScheduler::WaitHeap::remove(TArray<Waiter>& waiters, int32 index)
+    {
+        int32 pos = waiters[index].heapIndex;
+#if UE_5_5_OR_LATER
+        int32 last = items.Pop(EAllowShrinking::No);
+#else
+        int32 last = items.Pop(false);
+#endif
+        waiters[index].heapIndex = INDEX_NONE;
+        waiters[index].heap = EWaitHeap::None;
+        if (pos < items.Num()) {
+            // fill the hole with last item, it may go either way
+            place(waiters, pos, last);
+            siftUp(waiters, pos);
+            siftDown(waiters, waiters[last].heapIndex);
+        }
+    }
+
+    void LuaCoroutineScheduler::WaitHeap::popDue(TArray<Waiter>& waiters, double now, TArray<int32>& out)
+    {
+        while (items.Num() > 0 && waiters[items[0]].wakeAt <= now) {
+            int32 index = items[0];
+            remove(waiters, index);
+            out.Add(makeHandle(index, waiters[index].serial));
+        }
+    }
+
+    LuaCoroutineScheduler::LuaCoroutineScheduler(LuaState* inState)
+        : state(inState)
+        , L(inState->getLuaState())
+        , freeWaiterHead(INDEX_NONE)
+        , numWaiters(0)
+        , frame(0)
+        , time(0)
+    {
+    }
+
+    LuaCoroutineScheduler::~LuaCoroutineScheduler()
+    {
+        // registry refs and delegate bindings are released by lua_close
+    }
+
+    void LuaCoroutineScheduler::reg(lua_State* L)
+    {
+        lua_getglobal(L, "slua");
+        lua_newtable(L);
+        RegMetaMethod(L, Start);
+        RegMetaMethod(L, Cancel);
+        RegMetaMethod(L, IsWaiting);
+        RegMetaMethod(L, WaitFrame);
+        RegMetaMethod(L, WaitSeconds);
+        RegMetaMethod(L, WaitDelegate);
+        RegMetaMethod(L, WaitAsyncLoad);
+        lua_setfield(L, -2, "Coroutine");
+        lua_pop(L, 1);
+    }
+
+    LuaCoroutineScheduler* LuaCoroutineScheduler::get(lua_State* L)
+    {
+        LuaState* ls = LuaState::get(L);
+        LuaCoroutineScheduler* scheduler = ls ? ls->getCoroutineScheduler() : nullptr;
+        if (!scheduler)
+            luaL_error(L, "Coroutine scheduler is closed");
+        return scheduler;
+    }
+
+    LuaCoroutineScheduler::WaitHeap& LuaCoroutineScheduler::getHeap(EWaitHeap heap)
+    {
+        return heap == EWaitHeap::Frame ? frameHeap : timeHeap;
+    }
+
+    int32 LuaCoroutineScheduler::addWaiter(lua_State* thread)
+    {
+        if (lua_pushthread(thread) == 1) {
+            lua_pop(thread, 1);
+            luaL_error(thread, "Can't wait in main lua thread!");
+        }
+
+        int32 index = freeWaiterHead;
+        if (index != INDEX_NONE) {
+            freeWaiterHead = waiters[index].nextFree;
+        }
+        else {
+            if (waiters.Num() >= MaxWaiters) {
+                lua_pop(thread, 1);
+                luaL_error(thread, "Too many waiting coroutines!");
+            }
+            index = waiters.AddDefaulted();
+        }
+
+        Waiter& waiter = waiters[index];
+        waiter.thread = thread;
+        waiter.nextFree = INDEX_NONE;
+        if (PooledThread* pooled = runningThreads.Find(thread)) {
+            pooled->numWaits++;
+            waiter.threadRef = LUA_NOREF;
+            lua_pop(thread, 1);
+        }
+        else {
+            // keep coroutine alive until it's resumed
+            waiter.threadRef = state->refRegistry(thread);
+        }
+        numWaiters++;
+        return makeHandle(index, waiter.serial);
+    }
+
+    void LuaCoroutineScheduler::freeWaiter(int32 index)
+    {
+        Waiter& waiter = waiters[index];
+        waiter.thread = nullptr;
+        waiter.threadRef = LUA_NOREF;
+        waiter.delegateRef = LUA_NOREF;
+        waiter.delegateHandle = 0;
+        waiter.serial = waiter.serial == MaxSerial ? 1 : waiter.serial + 1;
+        waiter.nextFree = freeWaiterHead;
+        freeWaiterHead = index;
+        numWaiters--;
+    }
+
+    LuaCoroutineScheduler::Waiter* LuaCoroutineScheduler::findWaiter(int32 handle, int32& outIndex)
+    {
+        if (handle <= 0)
+            return nullptr;
+        outIndex = handle & (MaxWaiters - 1);
+        if (outIndex >= waiters.Num())
+            return nullptr;
+        Waiter& waiter = waiters[outIndex];
+        if (!waiter.thread || waiter.serial != (uint16)(handle >> WaiterIndexBits))
+            return nullptr;
+        return &waiter;
+    }
+
+    int32 LuaCoroutineScheduler::waitHandle(lua_State* thread)
+    {
+        return addWaiter(thread);
+    }
+
+    int32 LuaCoroutineScheduler::findHandle(lua_State* thread) const
+    {
+        for (int32 i = 0; i < waiters.Num(); i++) {
+            if (waiters[i].thread == thread)
+                return makeHandle(i, waiters[i].serial);
+        }
+        return 0;
+    }
+
+    bool LuaCoroutineScheduler::cancel(lua_State* thread)
+    {
+        bool bCancelled = false;
+        for (int32 i = 0; i < waiters.Num(); i++) {
+            Waiter& waiter = waiters[i];
+            if (waiter.thread != thread)
+                continue;
+
+            int threadRef = waiter.threadRef;
+            if (waiter.heap != EWaitHeap::None)
+                getHeap(waiter.heap).remove(waiters, i);
+            if (waiter.delegateRef != LUA_NOREF)
+                firedDelegates.Emplace(waiter.delegateRef, waiter.delegateHandle);
+            freeWaiter(i);
+            if (threadRef != LUA_NOREF)
+                state->unrefRegistry(threadRef);
+            else
+                runningThreads.FindChecked(thread).numWaits--;
+            bCancelled = true;
+        }
+
+        // suspended thread can't be reused
+        PooledThread* pooled = runningThreads.Find(thread);
+        if (bCancelled && pooled && pooled->numWaits == 0 && !pooled->bRunning)
+            releasePooledThread(thread, false);
+        return bCancelled;
+    }
+
+    void LuaCoroutineScheduler::resume(int32 handle, lua_State* from, int nargs)
+    {
+        int32 index;
+        Waiter* waiter = findWaiter(handle, index);
+        if (!waiter) {
+            // resumed already, or state is closed and opened again
+            if (from && nargs > 0)
+                lua_pop(from, nargs);
+            return;
+        }
+
+        lua_State* thread = waiter->thread;
+        int threadRef = waiter->threadRef;
+        if (waiter->heap != EWaitHeap::None)
+            getHeap(waiter->heap).remove(waiters, index);
+        if (waiter->delegateRef != LUA_NOREF)
+            firedDelegates.Emplace(waiter->delegateRef, waiter->delegateHandle);
+        freeWaiter(index);
+
+        PooledThread* pooled = nullptr;
+        if (threadRef == LUA_NOREF) {
+            pooled = runningThreads.Find(thread);
+            check(pooled);
+            pooled->numWaits--;
+        }
+
+        if (lua_status(thread) != LUA_YIELD) {
+            // fired before coroutine yields, or coroutine ended with error after it began to wait
+            if (from && nargs > 0)
+                lua_pop(from, nargs);
+            Log::Error("cannot resume coroutine not suspended");
+            if (threadRef != LUA_NOREF)
+                state->unrefRegistry(threadRef);
+            else if (pooled->numWaits == 0 && !pooled->bRunning)
+                releasePooledThread(thread, false);
+            return;
+        }
+
+        if (!from)
+            from = L;
+        if (nargs > 0)
+            lua_xmove(from, thread, nargs);
+        run(thread, from, nargs, threadRef);
+    }
+
+    void LuaCoroutineScheduler::run(lua_State* thread, lua_State* from, int nargs, int threadRef)
+    {
+        QUICK_SCOPE_CYCLE_COUNTER(Lua_ResumeCoroutine);
+        LuaFrameBudgetScope budgetScope(state, ELuaEntryPoint::Latent);
+
+        if (threadRef == LUA_NOREF)
+            runningThreads.FindChecked(thread).bRunning = true;
+#if LUA_VERSION_NUM > 503
+        int nres = 0;
+        int status = lua_resume(thread, from, nargs, &nres);
+#else
+        int status = lua_resume(thread, from, nargs);
+#endif
+        if (status != LUA_OK && status != LUA_YIELD) {
+            luaL_traceback(L, thread, lua_tostring(thread, -1), 0);
+            state->onError(lua_tostring(L, -1));
+            lua_pop(L, 1);
+        }
+
+        // a waiting coroutine has a new ref taken by addWaiter
+        if (threadRef != LUA_NOREF) {
+            state->unrefRegistry(threadRef);
+            return;
+        }
+
+        PooledThread& pooled = runningThreads.FindChecked(thread);
+        pooled.bRunning = false;
+        if (pooled.numWaits > 0) {
+            // thread is kept until its waits are resumed, it can't be reused before
+            return;
+        }
+        if (status == LUA_YIELD) {
+            // yielded by coroutine.yield, no one can resume it
+            Log::Error("coroutine started by slua.Coroutine.Start yielded without waiting");
+        }
+        releasePooledThread(thread, status == LUA_OK);
+    }
+
+    void LuaCoroutineScheduler::releasePooledThread(lua_State* thread, bool bRecycle)
+    {
+        PooledThread pooled;
+        if (!runningThreads.RemoveAndCopyValue(thread, pooled))
+            return;
+
+        if (bRecycle && pooledThreads.Num() < CoroutinePoolSize) {
+            lua_settop(thread, 0);
+            pooledThreads.Emplace(thread, pooled.ref);
+        }
+        else {
+            state->unrefRegistry(pooled.ref);
+        }
+    }
+
+    void LuaCoroutineScheduler::tick(float dtime)
+    {
+        frame++;
+        time += dtime;
+
+        if (firedDelegates.Num() > 0)
+            removeDelegates();
+
+        dueWaiters.Reset();
+        frameHeap.popDue(waiters, (double)frame, dueWaiters);
+        timeHeap.popDue(waiters, time, dueWaiters);
+        // resumed coroutines may wait again, they are not due until next tick
+        for (int32 i = 0; i < dueWaiters.Num(); i++)
+            resume(dueWaiters[i]);
+    }
+
+    void LuaCoroutineScheduler::removeDelegates()
+    {
+        TArray<TPair<int, int64>> fired = MoveTemp(firedDelegates);
+        int top = lua_gettop(L);
+        for (auto& it : fired) {
+            int errIndex = LuaState::pushErrorHandler(L);
+            lua_rawgeti(L, LUA_REGISTRYINDEX, it.Key);
+            if (lua_getfield(L, -1, "Remove") == LUA_TFUNCTION) {
+                lua_insert(L, -2);
+                lua_pushinteger(L, it.Value);
+                lua_pcall(L, 2, 0, errIndex);
+            }
+            lua_settop(L, top);
+            state->unrefRegistry(it.Key);
+        }
+    }
+
+    int LuaCoroutineScheduler::Start(lua_State* L)
+    {
+        luaL_checktype(L, 1, LUA_TFUNCTION);
+        LuaCoroutineScheduler* scheduler = get(L);
+        int nargs = lua_gettop(L) - 1;
+
+        lua_State* thread;
+        int ref;
+        if (scheduler->pooledThreads.Num() > 0) {
+#if UE_5_5_OR_LATER
+            TPair<lua_State*, int> pooled = scheduler->pooledThreads.Pop(EAllowShrinking::No);
+#else
+            TPair<lua_State*, int> pooled = scheduler->pooledThreads.Pop(false);
+#endif
+            thread = pooled.Key;
+            ref = pooled.Value;
+        }
+        else {
+            thread = lua_newthread(L);
+            ref = scheduler->state->refRegistry(L);
+        }
+
+        scheduler->runningThreads.Add(thread, { ref, 0, false });
+        lua_xmove(L, thread, nargs + 1);
+        // return thread, which can be passed to Cancel and IsWaiting
+        lua_pushthread(thread);
+        lua_xmove(thread, L, 1);
+        scheduler->run(thread, L, nargs, LUA_NOREF);
+        return 1;
+    }
+
+    // Cancel(co), remove waits of coroutine without resuming it
+    int LuaCoroutineScheduler::Cancel(lua_State* L)
+    {
+        luaL_checktype(L, 1, LUA_TTHREAD);
+        lua_pushboolean(L, get(L)->cancel(lua_tothread(L, 1)));
+        return 1;
+    }
+
+    int LuaCoroutineScheduler::IsWaiting(lua_State* L)
+    {
+        luaL_checktype(L, 1, LUA_TTHREAD);
+        lua_pushboolean(L, get(L)->findHandle(lua_tothread(L, 1)) != 0);
+        return 1;
+    }
+
+    int LuaCoroutineScheduler::WaitFrame(lua_State* L)
+    {
+        lua_Integer frames = FMath::Max<lua_Integer>(luaL_optinteger(L, 1, 1), 1);
+        LuaCoroutineScheduler* scheduler = get(L);
+        int32 index;
+        Waiter* waiter = scheduler->findWaiter(scheduler->addWaiter(L), index);
+        waiter->wakeAt = (double)(scheduler->frame + frames);
+        waiter->heap = EWaitHeap::Frame;
+        scheduler->frameHeap.push(scheduler->waiters, index);
+        return lua_yield(L, 0);
+    }
+
+    int LuaCoroutineScheduler::WaitSeconds(lua_State* L)
+    {
+        lua_Number seconds = luaL_checknumber(L, 1);
+        LuaCoroutineScheduler* scheduler = get(L);
+        int32 index;
+        Waiter* waiter = scheduler->findWaiter(scheduler->addWaiter(L), index);
+        waiter->wakeAt = scheduler->time + seconds;
+        waiter->heap = EWaitHeap::Time;
+        scheduler->timeHeap.push(scheduler->waiters, index);
+        return lua_yield(L, 0);
+    }
+
+    int LuaCoroutineScheduler::onDelegateFired(lua_State* L)
+    {
+        LuaState* ls = LuaState::get(L);
+        LuaCoroutineScheduler* scheduler = ls ? ls->getCoroutineScheduler() : nullptr;
+        if (scheduler)
+            scheduler->resume((int32)lua_tointeger(L, lua_upvalueindex(1)), L, lua_gettop(L));
+        return 0;
+    }
+
+    int LuaCoroutineScheduler::WaitDelegate(lua_State* L)
+    {
+        luaL_checktype(L, 1, LUA_TUSERDATA);
+        LuaCoroutineScheduler* scheduler = get(L);
+        int32 handle = scheduler->addWaiter(L);
+
+        // bind a one shot function, it's removed on next tick after it fires
+        int errIndex = LuaState::pushErrorHandler(L);
+        lua_getfield(L, 1, "Add");
+        lua_pushvalue(L, 1);
+        lua_pushinteger(L, handle);
+        lua_pushcclosure(L, onDelegateFired, 1);
+        int32 index;
+        if (lua_pcall(L, 2, 1, errIndex) != LUA_OK || !lua_isinteger(L, -1)) {
+            Waiter* waiter = scheduler->findWaiter(handle, index);
+            lua_State* thread = waiter->thread;
+            int threadRef = waiter->threadRef;
+            scheduler->freeWaiter(index);
+            if (threadRef != LUA_NOREF)
+                scheduler->state->unrefRegistry(threadRef);
+            else
+                scheduler->runningThreads.FindChecked(thread).numWaits--;
+            luaL_error(L, "WaitDelegate expect a multicast delegate");
+        }
+
+        Waiter* waiter = scheduler->findWaiter(handle, index);
+        waiter->delegateHandle = lua_tointeger(L, -1);
+        lua_pushvalue(L, 1);
+        waiter->delegateRef = scheduler->state->refRegistry(L);
+        return lua_yield(L, 0);
+    }
+
+    int LuaCoroutineScheduler::WaitAsyncLoad(lua_State* L)
+    {
+        FString objectPath = UTF8_TO_TCHAR(luaL_checkstring(L, 1));
+        if (UObject* loaded = FindObject<UObject>(nullptr, *objectPath))
+            return LuaObject::push(L, loaded);
+
+        LuaCoroutineScheduler* scheduler = get(L);
+        int32 handle = scheduler->addWaiter(L);
+        // state may be closed before loading completes, find it again by index,
+        // indices aren't reused so a state opened later can't get this resume
+        int stateIndex = scheduler->state->stateIndex();
+        LoadPackageAsync(FPackageName::ObjectPathToPackageName(objectPath), FLoadPackageAsyncDelegate::CreateLambda(
+            [stateIndex, handle, objectPath](const FName& packageName, UPackage* package, EAsyncLoadingResult::Type result) {
+                LuaState* ls = LuaState::get(stateIndex);
+                LuaCoroutineScheduler* scheduler = ls ? ls->getCoroutineScheduler() : nullptr;
+                if (!scheduler)
+                    return;
+                lua_State* L = ls->getLuaState();
+                UObject* loaded = result == EAsyncLoadingResult::Succeeded ? FindObject<UObject>(nullptr, *objectPath) : nullptr;
+                LuaObject::push(L, loaded);
+                scheduler->resume(handle, L, 1);
+            }));
+        return lua_yield(L, 0);
+    }
+}
@@ -113,6 +113,8 @@ void ULuaDelegate::ProcessEvent( UFunction* f, void* Parms ) {
 #endif
         return;
     }
+    auto L = luafunction->getState();
+    NS_SLUA::LuaFrameBudgetScope budgetScope(L ? NS_SLUA::LuaState::get(L) : nullptr, NS_SLUA::ELuaEntryPoint::Delegate, ufunction);
     luafunction->callByUFunction(ufunction,reinterpret_cast<uint8*>(Parms));
 }
 
@@ -142,6 +144,30 @@ void ULuaDelegate::dispose()
     }
 }
 
+static void addLuaDelegateTrace(NS_SLUA::lua_State* L, int64 handle)
+{
+#if !UE_BUILD_SHIPPING
+    if (bLuaDelegateTraceEnable)
+    {
+        luaL_traceback(L, L, nullptr, 0);
+        const char* stacktrace = lua_tostring(L, -1);
+
+        LuaDelegateTraceback.Add(handle, FString(UTF8_TO_TCHAR(stacktrace)));
+        lua_pop(L, 1);
+    }
+#endif
+}
+
+static void removeLuaDelegateTrace(int64 handle)
+{
+#if !UE_BUILD_SHIPPING
+    if (bLuaDelegateTraceEnable)
+    {
+        LuaDelegateTraceback.Remove(handle);
+    }
+#endif
+}
+
 int ULuaDelegate::addLuaDelegate(NS_SLUA::lua_State* L, ULuaDelegate* obj)
 {
     DelegateHandle++;
@@ -153,16 +179,7 @@ int ULuaDelegate::addLuaDelegate(NS_SLUA::lua_State* L, ULuaDelegate* obj)
 
     lua_pushinteger(L, DelegateHandle);
 
-#if !UE_BUILD_SHIPPING
-    if (bLuaDelegateTraceEnable)
-    {
-        luaL_traceback(L, L, nullptr, 0);
-        const char* stacktrace = lua_tostring(L, -1);
-
-        LuaDelegateTraceback.Add(DelegateHandle, FString(UTF8_TO_TCHAR(stacktrace)));
-        lua_pop(L, 1);
-    }
-#endif
+    addLuaDelegateTrace(L, DelegateHandle);
     return 1;
 }
 
@@ -174,17 +191,384 @@ int ULuaDelegate::removeLuaDelegate(NS_SLUA::lua_State* L, ULuaDelegate* obj)
     NS_SLUA::LuaObject::removeRef(L,obj);
     obj->dispose();
 
-#if !UE_BUILD_SHIPPING
-    if (bLuaDelegateTraceEnable)
+    removeLuaDelegateTrace(obj->handle);
+    return 0;
+}
+
+namespace NS_SLUA {
+
+    static const FName EventTriggerName(TEXT("EventTrigger"));
+
+    // a reused proxy is bound by trigger name of its generation, EventTrigger_0 ... EventTrigger_62 are
+    // duplicates of EventTrigger, so a copy of an older binding still finds its function but is ignored
+    static const int32 TriggerGenerations = 64;
+
+    static FName getTriggerName(int32 generation)
     {
-        LuaDelegateTraceback.Remove(obj->handle);
+        // number 0 is no number, the native EventTrigger
+        return FName(EventTriggerName, generation);
     }
+
+    static void addGenerationTriggers()
+    {
+        static bool bAdded = false;
+        if (bAdded)
+            return;
+        bAdded = true;
+
+        UClass* cls = ULuaDelegateProxy::StaticClass();
+        UFunction* trigger = cls->FindFunctionByName(EventTriggerName);
+        for (int32 generation = 1; generation < TriggerGenerations; generation++)
+        {
+            FName triggerName = getTriggerName(generation);
+            cls->AddNativeFunction(*triggerName.ToString(), trigger->GetNativeFunc());
+
+            FObjectDuplicationParameters duplicationParams(trigger, cls);
+            duplicationParams.DestName = triggerName;
+            duplicationParams.InternalFlagMask &= ~EInternalObjectFlags::Native;
+            UFunction* func = Cast<UFunction>(StaticDuplicateObjectEx(duplicationParams));
+            func->ClearInternalFlags(EInternalObjectFlags::Native);
+            func->AddToRoot();
+            cls->AddFunctionToFunctionMap(func, triggerName);
+        }
+    }
+
+    enum class ELuaDelegateOwner : uint8 {
+        Single,
+        Multicast,
+        Sparse,
+    };
+
+    // one lua function bound by Add/Bind, proxy is the object bound to delegate
+    struct LuaDelegateSlot {
+        ULuaDelegateProxy* proxy = nullptr;
+        LuaVar luafunction;
+        UFunction* signature = nullptr;
+        // delegate which slot had been added to, only dereferenced while parent is alive
+        const void* owner = nullptr;
+        ELuaDelegateOwner ownerType = ELuaDelegateOwner::Single;
+#if !((ENGINE_MINOR_VERSION<25) && (ENGINE_MAJOR_VERSION==4))
+        FMulticastSparseDelegateProperty* sparseProp = nullptr;
 #endif
-    return 0;
+        // object which owner delegate belongs to, slot is released when it's deleted
+        const void* parent = nullptr;
+        int64 handle = 0;
+        uint64 releasedFrame = 0;
+        // bumped every release, bindings of older generations do nothing when they fire
+        int32 generation = 0;
+#if WITH_EDITOR
+        FString pName;
+#endif
+
+        FName triggerName() const { return getTriggerName(generation); }
+    };
+
+    // proxies of a lua state are pooled and rebound to next lua function after released,
+    // so binding lua function only cost a free slot instead of a new UObject
+    class LuaDelegateSlots {
+    public:
+        // slots of main lua state of L
+        static LuaDelegateSlots* get(lua_State* L, bool bCreate);
+        static void close(lua_State* L);
+
+        ~LuaDelegateSlots();
+
+        LuaDelegateSlot* acquire(lua_State* L, int p, UFunction* signature, const void* owner, ELuaDelegateOwner ownerType, const void* parent, const FString& pName);
+        // unbind lua function and reuse slot by next generation, delegates still holding
+        // the old binding trigger nothing
+        void release(LuaDelegateSlot* slot);
+        // remove binding of slot from owner delegate if owner is known alive
+        void unbindFromOwner(LuaDelegateSlot* slot);
+        // owner delegate had been cleared
+        void releaseOwner(const void* owner);
+        // object holding owner delegates had been deleted
+        void releaseParent(const void* parent);
+
+        LuaDelegateSlot* findByHandle(int64 handle) const;
+        void getStats(int32& bound, int32& free) const;
+
+    private:
+        void recyclePending();
+        void destroy(LuaDelegateSlot* slot);
+
+        // free slots more than this are destroyed instead of pooled
+        static const int32 MaxFreeSlots = 256;
+
+        TSet<LuaDelegateSlot*> slots;
+        TArray<LuaDelegateSlot*> freeSlots;
+        // released slots wait one frame, broadcasting delegate may still hold a copy of invocation list
+        TArray<LuaDelegateSlot*> pendingSlots;
+        TMap<int64, LuaDelegateSlot*> handleToSlot;
+        TMultiMap<const void*, LuaDelegateSlot*> ownerToSlots;
+        TMultiMap<const void*, LuaDelegateSlot*> parentToSlots;
+
+        static TMap<lua_State*, LuaDelegateSlots*> statePools;
+    };
+
+    TMap<lua_State*, LuaDelegateSlots*> LuaDelegateSlots::statePools;
+
+    LuaDelegateSlots* LuaDelegateSlots::get(lua_State* L, bool bCreate)
+    {
+        LuaState* ls = LuaState::get(L);
+        if (!ls)
+            return nullptr;
+
+        lua_State* mainState = ls->getLuaState();
+        LuaDelegateSlots** pool = statePools.Find(mainState);
+        if (pool)
+            return *pool;
+        if (!bCreate)
+            return nullptr;
+        return statePools.Add(mainState, new LuaDelegateSlots());
+    }
+
+    void LuaDelegateSlots::close(lua_State* L)
+    {
+        LuaDelegateSlots* pool = nullptr;
+        if (statePools.RemoveAndCopyValue(L, pool))
+        {
+            delete pool;
+        }
+    }
+
+    LuaDelegateSlots::~LuaDelegateSlots()
+    {
+        // delegates may still hold proxies, they are unbound after proxies are collected
+        for (LuaDelegateSlot* slot : slots)
+        {
+            destroy(slot);
+        }
+    }
+
+    void LuaDelegateSlots::destroy(LuaDelegateSlot* slot)
+    {
+        slot->luafunction.free();
+        if (UObjectInitialized() && slot->proxy)
+        {
+            slot->proxy->slot = nullptr;
+            slot->proxy->RemoveFromRoot();
+        }
+        delete slot;
+    }
+
+    void LuaDelegateSlots::recyclePending()
+    {
+        int32 count = 0;
+        while (count < pendingSlots.Num() && pendingSlots[count]->releasedFrame < GFrameCounter)
+        {
+            LuaDelegateSlot* slot = pendingSlots[count];
+            if (freeSlots.Num() < MaxFreeSlots)
+            {
+                freeSlots.Add(slot);
+            }
+            else
+            {
+                slots.Remove(slot);
+                destroy(slot);
+            }
+            count++;
+        }
+        if (count > 0)
+        {
+#if UE_5_5_OR_LATER
+            pendingSlots.RemoveAt(0, count, EAllowShrinking::No);
+#else
+            pendingSlots.RemoveAt(0, count, false);
+#endif
+        }
+    }
+
+    LuaDelegateSlot* LuaDelegateSlots::acquire(lua_State* L, int p, UFunction* signature, const void* owner, const void* parent, const FString& pName)
+    {
+        luaL_checktype(L, p, LUA_TFUNCTION);
+        recyclePending();
+
+        LuaDelegateSlot* slot;
+        if (freeSlots.Num() > 0)
+        {
+#if UE_5_5_OR_LATER
+            slot = freeSlots.Pop(EAllowShrinking::No);
+#else
+            slot = freeSlots.Pop(false);
+#endif
+        }
+        else
+        {
+            addGenerationTriggers();
+            slot = new LuaDelegateSlot();
+            slot->proxy = NewObject<ULuaDelegateProxy>((UObject*)GetTransientPackage(), ULuaDelegateProxy::StaticClass());
+            slot->proxy->slot = slot;
+            slot->proxy->AddToRoot();
+            slots.Add(slot);
+        }
+
+        slot->luafunction = LuaVar(L, p, LuaVar::LV_FUNCTION);
+        slot->signature = signature;
+        slot->owner = owner;
+        slot->ownerType = ownerType;
+        slot->parent = parent;
+        slot->handle = ++DelegateHandle;
+#if WITH_EDITOR
+        slot->pName = pName;
+#endif
+        handleToSlot.Add(slot->handle, slot);
+        ownerToSlots.Add(owner, slot);
+        if (parent)
+            parentToSlots.Add(parent, slot);
+        return slot;
+    }
+
+    void LuaDelegateSlots::release(LuaDelegateSlot* slot)
+    {
+        if (!slot || !slot->handle)
+            return;
+
+        slot->luafunction.free();
+        removeLuaDelegateTrace(slot->handle);
+
+        handleToSlot.Remove(slot->handle);
+        ownerToSlots.RemoveSingle(slot->owner, slot);
+        if (slot->parent)
+            parentToSlots.RemoveSingle(slot->parent, slot);
+        slot->signature = nullptr;
+        slot->owner = nullptr;
+#if !((ENGINE_MINOR_VERSION<25) && (ENGINE_MAJOR_VERSION==4))
+        slot->sparseProp = nullptr;
+#endif
+        slot->parent = nullptr;
+        slot->handle = 0;
+        slot->generation = (slot->generation + 1) % TriggerGenerations;
+        slot->releasedFrame = GFrameCounter;
+        pendingSlots.Add(slot);
+    }
+
+    void LuaDelegateSlots::unbindFromOwner(LuaDelegateSlot* slot)
+    {
+        // owner without parent may have been freed, its binding is left to generation check
+        if (!slot || !slot->handle || !slot->owner || !slot->parent)
+            return;
+
+        FScriptDelegate Delegate;
+        Delegate.BindUFunction(slot->proxy, slot->triggerName());
+        switch (slot->ownerType)
+        {
+        case ELuaDelegateOwner::Single:
+            {
+                FScriptDelegate* owner = (FScriptDelegate*)slot->owner;
+                if (owner->GetUObject() == slot->proxy && owner->GetFunctionName() == Delegate.GetFunctionName())
+                    owner->Unbind();
+            }
+            break;
+        case ELuaDelegateOwner::Multicast:
+            ((FMulticastScriptDelegate*)slot->owner)->Remove(Delegate);
+            break;
+        case ELuaDelegateOwner::Sparse:
+#if !((ENGINE_MINOR_VERSION<25) && (ENGINE_MAJOR_VERSION==4))
+            slot->sparseProp->RemoveDelegate(Delegate, nullptr, (FSparseDelegate*)slot->owner);
+#endif
+            break;
+        }
+    }
+
+    void LuaDelegateSlots::releaseOwner(const void* owner)
+    {
+        TArray<LuaDelegateSlot*> ownerSlots;
+        ownerToSlots.MultiFind(owner, ownerSlots);
+        for (LuaDelegateSlot* slot : ownerSlots)
+        {
+            release(slot);
+        }
+    }
+
+    void LuaDelegateSlots::releaseParent(const void* parent)
+    {
+        TArray<LuaDelegateSlot*> parentSlots;
+        parentToSlots.MultiFind(parent, parentSlots);
+        for (LuaDelegateSlot* slot : parentSlots)
+        {
+            release(slot);
+        }
+    }
+
+    LuaDelegateSlot* LuaDelegateSlots::findByHandle(int64 handle) const
+    {
+        LuaDelegateSlot* const* slot = handleToSlot.Find(handle);
+        return slot ? *slot : nullptr;
+    }
+
+    void LuaDelegateSlots::getStats(int32& bound, int32& free) const
+    {
+        free = freeSlots.Num() + pendingSlots.Num();
+        bound = slots.Num() - free;
+    }
+}
+
+ULuaDelegateProxy::ULuaDelegateProxy(const FObjectInitializer& ObjectInitializer)
+    : Super(ObjectInitializer)
+    , slot(nullptr)
+{
+}
+
+void ULuaDelegateProxy::EventTrigger()
+{
+    ensure(false); // never run here
+}
+
+void ULuaDelegateProxy::ProcessEvent(UFunction* f, void* Parms)
+{
+    // binding of released generation may be kept by a copied delegate
+    if (!slot || f->GetFName() != slot->triggerName())
+    {
+        return;
+    }
+
+    if (!slot->luafunction.isValid()) {
+#if WITH_EDITOR
+        NS_SLUA::Log::Error("Can't remove lua delegate[%s] on trigger delegate!", TCHAR_TO_UTF8(*slot->pName));
+#else
+        NS_SLUA::Log::Error("Can't remove lua delegate on trigger delegate!");
+#endif
+        return;
+    }
+
+    auto L = slot->luafunction.getState();
+    NS_SLUA::LuaFrameBudgetScope budgetScope(L ? NS_SLUA::LuaState::get(L) : nullptr, NS_SLUA::ELuaEntryPoint::Delegate, slot->signature);
+    slot->luafunction.callByUFunction(slot->signature, reinterpret_cast<uint8*>(Parms));
+}
+
+void ULuaDelegateProxy::releaseState(NS_SLUA::lua_State* L)
+{
+    NS_SLUA::LuaDelegateSlots::close(L);
+}
+
+void ULuaDelegateProxy::releaseParent(NS_SLUA::lua_State* L, const void* parent)
+{
+    if (auto pool = NS_SLUA::LuaDelegateSlots::get(L, false))
+    {
+        pool->releaseParent(parent);
+    }
+}
+
+void ULuaDelegateProxy::getSlotStats(NS_SLUA::lua_State* L, int32& bound, int32& free)
+{
+    bound = free = 0;
+    if (auto pool = NS_SLUA::LuaDelegateSlots::get(L, false))
+    {
+        pool->getStats(bound, free);
+    }
 }
 
 int ULuaDelegate::removeLuaDelegateByHandle(NS_SLUA::lua_State* L, int64 handle)
 {
+    auto pool = NS_SLUA::LuaDelegateSlots::get(L, false);
+    if (auto slot = pool ? pool->findByHandle(handle) : nullptr)
+    {
+        pool->unbindFromOwner(slot);
+        pool->release(slot);
+        lua_pushboolean(L, 1);
+        return 1;
+    }
+
     auto objPtr = DelegateHandleToObjectMap.Find(handle);
     if (!objPtr)
     {
@@ -224,6 +608,50 @@ namespace NS_SLUA {
 
     DefTypeName(LuaDelegateWrap);
 
+    static const void* getOwner(LuaMultiDelegateWrap* UD) {
+#if !((ENGINE_MINOR_VERSION<25) && (ENGINE_MAJOR_VERSION==4))
+        if (UD->sparseProp)
+            return UD->sparseDelegate;
+#endif
+        return UD->delegate;
+    }
+
+    static ELuaDelegateOwner getOwnerType(LuaMultiDelegateWrap* UD) {
+#if !((ENGINE_MINOR_VERSION<25) && (ENGINE_MAJOR_VERSION==4))
+        if (UD->sparseProp)
+            return ELuaDelegateOwner::Sparse;
+#endif
+        return ELuaDelegateOwner::Multicast;
+    }
+
+    // object which delegate at p is a property of, null if it's not pushed as reference
+    static const void* getParent(lua_State* L, int p) {
+        auto ud = reinterpret_cast<GenericUserData*>(lua_touserdata(L, p));
+        return ud ? ud->parent : nullptr;
+    }
+
+    template<typename T>
+    static FString getPropName(T* UD) {
+#if WITH_EDITOR
+        return UD->pName;
+#else
+        return FString();
+#endif
+    }
+
+    static void removeScriptDelegate(LuaMultiDelegateWrap* UD, const FScriptDelegate& Delegate) {
+#if !((ENGINE_MINOR_VERSION<25) && (ENGINE_MAJOR_VERSION==4))
+        if (UD->sparseProp)
+        {
+            UD->sparseProp->RemoveDelegate(Delegate, nullptr, UD->sparseDelegate);
+        }
+        else
+#endif
+        {
+            UD->delegate->Remove(Delegate);
+        }
+    }
+
     int LuaMultiDelegate::Add(lua_State* L) {
         CheckUD(LuaMultiDelegateWrap,L,1);
 
@@ -232,19 +660,17 @@ namespace NS_SLUA {
         {
         case LUA_TFUNCTION:
             {
-                // bind luafucntion and signature function
-                auto obj = NewObject<ULuaDelegate>((UObject*)GetTransientPackage(),ULuaDelegate::StaticClass());
-#if WITH_EDITOR
-                obj->setPropName(UD->pName);
-#endif
-                obj->bindFunction(L,2,UD->funcAcc->func);
+                // bind luafucntion and signature function to a pooled proxy
+                auto pool = LuaDelegateSlots::get(L, true);
+                LuaDelegateSlot* slot = pool->acquire(L, 2, UD->funcAcc->func, getOwner(UD), getOwnerType(UD), getParent(L, 1), getPropName(UD));
 
                 // add event listener
                 FScriptDelegate Delegate;
-                Delegate.BindUFunction(obj, TEXT("EventTrigger"));
+                Delegate.BindUFunction(slot->proxy, slot->triggerName());
 #if !((ENGINE_MINOR_VERSION<25) && (ENGINE_MAJOR_VERSION==4))
                 if (UD->sparseProp)
                 {
+                    slot->sparseProp = UD->sparseProp;
                     UD->sparseProp->AddDelegate(Delegate, nullptr, UD->sparseDelegate);
                 }
                 else
@@ -252,7 +678,11 @@ namespace NS_SLUA {
                 {
                     UD->delegate->AddUnique(Delegate);
                 }
-                return ULuaDelegate::addLuaDelegate(L, obj);
+
+                int64 handle = slot->handle;
+                addLuaDelegateTrace(L, handle);
+                lua_pushinteger(L, handle);
+                return 1;
             }
             break;
         case LUA_TUSERDATA:
@@ -303,6 +733,19 @@ namespace NS_SLUA {
                 int64 handle = lua_tointeger(L, 2);
                 if (handle <= 0)
                     luaL_error(L,"arg 2 expect integer type of handle");
+
+                auto pool = LuaDelegateSlots::get(L, false);
+                if (auto slot = pool ? pool->findByHandle(handle) : nullptr)
+                {
+                    FScriptDelegate Delegate;
+                    Delegate.BindUFunction(slot->proxy, slot->triggerName());
+                    removeScriptDelegate(UD, Delegate);
+                    if (slot->owner != getOwner(UD))
+                        pool->unbindFromOwner(slot);
+                    pool->release(slot);
+                    return 0;
+                }
+
                 auto objPtr = DelegateHandleToObjectMap.Find(handle);
                 auto obj = objPtr ? objPtr->Get() : nullptr;
                 if (!obj)
@@ -397,6 +840,8 @@ namespace NS_SLUA {
             clearLuaDelegate(UD->delegate->GetAllObjects());
             UD->delegate->Clear();
         }
+        if (auto pool = LuaDelegateSlots::get(L, false))
+            pool->releaseOwner(getOwner(UD));
         return 0;
     }
 
@@ -496,6 +941,8 @@ namespace NS_SLUA {
             }
         }
         ldw->delegate->Clear();
+        if (auto pool = LuaDelegateSlots::get(L, false))
+            pool->releaseOwner(ldw->delegate);
     }
 
     int LuaDelegate::Bind(lua_State* L)
@@ -510,16 +957,15 @@ namespace NS_SLUA {
         {
         case LUA_TFUNCTION:
             {
-                // bind luafucntion and signature function
-                auto obj = NewObject<ULuaDelegate>((UObject*)GetTransientPackage(), ULuaDelegate::StaticClass());
-#if WITH_EDITOR 
-                obj->setPropName(UD->pName);
-#endif
-                obj->bindFunction(L, 2, UD->funcAcc->func);
-
-                UD->delegate->BindUFunction(obj, TEXT("EventTrigger"));
-
-                return ULuaDelegate::addLuaDelegate(L, obj);
+                // bind luafucntion and signature function to a pooled proxy
+                auto pool = LuaDelegateSlots::get(L, true);
+                LuaDelegateSlot* slot = pool->acquire(L, 2, UD->funcAcc->func, UD->delegate, ELuaDelegateOwner::Single, getParent(L, 1), getPropName(UD));
+                UD->delegate->BindUFunction(slot->proxy, slot->triggerName());
+
+                int64 handle = slot->handle;
+                addLuaDelegateTrace(L, handle);
+                lua_pushinteger(L, handle);
+                return 1;
             }
             break;
         case LUA_TUSERDATA:
@@ -0,0 +1,225 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "LuaFrameBudget.h"
+#include "LuaState.h"
+#include "Log.h"
+#include "HAL/IConsoleManager.h"
+
+namespace NS_SLUA {
+
+#if !UE_BUILD_SHIPPING
+    static int32 FrameBudgetMode = 1;
+
+    FAutoConsoleVariableRef CVarSluaFrameBudget(
+        TEXT("slua.FrameBudget"),
+        FrameBudgetMode,
+        TEXT("Lua frame budget counters, 0: off, 1: per entry point, 2: per entry point and class/function.\n"),
+        ECVF_Default);
+
+    static float FrameBudgetWarnMs = 0.0f;
+
+    FAutoConsoleVariableRef CVarSluaFrameBudgetWarnMs(
+        TEXT("slua.FrameBudgetWarnMs"),
+        FrameBudgetWarnMs,
+        TEXT("Log a warning when lua cost more than this milliseconds in one frame, 0 to disable.\n"),
+        ECVF_Default);
+#else
+    static const int32 FrameBudgetMode = 0;
+    static const float FrameBudgetWarnMs = 0.0f;
+#endif
+
+    const TCHAR* getEntryPointName(ELuaEntryPoint entry)
+    {
+        switch (entry)
+        {
+        case ELuaEntryPoint::StateTick:
+            return TEXT("StateTick");
+        case ELuaEntryPoint::ActorTick:
+            return TEXT("ActorTick");
+        case ELuaEntryPoint::Override:
+            return TEXT("Override");
+        case ELuaEntryPoint::Delegate:
+            return TEXT("Delegate");
+        case ELuaEntryPoint::Latent:
+            return TEXT("Latent");
+        default:
+            return TEXT("Unknown");
+        }
+    }
+
+    double LuaBudgetCounter::getMilliseconds() const
+    {
+        return FPlatformTime::ToMilliseconds64(cycles);
+    }
+
+    void LuaFrameBudgetStats::reset(uint64 inFrameNumber)
+    {
+        frameNumber = inFrameNumber;
+        bOverrun = false;
+        total = LuaBudgetCounter();
+        for (auto& counter : entries)
+        {
+            counter = LuaBudgetCounter();
+        }
+        details.Reset();
+    }
+
+    LuaFrameBudget::LuaFrameBudget()
+        : currentScope(nullptr)
+        , overrunFrames(0)
+    {
+        current.reset(GFrameCounter);
+        last.reset(GFrameCounter - 1);
+    }
+
+    int32 LuaFrameBudget::getMode()
+    {
+        return FrameBudgetMode;
+    }
+
+    const LuaFrameBudgetStats& LuaFrameBudget::getLastFrame()
+    {
+        advance(GFrameCounter);
+        return last;
+    }
+
+    const LuaFrameBudgetStats& LuaFrameBudget::getCurrentFrame()
+    {
+        advance(GFrameCounter);
+        fillDetails(current);
+        return current;
+    }
+
+    void LuaFrameBudget::fillDetails(LuaFrameBudgetStats& stats) const
+    {
+        stats.details.Reset(currentDetails.Num());
+        for (auto& pair : currentDetails)
+        {
+            stats.details.Add({ pair.Key.name, pair.Key.entry, pair.Value });
+        }
+    }
+
+    void LuaFrameBudget::advance(uint64 frameNumber)
+    {
+        if (frameNumber == current.frameNumber)
+            return;
+
+        // report frame being finished even if lua isn't called again in next frame
+        if (FrameBudgetWarnMs > 0.0f && current.total.getMilliseconds() > FrameBudgetWarnMs)
+        {
+            current.bOverrun = true;
+            overrunFrames++;
+            Log::Log("Lua frame budget exceeded at frame %llu: %.3f ms in %d calls",
+                current.frameNumber, current.total.getMilliseconds(), current.total.calls);
+        }
+
+        if (current.frameNumber + 1 == frameNumber)
+        {
+            fillDetails(current);
+            Swap(last, current);
+        }
+        else
+        {
+            // no lua call in last frame
+            last.reset(frameNumber - 1);
+        }
+
+        current.reset(frameNumber);
+        currentDetails.Reset();
+    }
+
+    void LuaFrameBudget::record(ELuaEntryPoint entry, const UObject* id, uint64 cycles)
+    {
+        advance(GFrameCounter);
+
+        current.total.cycles += cycles;
+        current.total.calls++;
+        LuaBudgetCounter& counter = current.entries[(int32)entry];
+        counter.cycles += cycles;
+        counter.calls++;
+
+        if (FrameBudgetMode >= 2 && id)
+        {
+            FName* name = idNames.Find(id);
+            if (!name)
+            {
+                name = &idNames.Add(id, FName(*id->GetPathName()));
+            }
+            LuaBudgetCounter& detail = currentDetails.FindOrAdd({ *name, entry });
+            detail.cycles += cycles;
+            detail.calls++;
+        }
+    }
+
+    void LuaFrameBudget::onEngineGC()
+    {
+        // address may be reused by new object
+        idNames.Reset();
+    }
+
+    void LuaFrameBudget::dump(FOutputDevice& Ar)
+    {
+        const LuaFrameBudgetStats& stats = getLastFrame();
+        Ar.Logf(TEXT("Frame %llu: %.3f ms, %d calls"), stats.frameNumber, stats.total.getMilliseconds(), stats.total.calls);
+        for (int32 i = 0; i < (int32)ELuaEntryPoint::Num; i++)
+        {
+            const LuaBudgetCounter& counter = stats.entries[i];
+            Ar.Logf(TEXT("\t%-10s %8.3f ms %6d calls"), getEntryPointName((ELuaEntryPoint)i), counter.getMilliseconds(), counter.calls);
+        }
+
+        TArray<LuaBudgetDetail> details = stats.details;
+        details.Sort([](const LuaBudgetDetail& a, const LuaBudgetDetail& b)
+        {
+            return a.counter.cycles > b.counter.cycles;
+        });
+        for (auto& detail : details)
+        {
+            Ar.Logf(TEXT("\t\t%-10s %8.3f ms %6d calls %s"), getEntryPointName(detail.entry),
+                detail.counter.getMilliseconds(), detail.counter.calls, *detail.name.ToString());
+        }
+    }
+
+#if !UE_BUILD_SHIPPING
+    LuaFrameBudgetScope::LuaFrameBudgetScope(LuaState* state, ELuaEntryPoint inEntry, const UObject* inId)
+        : budget(nullptr)
+        , parent(nullptr)
+        , id(inId)
+        , startCycles(0)
+        , childCycles(0)
+        , entry(inEntry)
+    {
+        if (FrameBudgetMode <= 0 || !state)
+            return;
+
+        budget = &state->getFrameBudget();
+        parent = budget->currentScope;
+        budget->currentScope = this;
+        startCycles = FPlatformTime::Cycles64();
+    }
+
+    LuaFrameBudgetScope::~LuaFrameBudgetScope()
+    {
+        if (!budget)
+            return;
+
+        const uint64 elapsed = FPlatformTime::Cycles64() - startCycles;
+        budget->record(entry, id, elapsed > childCycles ? elapsed - childCycles : 0);
+        if (parent)
+        {
+            parent->childCycles += elapsed;
+        }
+        budget->currentScope = parent;
+    }
+#endif
+}
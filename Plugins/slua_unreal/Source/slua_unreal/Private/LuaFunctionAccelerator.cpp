@@ -255,9 +255,12 @@ namespace NS_SLUA
                 lua_State* mainThread = L->l_G->mainthread;
 
                 ULatentDelegate* latentObj = LuaObject::getLatentDelegate(mainThread);
-                int threadRef = latentObj->getThreadRef(L);
-                FLatentActionInfo LatentActionInfo(threadRef, GetTypeHash(FGuid::NewGuid()),
-                                                   *ULatentDelegate::NAME_LatentCallback, latentObj);
+                FLatentActionInfo LatentActionInfo;
+                LatentActionInfo.Linkage = latentObj->getThreadRef(L);
+                // wait handle is unique among pending actions, so it's UUID too
+                LatentActionInfo.UUID = LatentActionInfo.Linkage;
+                LatentActionInfo.ExecutionFunction = ULatentDelegate::LatentCallbackName;
+                LatentActionInfo.CallbackTarget = latentObj;
 
                 prop->CopySingleValue(prop->ContainerPtrToValuePtr<void>(params), &LatentActionInfo);
                 isLatentFunction = true;
@@ -378,9 +381,12 @@ namespace NS_SLUA
                 lua_State* mainThread = L->l_G->mainthread;
 
                 ULatentDelegate* latentObj = LuaObject::getLatentDelegate(mainThread);
-                int threadRef = latentObj->getThreadRef(L);
-                FLatentActionInfo LatentActionInfo(threadRef, GetTypeHash(FGuid::NewGuid()),
-                                                   *ULatentDelegate::NAME_LatentCallback, latentObj);
+                FLatentActionInfo LatentActionInfo;
+                LatentActionInfo.Linkage = latentObj->getThreadRef(L);
+                // wait handle is unique among pending actions, so it's UUID too
+                LatentActionInfo.UUID = LatentActionInfo.Linkage;
+                LatentActionInfo.ExecutionFunction = ULatentDelegate::LatentCallbackName;
+                LatentActionInfo.CallbackTarget = latentObj;
 
                 prop->CopySingleValue(prop->ContainerPtrToValuePtr<void>(params), &LatentActionInfo);
                 isLatentFunction = true;
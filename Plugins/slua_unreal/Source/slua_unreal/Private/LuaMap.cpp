@@ -17,6 +17,8 @@
 #include "LuaState.h"
 #include "LuaReference.h"
 #include "LuaNetSerialization.h"
+#include "LuaContainerKey.h"
+#include "LuaContainerConvert.h"
 
 #if LUA_VERSION_RELEASE_NUM >= 50406
 #include <lgc.h>
@@ -261,12 +263,8 @@ namespace NS_SLUA {
     }
 
     // modified FScriptMapHelper::RemovePair function to call LuaMap::RemoveAt
-    bool LuaMap::removePair(const void* KeyPtr) {
-        FProperty* LocalKeyPropForCapture = keyProp;
-        if (uint8* Entry = map->FindValue(KeyPtr, helper.MapLayout,
-            [LocalKeyPropForCapture](const void* ElementKey) { return LocalKeyPropForCapture->GetValueTypeHash(ElementKey); },
-            [LocalKeyPropForCapture](const void* A, const void* B) { return LocalKeyPropForCapture->Identical(A, B); }
-        )) {
+    bool LuaMap::removePair(const LuaContainerKey& Key) {
+        if (uint8* Entry = Key.findMapValue(map, helper.MapLayout)) {
             int32 Idx = (Entry - (uint8*)map->GetData(0, helper.MapLayout)) / helper.MapLayout.SetLayout.Size;
             removeAt(Idx);
             return true;
@@ -364,11 +362,8 @@ namespace NS_SLUA {
             luaL_error(L, "arg 1 expect LuaMap, but got nil!");
         }
         GET_CHECKER(key);
-        FDefaultConstructedPropertyElement tempKey(UD->keyProp);
-        auto keyPtr = tempKey.GetObjAddress();
-        keyChecker(L, UD->keyProp, (uint8*)keyPtr, 2, true);
-
-        auto valuePtr = UD->helper.FindValueFromHash(keyPtr);
+        LuaContainerKey tempKey(L, UD->keyProp, keyChecker, 2);
+        auto valuePtr = tempKey.findMapValue(UD->map, UD->helper.MapLayout);
         if (valuePtr)
         {
             auto prop = UD->valueProp;
@@ -431,10 +426,8 @@ namespace NS_SLUA {
         }
 
         GET_CHECKER(key);
-        FDefaultConstructedPropertyElement tempKey(UD->keyProp);
-        auto keyPtr = tempKey.GetObjAddress();
-        keyChecker(L, UD->keyProp, (uint8*)keyPtr, 2, true);
-        auto valuePtr = UD->helper.FindValueFromHash(keyPtr);
+        LuaContainerKey tempKey(L, UD->keyProp, keyChecker, 2);
+        auto valuePtr = tempKey.findMapValue(UD->map, UD->helper.MapLayout);
 
         if (!valuePtr)
         {
@@ -474,11 +467,10 @@ namespace NS_SLUA {
         }
         GET_CHECKER(key);
         GET_CHECKER(value);
-        FDefaultConstructedPropertyElement tempKey(UD->keyProp);
+        LuaContainerKey tempKey(L, UD->keyProp, keyChecker, 2, false);
         FDefaultConstructedPropertyElement tempValue(UD->valueProp);
-        auto keyPtr = tempKey.GetObjAddress();
+        auto keyPtr = tempKey.getObjAddress();
         auto valuePtr = tempValue.GetObjAddress();
-        keyChecker(L, UD->keyProp, (uint8*)keyPtr, 2, true);
         valueChecker(L, UD->valueProp, (uint8*)valuePtr, 3, true);
         UD->helper.AddPair(keyPtr, valuePtr);
 
@@ -493,13 +485,11 @@ namespace NS_SLUA {
             luaL_error(L, "arg 1 expect LuaMap, but got nil!");
         }
         GET_CHECKER(key);
-        FDefaultConstructedPropertyElement tempKey(UD->keyProp);
-        auto keyPtr = tempKey.GetObjAddress();
-        keyChecker(L, UD->keyProp, (uint8*)keyPtr, 2, true);
+        LuaContainerKey tempKey(L, UD->keyProp, keyChecker, 2);
 
         markDirty(UD);
 
-        return LuaObject::push(L, UD->removePair(keyPtr));
+        return LuaObject::push(L, UD->removePair(tempKey));
     }
 
     int LuaMap::Clear(lua_State* L) {
@@ -776,6 +766,28 @@ namespace NS_SLUA {
         return 0;
     }
 
+    int LuaMap::ToTable(lua_State* L) {
+        CheckUD(LuaMap, L, 1);
+        if (!UD) {
+            luaL_error(L, "arg 1 expect LuaMap, but got nil!");
+        }
+        return LuaContainerConvert::pushMap(L, UD->keyProp, UD->valueProp, UD->helper);
+    }
+
+    int LuaMap::FromTable(lua_State* L) {
+        CheckUD(LuaMap, L, 1);
+        if (!UD) {
+            luaL_error(L, "arg 1 expect LuaMap, but got nil!");
+        }
+        luaL_checktype(L, 2, LUA_TTABLE);
+
+        UD->clear();
+        LuaContainerConvert::readMap(L, 2, UD->keyProp, UD->valueProp, UD->helper);
+
+        markDirty(UD);
+        return 0;
+    }
+
     int LuaMap::setupMT(lua_State* L) {
         LuaObject::setupMTSelfSearch(L);
 
@@ -790,6 +802,8 @@ namespace NS_SLUA {
         RegMetaMethod(L, Remove);
         RegMetaMethod(L, Clear);
         RegMetaMethod(L, CreateValueTypeObject);
+        RegMetaMethod(L, ToTable);
+        RegMetaMethod(L, FromTable);
 
         RegMetaMethodByName(L, "__pairs", Pairs);
 
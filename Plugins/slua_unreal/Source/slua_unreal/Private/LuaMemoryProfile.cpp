@@ -17,15 +17,247 @@
 #include "Log.h"
 #include "lstate.h"
 #include "LuaProfiler.h"
+#include "LuaSmallBlockAllocator.h"
 #include "HAL/LowLevelMemTracker.h"
+#include "Math/RandomStream.h"
+#include "Misc/Crc.h"
 
 namespace NS_SLUA {
 
+    static int32 MemorySampleInterval = 0;
+
+    FAutoConsoleVariableRef CVarSluaMemorySampleInterval(
+        TEXT("slua.MemorySampleInterval"),
+        MemorySampleInterval,
+        TEXT("Average bytes between two sampled lua allocations when memory track started, 0 to track every allocation.\n"),
+        ECVF_Default);
+
+    // max lua frames recorded for one sampled allocation
+    const int MaxSampleStackDepth = 16;
+    // stacks and frames interned before table is compacted
+    const int32 MaxSampleStackEntries = 16384;
+
     // only calc memory alloc from lua script
     // not include alloc from lua vm
     size_t totalMemory;
-    
+
+    struct LuaMemStackFrame {
+        FString source;
+        int lineNumber;
+        // utf8 source to validate frame found by source pointer
+        TArray<ANSICHAR> rawSource;
+        // key of frameMap, null for named frame
+        const char* sourceKey;
+    };
+
+    // intern stacks of sampled allocations, every allocation only keep a stack id
+    class LuaMemStackTable {
+    public:
+        // source is the string of proto, shared by all functions of a chunk and never moved while proto alive,
+        // so frame is found by its address, and checked by content in case address is reused by another source
+        int32 internFrame(const char* source, int line) {
+            FrameKey key{ source, line };
+            if (int32* id = frameMap.Find(key)) {
+                if (FCStringAnsi::Strcmp(frames[*id].rawSource.GetData(), source) == 0)
+                    return *id;
+                frameMap.Remove(key);
+            }
+            int32 id = addFrame(source, line);
+            frameMap.Add(key, id);
+            return id;
+        }
+
+        // name isn't a lua string, e.g. name of C function, interned by content
+        int32 internNamedFrame(const FString& name) {
+            if (int32* id = namedFrameMap.Find(name))
+                return *id;
+            int32 id = frames.Add(LuaMemStackFrame{ name, 0, {}, nullptr });
+            namedFrameMap.Add(name, id);
+            return id;
+        }
+
+        // copy stack of other table to this one, frameRemap maps frame ids of other table to this one
+        int32 copyStack(const LuaMemStackTable& other, int32 id, TMap<int32, int32>& frameRemap) {
+            int32 frameIds[MaxSampleStackDepth];
+            int depth = other.stackDepth(id);
+            const int32* otherIds = other.stackFrames(id);
+            for (int i = 0; i < depth; i++) {
+                int32* frameId = frameRemap.Find(otherIds[i]);
+                if (!frameId) {
+                    const LuaMemStackFrame& f = other.frames[otherIds[i]];
+                    int32 newId = frames.Add(f);
+                    if (f.sourceKey)
+                        frameMap.Add(FrameKey{ f.sourceKey, f.lineNumber }, newId);
+                    else
+                        namedFrameMap.Add(f.source, newId);
+                    frameId = &frameRemap.Add(otherIds[i], newId);
+                }
+                frameIds[i] = *frameId;
+            }
+            return internStack(frameIds, depth);
+        }
+
+        int32 internStack(const int32* frameIds, int depth) {
+            uint32 hash = FCrc::MemCrc32(frameIds, depth * sizeof(int32));
+            for (auto it = stackMap.CreateConstKeyIterator(hash); it; ++it) {
+                int32 id = it.Value();
+                if (stackDepth(id) == depth && FMemory::Memcmp(stackFrames(id), frameIds, depth * sizeof(int32)) == 0)
+                    return id;
+            }
+            int32 id = stackOffsets.Add(stackFrameIds.Num());
+            stackFrameIds.Append(frameIds, depth);
+            stackMap.Add(hash, id);
+            return id;
+        }
+
+        int stackDepth(int32 id) const {
+            int32 end = id + 1 < stackOffsets.Num() ? stackOffsets[id + 1] : stackFrameIds.Num();
+            return end - stackOffsets[id];
+        }
+
+        const int32* stackFrames(int32 id) const {
+            return stackFrameIds.GetData() + stackOffsets[id];
+        }
+
+        const LuaMemStackFrame& frame(int32 frameId) const {
+            return frames[frameId];
+        }
+
+        // top frame of stack, used as hint of LuaMemInfo
+        const LuaMemStackFrame& topFrame(int32 id) const {
+            return frames[stackFrames(id)[0]];
+        }
+
+        int32 numEntries() const {
+            return frames.Num() + stackOffsets.Num();
+        }
+
+        FString stackToString(int32 id) const {
+            FString str;
+            const int32* ids = stackFrames(id);
+            for (int i = 0; i < stackDepth(id); i++) {
+                auto& f = frames[ids[i]];
+                str += FString::Printf(TEXT("\n\t%s:%d"), *f.source, f.lineNumber);
+            }
+            return str;
+        }
+
+        void empty() {
+            frames.Empty();
+            frameMap.Empty();
+            namedFrameMap.Empty();
+            stackOffsets.Empty();
+            stackFrameIds.Empty();
+            stackMap.Empty();
+        }
+
+    private:
+        struct FrameKey {
+            const char* source;
+            int line;
+
+            bool operator==(const FrameKey& other) const {
+                return source == other.source && line == other.line;
+            }
+            friend uint32 GetTypeHash(const FrameKey& key) {
+                return HashCombine(PointerHash(key.source), (uint32)key.line);
+            }
+        };
+
+        int32 addFrame(const char* source, int line) {
+            int32 len = FCStringAnsi::Strlen(source);
+            int32 id = frames.Add(LuaMemStackFrame{ UTF8_TO_TCHAR(source), line, {}, source });
+            frames[id].rawSource.Append(source, len + 1);
+            return id;
+        }
+
+        TArray<LuaMemStackFrame> frames;
+        TMap<FrameKey, int32> frameMap;
+        TMap<FString, int32> namedFrameMap;
+        TArray<int32> stackOffsets;
+        TArray<int32> stackFrameIds;
+        TMultiMap<uint32, int32> stackMap;
+    };
+
+    struct LuaSampledAlloc {
+        int32 stackId;
+        int32 scaledSize;
+    };
+
+    struct LuaSampledEvent {
+        void* ptr;
+        int32 stackId;
+        int32 scaledSize;
+        bool bAlloc;
+    };
+
+    struct LuaMemorySampler {
+        int64 sampleInterval;
+        // bytes left before next sample
+        int64 countdown;
+        FRandomStream random;
+        LuaMemStackTable stacks;
+        TMap<void*, LuaSampledAlloc> allocs;
+        TArray<LuaSampledEvent> eventsThisFrame;
+        // stack table is compacted when its entries exceed limit
+        int32 stackLimit;
+
+        explicit LuaMemorySampler(int64 interval)
+            : sampleInterval(interval)
+            , stackLimit(MaxSampleStackEntries)
+            , random(FPlatformTime::Cycles())
+        {
+            countdown = nextCountdown();
+        }
+
+        // distance between samples follow exponential distribution, like tcmalloc/jemalloc heap profiler,
+        // so allocation pattern can't sync with sample points
+        int64 nextCountdown() {
+            double u = FMath::Max(random.GetFraction(), 1e-7f);
+            return (int64)(-FMath::Loge(u) * sampleInterval) + 1;
+        }
+
+        // expected bytes represented by one sample of size
+        int32 scaleSize(size_t size) const {
+            double ratio = (double)size / sampleInterval;
+            double scaled = size / (1.0 - FMath::Exp(-ratio));
+            return (int32)FMath::Min<double>(scaled, MAX_int32);
+        }
+
+        // stacks of freed allocations are dropped, those of live samples and events of this frame are kept,
+        // limit grows with live stacks so table isn't compacted on every sample
+        void compactStacks() {
+            LuaMemStackTable compacted;
+            TMap<int32, int32> stackRemap;
+            TMap<int32, int32> frameRemap;
+            auto remap = [&](int32& stackId) {
+                int32* newId = stackRemap.Find(stackId);
+                if (!newId)
+                    newId = &stackRemap.Add(stackId, compacted.copyStack(stacks, stackId, frameRemap));
+                stackId = *newId;
+            };
+            for (auto& it : allocs)
+                remap(it.Value.stackId);
+            for (auto& event : eventsThisFrame)
+                remap(event.stackId);
+            stacks = MoveTemp(compacted);
+            stackLimit = FMath::Max(MaxSampleStackEntries, stacks.numEntries() * 2);
+        }
+
+        void reset() {
+            for (auto& it : allocs)
+                totalMemory -= it.Value.scaledSize;
+            stacks.empty();
+            allocs.Empty();
+            eventsThisFrame.Empty();
+            stackLimit = MaxSampleStackEntries;
+            countdown = nextCountdown();
+        }
+    };
+
     TMap<LuaState*, MemoryDetail> memoryRecord;
+    // sampled records expanded by memDetail, memoryRecord only keep records of full track
+    TMap<LuaState*, MemoryDetail> sampledRecord;
     TMap<LuaState*, TArray<LuaMemInfo>> memoryIncreaseThisFrame;
 
     bool getMemInfo(LuaState* ls, size_t size, LuaMemInfo& info);
@@ -67,6 +299,70 @@ namespace NS_SLUA {
         totalMemory += size;
     }
 
+    bool getMemStack(LuaState* ls, LuaMemorySampler* sampler, int32& stackId);
+
+    FORCEINLINE void* vmRealloc(LuaState* ls, void* ptr, size_t osize, size_t nsize)
+    {
+        if (auto* allocator = ls->getAllocator())
+            return allocator->realloc(ptr, osize, nsize);
+        return FMemory::Realloc(ptr, nsize);
+    }
+
+    FORCEINLINE void vmFree(LuaState* ls, void* ptr, size_t osize)
+    {
+        if (auto* allocator = ls->getAllocator())
+            allocator->free(ptr, osize);
+        else
+            FMemory::Free(ptr);
+    }
+
+    inline void addSampledRecord(LuaMemorySampler* sampler, void* ptr, size_t size, int32 stackId) {
+        int32 scaledSize = sampler->scaleSize(size);
+        sampler->allocs.Add(ptr, LuaSampledAlloc{ stackId, scaledSize });
+        sampler->eventsThisFrame.Add(LuaSampledEvent{ ptr, stackId, scaledSize, true });
+        totalMemory += scaledSize;
+    }
+
+    inline void removeSampledRecord(LuaMemorySampler* sampler, void* ptr) {
+        LuaSampledAlloc alloc;
+        if (sampler->allocs.RemoveAndCopyValue(ptr, alloc)) {
+            sampler->eventsThisFrame.Add(LuaSampledEvent{ ptr, alloc.stackId, alloc.scaledSize, false });
+            totalMemory -= alloc.scaledSize;
+        }
+    }
+
+    void* sampledAlloc(LuaState* ls, void* ptr, size_t osize, size_t nsize)
+    {
+        LuaMemorySampler* sampler = ls->getMemSampler();
+        if (nsize == 0)
+        {
+            removeSampledRecord(sampler, ptr);
+            vmFree(ls, ptr, osize);
+            return NULL;
+        }
+
+        if (ptr)
+        {
+            removeSampledRecord(sampler, ptr);
+        }
+
+        sampler->countdown -= nsize;
+        if (sampler->countdown > 0)
+        {
+            // fast path, most allocations don't need stack
+            return vmRealloc(ls, ptr, osize, nsize);
+        }
+
+        sampler->countdown = sampler->nextCountdown();
+        int32 stackId = INDEX_NONE;
+        // get stack before realloc to avoid luaD_reallocstack crash!
+        bool bHasStack = getMemStack(ls, sampler, stackId);
+        ptr = vmRealloc(ls, ptr, osize, nsize);
+        if (bHasStack)
+            addSampledRecord(sampler, ptr, nsize, stackId);
+        return ptr;
+    }
+
     inline void removeRecord(LuaState* LS, void* ptr, size_t osize) {
         auto* memoryRecordDetail = TryGetMemoryRecord(LS);
         
@@ -85,13 +381,18 @@ namespace NS_SLUA {
     {
         LuaState* ls = (LuaState*)ud;
         int memTrack = ls->memTrack;
+        if (memTrack == MTM_SAMPLED)
+        {
+            return sampledAlloc(ls, ptr, osize, nsize);
+        }
+
         if (nsize == 0) 
         {
             if (memTrack) 
             {
                 removeRecord(ls, ptr, osize);
             }
-            FMemory::Free(ptr);
+            vmFree(ls, ptr, osize);
             return NULL;
         }
         else 
@@ -108,7 +409,7 @@ namespace NS_SLUA {
                 // get stack before realloc to avoid luaD_reallocstack crash!
                 bHasStack = getMemInfo(ls, nsize, memInfo);
             }
-            ptr = FMemory::Realloc(ptr,nsize);
+            ptr = vmRealloc(ls, ptr, osize, nsize);
             if (bHasStack)
                 addRecord(ls,ptr,nsize,memInfo);
             return ptr;
@@ -120,22 +421,56 @@ namespace NS_SLUA {
         return totalMemory;
     }
 
-    void LuaMemoryProfile::start(lua_State* L)
+    void LuaMemoryProfile::start(lua_State* L, int64 sampleInterval)
     {
         auto LS = LuaState::get(L);
         if (LS)
         {
-            LS->memTrack = 1;
+            if (sampleInterval <= 0)
+            {
+                sampleInterval = MemorySampleInterval;
+            }
+
+            if (sampleInterval > 0)
+            {
+                if (!LS->memSampler || LS->memSampler->sampleInterval != sampleInterval)
+                {
+                    delete LS->memSampler;
+                    LS->memSampler = new LuaMemorySampler(sampleInterval);
+                }
+                LS->memTrack = MTM_SAMPLED;
+            }
+            else
+            {
+                LS->memTrack = MTM_FULL;
+            }
             onStart(LS);
         }
     }
 
+    // drop records of LS and bytes they counted in totalMemory
+    void clearRecords(LuaState* LS)
+    {
+        if (auto* memRecord = memoryRecord.Find(LS))
+        {
+            for (auto& it : *memRecord)
+            {
+                totalMemory -= it.Value.size;
+            }
+            memRecord->Empty();
+        }
+        sampledRecord.Remove(LS);
+        if (auto* sampler = LS->getMemSampler())
+        {
+            sampler->reset();
+        }
+    }
+
     void LuaMemoryProfile::onStart(LuaState* LS)
     {
-        auto *memRecord = TryGetMemoryRecord(LS);
-        auto *memIncrease = TryGetMemoryIncrease(LS);
-        memRecord->Empty();
-        memIncrease->Empty();
+        clearRecords(LS);
+        TryGetMemoryRecord(LS);
+        TryGetMemoryIncrease(LS)->Empty();
     }
 
     void LuaMemoryProfile::stop(lua_State* L)
@@ -151,17 +486,62 @@ namespace NS_SLUA {
     {
         auto *memoryIncrease = TryGetMemoryIncrease(LS);
         memoryIncrease->Empty();
+        if (auto* sampler = LS->getMemSampler())
+        {
+            sampler->eventsThisFrame.Reset();
+        }
+    }
+
+    void LuaMemoryProfile::clean(LuaState* LS)
+    {
+        LS->memTrack = MTM_NONE;
+        clearRecords(LS);
+        delete LS->memSampler;
+        LS->memSampler = nullptr;
+        memoryRecord.Remove(LS);
+        memoryIncreaseThisFrame.Remove(LS);
+    }
+
+    void fillSampledMemInfo(const LuaMemorySampler* sampler, void* ptr, int32 stackId, int32 scaledSize, bool bAlloc, LuaMemInfo& info)
+    {
+        auto& frame = sampler->stacks.topFrame(stackId);
+        info.hint = frame.source;
+        info.lineNumber = frame.lineNumber;
+        info.size = scaledSize;
+        info.ptr = (int64)ptr;
+        info.bAlloc = bAlloc;
     }
 
     const MemoryDetail& LuaMemoryProfile::memDetail(LuaState* LS)
     {
-        auto *memoryRecordDetail = TryGetMemoryRecord(LS);
-        return *memoryRecordDetail;
+        if (LS->memTrack == MTM_SAMPLED)
+        {
+            // expand sampled records only when required
+            auto* sampler = LS->getMemSampler();
+            auto& memoryRecordDetail = sampledRecord.FindOrAdd(LS);
+            memoryRecordDetail.Empty(sampler->allocs.Num());
+            for (auto& it : sampler->allocs)
+            {
+                LuaMemInfo& info = memoryRecordDetail.Add(it.Key);
+                fillSampledMemInfo(sampler, it.Key, it.Value.stackId, it.Value.scaledSize, true, info);
+            }
+            return memoryRecordDetail;
+        }
+        return *TryGetMemoryRecord(LS);
     }
 
     TArray<LuaMemInfo>& LuaMemoryProfile::memIncreaceThisFrame(LuaState* LS)
     {
         auto *memoryIncrease = TryGetMemoryIncrease(LS);
+        if (LS->memTrack == MTM_SAMPLED)
+        {
+            auto* sampler = LS->getMemSampler();
+            memoryIncrease->Reset(sampler->eventsThisFrame.Num());
+            for (auto& event : sampler->eventsThisFrame)
+            {
+                fillSampledMemInfo(sampler, event.ptr, event.stackId, event.scaledSize, event.bAlloc, memoryIncrease->AddDefaulted_GetRef());
+            }
+        }
         return *memoryIncrease;
     }
 
@@ -269,6 +649,90 @@ namespace NS_SLUA {
         return true;
     }
 
+    bool getMemStack(LuaState* ls, LuaMemorySampler* sampler, int32& stackId) {
+        lua_State* L = ls->getLuaState();
+        if (!L) return false;
+
+        // compact before interning, ids interned below stay valid
+        if (sampler->stacks.numEntries() > sampler->stackLimit)
+            sampler->compactStacks();
+
+        int32 frameIds[MaxSampleStackDepth];
+        int depth = 0;
+        FString firstCName = TEXT("C");
+
+        for (int i = 0; depth < MaxSampleStackDepth; i++) {
+            lua_Debug ar;
+#if LUA_VERSION_RELEASE_NUM >= 50406
+            if (lua_getstack(L, i, &ar) && L->base_ci.func.p != nullptr && lua_getinfo(L, "nSl", &ar)) {
+#else
+            if (lua_getstack(L, i, &ar) && lua_getinfo(L, "nSl", &ar)) {
+#endif
+                if (strcmp(ar.what, "C") == 0) {
+                    if (ar.name) {
+                        if (depth == 0) firstCName += UTF8_TO_TCHAR(ar.name);
+                        lua_CFunction cfunc = getCFunction(ar);
+                        if (cfunc == LuaProfiler::resumeFunc && lua_isthread(L, 1)) {
+                            // allocation happened in coroutine, walk coroutine stack first
+                            lua_State* L1 = lua_tothread(L, 1);
+                            if (isCoroutineAlive(L1)) {
+                                L = L1;
+                                i = -1;
+                                continue;
+                            }
+                        }
+                    }
+                    continue;
+                }
+
+                if (strcmp(ar.source, SLUA_LUACODE) == 0)
+                    continue;
+
+                if (strcmp(ar.source, LuaProfiler::ChunkName) == 0)
+                    return false;
+
+                frameIds[depth++] = sampler->stacks.internFrame(ar.source, ar.currentline);
+            }
+            else break;
+        }
+
+        if (depth == 0) {
+            frameIds[depth++] = sampler->stacks.internNamedFrame(firstCName);
+        }
+        stackId = sampler->stacks.internStack(frameIds, depth);
+        return true;
+    }
+
+    void dumpMemorySamples(FOutputDevice& Ar)
+    {
+        for (auto& it : memoryRecord)
+        {
+            LuaState* LS = it.Key;
+            auto* sampler = LS->getMemSampler();
+            if (LS->memTrack != MTM_SAMPLED || !sampler)
+                continue;
+
+            Ar.Logf(TEXT("Lua state %p, sample interval %lld bytes, %d live samples"), LS, sampler->sampleInterval, sampler->allocs.Num());
+            TMap<int32, int64> stackSizes;
+            for (auto& alloc : sampler->allocs)
+            {
+                stackSizes.FindOrAdd(alloc.Value.stackId) += alloc.Value.scaledSize;
+            }
+
+            stackSizes.ValueSort(TGreater<int64>());
+            for (auto& stackIt : stackSizes)
+            {
+                Ar.Logf(TEXT("MemAllocInfo %lld from %s"), stackIt.Value, *sampler->stacks.stackToString(stackIt.Key));
+            }
+        }
+    }
+
+    static FAutoConsoleCommandWithOutputDevice CVarDumpMemorySamples(
+        TEXT("slua.DumpMemorySamples"),
+        TEXT("Dump estimated lua memory group by full stack when memory track is in sampling mode"),
+        FConsoleCommandWithOutputDeviceDelegate::CreateStatic(dumpMemorySamples),
+        ECVF_Default);
+
     void dumpMemoryDetail(FOutputDevice& Ar)
     {
         Ar.Logf(TEXT("Total memory alloc %d bytes"), totalMemory);
@@ -277,7 +741,7 @@ namespace NS_SLUA {
             Ar.Logf(TEXT("Lua state %p"), it.Key);
             TMap<FString, int> MemAllocInfos;
 
-            for (auto& itMemInfo : it.Value)
+            for (auto& itMemInfo : LuaMemoryProfile::memDetail(it.Key))
             {
                 auto& memInfo = itMemInfo.Value;
                 FString Key = FString::Printf(TEXT("%s:%d"), *memInfo.hint, memInfo.lineNumber);
@@ -0,0 +1,103 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "LuaModulePreloader.h"
+#include "LuaScriptArchive.h"
+#include "lauxlib.h"
+#include "Async/Async.h"
+#include "Misc/ScopeLock.h"
+
+namespace NS_SLUA {
+
+    void LuaModulePreloader::start(const TArray<FString>& modules, LuaState::LoadFileDelegate loadFile)
+    {
+        if (modules.Num() == 0 || !loadFile)
+            return;
+
+        // modules are shared by all batches, batch i compiles modules i, i + stride...
+        TSharedRef<TArray<FString>, ESPMode::ThreadSafe> names = MakeShared<TArray<FString>, ESPMode::ThreadSafe>(modules);
+        int32 stride = FMath::Clamp(FPlatformMisc::NumberOfWorkerThreadsToSpawn(), 1, modules.Num());
+        {
+            FScopeLock scopeLock(&lock);
+            pending.Append(modules);
+        }
+        auto self = AsShared();
+        for (int32 i = 0; i < stride; i++) {
+            Async(EAsyncExecution::ThreadPool, [self, names, i, stride, loadFile]() {
+                self->compileBatch(*names, i, stride, loadFile);
+            });
+        }
+    }
+
+    void LuaModulePreloader::compileBatch(const TArray<FString>& modules, int32 first, int32 stride, LuaState::LoadFileDelegate loadFile)
+    {
+        // only compile, no library needed
+        lua_State* L = luaL_newstate();
+        if (!L) return;
+
+        for (int32 i = first; i < modules.Num(); i += stride) {
+            {
+                // required already, don't compile it at all
+                FScopeLock scopeLock(&lock);
+                if (!pending.Contains(modules[i]))
+                    continue;
+            }
+
+            FString filepath;
+            TArray<uint8> source = loadFile(TCHAR_TO_UTF8(*modules[i]), filepath);
+
+            // same chunk name as LuaState::loader, compile error is reported when it's required
+            TArray<uint8> code;
+            if (source.Num() > 0) {
+                char chunk[256];
+                snprintf(chunk, 256, "@%s", TCHAR_TO_UTF8(*filepath));
+                if (!LuaScriptArchive::compile(L, source.GetData(), source.Num(), chunk, false, code))
+                    code.Empty();
+            }
+
+            // module required while compiling had loaded its source, drop the bytecode
+            FScopeLock scopeLock(&lock);
+            if (pending.Remove(modules[i]) > 0 && code.Num() > 0)
+                ready.Add(modules[i], MoveTemp(code));
+        }
+        lua_close(L);
+    }
+
+    bool LuaModulePreloader::take(const char* fn, TArray<uint8>& outCode)
+    {
+        FScopeLock scopeLock(&lock);
+        if (ready.Num() == 0 && pending.Num() == 0)
+            return false;
+        FString name = UTF8_TO_TCHAR(fn);
+        TArray<uint8>* code = ready.Find(name);
+        if (!code) {
+            pending.Remove(name);
+            return false;
+        }
+        outCode = MoveTemp(*code);
+        ready.Remove(name);
+        return true;
+    }
+
+    int32 LuaModulePreloader::numReady()
+    {
+        FScopeLock scopeLock(&lock);
+        return ready.Num();
+    }
+
+    int32 LuaModulePreloader::numPending()
+    {
+        FScopeLock scopeLock(&lock);
+        return pending.Num();
+    }
+}
@@ -0,0 +1,44 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "LuaState.h"
+
+namespace NS_SLUA {
+
+    // read and compile modules to bytecode on worker threads, each worker has its own scratch lua_State.
+    // worker tasks hold a shared reference, so LuaState can be closed while they are running.
+    class LuaModulePreloader : public TSharedFromThis<LuaModulePreloader, ESPMode::ThreadSafe>
+    {
+    public:
+        // loadFile is called on worker threads at the same time, it must be thread safe
+        void start(const TArray<FString>& modules, LuaState::LoadFileDelegate loadFile);
+
+        // move out bytecode of fn, false if fn isn't preloaded or still compiling.
+        // fn still compiling is loaded from source by caller, its bytecode is dropped when compiled,
+        // so a module required again after reloading never gets code read before the first require
+        bool take(const char* fn, TArray<uint8>& outCode);
+
+        int32 numReady();
+        // modules neither compiled nor required yet
+        int32 numPending();
+
+    private:
+        void compileBatch(const TArray<FString>& modules, int32 first, int32 stride, LuaState::LoadFileDelegate loadFile);
+
+        FCriticalSection lock;
+        TMap<FString, TArray<uint8>> ready;
+        TSet<FString> pending;
+    };
+}
@@ -97,6 +97,18 @@ namespace NS_SLUA
         }
     }
 
+    bool LuaNet::prepareReplication(UObject* obj, uint32 replicationFrame, UPackageMap* map)
+    {
+        void** ptr = objectToLuaNetAddressMap.Find(obj);
+        if (!ptr)
+        {
+            return false;
+        }
+
+        auto proxy = luaNetSerializationMap.FindChecked(*ptr);
+        return ((FLuaNetSerialization*)*ptr)->PrepareReplication(*proxy, map, replicationFrame);
+    }
+
     void LuaNet::onObjectDeleted(UClass* cls)
     {
         auto classLuaReplicatedPtr = classLuaReplicatedMap.Find(cls);
@@ -913,6 +913,30 @@ bool FLuaNetSerialization::UpdateChangeListMgr(NS_SLUA::FLuaNetSerializationProx
     return true;
 }
 
+bool FLuaNetSerialization::PrepareReplication(NS_SLUA::FLuaNetSerializationProxy& proxy, UPackageMap* map, uint32 ReplicationFrame)
+{
+    auto obj = proxy.owner.Get();
+    if (!obj)
+    {
+        return false;
+    }
+
+    CompareProperties(obj, proxy, ReplicationFrame);
+    if (!UpdateChangeListMgr(proxy, ReplicationFrame) || !proxy.bDirtyThisFrame)
+    {
+        return false;
+    }
+
+    // changes of this frame only, what Write sends to a connection that got last frame
+    const int32 historyIndex = (proxy.historyEnd - 1) % NS_SLUA::FLuaNetSerializationProxy::MAX_CHANGE_HISTORY;
+    auto& changes = proxy.changeHistorys[historyIndex];
+    if (!changes.IsEmpty() && !proxy.sharedSerialization.IsValid())
+    {
+        BuildSharedSerialization(map, NS_SLUA::LuaNet::getClassReplicatedProps(obj), &proxy, changes, proxy.arrayChangeHistorys[historyIndex]);
+    }
+    return true;
+}
+
 void FLuaNetSerialization::BuildSharedSerialization(UPackageMap* map, NS_SLUA::ClassLuaReplicated* classLuaReplicated,
     NS_SLUA::FLuaNetSerializationProxy* proxy, const LuaBitArray& changes, const TMap<int32, LuaBitArray>& arrayChanges)
 {
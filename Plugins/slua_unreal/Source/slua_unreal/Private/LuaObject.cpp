@@ -28,6 +28,7 @@
 #include "LuaArray.h"
 #include "LuaMap.h"
 #include "LuaSet.h"
+#include "LuaContainerConvert.h"
 #include "LuaState.h"
 #include "LuaWrapper.h"
 
@@ -58,6 +59,13 @@ FAutoConsoleVariableRef CVarSluaEnableReference(
     GSluaEnableReference,
     TEXT("Whether enable struct reference."));
 
+static int32 GSluaPrecompileAccessors = 1;
+FAutoConsoleVariableRef CVarSluaPrecompileAccessors(
+    TEXT("slua.PrecompileAccessors"),
+    GSluaPrecompileAccessors,
+    TEXT("Whether accessors of all properties of a class are added when the class is first indexed, otherwise they are added as properties are indexed.\n"),
+    ECVF_Default);
+
 namespace NS_SLUA {
     static const uint64 ReferenceCastFlags = FArrayProperty::StaticClassCastFlags()
         | FMapProperty::StaticClassCastFlags()
@@ -462,8 +470,9 @@ namespace NS_SLUA {
             if (lua_getfield(L, -1, "__name") == LUA_TSTRING) {
                 auto name = lua_tostring(L, -1);
                 // skip first prefix "F" or "U" or "A"
-                if (noprefix) return strcmp(name + 1, tn) == 0;
-                else return strcmp(name, tn) == 0;
+                bool match = noprefix ? strcmp(name + 1, tn) == 0 : strcmp(name, tn) == 0;
+                lua_pop(L, 2);
+                return match;
             }
 
             lua_pop(L, 2);
@@ -500,7 +509,63 @@ namespace NS_SLUA {
         return nullptr;
     }
 
-    int LuaObject::setUservalueMeta(lua_State* L, UStruct* cls)
+    int instanceIndex(lua_State* L);
+
+    // push accessor of a property, a closure whose upvalues are read by fastIndex and fastNewIndex
+    static void pushAccessor(lua_State* L, FProperty* prop, void* pusher, void* checker, bool bReferencePusher)
+    {
+        lua_pushlightuserdata(L, prop);
+        lua_pushlightuserdata(L, pusher);
+        lua_pushlightuserdata(L, checker);
+        lua_pushboolean(L, !!bReferencePusher);
+        lua_pushcclosure(L, instanceIndex, 4);
+    }
+
+    // reference pusher if property is pushed by reference, otherwise value pusher
+    static void* getAccessorPusher(FProperty* up, bool& bReferencePusher)
+    {
+        bReferencePusher = false;
+        void* pusher = nullptr;
+#if (ENGINE_MINOR_VERSION<25) && (ENGINE_MAJOR_VERSION==4)
+        if (GSluaEnableReference || up->GetClass()->HasAnyCastFlag(ReferenceCastFlags))
+#elif ENGINE_MAJOR_VERSION >= 5
+        if (GSluaEnableReference || (up->GetCastFlags() & ReferenceCastFlags))
+#else
+        if (GSluaEnableReference || up->HasAnyCastFlags(ReferenceCastFlags))
+#endif
+        {
+            pusher = (void*)LuaObject::getReferencePusher(up);
+            bReferencePusher = pusher != nullptr;
+        }
+
+        if (!pusher)
+        {
+            pusher = (void*)LuaObject::getPusher(up);
+        }
+        return pusher;
+    }
+
+    // add accessors of properties to accessor table on top
+    static void compileClassAccessors(lua_State* L, const TMap<SimpleString, FProperty*>& props)
+    {
+        for (auto& it : props)
+        {
+            FProperty* up = it.Value;
+            auto checker = LuaObject::getChecker(up);
+            bool bReferencePusher;
+            void* pusher = getAccessorPusher(up, bReferencePusher);
+            if (!pusher || !checker)
+            {
+                continue;
+            }
+
+            lua_pushstring(L, it.Key.c_str());
+            pushAccessor(L, up, pusher, (void*)checker, bReferencePusher);
+            lua_rawset(L, -3);
+        }
+    }
+
+    int LuaObject::pushClassAccessors(lua_State* L, UStruct* cls)
     {
         auto ls = LuaState::get(L);
         lua_geti(L, LUA_REGISTRYINDEX, ls->cacheClassPropRef);
@@ -512,69 +577,107 @@ namespace NS_SLUA {
         {
             lua_pop(L, 1);
             lua_newtable(L);
+            // accessor table is metatable of instance tables, values cached by them are weak
             lua_pushstring(L, "v");
             lua_setfield(L, -2, "__mode");
+            // struct accessors are added as they are indexed, replicated struct references need their replicated index
+            if (GSluaPrecompileAccessors && cls->IsA<UClass>())
+            {
+                compileClassAccessors(L, ls->classMap.getProps(cls));
+            }
 
             lua_pushlightuserdata(L, cls);
             lua_pushvalue(L, -2);
             lua_rawset(L, -4);
         }
         lua_remove(L, -2); // remove cache table
-        
+        return 1;
+    }
+
+    int LuaObject::setUservalueMeta(lua_State* L, UStruct* cls)
+    {
+        pushClassAccessors(L, cls);
         lua_setmetatable(L, -2);
         return 1;
     }
 
+    // objects cache accessors and values in a cache slot, uservalue of userdata or CACHE_NAME field of lua self table.
+    // the slot holds accessor table of object's class shared by all its objects, until object caches a value of its own,
+    // then it holds an instance table whose metatable is the accessor table. accessor table has no metatable.
+    static int getCacheSlot(lua_State* L, int selfType)
+    {
+        if (selfType == LUA_TUSERDATA)
+        {
+            return lua_getuservalue(L, 1);
+        }
+        lua_pushstring(L, LuaOverrider::CACHE_NAME);
+        return lua_rawget(L, 1);
+    }
+
+    // pop value on top to cache slot
+    static void setCacheSlot(lua_State* L, int selfType)
+    {
+        if (selfType == LUA_TUSERDATA)
+        {
+            lua_setuservalue(L, 1);
+        }
+        else
+        {
+            lua_pushstring(L, LuaOverrider::CACHE_NAME);
+            lua_insert(L, -2);
+            lua_rawset(L, 1);
+        }
+    }
+
+    // push accessor table of self, an empty cache slot is set to accessor table of cls
+    static void pushAccessors(lua_State* L, int selfType, UStruct* cls)
+    {
+        if (getCacheSlot(L, selfType) == LUA_TNIL)
+        {
+            lua_pop(L, 1);
+            LuaObject::pushClassAccessors(L, cls);
+            lua_pushvalue(L, -1);
+            setCacheSlot(L, selfType);
+        }
+        else if (lua_getmetatable(L, -1))
+        {
+            lua_remove(L, -2);
+        }
+    }
+
+    // push instance table of self, create it on first value cached by self
+    static void pushInstanceCache(lua_State* L, int selfType, UStruct* cls)
+    {
+        if (getCacheSlot(L, selfType) == LUA_TNIL)
+        {
+            lua_pop(L, 1);
+            LuaObject::pushClassAccessors(L, cls);
+        }
+        else if (lua_getmetatable(L, -1))
+        {
+            lua_pop(L, 1);
+            return;
+        }
+
+        lua_newtable(L);
+        lua_insert(L, -2);
+        lua_setmetatable(L, -2);
+        lua_pushvalue(L, -1);
+        setCacheSlot(L, selfType);
+    }
+
     int LuaObject::pushReferenceAndCache(const ReferencePusherPropertyFunction& pusher, lua_State* L, UStruct* cls,
                                         FProperty* prop, uint8* parms, void* parentAdrres, uint16 replicateIndex)
     {
         int ret = pusher(L, prop, parms, parentAdrres, replicateIndex);
         if (ret) {
             int selfType = lua_type(L, 1);
-            if (selfType == LUA_TUSERDATA) {
-                if (lua_getuservalue(L, 1) == LUA_TNIL) {
-                    lua_pop(L, 1);
-                    lua_newtable(L);
-                    lua_setuservalue(L, 1);
-#if LUA_VERSION_RELEASE_NUM >= 50406
-                    L->top.p++;
-#else
-                    L->top++;
-#endif
-                    setUservalueMeta(L, cls);
-                }
-
+            if (selfType == LUA_TUSERDATA || selfType == LUA_TTABLE) {
+                pushInstanceCache(L, selfType, cls);
                 lua_pushvalue(L, 2); // push key
                 lua_pushvalue(L, -3); // push reference value
                 lua_rawset(L, -3);
-#if LUA_VERSION_RELEASE_NUM >= 50406
-                L->top.p--;
-#else
-                L->top--;
-#endif
-            }
-            else if (selfType == LUA_TTABLE) {
-                lua_pushstring(L, LuaOverrider::CACHE_NAME);
-                if (lua_rawget(L, 1) == LUA_TNIL) {
-#if LUA_VERSION_RELEASE_NUM >= 50406
-                    L->top.p--;
-#else
-                    L->top--;
-#endif
-                    lua_newtable(L);
-                    setUservalueMeta(L, cls);
-                    lua_pushstring(L, LuaOverrider::CACHE_NAME);
-                    lua_pushvalue(L, -2);
-                    lua_rawset(L, 1);
-                }
-                lua_pushvalue(L, 2); // push key
-                lua_pushvalue(L, -3); // push reference value
-                lua_rawset(L, -3);
-#if LUA_VERSION_RELEASE_NUM >= 50406
-                    L->top.p--;
-#else
-                    L->top--;
-#endif
+                lua_pop(L, 1);
             }
         }
         return ret;
@@ -714,27 +817,11 @@ namespace NS_SLUA {
         
         if (ensure(selfType == LUA_TUSERDATA)) 
         {
-            if (lua_getuservalue(L, 1) == LUA_TNIL) 
-            {
-                lua_pop(L, 1);
-                lua_newtable(L);
-                lua_setuservalue(L, 1);
-#if LUA_VERSION_RELEASE_NUM >= 50406
-                L->top.p++;
-#else
-                L->top++;
-#endif
-                LuaObject::setUservalueMeta(L, cls);
-            }
-
+            pushInstanceCache(L, selfType, cls);
             lua_pushvalue(L, 2); // push key
             lua_pushvalue(L, -3); // push reference value
             lua_rawset(L, -3);
-#if LUA_VERSION_RELEASE_NUM >= 50406
-            L->top.p--;
-#else
-            L->top--;
-#endif
+            lua_pop(L, 1);
         }
     }
 
@@ -992,199 +1079,111 @@ namespace NS_SLUA {
 
     int LuaObject::fastIndex(lua_State* L, uint8* parent, UStruct* cls)
     {
-        switch (lua_type(L, 1)) 
+        int selfType = lua_type(L, 1);
+        if (selfType != LUA_TUSERDATA && selfType != LUA_TTABLE)
         {
-        case LUA_TUSERDATA:
-            if (lua_getuservalue(L, 1) != LUA_TNIL) 
-            {
-                lua_pushvalue(L, 2);
-                if (lua_rawget(L, -2) != LUA_TNIL)
-                {
-                    return 1;
-                }
-#if LUA_VERSION_RELEASE_NUM >= 50406
-                L->top.p--;
-#else
-                L->top--;
-#endif
-            
-                if (lua_getmetatable(L, -1)) 
-                {
-                    lua_pushvalue(L, 2);
-                    int cacheType = lua_rawget(L, -2);
-                    if (cacheType == LUA_TFUNCTION) {
-#if LUA_VERSION_NUM >= 504
-#if LUA_VERSION_RELEASE_NUM >= 50406
-                        TValue* v = s2v(L->top.p - 1);
-#else
-                        TValue* v = s2v(L->top - 1);
-#endif
-                        CClosure* f = clCvalue(v);
-#else
-                        CClosure* f = clCvalue(L->top - 1);
-#endif
-
-                        auto prop = (FProperty*)pvalue(&f->upvalue[0]);
-                        void* pusher = pvalue(&f->upvalue[1]);
-#if LUA_VERSION_NUM >= 504
-                        bool bReferencePusher = !l_isfalse(&f->upvalue[3]);
-#else
-                        bool bReferencePusher = !!bvalue(&f->upvalue[3]);
-#endif
-                        if (bReferencePusher)
-                        {
-                            auto ud = reinterpret_cast<GenericUserData*>(lua_touserdata(L, 1));
-                            void* parentAddress = ud->parent ? ud->parent : parent;
-                            return pushReferenceAndCache((ReferencePusherPropertyFunction)pusher, L,
-                                                         prop->GetOwnerClass(), prop,
-                                                         parent + prop->GetOffset_ForInternal(), parentAddress, InvalidReplicatedIndex);
-                        }
-                        else
-                        {
-                            return ((PushPropertyFunction)pusher)(L, prop, parent + prop->GetOffset_ForInternal(), 0, nullptr);
-                        }
-                    }
-                    lua_pop(L, 2);
-                }
+            return 0;
+        }
 
+        int top = lua_gettop(L);
+        if (getCacheSlot(L, selfType) == LUA_TNIL)
+        {
+            // first index of object, share accessor table of its class instead of creating an instance table
+            lua_pop(L, 1);
+            pushClassAccessors(L, cls);
+            lua_pushvalue(L, -1);
+            setCacheSlot(L, selfType);
+        }
+        else if (lua_getmetatable(L, -1))
+        {
+            // instance table, values cached by object first
+            lua_pushvalue(L, 2);
+            if (lua_rawget(L, -3) != LUA_TNIL)
+            {
+                return 1;
             }
-
             lua_pop(L, 1);
-            break;
-        case LUA_TTABLE:
-            lua_pushstring(L, LuaOverrider::CACHE_NAME);
-            if (lua_rawget(L, 1)) {
-                lua_pushvalue(L, 2);
-                if (lua_rawget(L, -2) != LUA_TNIL)
-                {
-                    return 1;
-                }
-#if LUA_VERSION_RELEASE_NUM >= 50406
-                L->top.p--;
-#else
-                L->top--;
-#endif
+        }
 
-                if (lua_getmetatable(L, -1))
-                {
-                    lua_pushvalue(L, 2);
-                    int cacheType = lua_rawget(L, -2);
-                    if (cacheType == LUA_TFUNCTION) {
+        lua_pushvalue(L, 2);
+        if (lua_rawget(L, -2) == LUA_TFUNCTION)
+        {
 #if LUA_VERSION_NUM >= 504
 #if LUA_VERSION_RELEASE_NUM >= 50406
-                        TValue* v = s2v(L->top.p - 1);
+            TValue* v = s2v(L->top.p - 1);
 #else
-                        TValue* v = s2v(L->top - 1);
+            TValue* v = s2v(L->top - 1);
 #endif
-                        CClosure* f = clCvalue(v);
+            CClosure* f = clCvalue(v);
 #else
-                        CClosure* f = clCvalue(L->top - 1);
+            CClosure* f = clCvalue(L->top - 1);
 #endif
 
-                        auto prop = (FProperty*)pvalue(&f->upvalue[0]);
-                        void* pusher = pvalue(&f->upvalue[1]);
-
+            auto prop = (FProperty*)pvalue(&f->upvalue[0]);
+            void* pusher = pvalue(&f->upvalue[1]);
 #if LUA_VERSION_NUM >= 504
-                        bool bReferencePusher = !l_isfalse(&f->upvalue[3]);
+            bool bReferencePusher = !l_isfalse(&f->upvalue[3]);
 #else
-                        bool bReferencePusher = !!bvalue(&f->upvalue[3]);
+            bool bReferencePusher = !!bvalue(&f->upvalue[3]);
 #endif
+            if (!bReferencePusher)
+            {
+                return ((PushPropertyFunction)pusher)(L, prop, parent + prop->GetOffset_ForInternal(), 0, nullptr);
+            }
 
-                        if (bReferencePusher)
-                        {
-                            return pushReferenceAndCache((ReferencePusherPropertyFunction)pusher, L,
-                                                         cls, prop,
-                                                         parent + prop->GetOffset_ForInternal(), parent, InvalidReplicatedIndex);
-                        }
-                        else
-                        {
-                            return ((PushPropertyFunction)pusher)(L, prop, parent + prop->GetOffset_ForInternal(), 0, nullptr);
-                        }
-                    }
-                    lua_pop(L, 2);
-                }
+            if (selfType == LUA_TUSERDATA)
+            {
+                auto ud = reinterpret_cast<GenericUserData*>(lua_touserdata(L, 1));
+                void* parentAddress = ud->parent ? ud->parent : parent;
+                return pushReferenceAndCache((ReferencePusherPropertyFunction)pusher, L,
+                                             prop->GetOwnerClass(), prop,
+                                             parent + prop->GetOffset_ForInternal(), parentAddress, InvalidReplicatedIndex);
             }
-            lua_pop(L, 1);
-            break;
-        default:
-            break;
+            return pushReferenceAndCache((ReferencePusherPropertyFunction)pusher, L,
+                                         cls, prop,
+                                         parent + prop->GetOffset_ForInternal(), parent, InvalidReplicatedIndex);
         }
-        
+
+        lua_settop(L, top);
         return 0;
     }
 
     int LuaObject::fastNewIndex(lua_State* L, uint8* parent)
     {
-        switch (lua_type(L, 1))
+        int selfType = lua_type(L, 1);
+        if (selfType != LUA_TUSERDATA && selfType != LUA_TTABLE)
         {
-        case LUA_TUSERDATA:
-            if (lua_getuservalue(L, 1) != LUA_TNIL) 
-            {
-                if (lua_getmetatable(L, -1)) 
-                {
-                    lua_pushvalue(L, 2);
-                    int cacheType = lua_rawget(L, -2);
-                    if (cacheType == LUA_TFUNCTION) {
-#if LUA_VERSION_NUM > 503
-#if LUA_VERSION_RELEASE_NUM >= 50406
-                        TValue* v = s2v(L->top.p - 1);
-#else
-                        TValue* v = s2v(L->top - 1);
-#endif
-                        CClosure* f = clCvalue(v);
-#else
-                        CClosure* f = clCvalue(L->top - 1);
-#endif
-
-                        auto prop = (FProperty*)pvalue(&f->upvalue[0]);
-                        auto checker = (CheckPropertyFunction)pvalue(&f->upvalue[2]);
-                        checker(L, prop, parent + prop->GetOffset_ForInternal(), 3, true);
-                        lua_pop(L, 2);
-                        return 1;
-                    }
-                    lua_pop(L, 2);
-                    return 0;
-                }
-            }
+            return 0;
+        }
 
-            lua_pop(L, 1);
-            break;
-        case LUA_TTABLE:
-            lua_pushstring(L, LuaOverrider::CACHE_NAME);
-            if (lua_rawget(L, 1)) {
-                if (lua_getmetatable(L, -1))
-                {
-                    lua_pushvalue(L, 2);
-                    int cacheType = lua_rawget(L, -2);
-                    if (cacheType == LUA_TFUNCTION) {
-#if LUA_VERSION_NUM > 503
+        int top = lua_gettop(L);
+        if (getCacheSlot(L, selfType) != LUA_TNIL)
+        {
+            // accessor table is metatable of instance table or the slot itself
+            lua_getmetatable(L, -1);
+            lua_pushvalue(L, 2);
+            if (lua_rawget(L, -2) == LUA_TFUNCTION)
+            {
+#if LUA_VERSION_NUM >= 504
 #if LUA_VERSION_RELEASE_NUM >= 50406
-                        TValue* v = s2v(L->top.p - 1);
+                TValue* v = s2v(L->top.p - 1);
 #else
-                        TValue* v = s2v(L->top - 1);
+                TValue* v = s2v(L->top - 1);
 #endif
-                        CClosure* f = clCvalue(v);
+                CClosure* f = clCvalue(v);
 #else
-                        CClosure* f = clCvalue(L->top - 1);
+                CClosure* f = clCvalue(L->top - 1);
 #endif
 
-                        auto prop = (FProperty*)pvalue(&f->upvalue[0]);
-                        auto checker = (CheckPropertyFunction)pvalue(&f->upvalue[2]);
-                        checker(L, prop, parent + prop->GetOffset_ForInternal(), 3, true);
-                        lua_pop(L, 3);
-                        return 1;
-                    }
-                    lua_pop(L, 3);
-                    return 0;
-                }
+                auto prop = (FProperty*)pvalue(&f->upvalue[0]);
+                auto checker = (CheckPropertyFunction)pvalue(&f->upvalue[2]);
+                checker(L, prop, parent + prop->GetOffset_ForInternal(), 3, true);
+                lua_settop(L, top);
+                return 1;
             }
-            
-            lua_pop(L, 1);
-            break;
-        default:
-            break;
         }
-        
+
+        lua_settop(L, top);
         return 0;
     }
 
@@ -1253,57 +1252,18 @@ namespace NS_SLUA {
     bool cachePropertyOperator(lua_State* L, FProperty* prop, UStruct* cls, void* pusher, void* checker, bool bReferencePusher)
     {
         int selfType = lua_type(L, 1);
-        if (selfType == LUA_TUSERDATA) {
-            if (lua_getuservalue(L, 1) == LUA_TNIL) {
-                lua_pop(L, 1);
-                lua_newtable(L);
-                lua_setuservalue(L, 1);
-#if LUA_VERSION_RELEASE_NUM >= 50406
-                L->top.p++;
-#else
-                L->top++;
-#endif
-                LuaObject::setUservalueMeta(L, cls);
-            }
-
-            lua_getmetatable(L, -1);
-            lua_pushvalue(L, 2);
-            lua_pushlightuserdata(L, prop);
-            lua_pushlightuserdata(L, pusher);
-            lua_pushlightuserdata(L, checker);
-            lua_pushboolean(L, !!bReferencePusher);
-            lua_pushcclosure(L, instanceIndex, 4);
-            lua_rawset(L, -3);
-            lua_pop(L, 2);
-            return true;
-        }
-        else if (selfType == LUA_TTABLE) {
-            lua_pushstring(L, LuaOverrider::CACHE_NAME);
-            if (lua_rawget(L, 1) == LUA_TNIL) {
-#if LUA_VERSION_RELEASE_NUM >= 50406
-                L->top.p--;
-#else
-                L->top--;
-#endif
-                lua_newtable(L);
-                LuaObject::setUservalueMeta(L, cls);
-                lua_pushstring(L, LuaOverrider::CACHE_NAME);
-                lua_pushvalue(L, -2);
-                lua_rawset(L, 1);
-            }
-            lua_getmetatable(L, -1);
-            lua_pushvalue(L, 2);
-            lua_pushlightuserdata(L, prop);
-            lua_pushlightuserdata(L, pusher);
-            lua_pushlightuserdata(L, checker);
-            lua_pushboolean(L, !!bReferencePusher);
-            lua_pushcclosure(L, instanceIndex, 4);
-            lua_rawset(L, -3);
-            lua_pop(L, 1);
-            return true;
+        if (selfType != LUA_TUSERDATA && selfType != LUA_TTABLE)
+        {
+            return false;
         }
 
-        return false;
+        // accessor is added to accessor table of class, object doesn't need an instance table for it
+        pushAccessors(L, selfType, cls);
+        lua_pushvalue(L, 2);
+        pushAccessor(L, prop, pusher, checker, bReferencePusher);
+        lua_rawset(L, -3);
+        lua_pop(L, 1);
+        return true;
     }
 
     int LuaObject::objectIndex(lua_State* L, UObject* obj, const char* name, bool cacheToLua) {
@@ -1395,25 +1355,8 @@ namespace NS_SLUA {
         auto checker = LuaObject::getChecker(up);
         if (!checker) luaL_error(L, "Property %s type is not support", name);
 
-        bool bReferencePusher = false;
-        void* pusher = nullptr;
-#if (ENGINE_MINOR_VERSION<25) && (ENGINE_MAJOR_VERSION==4)
-        if (GSluaEnableReference || up->GetClass()->HasAnyCastFlag(ReferenceCastFlags))
-#elif ENGINE_MAJOR_VERSION >= 5
-        if (GSluaEnableReference || (up->GetCastFlags() & ReferenceCastFlags))
-#else
-        if (GSluaEnableReference || up->HasAnyCastFlags(ReferenceCastFlags))
-#endif
-        {
-            pusher = (void*)getReferencePusher(up);
-            bReferencePusher = pusher != nullptr;
-        }
-
-        if (!pusher)
-        {
-            pusher = (void*)getPusher(up);
-        }
-
+        bool bReferencePusher;
+        void* pusher = getAccessorPusher(up, bReferencePusher);
         cachePropertyOperator(L, up, cls, pusher, (void*)checker, bReferencePusher);
 
         // set property value
@@ -1894,23 +1837,13 @@ namespace NS_SLUA {
             int arraySize = lua_rawlen(L, i);
             if (arraySize <= 0)
                 return 0;
-            int tableIndex = i;
-            if (i < 0 && i > LUA_REGISTRYINDEX) {
-                tableIndex = i - 1;
-            }
 
             FScriptArrayHelper arrayHelper(p, parms);
             arrayHelper.Resize(arraySize);
-
-            auto checker = LuaObject::getChecker(p->Inner);
-
-            int index = 0;
-
-            lua_pushnil(L);
-            while (index < arraySize && lua_next(L, tableIndex) != 0) {
-                checker(L, p->Inner, arrayHelper.GetRawPtr(index++), -1, bForceCopy);
-                lua_pop(L, 1);
-            }
+            // nil of table is skipped as iterating it does
+            int32 num = LuaContainerConvert::readArray(L, i, p->Inner, arrayHelper.GetRawPtr(0), arraySize, bForceCopy);
+            if (num < arraySize)
+                arrayHelper.Resize(num);
             return nullptr;
         }
 
@@ -1955,26 +1888,8 @@ namespace NS_SLUA {
         ensure(p);
 
         if (lua_istable(L, i)) {
-            int tableIndex = i;
-            if (i < 0 && i > LUA_REGISTRYINDEX) {
-                tableIndex = i - 1;
-            }
-            
             FScriptMapHelper mapHelper(p, parms);
-
-            lua_pushnil(L);
-            while (lua_next(L, tableIndex) != 0) {
-                FDefaultConstructedPropertyElement tempKey(p->KeyProp);
-                FDefaultConstructedPropertyElement tempValue(p->ValueProp);
-                auto keyPtr = tempKey.GetObjAddress();
-                auto valuePtr = tempValue.GetObjAddress();
-                auto keyChecker = LuaObject::getChecker(p->KeyProp);
-                auto valueChecker = LuaObject::getChecker(p->ValueProp);
-                keyChecker(L, p->KeyProp, (uint8*)keyPtr, -2, bForceCopy);
-                valueChecker(L, p->ValueProp, (uint8*)valuePtr, -1, bForceCopy);
-                mapHelper.AddPair(keyPtr, valuePtr);
-                lua_pop(L, 1);
-            }
+            LuaContainerConvert::readMap(L, i, p->KeyProp, p->ValueProp, mapHelper);
             return nullptr;
         }
 
@@ -2008,24 +1923,8 @@ namespace NS_SLUA {
         ensure(p);
 
         if (lua_istable(L, i)) {
-            int tableIndex = i;
-            if (i <0 && i > LUA_REGISTRYINDEX) {
-                tableIndex = i - 1;
-            }
-
             FScriptSetHelper SetHelper(p, params);
-
-            lua_pushnil(L);
-
-            const auto ElementChecker = LuaObject::getChecker(p->ElementProp);
-
-            while (lua_next(L, tableIndex) != 0) {
-                FDefaultConstructedPropertyElement TempInElement(p->ElementProp);
-                const auto ElementPtr = TempInElement.GetObjAddress();
-                ElementChecker(L, p->ElementProp, static_cast<uint8*>(ElementPtr), -1, bForceCopy);
-                SetHelper.AddElement(ElementPtr);
-                lua_pop(L, 1);
-            }
+            LuaContainerConvert::readSet(L, i, p->ElementProp, SetHelper);
             return nullptr;
         }
         CheckUD(LuaSet, L, i);
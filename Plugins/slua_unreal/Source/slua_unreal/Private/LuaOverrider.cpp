@@ -20,6 +20,7 @@
 #include "GameFramework/Pawn.h"
 #include "GameFramework/InputSettings.h"
 #include "GameFramework/PlayerController.h"
+#include <atomic>
 
 #if (ENGINE_MINOR_VERSION<25) && (ENGINE_MAJOR_VERSION==4)
     typedef NS_SLUA::FProperty FProperty;
@@ -173,6 +174,7 @@ void ULuaOverrider::luaOverrideFunc(UObject* Context, FFrame& Stack, RESULT_DECL
             if (luaFunc.isValid())
             {
                 NS_SLUA::AutoStack as(L);
+                NS_SLUA::LuaFrameBudgetScope budgetScope(NS_SLUA::LuaState::get(L), NS_SLUA::ELuaEntryPoint::Override, func);
                 luaFunc.callByUFunction(func, locals, bContextOp ? nullptr : Stack.OutParms, luaSelfTable);
                 bCallSuper = false;
             }
@@ -518,6 +520,71 @@ namespace NS_SLUA
     FRWLock LuaOverrider::classHookMutex;
     TMap<TWeakObjectPtr<UClass>, UClass::ClassConstructorType> LuaOverrider::classConstructors;
     TMap<UObject*, TArray<LuaOverrider*>> LuaOverrider::objectOverriders;
+    TMap<TWeakObjectPtr<UClass>, LuaOverrider::ClassLuaFilePath> LuaOverrider::classLuaFilePaths;
+
+    namespace {
+        enum EClassHookState : uint8 {
+            ClassHookUnknown = 0,
+            ClassNotHookable,
+            ClassHookable,
+        };
+
+        // hookable decision of classes indexed by object index of class,
+        // read and written on any thread without lock, chunks are never freed
+        class ClassHookStateTable {
+        public:
+            uint8 get(int32 index) const {
+                if (index < 0 || index >= ChunkSize * MaxChunks) return ClassHookUnknown;
+                const std::atomic<uint8>* chunk = chunks[index / ChunkSize].load(std::memory_order_acquire);
+                return chunk ? chunk[index % ChunkSize].load(std::memory_order_relaxed) : ClassHookUnknown;
+            }
+
+            void set(int32 index, uint8 state) {
+                if (index < 0 || index >= ChunkSize * MaxChunks) return;
+                std::atomic<std::atomic<uint8>*>& slot = chunks[index / ChunkSize];
+                std::atomic<uint8>* chunk = slot.load(std::memory_order_acquire);
+                if (!chunk) {
+                    std::atomic<uint8>* newChunk = new std::atomic<uint8>[ChunkSize]();
+                    if (slot.compare_exchange_strong(chunk, newChunk, std::memory_order_acq_rel)) {
+                        chunk = newChunk;
+                    }
+                    else {
+                        // other thread won, chunk is loaded by compare_exchange
+                        delete[] newChunk;
+                    }
+                }
+                chunk[index % ChunkSize].store(state, std::memory_order_relaxed);
+            }
+
+            // forget all decisions, e.g. index of a class deleted while nobody listened may be reused
+            void reset() {
+                for (auto& slot : chunks) {
+                    std::atomic<uint8>* chunk = slot.load(std::memory_order_acquire);
+                    if (!chunk) continue;
+                    for (int32 i = 0; i < ChunkSize; i++) {
+                        chunk[i].store(ClassHookUnknown, std::memory_order_relaxed);
+                    }
+                }
+            }
+
+        private:
+            static const int32 ChunkSize = 64 * 1024;
+            static const int32 MaxChunks = 2048;
+            // zero initialized as static storage
+            std::atomic<std::atomic<uint8>*> chunks[MaxChunks];
+        };
+
+        ClassHookStateTable classHookStates;
+
+        // blueprint classes are compiled in place in editor, their decision may change
+        bool canCacheClass(const UClass* cls) {
+#if WITH_EDITOR
+            return !cls->HasAnyClassFlags(CLASS_CompiledFromBlueprint | CLASS_NewerVersionExists);
+#else
+            return true;
+#endif
+        }
+    }
 
     const TCHAR* LuaOverrider::EInputEventNames[] = { TEXT("Pressed"), TEXT("Released"), TEXT("Repeat"), TEXT("DoubleClick"), TEXT("Axis"), TEXT("Max") };
 #if (ENGINE_MINOR_VERSION<25) && (ENGINE_MAJOR_VERSION==4)
@@ -532,6 +599,7 @@ namespace NS_SLUA
         
         GUObjectArray.AddUObjectDeleteListener(this);
         GUObjectArray.AddUObjectCreateListener(this);
+        resetClassCaches();
         asyncLoadingFlushUpdateHandle = FCoreDelegates::OnAsyncLoadingFlushUpdate.AddRaw(this, &LuaOverrider::onAsyncLoadingFlushUpdate);
         gcHandler = FCoreUObjectDelegates::GetPostGarbageCollect().AddRaw(this, &LuaOverrider::onEngineGC);
 #if (ENGINE_MINOR_VERSION<25) && (ENGINE_MAJOR_VERSION==4)
@@ -586,6 +654,21 @@ namespace NS_SLUA
         classConstructors.Empty();
     }
 
+    void LuaOverrider::resetClassCaches()
+    {
+        // class caches are shared by all overriders but only cleaned by their delete listener,
+        // classes deleted while no overrider existed may have left stale entries
+        classHookStates.reset();
+        FRWScopeLock lock(classHookMutex, SLT_Write);
+        for (auto it = classLuaFilePaths.CreateIterator(); it; ++it)
+        {
+            if (!it.Key().IsValid())
+            {
+                it.RemoveCurrent();
+            }
+        }
+    }
+
     void LuaOverrider::NotifyUObjectCreated(const UObjectBase* Object, int32 Index)
     {
         QUICK_SCOPE_CYCLE_COUNTER(LuaOverrider_NotifyUObjectCreated);
@@ -620,8 +703,13 @@ namespace NS_SLUA
                 overridedClasses.Remove(cls);
             }
 
+            if (classHookStates.get(Index) != ClassHookUnknown)
+                classHookStates.set(Index, ClassHookUnknown);
+
+            TWeakObjectPtr<UClass> weakCls(cls);
             FRWScopeLock lock(classHookMutex, SLT_Write);
-            classConstructors.Remove(cls);
+            classConstructors.Remove(weakCls);
+            classLuaFilePaths.Remove(weakCls);
         }
     }
 
@@ -1001,14 +1089,38 @@ namespace NS_SLUA
     FString LuaOverrider::getLuaFilePath(UObject* obj, UClass* cls, bool bCDOLua, bool& bHookInstancedObj)
     {
         bHookInstancedObj = false;
-        const FString GET_LUA_FILE_FUNC_NAME = TEXT("GetLuaFilePath");
-        UFunction* func = cls->FindFunctionByName(FName(*GET_LUA_FILE_FUNC_NAME));
-        FString luaFilePath;
-        if (func->GetNativeFunc())
+        static const FName GET_LUA_FILE_FUNC_NAME(TEXT("GetLuaFilePath"));
+
+        // function and path of CDO are same for all instances of cls
+        ClassLuaFilePath classPath;
+        bool bCached;
         {
-            UObject* defaultObject = cls->GetDefaultObject();
-            defaultObject->ProcessEvent(func, &luaFilePath);
+            FRWScopeLock lock(classHookMutex, SLT_ReadOnly);
+            const ClassLuaFilePath* cached = classLuaFilePaths.Find(cls);
+            bCached = cached != nullptr;
+            if (cached)
+                classPath = *cached;
+        }
+        if (!bCached)
+        {
+            classPath.func = cls->FindFunctionByName(GET_LUA_FILE_FUNC_NAME);
+            if (classPath.func && classPath.func->GetNativeFunc())
+            {
+                UObject* defaultObject = cls->GetDefaultObject();
+                defaultObject->ProcessEvent(classPath.func, &classPath.path);
+            }
+            if (canCacheClass(cls))
+            {
+                FRWScopeLock lock(classHookMutex, SLT_Write);
+                classLuaFilePaths.Add(cls, classPath);
+            }
+        }
 
+        UFunction* func = classPath.func;
+        FString luaFilePath = MoveTemp(classPath.path);
+        if (func && func->GetNativeFunc())
+        {
+            // LuaFilePath is editable per instance, so instance is always asked
             if (!bCDOLua)
             {
                 FString instanceFilePath;
@@ -1165,52 +1277,27 @@ namespace NS_SLUA
             //NS_SLUA::Log::Log("LuaOverrider::BindOverrideFuncs LuaFilePath empty of Object[%s]", TCHAR_TO_UTF8(*(obj->GetFName().ToString())));
             return false;
         }
-        NS_SLUA::LuaVar luaModule = sluaState->requireModule(TCHAR_TO_UTF8(*luaFilePath));
-        if (!luaModule.isValid()) {
-            NS_SLUA::Log::Error("LuaOverrider::BindOverrideFuncs can't find LuaFilePath[%s] of Object[%s]", 
-                TCHAR_TO_UTF8(*luaFilePath), TCHAR_TO_UTF8(*(obj->GetFName().ToString())));
-            return false;
+        TSharedPtr<BindTemplate> bindTemplate = bindTemplates.FindRef(luaFilePath);
+        if (bindTemplate.IsValid() && !isModuleLoaded(L, *bindTemplate)) {
+            bindTemplates.Remove(luaFilePath);
+            bindTemplate.Reset();
         }
-
-        if (!luaModule.isTable() && !luaModule.isFunction()) {
-            NS_SLUA::Log::Error("LuaOverrider::BindOverrideFuncs Object[%s]'s LuaModule[%s] not a lua table or function!", 
-                TCHAR_TO_UTF8(*(obj->GetFName().ToString())), TCHAR_TO_UTF8(*luaFilePath));
-            return false;
+        if (!bindTemplate.IsValid()) {
+            bindTemplate = resolveBindTemplate(luaFilePath, obj);
+            if (!bindTemplate.IsValid()) {
+                return false;
+            }
+            if (bindTemplate->bCacheable) {
+                bindTemplates.Add(luaFilePath, bindTemplate);
+            }
         }
-        //NS_SLUA::Log::Log("LuaOverrider::BindOverrideFuncs LuaFilePath[%s] of Object[%s]", TCHAR_TO_UTF8(*luaFilePath), TCHAR_TO_UTF8(*(obj->GetFName().ToString())));
+        NS_SLUA::LuaVar luaModule = bindTemplate->module;
+        bool bFirstBind = bindTemplate->numFields == 0;
 
         NS_SLUA::LuaVar luaSelfTable;
-        if (luaModule.isFunction()) {
-            luaModule = luaModule.call();
-        }
-
-        if (luaModule.isTable()) {
+        {
             SCOPE_CYCLE_COUNTER(STAT_LuaOverrider_bindOverrideFuncs_selfCtor);
-            
-            AutoStack as(L);
-            luaModule.push(L);
-            if (lua_getmetatable(L, -1)) {
-                if (lua_getfield(L, -1, "__call") != LUA_TNIL) {
-                    int top = LuaState::pushErrorHandler(L) - 1;
-                    lua_insert(L, -2);
-                    
-                    lua_pushvalue(L, -4);
-                    if (lua_pcall(L, 1, 1, top))
-                        lua_pop(L, 1);
-
-                    lua_remove(L, top);
-
-                    int retCount = lua_gettop(L) - top + 1;
-                    if (retCount)
-                        luaSelfTable = LuaVar(L, -retCount);
-                }
-                else {
-                    lua_pop(L, 1);
-                }
-
-                lua_pop(L, 1);
-            }
-            lua_pop(L, 1);
+            luaSelfTable = newSelfTable(L, *bindTemplate);
         }
 
         if (!luaSelfTable.isTable()) {
@@ -1219,13 +1306,16 @@ namespace NS_SLUA
             return false;
         }
 #if UE_BUILD_DEVELOPMENT
-        luaSelfTable.push(L);
-        lua_pushstring(L, UOBJECT_NAME);
-        if (lua_rawget(L, -2) != LUA_TNIL) {
-            NS_SLUA::Log::Error("LuaOverrider::BindOverrideFuncs Object[%s]'s luaSelfTable[%s] not allow to define \"Object\" variable!",
-                TCHAR_TO_UTF8(*(obj->GetFName().ToString())), TCHAR_TO_UTF8(*luaFilePath));
+        // ctor may set fields differently for every object
+        {
+            luaSelfTable.push(L);
+            lua_pushstring(L, UOBJECT_NAME);
+            if (lua_rawget(L, -2) != LUA_TNIL) {
+                NS_SLUA::Log::Error("LuaOverrider::BindOverrideFuncs Object[%s]'s luaSelfTable[%s] not allow to define \"Object\" variable!",
+                    TCHAR_TO_UTF8(*(obj->GetFName().ToString())), TCHAR_TO_UTF8(*luaFilePath));
+            }
+            lua_pop(L, 2);
         }
-        lua_pop(L, 2);
 #endif
         
         if (!overridedClasses.Contains(cls) || bHookInstancedObj) {
@@ -1273,7 +1363,19 @@ namespace NS_SLUA
             bNetReplicated = true;
         }
 
-        setmetatable(luaSelfTable, (void*)obj, bNetReplicated);
+        setmetatable(luaSelfTable, (void*)obj, bNetReplicated, bindTemplate.Get());
+        if (bFirstBind) {
+            // later self tables are created with this size
+            AutoStack as(L);
+            luaSelfTable.push(L);
+            int32 numFields = 0;
+            lua_pushnil(L);
+            while (lua_next(L, -2)) {
+                lua_pop(L, 1);
+                numFields++;
+            }
+            bindTemplate->numFields = FMath::Max(numFields, 1);
+        }
         ULuaOverrider::addObjectTable(L, obj, luaSelfTable, bHookInstancedObj);
 
         if (auto luaInterface = Cast<ILuaOverriderInterface>(obj))
@@ -1311,7 +1413,106 @@ namespace NS_SLUA
         return true;
     }
 
-    void LuaOverrider::setmetatable(const LuaVar& luaSelfTable, void* objPtr, bool bNetReplicated)
+    TSharedPtr<LuaOverrider::BindTemplate> LuaOverrider::resolveBindTemplate(const FString& luaFilePath, UObject* obj)
+    {
+        lua_State* L = sluaState->getLuaState();
+        NS_SLUA::LuaVar luaModule = sluaState->requireModule(TCHAR_TO_UTF8(*luaFilePath));
+        if (!luaModule.isValid()) {
+            NS_SLUA::Log::Error("LuaOverrider::BindOverrideFuncs can't find LuaFilePath[%s] of Object[%s]", 
+                TCHAR_TO_UTF8(*luaFilePath), TCHAR_TO_UTF8(*(obj->GetFName().ToString())));
+            return nullptr;
+        }
+
+        if (!luaModule.isTable() && !luaModule.isFunction()) {
+            NS_SLUA::Log::Error("LuaOverrider::BindOverrideFuncs Object[%s]'s LuaModule[%s] not a lua table or function!", 
+                TCHAR_TO_UTF8(*(obj->GetFName().ToString())), TCHAR_TO_UTF8(*luaFilePath));
+            return nullptr;
+        }
+
+        TSharedPtr<BindTemplate> outTemplate = MakeShared<BindTemplate>();
+        outTemplate->moduleName = SimpleString(TCHAR_TO_UTF8(*luaFilePath));
+        if (luaModule.isFunction()) {
+            luaModule = luaModule.call();
+            outTemplate->bCacheable = false;
+        }
+        outTemplate->module = luaModule;
+
+        if (luaModule.isTable()) {
+            AutoStack as(L);
+            luaModule.push(L);
+            if (lua_getmetatable(L, -1)) {
+                if (lua_getfield(L, -1, "__new") == LUA_TFUNCTION) {
+                    outTemplate->bPresized = true;
+                    outTemplate->ctor = LuaVar(L, -1);
+                }
+                else {
+                    lua_pop(L, 1);
+                    if (lua_getfield(L, -1, "__call") != LUA_TNIL) {
+                        outTemplate->ctor = LuaVar(L, -1);
+                    }
+                }
+            }
+        }
+        return outTemplate;
+    }
+
+    bool LuaOverrider::isModuleLoaded(lua_State* L, const BindTemplate& bindTemplate)
+    {
+        AutoStack as(L);
+        lua_getfield(L, LUA_REGISTRYINDEX, LUA_LOADED_TABLE);
+        lua_getfield(L, -1, bindTemplate.moduleName.c_str());
+        bindTemplate.module.push(L);
+        return lua_rawequal(L, -1, -2) != 0;
+    }
+
+    LuaVar LuaOverrider::newSelfTable(lua_State* L, const BindTemplate& bindTemplate)
+    {
+        LuaVar luaSelfTable;
+        if (!bindTemplate.ctor.isValid()) {
+            return luaSelfTable;
+        }
+
+        AutoStack as(L);
+        int top = LuaState::pushErrorHandler(L);
+        bindTemplate.ctor.push(L);
+        if (bindTemplate.bPresized) {
+            lua_createtable(L, 0, bindTemplate.numFields);
+        }
+        else {
+            bindTemplate.module.push(L);
+        }
+        if (lua_pcall(L, 1, 1, top) == 0) {
+            luaSelfTable = LuaVar(L, -1);
+        }
+        return luaSelfTable;
+    }
+
+    void LuaOverrider::prewarmClasses(const TArray<UClass*>& classes)
+    {
+        for (UClass* cls : classes) {
+            if (!cls || !isClassHookable(cls)) {
+                continue;
+            }
+
+            bool bHookInstancedObj;
+            FString luaFilePath = getLuaFilePath(cls->GetDefaultObject(), cls, true, bHookInstancedObj);
+            if (luaFilePath.IsEmpty() || bindTemplates.Contains(luaFilePath)) {
+                continue;
+            }
+
+            TSharedPtr<BindTemplate> bindTemplate = resolveBindTemplate(luaFilePath, cls->GetDefaultObject());
+            if (bindTemplate.IsValid() && bindTemplate->bCacheable) {
+                bindTemplates.Add(luaFilePath, bindTemplate);
+            }
+        }
+    }
+
+    void LuaOverrider::clearBindTemplates()
+    {
+        bindTemplates.Empty();
+    }
+
+    void LuaOverrider::setmetatable(const LuaVar& luaSelfTable, void* objPtr, bool bNetReplicated, BindTemplate* bindTemplate)
     {
         lua_State* L = sluaState->getLuaState();
         // setup __cppinst
@@ -1331,13 +1532,31 @@ namespace NS_SLUA
         lua_rawset(L, -3);
 
         if (lua_getmetatable(L, -1)) {
-            lua_newtable(L);
-            lua_getfield(L, -2, "__index");
-            lua_pushcclosure(L, classIndex, 1);
-            lua_setfield(L, -2, "__index");
+            // self tables made by same ctor share metatable, so they can share the wrapper too
+            bool bCachedWrapper = false;
+            if (bindTemplate && bindTemplate->wrapperMeta.isValid()) {
+                bindTemplate->instanceMeta.push(L);
+                bCachedWrapper = !!lua_rawequal(L, -1, -2);
+                lua_pop(L, 1);
+            }
 
-            lua_pushcfunction(L, classNewindex);
-            lua_setfield(L, -2, "__newindex");
+            if (bCachedWrapper) {
+                bindTemplate->wrapperMeta.push(L);
+            }
+            else {
+                lua_newtable(L);
+                lua_getfield(L, -2, "__index");
+                lua_pushcclosure(L, classIndex, 1);
+                lua_setfield(L, -2, "__index");
+
+                lua_pushcfunction(L, classNewindex);
+                lua_setfield(L, -2, "__newindex");
+
+                if (bindTemplate && bindTemplate->bCacheable && !bindTemplate->wrapperMeta.isValid()) {
+                    bindTemplate->instanceMeta = LuaVar(L, -2);
+                    bindTemplate->wrapperMeta = LuaVar(L, -1);
+                }
+            }
 
             lua_setmetatable(L, -3);
 
@@ -1365,12 +1584,29 @@ namespace NS_SLUA
         check(!obj->IsPendingKill());
 #endif
         UClass* cls = obj->GetClass();
-        //NS_SLUA::Log::Log("LuaOverrider::isHookable GetClass %s, is Class: %d", TCHAR_TO_UTF8(*obj->GetFName().ToString()), cls->IsChildOf<UClass>());
+        int32 classObjIndex = cls->GetUniqueID();
+        uint8 state = classHookStates.get(classObjIndex);
+        if (state != ClassHookUnknown)
+        {
+            return state == ClassHookable;
+        }
+
+        bool bHookable = isClassHookable(cls);
+        if (canCacheClass(cls))
+        {
+            classHookStates.set(classObjIndex, bHookable ? ClassHookable : ClassNotHookable);
+        }
+        return bHookable;
+    }
+
+    bool LuaOverrider::isClassHookable(const UClass* cls)
+    {
+        //NS_SLUA::Log::Log("LuaOverrider::isHookable GetClass %s, is Class: %d", TCHAR_TO_UTF8(*cls->GetFName().ToString()), cls->IsChildOf<UClass>());
         if (cls->IsChildOf<UPackage>() || cls->IsChildOf<UClass>())
         {
             return false;
         }
-        //NS_SLUA::Log::Log("LuaOverrider::isHookable not UPackage %s", TCHAR_TO_UTF8(*obj->GetFName().ToString()));
+        //NS_SLUA::Log::Log("LuaOverrider::isHookable not UPackage %s", TCHAR_TO_UTF8(*cls->GetFName().ToString()));
         static UClass* interfaceClass = ULuaOverriderInterface::StaticClass();
         if (cls->ImplementsInterface(interfaceClass))
         {
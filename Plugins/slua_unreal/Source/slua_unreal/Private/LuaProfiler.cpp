@@ -17,22 +17,20 @@
 #include "Serialization/ArrayWriter.h"
 #include "Serialization/ArrayReader.h"
 #include "LuaMemoryProfile.h"
-#include "luasocket/buffer.h"
 #include "lua.h"
 #include "lstate.h"
 #include "LuaStatProfile.h"
 
+#include "FLuaCycleCounter.h"
+#include "SluaProfilerDataManager.h"
+#include "LuaProfilerTransport.h"
 #if PLATFORM_WINDOWS
 #include "Windows/AllowWindowsPlatformTypes.h"
 #include "Windows/AllowWindowsPlatformAtomics.h"
 #include <winsock2.h>
 #include "Windows/HideWindowsPlatformAtomics.h"
 #include "Windows/HideWindowsPlatformTypes.h"
-#else
-#include <sys/ioctl.h>
 #endif
-#include "FLuaCycleCounter.h"
-#include "SluaProfilerDataManager.h"
 #include "luasocket/tcp.h"
 
 #include "LuaProfiler.inl"
@@ -66,92 +64,26 @@ namespace NS_SLUA {
         bool ignoreHook = false;
         HookState currentHookState = HookState::UNHOOK;
         int64 profileTotalCost = 0;
-        p_tcp tcpSocket = nullptr;
-        
-        // copy code from buffer.cpp in luasocket
-        int buffer_get(p_buffer buf, size_t *count, FArrayReader& messageReader) {
-            int err = IO_DONE;
-            p_io io = buf->io;
-            p_timeout tm = buf->tm;
-            if (buf->first >= buf->last) {
-                size_t got;
-                err = io->recv(io->ctx, buf->data, BUF_SIZE, &got, tm);
-                buf->first = 0;
-                buf->last = got;
-            }
-            *count = buf->last - buf->first;
-            messageReader.Insert((uint8 *)(buf->data + buf->first), *count, buf->first);
-            return err;
-        }
-        
-        // copy code from buffer.cpp in luasocket
-        void profiler_buffer_skip(p_buffer buf, size_t count) {
-            buf->received += count;
-            buf->first += count;
-            if (buf->first >= buf->last)
-                buf->first = buf->last = 0;
-        }
         
-        // copy code from buffer.cpp in luasocket
-        int recvraw(p_buffer buf, size_t wanted, FArrayReader& messageReader) {
-            int err = IO_DONE;
-            size_t total = 0;
-            while (err == IO_DONE) {
-                size_t count;
-                err = buffer_get(buf, &count, messageReader);
-                count = count > wanted - total ? wanted - total : count;
-                profiler_buffer_skip(buf, count);
-                total += count;
-                if(err == IO_DONE)
-                if (total >= wanted) break;
-            }
-            return err;
-        }
-        
-        bool receieveGCMessage(size_t wanted) {
-            if(!tcpSocket) return false;
-            
-            int event = 0;
-            FArrayReader messageReader = FArrayReader(true);
-            messageReader.SetNumUninitialized(sizeof(int));
-            
-            int err = recvraw(&tcpSocket->buf, wanted, messageReader);
-            if(err != IO_DONE) {
-                return false;
-            }
-            
-            messageReader << event;
-            return event == PHE_MEMORY_GC;
+        FLuaProfilerTransport* transport = nullptr;
+
+        FLuaProfilerTransport& getTransport() {
+            if (!transport) transport = new FLuaProfilerTransport();
+            return *transport;
         }
-        
+
+        // max time to wait send thread for large package, e.g. memory snapshot
+        const double ReliableSendTimeout = 1.0;
+
         void memoryGC(lua_State* L) {
-            if(!tcpSocket) return;
-            
-            int wantedSize = 4;
-            if(L && receieveGCMessage(wantedSize)) {
-                int nowMemSize;
-                int originMemSize = lua_gc(L, LUA_GCCOUNT, 0);
-                
-                lua_gc(L, LUA_GCCOLLECT, 0);
-                nowMemSize = lua_gc(L, LUA_GCCOUNT, 0);
-                UE_LOG(Slua, Log, TEXT("After GC , lua free %d KB"), originMemSize - nowMemSize);
-            }
-        }
-    
-        bool checkSocketRead() {
-            int result;
-            u_long nread = 0;
-            t_socket fd = tcpSocket->sock;
-            
-            #if PLATFORM_WINDOWS
-            result = ioctlsocket(fd, FIONREAD, &nread);
-            #else
-            result = ioctl(fd, FIONREAD, &nread);
-            #endif
-            
-            return result == 0 && nread > 0;
+            int nowMemSize;
+            int originMemSize = lua_gc(L, LUA_GCCOUNT, 0);
+
+            lua_gc(L, LUA_GCCOLLECT, 0);
+            nowMemSize = lua_gc(L, LUA_GCCOUNT, 0);
+            UE_LOG(Slua, Log, TEXT("After GC , lua free %d KB"), originMemSize - nowMemSize);
         }
-        
+
         void makeProfilePackage(FArrayWriter& messageWriter,
             int hookEvent, int64 time,
             int lineDefined, const char* funcName,
@@ -189,34 +121,14 @@ namespace NS_SLUA {
             messageWriter << packageSize;
         }
         
-        // copy code from buffer.cpp in luasocket
-        int profiler_sendraw(p_buffer buf, const char* data, size_t count, size_t * sent) {
-            const size_t stepsize = 8192;
-            p_io io = buf->io;
-            if (!io) return IO_CLOSED;
-            p_timeout tm = buf->tm;
-            size_t total = 0;
-            int err = IO_DONE;
-            while (total < count && err == IO_DONE) {
-                size_t done = 0;
-                size_t step = (count - total <= stepsize) ? count - total : stepsize;
-                err = io->send(io->ctx, data + total, step, &done, tm);
-                total += done;
-            }
-            *sent = total;
-            buf->sent += total;
-            return err;
-        }
-
-        void sendMessage(FArrayWriter& msg, lua_State* L) {
+        void sendMessage(FArrayWriter& msg, bool bReliable = false) {
             QUICK_SCOPE_CYCLE_COUNTER(LuaProfiler_sendMessage)
-            if (!tcpSocket) return;
-            size_t sent;
-            int err = profiler_sendraw(&tcpSocket->buf, (const char*)msg.GetData(), msg.Num(), &sent);
-            if (err != IO_DONE) {
-                auto& profiler = selfProfiler.FindChecked(LuaState::get(L));
-                (void)profiler.callField("disconnect");
-            }
+            if (!transport || !transport->isAttached()) return;
+            // never touch socket here, send thread will take it
+            if (bReliable)
+                transport->enqueueReliable(msg.GetData(), msg.Num(), ReliableSendTimeout);
+            else
+                transport->enqueue(msg.GetData(), msg.Num());
         }
 
         void takeSample(int event,int line,const char* funcname,const char* shortsrc, int64 startTime, lua_State* L) {
@@ -228,7 +140,7 @@ namespace NS_SLUA {
                 s_messageWriter.Empty();
                 s_messageWriter.Seek(0);
                 makeProfilePackage(s_messageWriter, event, startTime - profileTotalCost, line, funcname, shortsrc);
-                sendMessage(s_messageWriter, L);
+                sendMessage(s_messageWriter);
             }
             else
             {
@@ -236,7 +148,7 @@ namespace NS_SLUA {
             }
         }
 
-        void takeMemorySample(int event, TArray<LuaMemInfo>& memoryDetail, lua_State* L) {
+        void takeMemorySample(int event, TArray<LuaMemInfo>& memoryDetail, lua_State* L, bool bReliable = false) {
             QUICK_SCOPE_CYCLE_COUNTER(LuaProfiler_takeMemorySample)
             if (!SluaProfilerDataManager::IsRecording())
             {
@@ -245,7 +157,7 @@ namespace NS_SLUA {
                 s_memoryMessageWriter.Empty();
                 s_memoryMessageWriter.Seek(0);
                 makeMemoryProfilePackage(s_memoryMessageWriter, event, memoryDetail);
-                sendMessage(s_memoryMessageWriter, L);
+                sendMessage(s_memoryMessageWriter, bReliable);
             }
             else
             {
@@ -342,7 +254,8 @@ namespace NS_SLUA {
                 for (auto& memInfo : memoryDetail) {
                     memoryInfoList.Add(memInfo.Value);
                 }
-                takeMemorySample(PHE_MEMORY_TICK, memoryInfoList, L);
+                // snapshot is sent once on connect, viewer can't work without it
+                takeMemorySample(PHE_MEMORY_TICK, memoryInfoList, L, true);
 
                 lua_sethook(L, debug_hook, LUA_MASKRET | LUA_MASKCALL, 0);
                 //处理lua stat profile兼容问题
@@ -376,11 +289,13 @@ namespace NS_SLUA {
 
         int setSocket(lua_State* L) {
             if (lua_isnil(L, 1)) {
-                tcpSocket = nullptr;
+                // lua will close socket after this call, wait send thread leaving it
+                if (transport) transport->detach();
                 return 0;
             }
-            tcpSocket = (p_tcp)luaL_checkudata(L, 1, "tcp{client}");
+            p_tcp tcpSocket = (p_tcp)luaL_checkudata(L, 1, "tcp{client}");
             if (!tcpSocket) luaL_error(L, "Set invalid socket");
+            getTransport().attach((uint64)tcpSocket->sock);
             return 0;
         }
 
@@ -424,7 +339,8 @@ namespace NS_SLUA {
 
         int startMemoryTrack(lua_State* L)
         {
-            LuaMemoryProfile::start(L);
+            // optional sample interval in bytes, see slua.MemorySampleInterval
+            LuaMemoryProfile::start(L, luaL_optinteger(L, 1, 0));
             return 0;
         }
 
@@ -433,6 +349,83 @@ namespace NS_SLUA {
             LuaMemoryProfile::stop(L);
             return 0;
         }
+
+        // live tracked bytes grouped by "source:line" of top lua frame, sampled sizes are scaled
+        int getMemoryDetail(lua_State* L)
+        {
+            TMap<FString, int64> sizes;
+            for (auto& it : LuaMemoryProfile::memDetail(LuaState::get(L)))
+            {
+                sizes.FindOrAdd(FString::Printf(TEXT("%s:%d"), *it.Value.hint, it.Value.lineNumber)) += it.Value.size;
+            }
+
+            lua_createtable(L, 0, sizes.Num());
+            for (auto& it : sizes)
+            {
+                lua_pushinteger(L, it.Value);
+                lua_setfield(L, -2, TCHAR_TO_UTF8(*it.Key));
+            }
+            return 1;
+        }
+
+        // tracked bytes of all states, sampled sizes are scaled
+        int getMemoryTotal(lua_State* L)
+        {
+            lua_pushinteger(L, LuaMemoryProfile::total());
+            return 1;
+        }
+
+        int getTransportStats(lua_State* L)
+        {
+            FProfilerTransportStats stats;
+            if (transport) stats = transport->getStats();
+
+            lua_newtable(L);
+            lua_pushinteger(L, stats.queuedPackages);
+            lua_setfield(L, -2, "queuedPackages");
+            lua_pushinteger(L, stats.queuedBytes);
+            lua_setfield(L, -2, "queuedBytes");
+            lua_pushinteger(L, stats.sentBytes);
+            lua_setfield(L, -2, "sentBytes");
+            lua_pushinteger(L, stats.droppedPackages);
+            lua_setfield(L, -2, "droppedPackages");
+            lua_pushinteger(L, stats.droppedBytes);
+            lua_setfield(L, -2, "droppedBytes");
+            lua_pushinteger(L, stats.stallCount);
+            lua_setfield(L, -2, "stallCount");
+            lua_pushnumber(L, stats.stallSeconds);
+            lua_setfield(L, -2, "stallSeconds");
+            lua_pushinteger(L, stats.highWaterBytes);
+            lua_setfield(L, -2, "highWaterBytes");
+            lua_pushinteger(L, stats.capacity);
+            lua_setfield(L, -2, "capacity");
+            return 1;
+        }
+
+        int resetTransportStats(lua_State* L)
+        {
+            if (transport) transport->resetStats();
+            return 0;
+        }
+
+        void dumpTransportStats(FOutputDevice& Ar)
+        {
+            if (!transport) {
+                Ar.Logf(TEXT("Profiler transport isn't running"));
+                return;
+            }
+            auto stats = transport->getStats();
+            Ar.Logf(TEXT("Profiler transport connected: %d, buffer %u/%u bytes(high water)"), transport->isAttached(), stats.highWaterBytes, stats.capacity);
+            Ar.Logf(TEXT("Queued %lld packages, %lld bytes, sent %lld bytes"), stats.queuedPackages, stats.queuedBytes, stats.sentBytes);
+            Ar.Logf(TEXT("Dropped %lld packages, %lld bytes"), stats.droppedPackages, stats.droppedBytes);
+            Ar.Logf(TEXT("Stalled %lld times, %.3f seconds"), stats.stallCount, stats.stallSeconds);
+        }
+
+        static FAutoConsoleCommandWithOutputDevice CVarDumpTransportStats(
+            TEXT("slua.ProfilerTransportStats"),
+            TEXT("Dump lua profiler send buffer and drop counters"),
+            FConsoleCommandWithOutputDeviceDelegate::CreateStatic(dumpTransportStats),
+            ECVF_Default);
     }
 
     lua_CFunction LuaProfiler::resumeFunc = nullptr;
@@ -462,6 +455,14 @@ namespace NS_SLUA {
         lua_setfield(L, -2, "startMemoryTrack");
         lua_pushcfunction(L, stopMemoryTrack);
         lua_setfield(L, -2, "stopMemoryTrack");
+        lua_pushcfunction(L, getMemoryDetail);
+        lua_setfield(L, -2, "getMemoryDetail");
+        lua_pushcfunction(L, getMemoryTotal);
+        lua_setfield(L, -2, "getMemoryTotal");
+        lua_pushcfunction(L, getTransportStats);
+        lua_setfield(L, -2, "getTransportStats");
+        lua_pushcfunction(L, resetTransportStats);
+        lua_setfield(L, -2, "resetTransportStats");
         // using native hook instead of lua hook for performance
         // set selfProfiler to global as slua_profiler
         lua_setglobal(L, "slua_profile");
@@ -489,9 +490,16 @@ namespace NS_SLUA {
         
         RunState currentRunState = (RunState)profiler.getFromTable<int>("currentRunState");
         if (currentRunState == RunState::CONNECTED) {          
-            if(checkSocketRead()) memoryGC(L);
-            takeMemorySample(PHE_MEMORY_INCREACE, LuaMemoryProfile::memIncreaceThisFrame(LS), L);
-            takeSample(PHE_TICK, -1, "", "", getTime(), L);
+            if (transport && transport->consumeError()) {
+                // send thread found viewer closed
+                profiler.callField("disconnect");
+            }
+            else {
+                if (transport && transport->consumeGCRequest()) memoryGC(L);
+                takeMemorySample(PHE_MEMORY_INCREACE, LuaMemoryProfile::memIncreaceThisFrame(LS), L);
+                takeSample(PHE_TICK, -1, "", "", getTime(), L);
+                if (transport) transport->flush();
+            }
         }
         else
         {
@@ -516,7 +524,10 @@ namespace NS_SLUA {
 
         SluaProfilerDataManager::EndRecord();
 
-        tcpSocket = nullptr;
+        if (transport) {
+            delete transport;
+            transport = nullptr;
+        }
         ignoreHook = false;
         currentHookState = HookState::UNHOOK;
         profileTotalCost = 0;
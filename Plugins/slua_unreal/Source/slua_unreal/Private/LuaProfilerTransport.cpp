@@ -0,0 +1,393 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "LuaProfilerTransport.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/ScopeLock.h"
+#include "HAL/IConsoleManager.h"
+#include "LuaProfiler.h"
+#include "Log.h"
+
+#if PLATFORM_WINDOWS
+#include "Windows/AllowWindowsPlatformTypes.h"
+#include "Windows/AllowWindowsPlatformAtomics.h"
+#include <winsock2.h>
+#include "Windows/HideWindowsPlatformAtomics.h"
+#include "Windows/HideWindowsPlatformTypes.h"
+#endif
+#include "luasocket/socket.h"
+
+#ifdef ENABLE_PROFILER
+namespace NS_SLUA {
+
+    static int32 ProfilerSendBufferSizeKB = 4096;
+
+    FAutoConsoleVariableRef CVarSluaProfilerSendBufferSize(
+        TEXT("slua.ProfilerSendBufferSize"),
+        ProfilerSendBufferSizeKB,
+        TEXT("Size in KB of the buffer between lua profiler hook and send thread, package will be dropped when it's full.\n"),
+        ECVF_Default);
+
+    namespace {
+        // time in seconds send thread wait for socket in one loop
+        const double SocketWaitSeconds = 0.002;
+        // send thread sleep time if nothing to send
+        const uint32 IdleWaitMs = 2;
+
+        FORCEINLINE t_socket toSocket(uint64 handle)
+        {
+            return (t_socket)handle;
+        }
+    }
+
+    FProfilerRingBuffer::FProfilerRingBuffer(uint32 inCapacity)
+        : head(0)
+        , tail(0)
+    {
+        uint32 cap = FMath::RoundUpToPowerOfTwo(FMath::Max<uint32>(inCapacity, 4096));
+        buffer = (uint8*)FMemory::Malloc(cap);
+        mask = cap - 1;
+    }
+
+    FProfilerRingBuffer::~FProfilerRingBuffer()
+    {
+        FMemory::Free(buffer);
+        buffer = nullptr;
+    }
+
+    uint32 FProfilerRingBuffer::size() const
+    {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    bool FProfilerRingBuffer::write(const uint8* data, uint32 len)
+    {
+        uint32 h = head.load(std::memory_order_relaxed);
+        uint32 t = tail.load(std::memory_order_acquire);
+        if (capacity() - (h - t) < len)
+            return false;
+
+        uint32 offset = h & mask;
+        uint32 first = FMath::Min(len, capacity() - offset);
+        FMemory::Memcpy(buffer + offset, data, first);
+        if (first < len)
+            FMemory::Memcpy(buffer, data + first, len - first);
+
+        head.store(h + len, std::memory_order_release);
+        return true;
+    }
+
+    uint32 FProfilerRingBuffer::writeSome(const uint8* data, uint32 len)
+    {
+        uint32 h = head.load(std::memory_order_relaxed);
+        uint32 t = tail.load(std::memory_order_acquire);
+        uint32 freeSize = capacity() - (h - t);
+        len = FMath::Min(len, freeSize);
+        if (len == 0)
+            return 0;
+
+        uint32 offset = h & mask;
+        uint32 first = FMath::Min(len, capacity() - offset);
+        FMemory::Memcpy(buffer + offset, data, first);
+        if (first < len)
+            FMemory::Memcpy(buffer, data + first, len - first);
+
+        head.store(h + len, std::memory_order_release);
+        return len;
+    }
+
+    uint32 FProfilerRingBuffer::peek(const uint8*& data) const
+    {
+        uint32 t = tail.load(std::memory_order_relaxed);
+        uint32 h = head.load(std::memory_order_acquire);
+        uint32 offset = t & mask;
+        data = buffer + offset;
+        return FMath::Min(h - t, capacity() - offset);
+    }
+
+    void FProfilerRingBuffer::consume(uint32 len)
+    {
+        tail.store(tail.load(std::memory_order_relaxed) + len, std::memory_order_release);
+    }
+
+    void FProfilerRingBuffer::reset()
+    {
+        // only safe when consumer is idle
+        tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    FLuaProfilerTransport::FLuaProfilerTransport()
+        : ringBuffer((uint32)FMath::Max(ProfilerSendBufferSizeKB, 4) * 1024)
+        , thread(nullptr)
+        , wakeEvent(nullptr)
+        , socket((uint64)SOCKET_INVALID)
+        , attached(false)
+        , stopping(false)
+        , gcRequested(false)
+        , errorOccurred(false)
+        , requestReceived(0)
+        , stallCount(0)
+        , stallSeconds(0.0)
+        , highWaterBytes(0)
+    {
+    }
+
+    FLuaProfilerTransport::~FLuaProfilerTransport()
+    {
+        stopThread();
+    }
+
+    void FLuaProfilerTransport::attach(uint64 socketHandle)
+    {
+        {
+            FScopeLock lock(&socketLock);
+            socket = socketHandle;
+            requestReceived = 0;
+            ringBuffer.reset();
+            attached.store(true, std::memory_order_release);
+        }
+        gcRequested.store(false);
+        errorOccurred.store(false);
+
+        if (!thread) {
+            stopping.store(false);
+            wakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+            thread = FRunnableThread::Create(this, TEXT("FLuaProfilerTransport"), 0, TPri_BelowNormal);
+        }
+    }
+
+    void FLuaProfilerTransport::detach()
+    {
+        if (!attached.load(std::memory_order_acquire))
+            return;
+
+        // wait for send thread leaving socket, lua will close it soon
+        FScopeLock lock(&socketLock);
+        attached.store(false, std::memory_order_release);
+        socket = (uint64)SOCKET_INVALID;
+        requestReceived = 0;
+
+        auto stats = getStats();
+        if (stats.droppedPackages > 0) {
+            Log::Log("Profiler transport dropped %lld packages (%lld bytes) since last connect", stats.droppedPackages, stats.droppedBytes);
+        }
+    }
+
+    void FLuaProfilerTransport::stopThread()
+    {
+        detach();
+        if (thread) {
+            Stop();
+            thread->WaitForCompletion();
+            delete thread;
+            thread = nullptr;
+        }
+        if (wakeEvent) {
+            FPlatformProcess::ReturnSynchEventToPool(wakeEvent);
+            wakeEvent = nullptr;
+        }
+    }
+
+    bool FLuaProfilerTransport::enqueue(const uint8* data, uint32 len)
+    {
+        if (!attached.load(std::memory_order_acquire))
+            return false;
+
+        if (!ringBuffer.write(data, len)) {
+            droppedPackages.Increment();
+            droppedBytes.Add(len);
+            return false;
+        }
+
+        queuedPackages.Increment();
+        queuedBytes.Add(len);
+
+        uint32 used = ringBuffer.size();
+        if (used > highWaterBytes.load(std::memory_order_relaxed))
+            highWaterBytes.store(used, std::memory_order_relaxed);
+        // wake up sender early if buffer is filling up
+        if (used > ringBuffer.capacity() / 2 && wakeEvent)
+            wakeEvent->Trigger();
+        return true;
+    }
+
+    bool FLuaProfilerTransport::enqueueReliable(const uint8* data, uint32 len, double timeoutSeconds)
+    {
+        if (!attached.load(std::memory_order_acquire))
+            return false;
+
+        if (ringBuffer.write(data, len)) {
+            queuedPackages.Increment();
+            queuedBytes.Add(len);
+            return true;
+        }
+
+        // package can't fit into free space, stream it into buffer piece by piece
+        double start = FPlatformTime::Seconds();
+        uint32 written = 0;
+        stallCount++;
+        while (written < len) {
+            if (!attached.load(std::memory_order_acquire) || errorOccurred.load()) {
+                break;
+            }
+            uint32 n = ringBuffer.writeSome(data + written, len - written);
+            written += n;
+            if (written < len) {
+                if (wakeEvent) wakeEvent->Trigger();
+                if (FPlatformTime::Seconds() - start > timeoutSeconds) {
+                    break;
+                }
+                FPlatformProcess::SleepNoStats(0.0f);
+            }
+        }
+        stallSeconds += FPlatformTime::Seconds() - start;
+        queuedBytes.Add(written);
+
+        if (written < len) {
+            // half package in stream, viewer can't parse any more
+            droppedPackages.Increment();
+            droppedBytes.Add(len - written);
+            errorOccurred.store(true);
+            return false;
+        }
+        queuedPackages.Increment();
+        return true;
+    }
+
+    void FLuaProfilerTransport::flush()
+    {
+        if (wakeEvent && ringBuffer.size() > 0)
+            wakeEvent->Trigger();
+    }
+
+    bool FLuaProfilerTransport::consumeGCRequest()
+    {
+        return gcRequested.exchange(false);
+    }
+
+    bool FLuaProfilerTransport::consumeError()
+    {
+        return errorOccurred.exchange(false);
+    }
+
+    FProfilerTransportStats FLuaProfilerTransport::getStats() const
+    {
+        FProfilerTransportStats stats;
+        stats.queuedPackages = queuedPackages.GetValue();
+        stats.queuedBytes = queuedBytes.GetValue();
+        stats.sentBytes = sentBytes.GetValue();
+        stats.droppedPackages = droppedPackages.GetValue();
+        stats.droppedBytes = droppedBytes.GetValue();
+        stats.stallCount = stallCount;
+        stats.stallSeconds = stallSeconds;
+        stats.highWaterBytes = highWaterBytes.load(std::memory_order_relaxed);
+        stats.capacity = ringBuffer.capacity();
+        return stats;
+    }
+
+    void FLuaProfilerTransport::resetStats()
+    {
+        queuedPackages.Reset();
+        queuedBytes.Reset();
+        sentBytes.Reset();
+        droppedPackages.Reset();
+        droppedBytes.Reset();
+        stallCount = 0;
+        stallSeconds = 0.0;
+        highWaterBytes.store(0);
+    }
+
+    uint32 FLuaProfilerTransport::Run()
+    {
+        while (!stopping.load()) {
+            bool bIdle = true;
+            {
+                FScopeLock lock(&socketLock);
+                if (attached.load(std::memory_order_acquire) && !errorOccurred.load()) {
+                    if (!sendPending(socket) || !receiveRequest(socket)) {
+                        // tell game thread to disconnect, stop touching socket
+                        errorOccurred.store(true);
+                    }
+                    bIdle = ringBuffer.size() == 0;
+                }
+            }
+
+            if (bIdle) {
+                wakeEvent->Wait(IdleWaitMs);
+            }
+        }
+        return 0;
+    }
+
+    void FLuaProfilerTransport::Stop()
+    {
+        stopping.store(true);
+        if (wakeEvent)
+            wakeEvent->Trigger();
+    }
+
+    bool FLuaProfilerTransport::sendPending(uint64 socketHandle)
+    {
+        t_socket sock = toSocket(socketHandle);
+        const uint8* data = nullptr;
+        uint32 count = ringBuffer.peek(data);
+        while (count > 0) {
+            t_timeout tm;
+            timeout_init(&tm, SocketWaitSeconds, -1);
+            size_t sent = 0;
+            int err = socket_send(&sock, (const char*)data, count, &sent, &tm);
+            if (sent > 0) {
+                ringBuffer.consume((uint32)sent);
+                sentBytes.Add(sent);
+            }
+            if (err == IO_TIMEOUT) {
+                // viewer is slow, leave left bytes to next loop
+                return true;
+            }
+            if (err != IO_DONE) {
+                return false;
+            }
+            count = ringBuffer.peek(data);
+        }
+        return true;
+    }
+
+    bool FLuaProfilerTransport::receiveRequest(uint64 socketHandle)
+    {
+        t_socket sock = toSocket(socketHandle);
+        for (;;) {
+            t_timeout tm;
+            timeout_init(&tm, 0.0, -1);
+            size_t got = 0;
+            int err = socket_recv(&sock, (char*)requestBuffer + requestReceived, sizeof(requestBuffer) - requestReceived, &got, &tm);
+            if (err == IO_TIMEOUT) {
+                return true;
+            }
+            if (err != IO_DONE) {
+                return false;
+            }
+
+            requestReceived += (uint32)got;
+            if (requestReceived == sizeof(requestBuffer)) {
+                int32 event = 0;
+                FMemory::Memcpy(&event, requestBuffer, sizeof(event));
+                if (event == PHE_MEMORY_GC) {
+                    gcRequested.store(true);
+                }
+                requestReceived = 0;
+            }
+        }
+    }
+}
+#endif
@@ -0,0 +1,128 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include <atomic>
+
+#ifdef ENABLE_PROFILER
+namespace NS_SLUA {
+
+    // single producer/single consumer byte queue
+    // producer is the lua hook on game thread, consumer is the profiler send thread
+    class FProfilerRingBuffer
+    {
+    public:
+        explicit FProfilerRingBuffer(uint32 inCapacity);
+        ~FProfilerRingBuffer();
+
+        // write whole package or nothing, return false if no enough space
+        bool write(const uint8* data, uint32 len);
+        // write as much bytes as possible, return written size
+        uint32 writeSome(const uint8* data, uint32 len);
+        // get continuous readable bytes, call consume after bytes had been sent
+        uint32 peek(const uint8*& data) const;
+        void consume(uint32 len);
+        void reset();
+
+        uint32 size() const;
+        uint32 capacity() const { return mask + 1; }
+
+    private:
+        uint8* buffer;
+        uint32 mask;
+        // written by producer only
+        std::atomic<uint32> head;
+        // written by consumer only
+        std::atomic<uint32> tail;
+    };
+
+    struct FProfilerTransportStats
+    {
+        int64 queuedPackages = 0;
+        int64 queuedBytes = 0;
+        int64 sentBytes = 0;
+        int64 droppedPackages = 0;
+        int64 droppedBytes = 0;
+        int64 stallCount = 0;
+        double stallSeconds = 0.0;
+        uint32 highWaterBytes = 0;
+        uint32 capacity = 0;
+    };
+
+    // send profile packages to remote viewer on a background thread,
+    // so a slow viewer never blocks game thread
+    class FLuaProfilerTransport : public FRunnable
+    {
+    public:
+        FLuaProfilerTransport();
+        ~FLuaProfilerTransport();
+
+        // bind socket handle owned by lua socket object, start send thread if needed
+        void attach(uint64 socketHandle);
+        // unbind socket, after return send thread will not touch socket any more
+        void detach();
+        bool isAttached() const { return attached.load(std::memory_order_acquire); }
+
+        // called by hook, never block, drop package if viewer is too slow
+        bool enqueue(const uint8* data, uint32 len);
+        // for large package like memory snapshot, wait for free space up to timeout
+        bool enqueueReliable(const uint8* data, uint32 len, double timeoutSeconds);
+        // wake up send thread, called once per frame
+        void flush();
+
+        // viewer ask for full gc
+        bool consumeGCRequest();
+        // socket closed or send failed
+        bool consumeError();
+
+        FProfilerTransportStats getStats() const;
+        void resetStats();
+
+    protected:
+        uint32 Run() override;
+        void Stop() override;
+
+    private:
+        void stopThread();
+        bool sendPending(uint64 socketHandle);
+        bool receiveRequest(uint64 socketHandle);
+
+        FProfilerRingBuffer ringBuffer;
+        FRunnableThread* thread;
+        FEvent* wakeEvent;
+        // guard socket handle between game thread attach/detach and send thread
+        FCriticalSection socketLock;
+        uint64 socket;
+        std::atomic<bool> attached;
+        std::atomic<bool> stopping;
+        std::atomic<bool> gcRequested;
+        std::atomic<bool> errorOccurred;
+
+        uint8 requestBuffer[sizeof(int32)];
+        uint32 requestReceived;
+
+        FThreadSafeCounter64 queuedPackages;
+        FThreadSafeCounter64 queuedBytes;
+        FThreadSafeCounter64 sentBytes;
+        FThreadSafeCounter64 droppedPackages;
+        FThreadSafeCounter64 droppedBytes;
+        int64 stallCount;
+        double stallSeconds;
+        std::atomic<uint32> highWaterBytes;
+    };
+}
+#endif
@@ -0,0 +1,282 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "LuaScriptArchive.h"
+#include "lua.h"
+#include "lauxlib.h"
+#include "Log.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/FileManager.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/Crc.h"
+
+namespace NS_SLUA {
+
+    namespace {
+        const uint32 ArchiveMagic = 0x43424C53; // "SLBC"
+        const uint32 ArchiveVersion = 1;
+
+        struct ArchiveHeader {
+            uint32 magic;
+            uint32 version;
+            uint32 luaVersion;
+            uint32 count;
+        };
+
+        // '/' and '.' are same in module name
+        FORCEINLINE char normalizeChar(char c) {
+            return c == '/' ? '.' : c;
+        }
+
+        int compareModuleName(const char* a, const char* b) {
+            for (;; a++, b++) {
+                char ca = normalizeChar(*a);
+                char cb = normalizeChar(*b);
+                if (ca != cb || ca == 0)
+                    return (unsigned char)ca - (unsigned char)cb;
+            }
+        }
+
+        int dumpWriter(lua_State* L, const void* p, size_t sz, void* ud) {
+            ((TArray<uint8>*)ud)->Append((const uint8*)p, sz);
+            return 0;
+        }
+
+        struct CompiledModule {
+            FTCHARToUTF8 name;
+            TArray<uint8> code;
+            uint32 sourceHash;
+
+            CompiledModule(const FString& inName) : name(*inName), sourceHash(0) {}
+        };
+    }
+
+    // entries are sorted by module name, names are null terminated
+    struct LuaScriptArchive::Entry {
+        uint32 nameOffset;
+        uint32 dataOffset;
+        uint32 dataSize;
+        uint32 sourceHash;
+    };
+
+    LuaScriptArchive::LuaScriptArchive()
+        : mappedHandle(nullptr)
+        , mappedRegion(nullptr)
+        , data(nullptr)
+        , size(0)
+        , count(0)
+    {
+    }
+
+    LuaScriptArchive::~LuaScriptArchive()
+    {
+        delete mappedRegion;
+        delete mappedHandle;
+    }
+
+    LuaScriptArchive* LuaScriptArchive::open(const FString& path)
+    {
+        LuaScriptArchive* archive = new LuaScriptArchive();
+        archive->path = path;
+
+        IMappedFileHandle* handle = FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*path);
+        if (handle) {
+            archive->mappedHandle = handle;
+            archive->mappedRegion = handle->MapRegion(0, handle->GetFileSize());
+        }
+        if (archive->mappedRegion) {
+            archive->data = archive->mappedRegion->GetMappedPtr();
+            archive->size = archive->mappedRegion->GetMappedSize();
+        }
+        else if (FFileHelper::LoadFileToArray(archive->fileData, *path, FILEREAD_Silent)) {
+            archive->data = archive->fileData.GetData();
+            archive->size = archive->fileData.Num();
+        }
+
+        if (!archive->data || !archive->validate()) {
+            delete archive;
+            return nullptr;
+        }
+        return archive;
+    }
+
+    bool LuaScriptArchive::validate()
+    {
+        if (size < (int64)sizeof(ArchiveHeader)) {
+            Log::Error("Script archive %s is broken", TCHAR_TO_UTF8(*path));
+            return false;
+        }
+
+        const ArchiveHeader* header = (const ArchiveHeader*)data;
+        if (header->magic != ArchiveMagic || header->version != ArchiveVersion || header->luaVersion != LUA_VERSION_NUM) {
+            Log::Error("Script archive %s isn't built for this version", TCHAR_TO_UTF8(*path));
+            return false;
+        }
+
+        // last 0 ends every name
+        count = (int32)header->count;
+        if (count < 0 || sizeof(ArchiveHeader) + (int64)count * sizeof(Entry) > size || data[size - 1] != 0) {
+            Log::Error("Script archive %s is broken", TCHAR_TO_UTF8(*path));
+            return false;
+        }
+
+        // check once here, find does not check entries again
+        const Entry* entries = getEntries();
+        for (int32 i = 0; i < count; i++) {
+            const Entry& e = entries[i];
+            if (e.nameOffset >= size || (int64)e.dataOffset + e.dataSize > size) {
+                Log::Error("Script archive %s is broken", TCHAR_TO_UTF8(*path));
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const LuaScriptArchive::Entry* LuaScriptArchive::getEntries() const
+    {
+        return (const Entry*)(data + sizeof(ArchiveHeader));
+    }
+
+    const uint8* LuaScriptArchive::find(const char* fn, uint32& outSize, uint32& outSourceHash) const
+    {
+        const Entry* entries = getEntries();
+        int32 low = 0, high = count - 1;
+        while (low <= high) {
+            int32 mid = low + (high - low) / 2;
+            const Entry& e = entries[mid];
+            int cmp = compareModuleName(fn, (const char*)(data + e.nameOffset));
+            if (cmp == 0) {
+                outSize = e.dataSize;
+                outSourceHash = e.sourceHash;
+                return data + e.dataOffset;
+            }
+            if (cmp < 0) high = mid - 1;
+            else low = mid + 1;
+        }
+        return nullptr;
+    }
+
+    uint32 LuaScriptArchive::hashSource(const uint8* buf, int32 len)
+    {
+        return FCrc::MemCrc32(buf, len);
+    }
+
+    bool LuaScriptArchive::compile(lua_State* L, const uint8* source, int32 len, const char* chunk, bool bStripDebugInfo, TArray<uint8>& outCode, FString* outError)
+    {
+        if (luaL_loadbuffer(L, (const char*)source, len, chunk) != 0) {
+            if (outError) *outError = UTF8_TO_TCHAR(lua_tostring(L, -1));
+            lua_pop(L, 1);
+            return false;
+        }
+        lua_dump(L, dumpWriter, &outCode, bStripDebugInfo ? 1 : 0);
+        lua_pop(L, 1);
+        return true;
+    }
+
+    bool LuaScriptArchive::build(const FString& scriptDir, const FString& outPath, bool bStripDebugInfo)
+    {
+        TArray<FString> files;
+        IFileManager::Get().FindFilesRecursive(files, *scriptDir, TEXT("*.lua"), true, false);
+
+        // only compile, no library needed
+        lua_State* L = luaL_newstate();
+        if (!L) return false;
+
+        FString root = scriptDir;
+        FPaths::NormalizeDirectoryName(root);
+
+        TArray<CompiledModule*> modules;
+        for (const FString& file : files) {
+            // dir/a/b.lua => a/b.lua => a.b
+            FString relative = file;
+            FPaths::NormalizeFilename(relative);
+            relative = relative.Mid(root.Len() + 1);
+            FString name = relative.LeftChop(4).Replace(TEXT("/"), TEXT("."));
+
+            TArray<uint8> source;
+            if (!FFileHelper::LoadFileToArray(source, *file)) {
+                Log::Error("Can't read script %s", TCHAR_TO_UTF8(*file));
+                continue;
+            }
+
+            // same path the loader resolves module to under script dir, no path of build machine baked in
+            FString chunk = TEXT("@") + relative;
+            TArray<uint8> code;
+            FString error;
+            if (!compile(L, source.GetData(), source.Num(), TCHAR_TO_UTF8(*chunk), bStripDebugInfo, code, &error)) {
+                Log::Error("Compile script failed: %s", TCHAR_TO_UTF8(*error));
+                continue;
+            }
+
+            CompiledModule* module = new CompiledModule(name);
+            module->sourceHash = hashSource(source.GetData(), source.Num());
+            module->code = MoveTemp(code);
+            modules.Add(module);
+        }
+        lua_close(L);
+
+        modules.Sort([](const CompiledModule& a, const CompiledModule& b) {
+            return compareModuleName(a.name.Get(), b.name.Get()) < 0;
+        });
+
+        // header, entries, names, then bytecode
+        TArray<uint8> out;
+        ArchiveHeader header = { ArchiveMagic, ArchiveVersion, LUA_VERSION_NUM, (uint32)modules.Num() };
+        out.Append((const uint8*)&header, sizeof(header));
+        int32 entriesOffset = out.AddZeroed(modules.Num() * sizeof(Entry));
+
+        TArray<Entry> entries;
+        entries.SetNumZeroed(modules.Num());
+        for (int32 i = 0; i < modules.Num(); i++) {
+            entries[i].nameOffset = out.Num();
+            out.Append((const uint8*)modules[i]->name.Get(), modules[i]->name.Length() + 1);
+        }
+        for (int32 i = 0; i < modules.Num(); i++) {
+            entries[i].dataOffset = out.Num();
+            entries[i].dataSize = modules[i]->code.Num();
+            entries[i].sourceHash = modules[i]->sourceHash;
+            out.Append(modules[i]->code);
+        }
+        out.Add(0);
+        FMemory::Memcpy(out.GetData() + entriesOffset, entries.GetData(), entries.Num() * sizeof(Entry));
+
+        for (CompiledModule* module : modules)
+            delete module;
+
+        if (!FFileHelper::SaveArrayToFile(out, *outPath)) {
+            Log::Error("Can't write script archive %s", TCHAR_TO_UTF8(*outPath));
+            return false;
+        }
+        Log::Log("Built script archive %s with %d of %d scripts", TCHAR_TO_UTF8(*outPath), entries.Num(), files.Num());
+        return entries.Num() == files.Num();
+    }
+
+#if !UE_BUILD_SHIPPING
+    static void buildScriptArchive(const TArray<FString>& args)
+    {
+        if (args.Num() < 2) {
+            Log::Error("usage: slua.BuildScriptArchive ScriptDir OutPath [strip]");
+            return;
+        }
+        LuaScriptArchive::build(args[0], args[1], args.Num() > 2 && args[2] == TEXT("strip"));
+    }
+
+    static FAutoConsoleCommand CVarBuildScriptArchive(
+        TEXT("slua.BuildScriptArchive"),
+        TEXT("Precompile all lua files under ScriptDir into one archive, slua.BuildScriptArchive ScriptDir OutPath [strip]"),
+        FConsoleCommandWithArgsDelegate::CreateStatic(buildScriptArchive),
+        ECVF_Default);
+#endif
+}
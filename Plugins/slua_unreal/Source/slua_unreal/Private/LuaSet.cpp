@@ -5,6 +5,8 @@
 #include "LuaState.h"
 #include "LuaReference.h"
 #include "LuaNetSerialization.h"
+#include "LuaContainerKey.h"
+#include "LuaContainerConvert.h"
 
 #define GET_SET_CHECKER() \
     const auto elementChecker = LuaObject::getChecker(UD->inner);\
@@ -153,11 +155,9 @@ namespace NS_SLUA
             luaL_error(L, "arg 1 expect LuaSet, but got nil!");
         }
         GET_SET_CHECKER()
-        const FDefaultConstructedPropertyElement tempElement(UD->inner);
-        const auto elementPtr = tempElement.GetObjAddress();
-        elementChecker(L, UD->inner, static_cast<uint8*>(elementPtr), 2, true);
+        const LuaContainerKey tempElement(L, UD->inner, elementChecker, 2);
 
-        const auto index = UD->helper.FindElementIndexFromHash(elementPtr);
+        const auto index = tempElement.findSetIndex(UD->set, UD->helper.SetLayout);
         if (index != INDEX_NONE)
         {
             lua_pushvalue(L, 2);
@@ -178,10 +178,8 @@ namespace NS_SLUA
             luaL_error(L, "arg 1 expect LuaSet, but got nil!");
         }
         GET_SET_CHECKER();
-        const FDefaultConstructedPropertyElement tempElement(UD->inner);
-        const auto elementPtr = tempElement.GetObjAddress();
-        elementChecker(L, UD->inner, static_cast<uint8*>(elementPtr), 2, true);
-        UD->helper.AddElement(elementPtr);
+        const LuaContainerKey tempElement(L, UD->inner, elementChecker, 2, false);
+        UD->helper.AddElement(tempElement.getObjAddress());
 
         markDirty(UD);
 
@@ -195,13 +193,11 @@ namespace NS_SLUA
             luaL_error(L, "arg 1 expect LuaSet, but got nil!");
         }
         GET_SET_CHECKER();
-        const FDefaultConstructedPropertyElement tempElement(UD->inner);
-        const auto elementPtr = tempElement.GetObjAddress();
-        elementChecker(L, UD->inner, static_cast<uint8*>(elementPtr), 2, true);
+        const LuaContainerKey tempElement(L, UD->inner, elementChecker, 2);
 
         markDirty(UD);
 
-        return LuaObject::push(L, UD->removeElement(elementPtr));
+        return LuaObject::push(L, UD->removeElement(tempElement));
     }
 
     int LuaSet::Clear(lua_State* L)
@@ -404,15 +400,9 @@ namespace NS_SLUA
     }
 
     // Modify FScriptSetHelper::RemoveAt for the use of our custom removeAt.
-    bool LuaSet::removeElement(const void* elementToRemove)
+    bool LuaSet::removeElement(const LuaContainerKey& elementToRemove)
     {
-        FProperty* localElementPropForCapture = inner;
-        const auto foundIndex = set->FindIndex(
-            elementToRemove,
-            helper.SetLayout,
-            [localElementPropForCapture](const void* Element) { return localElementPropForCapture->GetValueTypeHash(Element); },
-            [localElementPropForCapture](const void* A, const void* B) { return localElementPropForCapture->Identical(A, B); }
-        );
+        const auto foundIndex = elementToRemove.findSetIndex(set, helper.SetLayout);
         if (foundIndex != INDEX_NONE)
         {
             removeAt(foundIndex);
@@ -424,6 +414,30 @@ namespace NS_SLUA
         }
     }
 
+    int LuaSet::ToTable(lua_State* L)
+    {
+        CheckUD(LuaSet, L, 1);
+        if (!UD) {
+            luaL_error(L, "arg 1 expect LuaSet, but got nil!");
+        }
+        return LuaContainerConvert::pushSet(L, UD->inner, UD->helper);
+    }
+
+    int LuaSet::FromTable(lua_State* L)
+    {
+        CheckUD(LuaSet, L, 1);
+        if (!UD) {
+            luaL_error(L, "arg 1 expect LuaSet, but got nil!");
+        }
+        luaL_checktype(L, 2, LUA_TTABLE);
+
+        UD->clear();
+        LuaContainerConvert::readSet(L, 2, UD->inner, UD->helper);
+
+        markDirty(UD);
+        return 0;
+    }
+
     int LuaSet::setupMT(lua_State* L)
     {
         LuaObject::setupMTSelfSearch(L);
@@ -435,6 +449,8 @@ namespace NS_SLUA
         RegMetaMethod(L, Clear);
         RegMetaMethod(L, Pairs);
         RegMetaMethod(L, CreateElementTypeObject);
+        RegMetaMethod(L, ToTable);
+        RegMetaMethod(L, FromTable);
         
         RegMetaMethodByName(L, "__pairs", Pairs);
         return 0;
@@ -0,0 +1,314 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "LuaSmallBlockAllocator.h"
+#include "Log.h"
+
+namespace NS_SLUA {
+
+    struct LuaSmallBlockAllocator::Page
+    {
+        Page* prev;
+        Page* next;
+        void* freeList;
+        uint32 classIndex;
+        uint32 usedBlocks;
+        // offset of area never allocated
+        uint32 bumpOffset;
+    };
+
+    namespace {
+        // sizeof(Page) rounded up to 16 bytes
+        const uint32 PageHeaderSize = 48;
+
+        FORCEINLINE uint32 classBlockSize(uint32 index)
+        {
+            return index < 16 ? (index + 1) * 8 : 128 + (index - 15) * 32;
+        }
+    }
+
+    int64 LuaAllocatorStats::internalFragmentation() const
+    {
+        return smallBlockBytes - (requestedBytes - largeBlockBytes);
+    }
+
+    int64 LuaAllocatorStats::externalFragmentation() const
+    {
+        return pageBytes - smallBlockBytes;
+    }
+
+    LuaSmallBlockAllocator::LuaSmallBlockAllocator()
+        : cachedPages(nullptr)
+        , cachedPageCount(0)
+    {
+        static_assert(sizeof(Page) <= 48, "page header too large");
+        for (uint32 i = 0; i < NumClasses; i++) {
+            SizeClass& sc = classes[i];
+            sc.blockSize = classBlockSize(i);
+            sc.blocksPerPage = (PageSize - PageHeaderSize) / sc.blockSize;
+            sc.partialPages = nullptr;
+            sc.liveBlocks = 0;
+            sc.requestedBytes = 0;
+        }
+        check(classBlockSize(NumClasses - 1) == MaxSmallSize);
+    }
+
+    LuaSmallBlockAllocator::~LuaSmallBlockAllocator()
+    {
+        // lua_close should free all blocks, pages left are leaked by someone
+        for (uint32 i = 0; i < NumClasses; i++) {
+            SizeClass& sc = classes[i];
+            if (sc.liveBlocks > 0) {
+                Log::Error("Lua small block allocator: %lld blocks of size %u leaked", sc.liveBlocks, sc.blockSize);
+            }
+            while (sc.partialPages) {
+                Page* page = sc.partialPages;
+                sc.partialPages = page->next;
+                FMemory::Free(page);
+            }
+        }
+        trim();
+    }
+
+    void* LuaSmallBlockAllocator::luaAlloc(void* ud, void* ptr, size_t osize, size_t nsize)
+    {
+        LuaSmallBlockAllocator* allocator = (LuaSmallBlockAllocator*)ud;
+        if (nsize == 0) {
+            allocator->free(ptr, osize);
+            return nullptr;
+        }
+        return allocator->realloc(ptr, osize, nsize);
+    }
+
+    FORCEINLINE uint32 LuaSmallBlockAllocator::classIndexOf(size_t size)
+    {
+        return size <= 128 ? (uint32)(size - 1) >> 3 : 15 + (((uint32)size - 128 + 31) >> 5);
+    }
+
+    FORCEINLINE LuaSmallBlockAllocator::Page* LuaSmallBlockAllocator::pageOf(void* ptr)
+    {
+        return (Page*)((UPTRINT)ptr & ~(UPTRINT)(PageSize - 1));
+    }
+
+    void* LuaSmallBlockAllocator::realloc(void* ptr, size_t osize, size_t nsize)
+    {
+        // osize is lua type tag if ptr is null
+        if (!ptr) {
+            stats.requestedBytes += nsize;
+            if (nsize <= MaxSmallSize)
+                return allocSmall((uint32)nsize);
+
+            stats.largeBlockBytes += nsize;
+            stats.largeBlockCount++;
+            return FMemory::Malloc(nsize);
+        }
+
+        bool oldSmall = osize <= MaxSmallSize;
+        bool newSmall = nsize <= MaxSmallSize;
+        if (oldSmall && newSmall && classIndexOf(osize) == classIndexOf(nsize)) {
+            // same block fit new size
+            classes[classIndexOf(osize)].requestedBytes += (int64)nsize - (int64)osize;
+            stats.requestedBytes += (int64)nsize - (int64)osize;
+            return ptr;
+        }
+
+        if (!oldSmall && !newSmall) {
+            stats.requestedBytes += (int64)nsize - (int64)osize;
+            stats.largeBlockBytes += (int64)nsize - (int64)osize;
+            return FMemory::Realloc(ptr, nsize);
+        }
+
+        void* newPtr;
+        if (newSmall) {
+            newPtr = allocSmall((uint32)nsize);
+        }
+        else {
+            newPtr = FMemory::Malloc(nsize);
+            stats.largeBlockBytes += nsize;
+            stats.largeBlockCount++;
+        }
+        if (!newPtr)
+            return nullptr;
+
+        stats.requestedBytes += nsize;
+        FMemory::Memcpy(newPtr, ptr, FMath::Min(osize, nsize));
+        free(ptr, osize);
+        return newPtr;
+    }
+
+    void LuaSmallBlockAllocator::free(void* ptr, size_t osize)
+    {
+        if (!ptr)
+            return;
+
+        stats.requestedBytes -= osize;
+        if (osize <= MaxSmallSize) {
+            freeSmall(ptr, (uint32)osize);
+        }
+        else {
+            stats.largeBlockBytes -= osize;
+            stats.largeBlockCount--;
+            FMemory::Free(ptr);
+        }
+    }
+
+    void* LuaSmallBlockAllocator::allocSmall(uint32 size)
+    {
+        uint32 index = classIndexOf(size);
+        SizeClass& sc = classes[index];
+        Page* page = sc.partialPages;
+        if (!page) {
+            page = newPage(index);
+            if (!page)
+                return nullptr;
+            sc.partialPages = page;
+        }
+
+        void* block;
+        if (page->freeList) {
+            block = page->freeList;
+            page->freeList = *(void**)block;
+        }
+        else {
+            block = (uint8*)page + page->bumpOffset;
+            page->bumpOffset += sc.blockSize;
+        }
+
+        if (++page->usedBlocks == sc.blocksPerPage) {
+            // page is full, remove from partial list
+            sc.partialPages = page->next;
+            if (page->next)
+                page->next->prev = nullptr;
+            page->next = page->prev = nullptr;
+        }
+
+        sc.liveBlocks++;
+        sc.requestedBytes += size;
+        stats.smallBlockBytes += sc.blockSize;
+        stats.smallBlockCount++;
+        return block;
+    }
+
+    void LuaSmallBlockAllocator::freeSmall(void* ptr, uint32 size)
+    {
+        Page* page = pageOf(ptr);
+        uint32 index = page->classIndex;
+        checkSlow(index == classIndexOf(size));
+        SizeClass& sc = classes[index];
+
+        *(void**)ptr = page->freeList;
+        page->freeList = ptr;
+
+        if (page->usedBlocks == sc.blocksPerPage) {
+            // page was full, it has free block now
+            page->prev = nullptr;
+            page->next = sc.partialPages;
+            if (sc.partialPages)
+                sc.partialPages->prev = page;
+            sc.partialPages = page;
+        }
+
+        sc.liveBlocks--;
+        sc.requestedBytes -= size;
+        stats.smallBlockBytes -= sc.blockSize;
+        stats.smallBlockCount--;
+
+        if (--page->usedBlocks == 0) {
+            if (page->prev)
+                page->prev->next = page->next;
+            else
+                sc.partialPages = page->next;
+            if (page->next)
+                page->next->prev = page->prev;
+            releasePage(page);
+        }
+    }
+
+    LuaSmallBlockAllocator::Page* LuaSmallBlockAllocator::newPage(uint32 classIndex)
+    {
+        Page* page = cachedPages;
+        if (page) {
+            cachedPages = page->next;
+            cachedPageCount--;
+        }
+        else {
+            // page aligned to its size, so block can find page by address mask
+            page = (Page*)FMemory::Malloc(PageSize, PageSize);
+            if (!page)
+                return nullptr;
+            stats.pageCount++;
+            stats.pageBytes += PageSize;
+        }
+
+        page->prev = page->next = nullptr;
+        page->freeList = nullptr;
+        page->classIndex = classIndex;
+        page->usedBlocks = 0;
+        page->bumpOffset = PageHeaderSize;
+        stats.cachedPageCount = cachedPageCount;
+        return page;
+    }
+
+    void LuaSmallBlockAllocator::releasePage(Page* page)
+    {
+        if (cachedPageCount < MaxCachedPages) {
+            page->next = cachedPages;
+            cachedPages = page;
+            cachedPageCount++;
+        }
+        else {
+            FMemory::Free(page);
+            stats.pageCount--;
+            stats.pageBytes -= PageSize;
+            stats.releasedPageCount++;
+        }
+        stats.cachedPageCount = cachedPageCount;
+    }
+
+    void LuaSmallBlockAllocator::trim()
+    {
+        while (cachedPages) {
+            Page* page = cachedPages;
+            cachedPages = page->next;
+            FMemory::Free(page);
+            stats.pageCount--;
+            stats.pageBytes -= PageSize;
+            stats.releasedPageCount++;
+        }
+        cachedPageCount = 0;
+        stats.cachedPageCount = 0;
+    }
+
+    void LuaSmallBlockAllocator::dumpStats(FOutputDevice& Ar) const
+    {
+        Ar.Logf(TEXT("Requested %lld bytes, small blocks %lld (%lld bytes), large blocks %lld (%lld bytes)"),
+            stats.requestedBytes, stats.smallBlockCount, stats.smallBlockBytes, stats.largeBlockCount, stats.largeBlockBytes);
+        Ar.Logf(TEXT("Pages %d (%lld bytes), cached %d, released %lld"),
+            stats.pageCount, stats.pageBytes, stats.cachedPageCount, stats.releasedPageCount);
+        Ar.Logf(TEXT("Fragmentation: internal %lld bytes, external %lld bytes"),
+            stats.internalFragmentation(), stats.externalFragmentation());
+
+        for (uint32 i = 0; i < NumClasses; i++) {
+            const SizeClass& sc = classes[i];
+            if (sc.liveBlocks == 0)
+                continue;
+
+            int32 partialCount = 0;
+            for (Page* page = sc.partialPages; page; page = page->next)
+                partialCount++;
+
+            Ar.Logf(TEXT("\tsize %3u: %lld blocks, %lld bytes requested, %lld bytes wasted, %d partial pages"),
+                sc.blockSize, sc.liveBlocks, sc.requestedBytes, sc.liveBlocks * sc.blockSize - sc.requestedBytes, partialCount);
+        }
+    }
+}
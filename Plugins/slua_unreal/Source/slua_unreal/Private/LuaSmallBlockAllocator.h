@@ -0,0 +1,96 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace NS_SLUA {
+
+    struct LuaAllocatorStats
+    {
+        // bytes lua asked for, small and large blocks
+        int64 requestedBytes = 0;
+        // bytes of small blocks handed out, include size class rounding
+        int64 smallBlockBytes = 0;
+        int64 smallBlockCount = 0;
+        int64 largeBlockBytes = 0;
+        int64 largeBlockCount = 0;
+        // bytes of pages own by allocator
+        int64 pageBytes = 0;
+        int32 pageCount = 0;
+        int32 cachedPageCount = 0;
+        int64 releasedPageCount = 0;
+
+        // rounding waste inside small blocks
+        int64 internalFragmentation() const;
+        // free space inside pages
+        int64 externalFragmentation() const;
+    };
+
+    // size class allocator for small lua objects(string, table, closure, upvalue...),
+    // one instance per LuaState, lua state only run on one thread at the same time,
+    // so free lists don't need any lock.
+    // lua pass the exact old size to allocator, so block size is known without header,
+    // block's page is found by address mask.
+    class LuaSmallBlockAllocator
+    {
+    public:
+        // blocks larger than this go to FMemory
+        static const uint32 MaxSmallSize = 512;
+        static const uint32 PageSize = 64 * 1024;
+        // 8 bytes step until 128, then 32 bytes step until 512
+        static const uint32 NumClasses = 28;
+        static const int32 MaxCachedPages = 8;
+
+        LuaSmallBlockAllocator();
+        ~LuaSmallBlockAllocator();
+
+        // lua_Alloc compatible realloc, ud is LuaSmallBlockAllocator
+        static void* luaAlloc(void* ud, void* ptr, size_t osize, size_t nsize);
+
+        void* realloc(void* ptr, size_t osize, size_t nsize);
+        void free(void* ptr, size_t osize);
+
+        // release cached empty pages
+        void trim();
+
+        const LuaAllocatorStats& getStats() const { return stats; }
+        void dumpStats(FOutputDevice& Ar) const;
+
+    private:
+        struct Page;
+        struct SizeClass
+        {
+            uint32 blockSize;
+            uint32 blocksPerPage;
+            // pages which have free block
+            Page* partialPages;
+            int64 liveBlocks;
+            int64 requestedBytes;
+        };
+
+        void* allocSmall(uint32 size);
+        void freeSmall(void* ptr, uint32 size);
+        Page* newPage(uint32 classIndex);
+        void releasePage(Page* page);
+        static Page* pageOf(void* ptr);
+        static uint32 classIndexOf(size_t size);
+
+        SizeClass classes[NumClasses];
+        // a few empty pages kept to avoid alloc/free page repeatly
+        Page* cachedPages;
+        int32 cachedPageCount;
+        LuaAllocatorStats stats;
+    };
+}
@@ -20,6 +20,7 @@
 #include "Log.h"
 #include "Misc/Paths.h"
 #include "Misc/ConfigCacheIni.h"
+#include "UObject/UObjectGlobals.h"
 
 namespace NS_SLUA {
     LuaStatProfile::LuaStatProfile()
@@ -32,12 +33,16 @@ namespace NS_SLUA {
 
     TArray<FString> LuaStatProfile::blackScripts;
     TArray<LuaStatProfile::LuaStackInfo> LuaStatProfile::luaStateStack;
+    TMap<lua_State*, int32> LuaStatProfile::luaStateIndex;
+    TMap<const void*, LuaStatProfile::CounterInfo> LuaStatProfile::counterCache;
+    TMap<TPair<const void*, const char*>, LuaStatProfile::NamedCounter> LuaStatProfile::namedCounterCache;
     int LuaStatProfile::coroutineStack = 0;
     int LuaStatProfile::mainStack = 0;
     int LuaStatProfile::coroutine = 0;
     int LuaStatProfile::level = 2;
     bool LuaStatProfile::switcher = false;
     FDelegateHandle LuaStatProfile::errorHandle;
+    FDelegateHandle LuaStatProfile::gcHandle;
 
     void LuaStatProfile::profile_coroutine_hook(lua_State* L, lua_Debug* ar)
     {
@@ -50,7 +55,6 @@ namespace NS_SLUA {
 
         checkCoroutine();
 
-        lua_getinfo(L, "nSl", ar);
         int event = ar->event;
         int stateYield = -1;
         int resumeEvent = 0;
@@ -58,10 +62,11 @@ namespace NS_SLUA {
         if (ar->event > LUA_HOOKRET && event != LUA_HOOKTAILCALL)
             return;
 
-        if (strstr(ar->short_src, LuaProfiler::ChunkName))
+        const CounterInfo counterInfo = getCounterInfo(L, ar);
+        if (counterInfo.bProfilerChunk)
             return;
 
-        if (ar->what && strcmp(ar->what, "C") == 0) {
+        if (counterInfo.bCFunction) {
 #if LUA_VERSION_RELEASE_NUM >= 50406
             StkId o = L->ci ? L->ci->func.p : nullptr;
 #else
@@ -90,32 +95,19 @@ namespace NS_SLUA {
 #endif
         }
 
-        FString counterName = generateCounterName(ar);
-        LuaStackInfo* curInfo = nullptr;
+        const int32 counterHandle = counterInfo.handle;
         int index = -1;
         //协程堆栈处理完毕之后，并不一定退出协程
-        for (int i = 0; i < luaStateStack.Num(); i++)
-        {
-            if (luaStateStack[i].luaState == L)
-            {
-                curInfo = &luaStateStack[i];
-                index = i;
-                break;
-            }
-        }
-
+        LuaStackInfo* curInfo = findStackInfo(L, index);
         if (curInfo == nullptr)
         {
-            LuaStackInfo stackInfo(L, 0);
-            luaStateStack.Add(stackInfo);
-            curInfo = &luaStateStack.Top();
-            index = luaStateStack.Num() - 1;
+            curInfo = pushStackInfo(L, index);
         }
         //尾调用特殊处理（因为尾调用后，函数不会再return到调用函数，相当于goto
         //所以当遇到尾调用时，也就是event=4要把之前函数调用的栈清理掉）
         if (event == LUA_HOOKTAILCALL)
         {
-            FLuaCycleCounter::counterStop(1, luaStateStack.Num(), counterName);
+            FLuaCycleCounter::counterStopByHandle(counterHandle, 1, luaStateStack.Num());
             curInfo->stackNum--;
         }
 
@@ -124,13 +116,13 @@ namespace NS_SLUA {
         {
             while (curInfo->stackNum > 0)
             {
-                FLuaCycleCounter::counterStop(2, luaStateStack.Num(), counterName);
+                FLuaCycleCounter::counterStopByHandle(counterHandle, 2, luaStateStack.Num());
                 curInfo->stackNum--;
             }
         }
         else if (stateYield == LUA_HOOKRET)
         {
-            FLuaCycleCounter::counterStart(counterName, 1, luaStateStack.Num());
+            FLuaCycleCounter::counterStartByHandle(counterHandle, 1, luaStateStack.Num());
             curInfo->stackNum++;
             //yield函数返回不统计
             return;
@@ -138,12 +130,12 @@ namespace NS_SLUA {
         else
         {
             //保留协程函数
-            if (resumeEvent < ENTER && checkHookSuc(ar) == false)
+            if (resumeEvent < ENTER && !counterInfo.bHookable)
                 return;
 
             if (event == LUA_HOOKCALL)
             {
-                FLuaCycleCounter::counterStart(counterName, 2, luaStateStack.Num());
+                FLuaCycleCounter::counterStartByHandle(counterHandle, 2, luaStateStack.Num());
                 curInfo->stackNum++;
             }
             else if (event == LUA_HOOKRET)
@@ -151,27 +143,27 @@ namespace NS_SLUA {
                 if (curInfo->stackNum > 0)
                 {
 
-                    FLuaCycleCounter::counterStop(3, luaStateStack.Num(), counterName);
+                    FLuaCycleCounter::counterStopByHandle(counterHandle, 3, luaStateStack.Num());
                     curInfo->stackNum--;
                 }
             }
             else if (ar->event == LUA_HOOKTAILCALL)
             {
-                FLuaCycleCounter::counterStart(counterName, 3, luaStateStack.Num());
+                FLuaCycleCounter::counterStartByHandle(counterHandle, 3, luaStateStack.Num());
                 curInfo->stackNum++;
             }
         }
 
         if (curInfo->stackNum <= 0)
         {
-            luaStateStack.RemoveAt(index);
+            removeStackInfo(index);
         }
 
         if (resumeEvent == ENTER)
         {
             lua_State* co = lua_tothread(L, 1);
-            LuaStackInfo stackInfo(co, 0);
-            luaStateStack.Add(stackInfo);
+            int coIndex;
+            pushStackInfo(co, coIndex);
             lua_sethook(co, profile_coroutine_hook, LUA_MASKRET | LUA_MASKCALL, 0);
 
         }
@@ -184,7 +176,6 @@ namespace NS_SLUA {
     void LuaStatProfile::profile_hook(lua_State* L, lua_Debug* ar)
     {
         checkCoroutine();
-        lua_getinfo(L, "nSl", ar);
         int event = ar->event;
         // we don't care about LUA_HOOKLINE, LUA_HOOKCOUNT
         if (event > LUA_HOOKRET && event != LUA_HOOKTAILCALL)
@@ -192,14 +183,15 @@ namespace NS_SLUA {
             return;
         }
 
-        if (strstr(ar->short_src, LuaProfiler::ChunkName))
+        const CounterInfo counterInfo = getCounterInfo(L, ar);
+        if (counterInfo.bProfilerChunk)
             return;
         lua_Debug* co_debug = NULL;
         lua_State* co = NULL;
         lua_Debug co_ar;
 
         int resumeEvent = 0;
-        if (ar->what && strcmp(ar->what, "C") == 0) {
+        if (counterInfo.bCFunction) {
 #if LUA_VERSION_RELEASE_NUM >= 50406
             StkId o = L->ci ? L->ci->func.p : nullptr;
 #else
@@ -222,7 +214,6 @@ namespace NS_SLUA {
                     case LUA_OK: 
                         if (lua_getstack(co, 1, &co_ar) > 0)
                         {
-                            lua_getinfo(co, "nSl", &co_ar);
                             co_debug = &co_ar;
                         }
                         break;
@@ -232,51 +223,51 @@ namespace NS_SLUA {
                 }
             }
         }
-        const FString counterName = generateCounterName(ar);
+        const int32 counterHandle = counterInfo.handle;
         //尾调用特殊处理（因为尾调用后，函数不会再return到调用函数，相当于goto
         //所以当遇到尾调用时，也就是event=4要把之前函数调用的栈清理掉）
         //同时还需要模拟一个进栈操作
         if (event == LUA_HOOKTAILCALL)
         {
-            FLuaCycleCounter::counterStop(4, luaStateStack.Num(), counterName);
+            FLuaCycleCounter::counterStopByHandle(counterHandle, 4, luaStateStack.Num());
         }
 
         //保留协程函数
-        if (resumeEvent < ENTER && checkHookSuc(ar) == false)
+        if (resumeEvent < ENTER && !counterInfo.bHookable)
             return;
 
         if (resumeEvent == ENTER)
         {
             //coroutine++;
-            LuaStackInfo stackInfo(co, 0);
-            luaStateStack.Add(stackInfo);
+            int coIndex;
+            pushStackInfo(co, coIndex);
             lua_sethook(co, profile_coroutine_hook, LUA_MASKRET | LUA_MASKCALL, 0);
         }
         else if (resumeEvent == EXIT)
         {
             if (co_debug && co)
             {
-                FLuaCycleCounter::counterStop(5, luaStateStack.Num(), generateCounterName(co_debug));
+                FLuaCycleCounter::counterStopByHandle(getCounterInfo(co, co_debug).handle, 5, luaStateStack.Num());
             }
         }
 
         if (ar->event == LUA_HOOKCALL)
         {
-            FLuaCycleCounter::counterStart(counterName, 4, luaStateStack.Num());
+            FLuaCycleCounter::counterStartByHandle(counterHandle, 4, luaStateStack.Num());
         }
         else if (ar->event == LUA_HOOKRET)
         {
-            FLuaCycleCounter::counterStop(5, luaStateStack.Num(), counterName);
+            FLuaCycleCounter::counterStopByHandle(counterHandle, 5, luaStateStack.Num());
         }
         //模拟一个进栈操作
         else if (ar->event == LUA_HOOKTAILCALL)
         {
-            FLuaCycleCounter::counterStart(counterName, 5, luaStateStack.Num());
+            FLuaCycleCounter::counterStartByHandle(counterHandle, 5, luaStateStack.Num());
         }
 
         if (resumeEvent == ENTER && co_debug && co)
         {
-            FLuaCycleCounter::counterStart(generateCounterName(co_debug), 5, luaStateStack.Num());
+            FLuaCycleCounter::counterStartByHandle(getCounterInfo(co, co_debug).handle, 5, luaStateStack.Num());
         }
     }
 
@@ -304,8 +295,152 @@ namespace NS_SLUA {
                 luaStateStack[index].stackNum--;
             }
 
-            luaStateStack.RemoveAt(index);
+            removeStackInfo(index);
+        }
+    }
+
+    LuaStatProfile::LuaStackInfo* LuaStatProfile::findStackInfo(lua_State* L, int& index)
+    {
+        int32* indexPtr = luaStateIndex.Find(L);
+        if (!indexPtr)
+        {
+            index = -1;
+            return nullptr;
+        }
+        index = *indexPtr;
+        return &luaStateStack[index];
+    }
+
+    LuaStatProfile::LuaStackInfo* LuaStatProfile::pushStackInfo(lua_State* L, int& index)
+    {
+        index = luaStateStack.Add(LuaStackInfo(L, 0));
+        // same thread may be pushed twice, lookup always return the first one
+        if (!luaStateIndex.Contains(L))
+        {
+            luaStateIndex.Add(L, index);
+        }
+        return &luaStateStack[index];
+    }
+
+    void LuaStatProfile::removeStackInfo(int index)
+    {
+        luaStateStack.RemoveAt(index);
+        // removing is rare(coroutine finished), stack is short, just rebuild
+        luaStateIndex.Reset();
+        for (int i = 0; i < luaStateStack.Num(); i++)
+        {
+            if (!luaStateIndex.Contains(luaStateStack[i].luaState))
+            {
+                luaStateIndex.Add(luaStateStack[i].luaState, i);
+            }
+        }
+    }
+
+    const void* LuaStatProfile::getFunctionKey(lua_Debug* ar, const void*& source, int& lineDefined)
+    {
+        source = nullptr;
+        lineDefined = 0;
+        auto ci = ar->i_ci;
+        if (!ci)
+            return nullptr;
+#if LUA_VERSION_RELEASE_NUM >= 50406
+        auto func = s2v(ci->func.p);
+#elif LUA_VERSION_NUM > 503
+        auto func = s2v(ci->func);
+#else
+        auto func = ci->func;
+#endif
+        if (ttisLclosure(func))
+        {
+            Proto* p = clLvalue(func)->p;
+            source = p->source;
+            lineDefined = p->linedefined;
+            return p;
+        }
+        if (ttislcf(func))
+        {
+            source = (const void*)fvalue(func);
+            return source;
+        }
+        if (ttisCclosure(func))
+        {
+            CClosure* cl = clCvalue(func);
+            source = (const void*)cl->f;
+            // closures share one c function, e.g. all ufunction closures, so key them by
+            // lightuserdata bound as first upvalue(ufunction accelerator), or by closure itself
+            if (cl->nupvalues > 0 && ttislightuserdata(&cl->upvalue[0]))
+                return pvalue(&cl->upvalue[0]);
+            return cl;
+        }
+        return nullptr;
+    }
+
+    LuaStatProfile::CounterInfo LuaStatProfile::getCounterInfo(lua_State* L, lua_Debug* ar)
+    {
+        const void* source;
+        int lineDefined;
+        const void* key = getFunctionKey(ar, source, lineDefined);
+        CounterInfo* cached = key ? counterCache.Find(key) : nullptr;
+        CounterInfo info;
+        if (cached && cached->source == source && cached->lineDefined == lineDefined)
+        {
+            info = *cached;
+            if (level <= 2 || info.bProfilerChunk)
+                return info;
+            // name of call site differs between calls
+            lua_getinfo(L, "n", ar);
+        }
+        else
+        {
+            // first time to see this function, below level 3 name stay the same as first call site
+            lua_getinfo(L, "nS", ar);
+            info.source = source;
+            info.lineDefined = lineDefined;
+            info.bCFunction = ar->what && strcmp(ar->what, "C") == 0;
+            info.bProfilerChunk = strstr(ar->short_src, LuaProfiler::ChunkName) != nullptr;
+            info.bHookable = checkHookSuc(ar);
+            info.handle = info.bProfilerChunk ? INDEX_NONE : FLuaCycleCounter::getCounterHandle(generateCounterName(ar));
+            if (key)
+            {
+                counterCache.Add(key, info);
+            }
+            if (level <= 2 || info.bProfilerChunk)
+                return info;
+        }
+
+        // function without name isn't hooked at level 3
+        if (ar->name == nullptr)
+        {
+            info.bHookable = false;
+            return info;
         }
+        // counter of function without key had been named by this call
+        if (key)
+            info.handle = getNamedCounterHandle(L, ar, key, info);
+        return info;
+    }
+
+    int32 LuaStatProfile::getNamedCounterHandle(lua_State* L, lua_Debug* ar, const void* key, const CounterInfo& info)
+    {
+        NamedCounter& named = namedCounterCache.FindOrAdd(TPair<const void*, const char*>(key, ar->name));
+        if (named.handle == INDEX_NONE || named.source != info.source || named.lineDefined != info.lineDefined
+            || FCStringAnsi::Strcmp(named.name.GetData(), ar->name) != 0)
+        {
+            lua_getinfo(L, "S", ar);
+            named.source = info.source;
+            named.lineDefined = info.lineDefined;
+            named.name.SetNumUninitialized(FCStringAnsi::Strlen(ar->name) + 1);
+            FMemory::Memcpy(named.name.GetData(), ar->name, named.name.Num());
+            named.handle = FLuaCycleCounter::getCounterHandle(generateCounterName(ar));
+        }
+        return named.handle;
+    }
+
+    void LuaStatProfile::onEngineGC()
+    {
+        // ufunction accelerators and closures used as key may be freed
+        counterCache.Empty();
+        namedCounterCache.Empty();
     }
 
     FString LuaStatProfile::generateCounterName(lua_Debug* ar)
@@ -338,8 +473,14 @@ namespace NS_SLUA {
                 errorDelegate->Remove(errorHandle);
             }
         }
+        FCoreUObjectDelegates::GetPostGarbageCollect().Remove(gcHandle);
+        gcHandle.Reset();
 
         luaStateStack.Empty();
+        luaStateIndex.Empty();
+        // prototype may be freed after hook removed, don't keep stale key
+        counterCache.Empty();
+        namedCounterCache.Empty();
         coroutineStack = 0;
         coroutine = 0;
         FLuaCycleCounter::clearCounter();
@@ -357,6 +498,9 @@ namespace NS_SLUA {
         const FString BlackListFileName = FPaths::ProjectConfigDir() / TEXT("LuaStatProfileBlackList.ini");
         GConfig->GetArray(TEXT("ScriptBlackList"), TEXT("+BlackList"), blackScripts, BlackListFileName);
         switcher = enable;
+        // black list may be changed
+        counterCache.Empty();
+        namedCounterCache.Empty();
         if (enable) {
             //已经监听
             if (luaStateStack.Num() > 0)
@@ -369,9 +513,10 @@ namespace NS_SLUA {
                 auto Del = ls->getErrorDelegate();
                 errorHandle = Del->AddStatic(&LuaStatProfile::onError);
             }
+            gcHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddStatic(&LuaStatProfile::onEngineGC);
 
-            const LuaStackInfo stackInfo(L, 0);
-            luaStateStack.Add(stackInfo);
+            int index;
+            pushStackInfo(L, index);
         }
         else
         {
@@ -383,6 +528,8 @@ namespace NS_SLUA {
     void LuaStatProfile::setHookLevel(int Level)
     {
         LuaStatProfile::level = Level;
+        counterCache.Empty();
+        namedCounterCache.Empty();
         UE_LOG(LogTemp, Log, TEXT("Lua Profile SetHookLevel"));
     }
 
@@ -401,11 +548,7 @@ namespace NS_SLUA {
             if (ar->linedefined == -1)
                 return false;
         }
-        if (level > 2)
-        {
-            if (ar->name == nullptr)
-                return false;
-        }
+        // name above level 2 depends on call site, it's checked by getCounterInfo every call
         return true;
     }
 }
\ No newline at end of file
@@ -30,9 +30,17 @@
 #include "LuaArray.h"
 #include "LuaMap.h"
 #include "LuaSet.h"
+#include "LuaArrayMath.h"
+#include "LuaScriptArchive.h"
+#include "LuaModulePreloader.h"
+#include "LuaCoroutineScheduler.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
 #include "LuaMemoryProfile.h"
+#include "LuaSmallBlockAllocator.h"
 #include "HAL/RunnableThread.h"
 #include "LatentDelegate.h"
+#include "LuaDelegate.h"
 #include "LuaFunctionAccelerator.h"
 #include "LuaOverrider.h"
 #include "LuaOverriderInterface.h"
@@ -53,6 +61,30 @@ namespace NS_SLUA {
         GCStructTimeLimit,
         TEXT("Defer gc struct time limit in one frame.\n"),
         ECVF_Default);
+
+    static bool UseSmallBlockAllocator = true;
+
+    FAutoConsoleVariableRef CVarSluaUseSmallBlockAllocator(
+        TEXT("slua.UseSmallBlockAllocator"),
+        UseSmallBlockAllocator,
+        TEXT("Use size class allocator for small lua objects, take effect on lua state created later.\n"),
+        ECVF_Default);
+
+    static int32 MaxFreeRegistryRefs = 4096;
+
+    FAutoConsoleVariableRef CVarSluaMaxFreeRegistryRefs(
+        TEXT("slua.MaxFreeRegistryRefs"),
+        MaxFreeRegistryRefs,
+        TEXT("Max registry slots released by LuaVar kept for reuse, slots over it are given back to lua.\n"),
+        ECVF_Default);
+
+    static bool ScriptArchiveVerify = false;
+
+    FAutoConsoleVariableRef CVarSluaScriptArchiveVerify(
+        TEXT("slua.ScriptArchiveVerify"),
+        ScriptArchiveVerify,
+        TEXT("Load source and compare its hash before using bytecode from script archive, stale bytecode falls back to source.\n"),
+        ECVF_Default);
     
     int print(lua_State *L) {
         FString str;
@@ -131,9 +163,45 @@ namespace NS_SLUA {
         return newObjectsInCallStack[stackLayer].Contains(const_cast<UObject*>(obj));
     }
 
+    bool LuaState::loadPrecompiled(lua_State* l, const char* fn) {
+        // bytecode keeps its own source name, chunk name is only used by errors of loading
+        char chunk[256];
+        snprintf(chunk, 256, "=%s", fn);
+
+        TArray<uint8> preloaded;
+        if (preloader && preloader->take(fn, preloaded)) {
+            if (luaL_loadbuffer(l, (const char*)preloaded.GetData(), preloaded.Num(), chunk) == 0)
+                return true;
+            lua_pop(l, 1);
+        }
+
+        if (!scriptArchive) return false;
+        uint32 size, sourceHash;
+        const uint8* code = scriptArchive->find(fn, size, sourceHash);
+        if (!code) return false;
+
+        if (ScriptArchiveVerify) {
+            FString filepath;
+            TArray<uint8> buf = loadFile(fn, filepath);
+            if (buf.Num() > 0 && LuaScriptArchive::hashSource(buf.GetData(), buf.Num()) != sourceHash)
+                return false;
+        }
+
+        if (luaL_loadbuffer(l, (const char*)code, size, chunk) == 0)
+            return true;
+
+        // built by incompatible lua, load source instead
+        Log::Error("Load %s from script archive failed: %s", fn, lua_tostring(l, -1));
+        lua_pop(l, 1);
+        return false;
+    }
+
     int LuaState::loader(lua_State* L) {
         LuaState* state = LuaState::get(L);
         const char* fn = lua_tostring(L, 1);
+        if (state->loadPrecompiled(L, fn))
+            return 1;
+
         FString filepath;
         TArray<uint8> buf = state->loadFile(fn, filepath);
         if (buf.Num() > 0) {
@@ -158,93 +226,178 @@ namespace NS_SLUA {
         return TArray<uint8>();
     }
 
-    int LuaState::import(lua_State *L) {
-        const char* name = LuaObject::checkValue<const char*>(L, 1);
-        if (name) {
-            LuaState* state = LuaState::get(L);
-            ImportedObjectCache* cacheImportedItem = state->cacheImportedMap.Find(name);
-            if (cacheImportedItem)
-            {
-                UObject* cacheObj = cacheImportedItem->cacheObjectPtr.Get();
-                if (cacheObj) {
-                    switch (cacheImportedItem->importedType) 
-                    {
-                    case ImportedClass:
-                    {
-                        UClass* uclass = Cast<UClass>(cacheObj);
-                        if (uclass) {
-                            LuaObject::pushClass(L, uclass);
-                            return 1;
-                        }
-                        break;
-                    }
-                    case ImportedStruct:
-                    {
-                        UScriptStruct* ustruct = Cast<UScriptStruct>(cacheObj);
-                        if (ustruct) {
-                            LuaObject::pushStruct(L, ustruct);
-                            return 1;
-                        }
-                        break;
-                    }
-                    case ImportedEnum:
-                    {
-                        UEnum* uenum = Cast<UEnum>(cacheObj);
-                        if (uenum) {
-                            LuaObject::pushEnum(L, uenum);
-                            return 1;
-                        }
-                        break;
-                    }
-                    default:
-                        break;
-                    }
-                }
-            }
+    bool LuaState::findImported(const FString& name, ImportedObjectCache& outImported) {
+        ImportedObjectCache* cacheImportedItem = cacheImportedMap.Find(name);
+        if (cacheImportedItem && cacheImportedItem->cacheObjectPtr.IsValid()) {
+            outImported = *cacheImportedItem;
+            return true;
+        }
 
 #if ENGINE_MAJOR_VERSION==5 && ENGINE_MINOR_VERSION>0
-            static UPackage* AnyPackage = (UPackage*)-1;
+        static UPackage* AnyPackage = (UPackage*)-1;
 #else
-            static UPackage* AnyPackage = ANY_PACKAGE;
+        static UPackage* AnyPackage = ANY_PACKAGE;
 #endif
+        if (UClass* uclass = FindObject<UClass>(AnyPackage, *name)) {
+            outImported = ImportedObjectCache{ uclass, ImportedClass };
+        }
+        else if (UScriptStruct* ustruct = FindObject<UScriptStruct>(AnyPackage, *name)) {
+            outImported = ImportedObjectCache{ ustruct, ImportedStruct };
+        }
+        else if (UEnum* uenum = FindObject<UEnum>(AnyPackage, *name)) {
+            outImported = ImportedObjectCache{ uenum, ImportedEnum };
+        }
+        else {
+            return false;
+        }
+        cacheImportedMap.Add(name, outImported);
+        return true;
+    }
+
+    void LuaState::pushImported(lua_State* L, const ImportedObjectCache& imported) {
+        UObject* obj = imported.cacheObjectPtr.Get();
+        switch (imported.importedType)
+        {
+        case ImportedClass:
+            LuaObject::pushClass(L, Cast<UClass>(obj));
+            break;
+        case ImportedStruct:
+            LuaObject::pushStruct(L, Cast<UScriptStruct>(obj));
+            break;
+        case ImportedEnum:
+            LuaObject::pushEnum(L, Cast<UEnum>(obj));
+            break;
+        default:
+            lua_pushnil(L);
+            break;
+        }
+    }
+
+    int LuaState::import(lua_State *L) {
+        const char* name = LuaObject::checkValue<const char*>(L, 1);
+        if (name) {
+            LuaState* state = LuaState::get(L);
             FString path = UTF8_TO_TCHAR(name);
-            if (!FindObject<UObject>(AnyPackage, *path)) {
+            ImportedObjectCache imported;
+            if (!state->findImported(path, imported)) {
                 // Try to load object if not found!
                 LoadObject<UObject>(NULL, *path);
+                if (!state->findImported(path, imported))
+                    luaL_error(L, "Can't find class named %s", name);
             }
+            pushImported(L, imported);
+            return 1;
+        }
+        return 0;
+    }
 
-            UClass* uclass = FindObject<UClass>(AnyPackage, *path);
-            if (uclass) {
-                LuaObject::pushClass(L, uclass);
-                state->cacheImportedMap.Add(name, ImportedObjectCache {uclass, ImportedClass});
-                return 1;
-            }
-            UScriptStruct* ustruct = FindObject<UScriptStruct>(AnyPackage, *path);
-            if (ustruct) {
-                LuaObject::pushStruct(L, ustruct);
-                state->cacheImportedMap.Add(name, ImportedObjectCache {ustruct, ImportedStruct});
-                return 1;
-            }
+    int LuaState::importAsync(lua_State *L) {
+        const char* name = luaL_checkstring(L, 1);
+        bool bCallback = !lua_isnoneornil(L, 2);
+        if (bCallback)
+            luaL_checktype(L, 2, LUA_TFUNCTION);
 
-            UEnum* uenum = FindObject<UEnum>(AnyPackage, *path);
-            if (uenum) {
-                LuaObject::pushEnum(L, uenum);
-                state->cacheImportedMap.Add(name, ImportedObjectCache{ uenum, ImportedEnum });
+        LuaState* state = LuaState::get(L);
+        FString path = UTF8_TO_TCHAR(name);
+        ImportedObjectCache imported;
+        if (state->findImported(path, imported)) {
+            pushImported(L, imported);
+            if (!bCallback)
                 return 1;
-            }
+            // loaded already, call back at once
+            lua_pushvalue(L, 2);
+            lua_insert(L, -2);
+            lua_call(L, 1, 0);
+            return 0;
+        }
 
+        FString packageName = FPackageName::ObjectPathToPackageName(path);
+        if (!FPackageName::IsValidLongPackageName(packageName))
             luaL_error(L, "Can't find class named %s", name);
+
+        // wait first, it raises error in main thread
+        int32 waitHandle = bCallback ? 0 : state->coroutineScheduler->waitHandle(L);
+        PendingImport* pending = state->pendingImports.Find(path);
+        if (!pending) {
+            pending = &state->pendingImports.Add(path);
+            state->requestImport(path, packageName);
+        }
+        if (bCallback) {
+            lua_pushvalue(L, 2);
+            pending->callbacks.Add(state->refRegistry(L));
+            return 0;
+        }
+        pending->waits.Add(waitHandle);
+        return lua_yield(L, 0);
+    }
+
+    void LuaState::requestImport(const FString& path, const FString& packageName) {
+        // state may be closed before loading completes, find it again by index
+        int index = si;
+        LoadPackageAsync(packageName, FLoadPackageAsyncDelegate::CreateLambda(
+            [index, path](const FName& loadedName, UPackage* package, EAsyncLoadingResult::Type result) {
+                if (LuaState* state = LuaState::get(index))
+                    state->onImportLoaded(path);
+            }));
+    }
+
+    void LuaState::onImportLoaded(const FString& path) {
+        PendingImport pending;
+        if (!pendingImports.RemoveAndCopyValue(path, pending))
+            return;
+
+        int top = lua_gettop(L);
+        ImportedObjectCache imported;
+        if (findImported(path, imported)) {
+            pushImported(L, imported);
+        }
+        else {
+            Log::Error("Can't find class named %s", TCHAR_TO_UTF8(*path));
+            lua_pushnil(L);
+        }
+
+        int result = lua_gettop(L);
+        for (int ref : pending.callbacks) {
+            int errIndex = pushErrorHandler(L);
+            lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+            lua_pushvalue(L, result);
+            lua_pcall(L, 1, 0, errIndex);
+            lua_settop(L, result);
+            unrefRegistry(ref);
+        }
+        for (int32 waitHandle : pending.waits) {
+            lua_pushvalue(L, result);
+            coroutineScheduler->resume(waitHandle, L, 1);
+        }
+        lua_settop(L, top);
+    }
+
+    void LuaState::prefetchImports(const TArray<FString>& names) {
+        for (const FString& path : names) {
+            ImportedObjectCache imported;
+            if (pendingImports.Contains(path) || findImported(path, imported))
+                continue;
+            FString packageName = FPackageName::ObjectPathToPackageName(path);
+            if (!FPackageName::IsValidLongPackageName(packageName)) {
+                Log::Error("Can't prefetch %s, it isn't an object path", TCHAR_TO_UTF8(*path));
+                continue;
+            }
+            pendingImports.Add(path);
+            requestImport(path, packageName);
         }
-        return 0;
     }
 
     LuaState* LuaState::mainState = nullptr;
     TMap<int,LuaState*> stateMapFromIndex;
+    // index of a closed state is never given to a new one,
+    // so callbacks keeping an index find no state rather than another one
     static int StateIndex = 0;
 
     LuaState::LuaState(const char* name, UGameInstance* gameInstance)
         : loadFileDelegate(nullptr)
         , L(nullptr)
+        , allocator(nullptr)
+        , scriptArchive(nullptr)
         , cacheObjRef(LUA_NOREF)
         , cacheEnumRef(LUA_NOREF)
         , cacheClassPropRef(LUA_NOREF)
@@ -256,6 +409,7 @@ namespace NS_SLUA {
         , stepGCCountLimit(0)
         , fullGCInterval(0.0)
         , lastFullGCSeconds(0.0)
+        , coroutineScheduler(nullptr)
         , latentDelegate(nullptr)
         , currentCallStack(0)
     {
@@ -335,8 +489,11 @@ namespace NS_SLUA {
 #endif
 
         if (stateTickFunc.isFunction()) {
+            LuaFrameBudgetScope budgetScope(this, ELuaEntryPoint::StateTick);
             stateTickFunc.call(dtime);
         }
+        if (coroutineScheduler)
+            coroutineScheduler->tick(dtime);
         tickGC(dtime);
         tickLuaActors(dtime);
     }
@@ -443,6 +600,7 @@ namespace NS_SLUA {
             auto obj = tickInfo.obj.Get();
             check(obj);
             if (obj && (tickInternalTime > tickInfo.expire)) {
+                LuaFrameBudgetScope budgetScope(this, ELuaEntryPoint::ActorTick, obj->GetClass());
                 callLuaTick(obj, tickInfo.tickFunc, tickInternalTime - tickInfo.preExecuteTime);
                 tickInfo.preExecuteTime = tickInternalTime;
                 tickInfo.expire = tickInternalTime + tickInfo.interval;
@@ -493,13 +651,20 @@ namespace NS_SLUA {
             overrider->removeOverrides();
 #endif
         if (overrider) {
+            // templates hold lua references, release them before lua state closed
+            overrider->clearBindTemplates();
             delete overrider;
             overrider = nullptr;
         }
 
         releaseAllLink();
 
-        cleanupThreads();
+        // callbacks are released by lua_close
+        pendingImports.Empty();
+        if (coroutineScheduler) {
+            delete coroutineScheduler;
+            coroutineScheduler = nullptr;
+        }
         
         if(L) {
 #ifdef ENABLE_PROFILER
@@ -508,7 +673,13 @@ namespace NS_SLUA {
             LuaProfiler::clean(this);
 #endif
 #endif
+            ULuaDelegateProxy::releaseState(L);
             lua_close(L);
+#ifdef ENABLE_PROFILER
+#if !UE_BUILD_SHIPPING
+            LuaMemoryProfile::clean(this);
+#endif
+#endif
             GUObjectArray.RemoveUObjectCreateListener(this);
             GUObjectArray.RemoveUObjectDeleteListener(this);
             FCoreUObjectDelegates::GetPostGarbageCollect().Remove(pgcHandler);
@@ -516,7 +687,19 @@ namespace NS_SLUA {
             stateMapFromIndex.Remove(si);
             L=nullptr;
         }
+        if (allocator) {
+            // all blocks had been freed by lua_close
+            delete allocator;
+            allocator = nullptr;
+        }
+        if (scriptArchive) {
+            delete scriptArchive;
+            scriptArchive = nullptr;
+        }
+        // running workers keep it alive until they finish
+        preloader.Reset();
         objRefs.Empty();
+        freeRegistryRefs.Empty();
         if (deadLoopCheck) {
             delete deadLoopCheck;
             deadLoopCheck = nullptr;
@@ -561,23 +744,32 @@ namespace NS_SLUA {
         }
 #endif
 
+        if (UseSmallBlockAllocator && !allocator) {
+            allocator = new LuaSmallBlockAllocator();
+        }
+
 #if ENABLE_PROFILER && !UE_BUILD_SHIPPING
         // use custom memory alloc func to profile memory footprint
         L = lua_newstate(LuaMemoryProfile::alloc,this);
 #else
-        L = lua_newstate([](void *ud, void *ptr, size_t osize, size_t nsize)
-        {
-            if (nsize == 0)
-            {
-                FMemory::Free(ptr);
-                ptr = nullptr;
-                return ptr;
-            }
-            else
+        if (allocator) {
+            L = lua_newstate(LuaSmallBlockAllocator::luaAlloc, allocator);
+        }
+        else {
+            L = lua_newstate([](void *ud, void *ptr, size_t osize, size_t nsize)
             {
-                return FMemory::Realloc(ptr, nsize);
-            }
-        }, nullptr);
+                if (nsize == 0)
+                {
+                    FMemory::Free(ptr);
+                    ptr = nullptr;
+                    return ptr;
+                }
+                else
+                {
+                    return FMemory::Realloc(ptr, nsize);
+                }
+            }, nullptr);
+        }
 #endif
         
         lua_atpanic(L,_atPanic);
@@ -606,6 +798,9 @@ namespace NS_SLUA {
         
         lua_pushcfunction(L,import);
         lua_setglobal(L, "import");
+
+        lua_pushcfunction(L,importAsync);
+        lua_setglobal(L, "importAsync");
         
         lua_pushcfunction(L,print);
         lua_setglobal(L, "print");
@@ -643,6 +838,9 @@ namespace NS_SLUA {
         LuaArray::reg(L);
         LuaMap::reg(L);
         LuaSet::reg(L);
+        LuaArrayMath::reg(L);
+        coroutineScheduler = new LuaCoroutineScheduler(this);
+        LuaCoroutineScheduler::reg(L);
 #ifdef ENABLE_PROFILER
 #if !UE_BUILD_SHIPPING
         LuaProfiler::init(this);
@@ -670,6 +868,56 @@ namespace NS_SLUA {
         loadFileDelegate = func;
     }
 
+    bool LuaState::setScriptArchive(const FString& path) {
+        if (scriptArchive)
+            delete scriptArchive;
+        scriptArchive = LuaScriptArchive::open(path);
+        if (scriptArchive)
+            Log::Log("Use script archive %s with %d scripts", TCHAR_TO_UTF8(*path), scriptArchive->num());
+        return scriptArchive != nullptr;
+    }
+
+    void LuaState::preloadModules(const TArray<FString>& modules) {
+        // modules in archive are precompiled already
+        TArray<FString> toCompile;
+        for (const FString& module : modules) {
+            uint32 size, sourceHash;
+            if (!scriptArchive || !scriptArchive->find(TCHAR_TO_UTF8(*module), size, sourceHash))
+                toCompile.Add(module);
+        }
+        if (toCompile.Num() == 0)
+            return;
+
+        if (!preloader.IsValid())
+            preloader = MakeShared<LuaModulePreloader, ESPMode::ThreadSafe>();
+        preloader->start(toCompile, loadFileDelegate);
+    }
+
+    bool LuaState::preloadManifest(const FString& path) {
+        TArray<FString> lines;
+        if (!FFileHelper::LoadFileToStringArray(lines, *path))
+            return false;
+
+        TArray<FString> modules;
+        for (FString& line : lines) {
+            line.TrimStartAndEndInline();
+            if (!line.IsEmpty() && !line.StartsWith(TEXT("--")))
+                modules.Add(line);
+        }
+        preloadModules(modules);
+        return true;
+    }
+
+    void LuaState::prewarmClasses(const TArray<UClass*>& classes) {
+        if (overrider)
+            overrider->prewarmClasses(classes);
+    }
+
+    void LuaState::clearBindTemplates() {
+        if (overrider)
+            overrider->clearBindTemplates();
+    }
+
     LuaState::ErrorDelegate* LuaState::getErrorDelegate()
     {
         return &errorDelegate;
@@ -734,6 +982,13 @@ namespace NS_SLUA {
         for (CacheImportedMap::TIterator it(cacheImportedMap); it; ++it)
             if (!it.Value().cacheObjectPtr.IsValid())
                 it.RemoveCurrent();
+
+        // give cached empty pages back
+        if (allocator)
+            allocator->trim();
+        freeRegistryRefs.Shrink();
+
+        frameBudget.onEngineGC();
     }
     
     void LuaState::onWorldCleanup(UWorld * World, bool bSessionEnded, bool bCleanupResources)
@@ -820,6 +1075,9 @@ namespace NS_SLUA {
         LuaObject::removeCache(L, Object, cacheClassFuncRef);
         LuaFunctionAccelerator::remove((UFunction*)Object);
 
+        // lua functions bound to delegates of object can't be triggered any more
+        ULuaDelegateProxy::releaseParent(L, Object);
+
         // indicate ud and all child had be free
         releaseLink((void*)Object);
         
@@ -904,93 +1162,61 @@ namespace NS_SLUA {
         return ls->_pushErrorHandler(L);
     }
 
-    int LuaState::addThread(lua_State *thread)
+    int LuaState::refRegistry(lua_State* l)
     {
-        int isMainThread = lua_pushthread(thread);
-        if (isMainThread == 1)
-        {
-            lua_pop(thread, 1);
+        if (freeRegistryRefs.Num() == 0 || lua_isnil(l, -1))
+            return luaL_ref(l, LUA_REGISTRYINDEX);
 
-            luaL_error(thread, "Can't call latent action in main lua thread!");
-            return LUA_REFNIL;
-        }
-
-        lua_xmove(thread, L, 1);
-        lua_pop(thread, 1);
+#if UE_5_5_OR_LATER
+        int ref = freeRegistryRefs.Pop(EAllowShrinking::No);
+#else
+        int ref = freeRegistryRefs.Pop(false);
+#endif
+        lua_rawseti(l, LUA_REGISTRYINDEX, ref);
+        return ref;
+    }
 
-        ensure(lua_isthread(L, -1));
+    void LuaState::unrefRegistry(int ref)
+    {
+        if (ref < 0 || !L)
+            return;
 
-        int threadRef = luaL_ref(L, LUA_REGISTRYINDEX);
-        threadToRef.Add(thread, threadRef);
-        refToThread.Add(threadRef, thread);
+        if (freeRegistryRefs.Num() >= MaxFreeRegistryRefs) {
+            // a burst of released refs, let lua's own free list take the rest
+            luaL_unref(L, LUA_REGISTRYINDEX, ref);
+            return;
+        }
 
-        return threadRef;
+        // keep slot non-nil, luaL_ref would hand it out again otherwise
+        lua_pushboolean(L, 0);
+        lua_rawseti(L, LUA_REGISTRYINDEX, ref);
+        freeRegistryRefs.Add(ref);
     }
 
-    void LuaState::resumeThread(int threadRef)
+    ULatentDelegate* LuaState::getLatentDelegate() const
     {
-        QUICK_SCOPE_CYCLE_COUNTER(Lua_LatentCallback);
-
-        lua_State **threadPtr = refToThread.Find(threadRef);
-        if (threadPtr)
-        {
-            lua_State *thread = *threadPtr;
-            bool threadIsDead = false;
-
-            if (lua_status(thread) == LUA_OK && lua_gettop(thread) == 0)
-            {
-                Log::Error("cannot resume dead coroutine");
-                threadIsDead = true;
-            }
-            else
-            {
-#if LUA_VERSION_NUM > 503
-                int nres = 0;
-                int status = lua_resume(thread, L, 0, &nres);
-#else
-                int status = lua_resume(thread, L, 0);
-#endif
-                if (status == LUA_OK || status == LUA_YIELD)
-                {
-                    if (status == LUA_OK)
-                    {
-                        threadIsDead = true;
-                    }
-                }
-            }
+        return latentDelegate;
+    }
 
-            if (threadIsDead)
-            {
-                threadToRef.Remove(thread);
-                refToThread.Remove(threadRef);
-                luaL_unref(L, LUA_REGISTRYINDEX, threadRef);
-            }
-        }
+    int LuaState::addThread(lua_State *thread)
+    {
+        return coroutineScheduler ? coroutineScheduler->waitHandle(thread) : LUA_REFNIL;
     }
 
-    int LuaState::findThread(lua_State *thread)
+    void LuaState::resumeThread(int threadRef)
     {
-        int32 *threadRefPtr = threadToRef.Find(thread);
-        return threadRefPtr ? *threadRefPtr : LUA_REFNIL;
+        if (coroutineScheduler)
+            coroutineScheduler->resume(threadRef);
     }
 
-    void LuaState::cleanupThreads()
+    int LuaState::findThread(lua_State *thread)
     {
-        for (TMap<lua_State*, int32>::TIterator It(threadToRef); It; ++It)
-        {
-            int32 threadRef = It.Value();
-            if (threadRef != LUA_REFNIL)
-            {
-                luaL_unref(L, LUA_REGISTRYINDEX, threadRef);
-            }
-        }
-        threadToRef.Empty();
-        refToThread.Empty();
+        int32 handle = coroutineScheduler ? coroutineScheduler->findHandle(thread) : 0;
+        return handle ? handle : LUA_REFNIL;
     }
 
-    ULatentDelegate* LuaState::getLatentDelegate() const
+    void LuaState::cleanupThreads()
     {
-        return latentDelegate;
     }
 
     bool LuaState::hookObject(LuaState* inState, const UObjectBaseUtility* obj, bool bHookImmediate/* = false*/, bool bPostLoad/* = false*/)
@@ -1286,6 +1512,14 @@ namespace NS_SLUA {
     }
 
     FProperty* LuaState::ClassCache::findProp(UStruct* ustruct, const char* pname)
+    {
+        auto prop = getProps(ustruct).Find(pname);
+        if (prop != nullptr)
+            return *prop;
+        return nullptr;
+    }
+
+    const LuaState::ClassCache::CachePropItem& LuaState::ClassCache::getProps(UStruct* ustruct)
     {
         auto item = cachePropMap.Find(ustruct);
         if (!item) {
@@ -1309,12 +1543,43 @@ namespace NS_SLUA {
                 }
             }
         }
-        auto prop = item->Find(pname);
-        if (prop != nullptr)
-            return *prop;
-        return nullptr;
+        return *item;
     }
 
+    void dumpAllocatorStats(FOutputDevice& Ar)
+    {
+        for (auto& pair : stateMapFromIndex)
+        {
+            LuaState* state = pair.Value;
+            Ar.Logf(TEXT("Lua state %d"), pair.Key);
+            if (auto* allocator = state->getAllocator())
+                allocator->dumpStats(Ar);
+            else
+                Ar.Logf(TEXT("small block allocator is off"));
+        }
+    }
+
+    static FAutoConsoleCommandWithOutputDevice CVarDumpAllocatorStats(
+        TEXT("slua.DumpAllocatorStats"),
+        TEXT("Dump lua small block allocator usage and fragmentation"),
+        FConsoleCommandWithOutputDeviceDelegate::CreateStatic(dumpAllocatorStats),
+        ECVF_Default);
+
+    void dumpFrameBudget(FOutputDevice& Ar)
+    {
+        for (auto& pair : stateMapFromIndex)
+        {
+            Ar.Logf(TEXT("Lua state %d"), pair.Key);
+            pair.Value->getFrameBudget().dump(Ar);
+        }
+    }
+
+    static FAutoConsoleCommandWithOutputDevice CVarDumpFrameBudget(
+        TEXT("slua.DumpFrameBudget"),
+        TEXT("Dump lua cost of last frame by entry point, set slua.FrameBudget 2 to see class/function detail"),
+        FConsoleCommandWithOutputDeviceDelegate::CreateStatic(dumpFrameBudget),
+        ECVF_Default);
+
     NewObjectRecorder::NewObjectRecorder(lua_State* inL)
         : luaState(LuaState::get(inL->l_G->mainthread))
     {
@@ -22,6 +22,7 @@
 #include "UObject/Stack.h"
 #include "LuaState.h"
 #include "lstate.h"
+#include "Containers/LockFreeFixedSizeAllocator.h"
 // #include "CrashContextCollector.h" // For PUBG Mobile
 
 namespace NS_SLUA {
@@ -161,16 +162,16 @@ namespace NS_SLUA {
             break;
         case LV_LIGHTUD:
             alloc(1);
-            vars[0].ptr = lua_touserdata(l,p);
-            vars[0].luatype = type;
+            getVar(0).ptr = lua_touserdata(l,p);
+            getVar(0).luatype = type;
             break;
         case LV_FUNCTION: 
         case LV_TABLE:
         case LV_USERDATA:
             alloc(1);
             lua_pushvalue(l,p);
-            vars[0].ref = new RefRef(l);
-            vars[0].luatype=type;
+            getVar(0).ref = RefRef::create(l);
+            getVar(0).luatype=type;
             break;
         case LV_TUPLE:
             ensure(p>0 && lua_gettop(l)>=p);
@@ -187,15 +188,14 @@ namespace NS_SLUA {
         if (!L || L != other.getState()) { return false; }
 
         if (numOfVar != other.numOfVar) { return false; }
-        if (numOfVar == 0 && vars == nullptr && other.vars == nullptr)
+        if (numOfVar == 0)
         {
             return true;
         }
-        if (vars == nullptr || other.vars == nullptr) { return false; }
 
         for (size_t i = 0; i < numOfVar; i++) {
-            Type luatype = vars[i].luatype;
-            if (luatype != other.vars[i].luatype)
+            Type luatype = getVar(i).luatype;
+            if (luatype != other.getVar(i).luatype)
             {
                 return false;
             }
@@ -203,28 +203,28 @@ namespace NS_SLUA {
             switch (luatype) {
                 case LV_BOOL:
                 {
-                    if (vars[i].b != other.vars[i].b) {
+                    if (getVar(i).b != other.getVar(i).b) {
                         return false;
                     }
                     break;
                 }
                 case LV_INT:
                 {
-                    if (vars[i].i != other.vars[i].i) {
+                    if (getVar(i).i != other.getVar(i).i) {
                         return false;
                     }
                     break;
                 }
                 case LV_NUMBER:
                 {
-                    if (vars[i].d != other.vars[i].d) {
+                    if (getVar(i).d != other.getVar(i).d) {
                         return false;
                     }
                     break;
                 }
                 case LV_STRING: 
                 {
-                    if (strcmp(vars[i].s->buf, other.vars[i].s->buf) != 0) {
+                    if (strcmp(getVar(i).s->buf, other.getVar(i).s->buf) != 0) {
                         return false;
                     }
                     break;
@@ -233,10 +233,10 @@ namespace NS_SLUA {
                 case LV_TABLE:
                 case LV_USERDATA:
                 {
-                    if (!vars[i].ref || !other.vars[i].ref) { return false; }
+                    if (!getVar(i).ref || !other.getVar(i).ref) { return false; }
 
-                    lua_rawgeti(L, LUA_REGISTRYINDEX, vars[i].ref->ref);
-                    lua_rawgeti(L, LUA_REGISTRYINDEX, other.vars[i].ref->ref);
+                    lua_rawgeti(L, LUA_REGISTRYINDEX, getVar(i).ref->ref);
+                    lua_rawgeti(L, LUA_REGISTRYINDEX, other.getVar(i).ref->ref);
                     bool bEqual = lua_compare(L, -1, -2, LUA_OPEQ) == 1;
                     lua_pop(L, 2);
                     if (!bEqual)
@@ -247,7 +247,7 @@ namespace NS_SLUA {
                 }
                 case LV_LIGHTUD:
                 {
-                    if (vars[i].ptr != other.vars[i].ptr) {
+                    if (getVar(i).ptr != other.getVar(i).ptr) {
                         return false;
                     }
                     break;
@@ -271,50 +271,50 @@ namespace NS_SLUA {
 
             switch(t) {
             case LUA_TBOOLEAN:
-                vars[i].luatype = LV_BOOL;
-                vars[i].b = !!lua_toboolean(l, p);
+                getVar(i).luatype = LV_BOOL;
+                getVar(i).b = !!lua_toboolean(l, p);
                 break;
             case LUA_TNUMBER:
                 {
                     if(lua_isinteger(l,p)) {
-                        vars[i].luatype = LV_INT;
-                        vars[i].i = lua_tointeger(l,p);
+                        getVar(i).luatype = LV_INT;
+                        getVar(i).i = lua_tointeger(l,p);
                     }
                     else {
-                        vars[i].luatype = LV_NUMBER;
-                        vars[i].d = lua_tonumber(l,p);
+                        getVar(i).luatype = LV_NUMBER;
+                        getVar(i).d = lua_tonumber(l,p);
                     }
                 }
                 break;
             case LUA_TSTRING: {
-                vars[i].luatype = LV_STRING;
+                getVar(i).luatype = LV_STRING;
                 size_t len;
                 const char* buf = lua_tolstring(l, p, &len);
-                vars[i].s = new RefStr(buf,len);
+                getVar(i).s = RefStr::create(buf,len);
                 break;
             }
             case LUA_TFUNCTION:
-                vars[i].luatype = LV_FUNCTION;
+                getVar(i).luatype = LV_FUNCTION;
                 lua_pushvalue(l,p);
-                vars[i].ref = new RefRef(l);
+                getVar(i).ref = RefRef::create(l);
                 break;
             case LUA_TTABLE:
-                vars[i].luatype = LV_TABLE;
+                getVar(i).luatype = LV_TABLE;
                 lua_pushvalue(l,p);
-                vars[i].ref = new RefRef(l);
+                getVar(i).ref = RefRef::create(l);
                 break;
             case LUA_TUSERDATA:
-                vars[i].luatype = LV_USERDATA;
+                getVar(i).luatype = LV_USERDATA;
                 lua_pushvalue(l, p);
-                vars[i].ref = new RefRef(l);
+                getVar(i).ref = RefRef::create(l);
                 break;
             case LUA_TLIGHTUSERDATA:
-                vars[i].luatype = LV_LIGHTUD;
-                vars[i].ptr = lua_touserdata(l, p);
+                getVar(i).luatype = LV_LIGHTUD;
+                getVar(i).ptr = lua_touserdata(l, p);
                 break;
             case LUA_TNIL:
             default:
-                vars[i].luatype = LV_NIL;
+                getVar(i).luatype = LV_NIL;
                 break;
             }
         }
@@ -324,35 +324,71 @@ namespace NS_SLUA {
         free();
     }
 
-    LuaVar::RefRef::RefRef(lua_State* l) 
-        :LuaVar::Ref() 
-    {
-        ref=luaL_ref(l,LUA_REGISTRYINDEX);
-        stateIndex = LuaState::get(l)->stateIndex();
+    namespace {
+        // leaked on purpose, LuaVar in static storage may be released after pool destructed
+        template<int32 Size>
+        TLockFreeFixedSizeAllocator<Size, PLATFORM_CACHE_LINE_SIZE>& getRefPool() {
+            static auto* pool = new TLockFreeFixedSizeAllocator<Size, PLATFORM_CACHE_LINE_SIZE>();
+            return *pool;
+        }
+    }
+
+    LuaVar::RefStr* LuaVar::RefStr::create(const char* s, size_t len) {
+        RefStr* r = (RefStr*)getRefPool<sizeof(RefStr)>().Allocate();
+        if (len == 0) len = strlen(s);
+        // alloc extra space for '\0'
+        r->buf = (char*) FMemory::Malloc(len+1);
+        FMemory::Memcpy(r->buf, s, len);
+        r->buf[len] = 0;
+        r->length = len;
+        r->refCount = 1;
+        return r;
+    }
+
+    void LuaVar::RefStr::release() {
+        ensure(refCount >0);
+        if(--refCount ==0) {
+            FMemory::Free(buf);
+            getRefPool<sizeof(RefStr)>().Free(this);
+        }
+    }
+
+    LuaVar::RefRef* LuaVar::RefRef::create(lua_State* l) {
+        RefRef* r = (RefRef*)getRefPool<sizeof(RefRef)>().Allocate();
+        auto state = LuaState::get(l);
+        r->ref = state->refRegistry(l);
+        r->stateIndex = state->stateIndex();
+        r->refCount = 1;
 #if UE_BUILD_DEVELOPMENT
-        LuaState::get(l)->addRefTraceback(ref);
+        state->addRefTraceback(r->ref);
 #endif
+        return r;
     }
 
-    LuaVar::RefRef::~RefRef() {
+    void LuaVar::RefRef::release() {
+        ensure(refCount >0);
+        if(--refCount !=0)
+            return;
+
         if(LuaState::isValid(stateIndex)) {
             auto state = LuaState::get(stateIndex);
             if (state) {
-                luaL_unref(state->getLuaState(),LUA_REGISTRYINDEX,ref);
+                state->unrefRegistry(ref);
 #if UE_BUILD_DEVELOPMENT
                 state->removeRefTraceback(ref);
 #endif
             }
         }
+        getRefPool<sizeof(RefRef)>().Free(this);
     }
 
     void LuaVar::free() {
         for(size_t n=0;n<numOfVar;n++) {
-            if( (vars[n].luatype==LV_FUNCTION || vars[n].luatype==LV_TABLE || vars[n].luatype == LV_USERDATA)
-                && vars[n].ref->isValid() )
-                vars[n].ref->release();
-            else if(vars[n].luatype==LV_STRING)
-                vars[n].s->release();
+            if( (getVar(n).luatype==LV_FUNCTION || getVar(n).luatype==LV_TABLE || getVar(n).luatype == LV_USERDATA)
+                && getVar(n).ref->isValid() )
+                getVar(n).ref->release();
+            else if(getVar(n).luatype==LV_STRING)
+                getVar(n).s->release();
         }
         numOfVar = 0;
         if (vars) {
@@ -362,10 +398,10 @@ namespace NS_SLUA {
     }
 
     void LuaVar::alloc(int n) {
-        if(n>0) {
+        if(n>1)
             vars = new lua_var[n];
+        if(n>0)
             numOfVar = n;
-        }
     }
 
     bool LuaVar::next(LuaVar& key,LuaVar& value) {
@@ -411,11 +447,11 @@ namespace NS_SLUA {
 
     int LuaVar::asInt() const {
         ensure(numOfVar==1);
-        switch(vars[0].luatype) {
+        switch(getVar(0).luatype) {
         case LV_INT:
-            return vars[0].i;
+            return getVar(0).i;
         case LV_NUMBER:
-            return vars[0].d;
+            return getVar(0).d;
         default:
             return -1;
         }
@@ -423,11 +459,11 @@ namespace NS_SLUA {
 
     int64 LuaVar::asInt64() const {
         ensure(numOfVar==1);
-        switch(vars[0].luatype) {
+        switch(getVar(0).luatype) {
         case LV_INT:
-            return vars[0].i;
+            return getVar(0).i;
         case LV_NUMBER:
-            return vars[0].d;
+            return getVar(0).d;
         default:
             return -1;
         }
@@ -435,11 +471,11 @@ namespace NS_SLUA {
 
     float LuaVar::asFloat() const {
         ensure(numOfVar==1);
-        switch(vars[0].luatype) {
+        switch(getVar(0).luatype) {
         case LV_INT:
-            return vars[0].i;
+            return getVar(0).i;
         case LV_NUMBER:
-            return vars[0].d;
+            return getVar(0).d;
         default:
             return NAN;
         }
@@ -447,36 +483,36 @@ namespace NS_SLUA {
 
     double LuaVar::asDouble() const {
         ensure(numOfVar==1);
-        switch(vars[0].luatype) {
+        switch(getVar(0).luatype) {
         case LV_INT:
-            return vars[0].i;
+            return getVar(0).i;
         case LV_NUMBER:
-            return vars[0].d;
+            return getVar(0).d;
         default:
             return NAN;
         }
     }
 
     const char* LuaVar::asString(size_t* outlen) const {
-        ensure(numOfVar==1 && vars[0].luatype==LV_STRING);
-        if(outlen) *outlen = vars[0].s->length;
-        return vars[0].s->buf;
+        ensure(numOfVar==1 && getVar(0).luatype==LV_STRING);
+        if(outlen) *outlen = getVar(0).s->length;
+        return getVar(0).s->buf;
     }
 
     LuaLString LuaVar::asLString() const
     {
-        ensure(numOfVar == 1 && vars[0].luatype == LV_STRING);
-        return { vars[0].s->buf,vars[0].s->length };
+        ensure(numOfVar == 1 && getVar(0).luatype == LV_STRING);
+        return { getVar(0).s->buf,getVar(0).s->length };
     }
 
     bool LuaVar::asBool() const {
-        ensure(numOfVar==1 && vars[0].luatype==LV_BOOL);
-        return vars[0].b;
+        ensure(numOfVar==1 && getVar(0).luatype==LV_BOOL);
+        return getVar(0).b;
     }
 
     void* LuaVar::asLightUD() const {
-        ensure(numOfVar==1 && vars[0].luatype==LV_LIGHTUD);
-        return vars[0].ptr;
+        ensure(numOfVar==1 && getVar(0).luatype==LV_LIGHTUD);
+        return getVar(0).ptr;
     }
 
     LuaVar LuaVar::getAt(size_t index) const {
@@ -494,7 +530,7 @@ namespace NS_SLUA {
             LuaVar r;
             r.alloc(1);
             r.stateIndex = this->stateIndex;
-            varClone(r.vars[0],vars[index-1]);
+            varClone(r.getVar(0),getVar(index-1));
             return r;
         }
     }
@@ -502,29 +538,29 @@ namespace NS_SLUA {
     void LuaVar::set(lua_Integer v) {
         free();
         alloc(1);
-        vars[0].i = v;
-        vars[0].luatype = LV_INT;
+        getVar(0).i = v;
+        getVar(0).luatype = LV_INT;
     }
 
     void LuaVar::set(int v) {
         free();
         alloc(1);
-        vars[0].i = v;
-        vars[0].luatype = LV_INT;
+        getVar(0).i = v;
+        getVar(0).luatype = LV_INT;
     }
 
     void LuaVar::set(lua_Number v) {
         free();
         alloc(1);
-        vars[0].d = v;
-        vars[0].luatype = LV_NUMBER;
+        getVar(0).d = v;
+        getVar(0).luatype = LV_NUMBER;
     }
 
     void LuaVar::set(const char* v,size_t len) {
         free();
         alloc(1);
-        vars[0].s = new RefStr(v,len);
-        vars[0].luatype = LV_STRING;
+        getVar(0).s = RefStr::create(v,len);
+        getVar(0).luatype = LV_STRING;
     }
 
     void LuaVar::set(const LuaLString & lstr)
@@ -535,8 +571,8 @@ namespace NS_SLUA {
     void LuaVar::set(bool b) {
         free();
         alloc(1);
-        vars[0].b = b;
-        vars[0].luatype = LV_BOOL;
+        getVar(0).b = b;
+        getVar(0).luatype = LV_BOOL;
     }
 
     void LuaVar::pushVar(lua_State* l,const lua_var& ov) const {
@@ -571,18 +607,18 @@ namespace NS_SLUA {
         if(l==nullptr) l=getState();
         if(l==nullptr) return 0;
 
-        if(vars==nullptr || numOfVar==0) {
+        if(numOfVar==0) {
             lua_pushnil(l);
             return 1;
         }
         
         if(numOfVar==1) {
-            const lua_var& ov = vars[0];
+            const lua_var& ov = getVar(0);
             pushVar(l,ov);
             return 1;
         }
         for(size_t n=0;n<numOfVar;n++) {
-            const lua_var& ov = vars[n];
+            const lua_var& ov = getVar(n);
             pushVar(l,ov);
         }
         return numOfVar;
@@ -593,11 +629,11 @@ namespace NS_SLUA {
     }
 
     bool LuaVar::isNil() const {
-        return vars==nullptr || numOfVar==0;
+        return numOfVar==0;
     }
 
     bool LuaVar::isFunction() const {
-        return numOfVar==1 && vars[0].luatype==LV_FUNCTION;
+        return numOfVar==1 && getVar(0).luatype==LV_FUNCTION;
     }
 
     bool LuaVar::isTuple() const {
@@ -605,23 +641,23 @@ namespace NS_SLUA {
     }
 
     bool LuaVar::isTable() const {
-        return numOfVar==1 && vars[0].luatype==LV_TABLE;
+        return numOfVar==1 && getVar(0).luatype==LV_TABLE;
     }
 
     bool LuaVar::isInt() const {
-        return numOfVar==1 && vars[0].luatype==LV_INT;
+        return numOfVar==1 && getVar(0).luatype==LV_INT;
     }
 
     bool LuaVar::isNumber() const {
-        return numOfVar==1 && vars[0].luatype==LV_NUMBER;
+        return numOfVar==1 && getVar(0).luatype==LV_NUMBER;
     }
 
     bool LuaVar::isBool() const {
-        return numOfVar==1 && vars[0].luatype==LV_BOOL;
+        return numOfVar==1 && getVar(0).luatype==LV_BOOL;
     }
 
     bool LuaVar::isUserdata(const char* t) const {
-        if(numOfVar==1 && vars[0].luatype==LV_USERDATA) {
+        if(numOfVar==1 && getVar(0).luatype==LV_USERDATA) {
             auto L = getState();
             push(L);
             auto typeName = LuaObject::getType(L, -1);
@@ -637,18 +673,18 @@ namespace NS_SLUA {
     }
 
     bool LuaVar::isLightUserdata() const {
-        return numOfVar==1 && vars[0].luatype==LV_LIGHTUD;
+        return numOfVar==1 && getVar(0).luatype==LV_LIGHTUD;
     }
 
     bool LuaVar::isString() const {
-        return numOfVar==1 && vars[0].luatype==LV_STRING;
+        return numOfVar==1 && getVar(0).luatype==LV_STRING;
     }
 
     LuaVar::Type LuaVar::type() const {
         if(numOfVar==0)
             return LV_NIL;
         else if(numOfVar==1)
-            return vars[0].luatype;
+            return getVar(0).luatype;
         else
             return LV_TUPLE;
     }
@@ -661,7 +697,7 @@ namespace NS_SLUA {
         }
         auto L = getState();
         int errhandle = LuaState::pushErrorHandler(L);
-        vars[0].ref->push(L);
+        getVar(0).ref->push(L);
         int argn = 0;
         if (fillParam) {
             argn = fillParam();
@@ -677,6 +713,42 @@ namespace NS_SLUA {
         return lua_gettop(L) - errhandle + 1;
     }
 
+    lua_State* LuaVar::prepareCall() const
+    {
+        if (!isFunction()) {
+            Log::Error("LuaVar is not a function, can't be called");
+#if UE_BUILD_DEVELOPMENT
+#if (ENGINE_MINOR_VERSION<26) && (ENGINE_MAJOR_VERSION==4)
+            FDebug::DumpStackTraceToLog();
+#else
+            FDebug::DumpStackTraceToLog(ELogVerbosity::Type::Verbose);
+#endif
+#endif
+            return nullptr;
+        }
+        if (!isValid()) {
+            Log::Error("State of lua function is invalid");
+            return nullptr;
+        }
+        auto L = getState();
+        LuaState::pushErrorHandler(L);
+        getVar(0).ref->push(L);
+        return L;
+    }
+
+    bool LuaVar::pcall(lua_State* L, int argn, int errhandle) const
+    {
+#if WITH_EDITOR
+        LuaScriptCallGuard g(L);
+#endif
+        if (lua_pcallk(L, argn, 1, errhandle, NULL, NULL)) {
+            // error had been reported by error handler
+            lua_settop(L, errhandle - 1);
+            return false;
+        }
+        return true;
+    }
+
     int LuaVar::pushArgByParms(FProperty* prop,uint8* parms) {
         auto L = getState();
         if (LuaObject::push(L,prop,parms,nullptr))
@@ -872,12 +944,9 @@ namespace NS_SLUA {
 
     void LuaVar::clone(const LuaVar& other) {
         stateIndex = other.stateIndex;
-        numOfVar = other.numOfVar;
-        if(numOfVar>0 && other.vars) {
-            vars = new lua_var[numOfVar];
-            for(size_t n=0;n<numOfVar;n++) {
-                varClone( vars[n], other.vars[n] );
-            }
+        alloc(other.numOfVar);
+        for(size_t n=0;n<numOfVar;n++) {
+            varClone( getVar(n), other.getVar(n) );
         }
     }
 
@@ -885,6 +954,7 @@ namespace NS_SLUA {
         stateIndex = other.stateIndex;
         numOfVar = other.numOfVar;
         vars = other.vars;
+        inlineVar = other.inlineVar;
 
         other.numOfVar = 0;
         other.vars = nullptr;
@@ -26,7 +26,7 @@
     else if (!(flag & UD_HADFREE) && (flag & UD_AUTOGC)) { \
         LuaObject::releaseLink(L, self); \
     } \
-    if ((flag & UD_AUTOGC) && !(flag & UD_HADFREE)) delete self
+    if ((flag & UD_AUTOGC) && !(flag & (UD_HADFREE | UD_INLINE))) delete self
 
 #define SLUA_MARK_NETPROP if (udptr->flag & UD_NETTYPE) \
     { \
@@ -187,9 +187,70 @@ namespace NS_SLUA {
         }
     };
 
+    // in-place math of inline math structs, result is written to self instead of a new userdata,
+    // so v:AddInPlace(d) in a loop creates no garbage
+    template<typename T, typename S>
+    struct LuaInPlaceMathWrapper {
+        static const char* typeName;
+
+        static T* checkSelf(lua_State* L) {
+            CheckSelf(T);
+            CheckIfConst(T);
+            SLUA_MARK_NETPROP;
+            return self;
+        }
+
+        static const T& checkOther(lua_State* L, const char* method) {
+            T* other = LuaObject::matchType(L, 2, typeName) ? LuaObject::checkValue<T*>(L, 2) : nullptr;
+            if (!other)
+                luaL_error(L, "%s %s expect %s at argument 2", typeName, method, typeName);
+            return *other;
+        }
+
+        static int AddInPlace(lua_State* L) {
+            T* self = checkSelf(L);
+            *self += checkOther(L, "AddInPlace");
+            lua_settop(L, 1);
+            return 1;
+        }
+
+        static int SubInPlace(lua_State* L) {
+            T* self = checkSelf(L);
+            *self -= checkOther(L, "SubInPlace");
+            lua_settop(L, 1);
+            return 1;
+        }
+
+        static int MulInPlace(lua_State* L) {
+            T* self = checkSelf(L);
+            *self *= (S)LuaObject::checkValue<double>(L, 2);
+            lua_settop(L, 1);
+            return 1;
+        }
+
+        static void bind(lua_State* L, const char* tn) {
+            AutoStack autoStack(L);
+            typeName = tn;
+            luaL_getmetatable(L, tn);
+            LuaObject::addOperator(L, "AddInPlace", AddInPlace);
+            LuaObject::addOperator(L, "SubInPlace", SubInPlace);
+            LuaObject::addOperator(L, "MulInPlace", MulInPlace);
+        }
+    };
+
+    template<typename T, typename S>
+    const char* LuaInPlaceMathWrapper<T, S>::typeName = nullptr;
+
     void LuaWrapper::initExt(lua_State* L)
     {
         init(L);
         FSoftObjectPtrWrapper::bind(L);
+
+        LuaInPlaceMathWrapper<FVector, decltype(FVector::X)>::bind(L, "FVector");
+        LuaInPlaceMathWrapper<FVector2D, decltype(FVector2D::X)>::bind(L, "FVector2D");
+        LuaInPlaceMathWrapper<FRotator, decltype(FRotator::Pitch)>::bind(L, "FRotator");
+        LuaInPlaceMathWrapper<FQuat, decltype(FQuat::X)>::bind(L, "FQuat");
+        LuaInPlaceMathWrapper<FLinearColor, decltype(FLinearColor::R)>::bind(L, "FLinearColor");
+        LuaInPlaceMathWrapper<FIntPoint, decltype(FIntPoint::X)>::bind(L, "FIntPoint");
     }
 }
\ No newline at end of file
@@ -1,6 +1,261 @@
 ﻿#include "ProfileDataDefine.h"
 
 FProfileNameSet* FProfileNameSet::GlobalProfileNameSet = nullptr;
+
+struct FProfileNameSet::FEntry
+{
+    uint32 index;
+    uint32 hash;
+    TArray<ANSICHAR> utf8;
+    FString name;
+};
+
+namespace {
+    // index is already a hash in most cases, spread it for sequential indexes after collision
+    FORCEINLINE uint32 IdSlot(uint32 index)
+    {
+        return index * 2654435761u;
+    }
+}
+
+FProfileNameSet::FProfileNameSet()
+    : numNames(0)
+{
+    nameTable.store(NewTable(1024), std::memory_order_relaxed);
+    idTable.store(NewTable(1024), std::memory_order_relaxed);
+}
+
+FProfileNameSet::~FProfileNameSet()
+{
+    retiredTables.Add(nameTable.load(std::memory_order_relaxed));
+    retiredTables.Add(idTable.load(std::memory_order_relaxed));
+    for (FTable* table : retiredTables)
+    {
+        delete[] table->slots;
+        delete table;
+    }
+    for (FEntry* entry : entries)
+    {
+        delete entry;
+    }
+}
+
+FProfileNameSet::FTable* FProfileNameSet::NewTable(uint32 capacity)
+{
+    FTable* table = new FTable();
+    table->mask = capacity - 1;
+    table->slots = new std::atomic<FEntry*>[capacity];
+    for (uint32 i = 0; i < capacity; i++)
+    {
+        table->slots[i].store(nullptr, std::memory_order_relaxed);
+    }
+    return table;
+}
+
+FProfileNameSet::FEntry* FProfileNameSet::FindByName(const ANSICHAR* utf8, int32 len, uint32 hash) const
+{
+    // table is never more than half full, so probing always reaches an empty slot
+    const FTable* table = nameTable.load(std::memory_order_acquire);
+    for (uint32 i = hash & table->mask;; i = (i + 1) & table->mask)
+    {
+        FEntry* entry = table->slots[i].load(std::memory_order_acquire);
+        if (!entry)
+        {
+            return nullptr;
+        }
+        if (entry->hash == hash && entry->utf8.Num() == len && FMemory::Memcmp(entry->utf8.GetData(), utf8, len) == 0)
+        {
+            return entry;
+        }
+    }
+}
+
+FProfileNameSet::FEntry* FProfileNameSet::FindById(uint32 index) const
+{
+    const FTable* table = idTable.load(std::memory_order_acquire);
+    for (uint32 i = IdSlot(index) & table->mask;; i = (i + 1) & table->mask)
+    {
+        FEntry* entry = table->slots[i].load(std::memory_order_acquire);
+        if (!entry)
+        {
+            return nullptr;
+        }
+        if (entry->index == index)
+        {
+            return entry;
+        }
+    }
+}
+
+uint32 FProfileNameSet::GetOrCreateIndex(const ANSICHAR* utf8, int32 len, uint32 hash)
+{
+    if (FEntry* entry = FindByName(utf8, len, hash))
+    {
+        return entry->index;
+    }
+
+    FScopeLock lock(&mutex);
+    if (FEntry* entry = FindByName(utf8, len, hash))
+    {
+        return entry->index;
+    }
+
+    uint32 index = hash;
+    while (index == InvalidIndex || FindById(index))
+    {
+        index++;
+    }
+    AddEntry(index, utf8, len, hash, true);
+    return index;
+}
+
+uint32 FProfileNameSet::GetIndex(const ANSICHAR* utf8, int32 len, uint32 hash) const
+{
+    FEntry* entry = FindByName(utf8, len, hash);
+    return entry ? entry->index : InvalidIndex;
+}
+
+FString FProfileNameSet::GetStringByIndex(uint32 index) const
+{
+    FEntry* entry = FindById(index);
+    if (entry)
+    {
+        return entry->name;
+    }
+
+    return TEXT("");
+}
+
+FProfileNameSet::FEntry* FProfileNameSet::AddEntry(uint32 index, const ANSICHAR* utf8, int32 len, uint32 hash, bool bNew)
+{
+    if ((uint32)(numNames + 1) * 2 > nameTable.load(std::memory_order_relaxed)->mask + 1)
+    {
+        Grow();
+    }
+
+    FEntry* entry = new FEntry();
+    entry->index = index;
+    entry->hash = hash;
+    entry->utf8.Append(utf8, len);
+    FUTF8ToTCHAR converter(utf8, len);
+    entry->name = FString(converter.Length(), converter.Get());
+    entries.Add(entry);
+    if (bNew)
+    {
+        newEntries.Add(entry);
+    }
+    numNames++;
+
+    // replaced entry is kept in entries, readers may hold it.
+    // publish index first, so whoever finds the name can find its index
+    FTable* table = idTable.load(std::memory_order_relaxed);
+    for (uint32 i = IdSlot(index) & table->mask;; i = (i + 1) & table->mask)
+    {
+        FEntry* slot = table->slots[i].load(std::memory_order_relaxed);
+        if (!slot || slot->index == index)
+        {
+            table->slots[i].store(entry, std::memory_order_release);
+            break;
+        }
+    }
+
+    table = nameTable.load(std::memory_order_relaxed);
+    for (uint32 i = hash & table->mask;; i = (i + 1) & table->mask)
+    {
+        FEntry* slot = table->slots[i].load(std::memory_order_relaxed);
+        if (!slot || (slot->hash == hash && slot->utf8 == entry->utf8))
+        {
+            table->slots[i].store(entry, std::memory_order_release);
+            break;
+        }
+    }
+    return entry;
+}
+
+void FProfileNameSet::Grow()
+{
+    FTable* oldNames = nameTable.load(std::memory_order_relaxed);
+    FTable* oldIds = idTable.load(std::memory_order_relaxed);
+    uint32 capacity = (oldNames->mask + 1) * 2;
+    FTable* names = NewTable(capacity);
+    FTable* ids = NewTable(capacity);
+
+    for (uint32 i = 0; i <= oldNames->mask; i++)
+    {
+        FEntry* entry = oldNames->slots[i].load(std::memory_order_relaxed);
+        if (!entry)
+        {
+            continue;
+        }
+        uint32 j = entry->hash & names->mask;
+        while (names->slots[j].load(std::memory_order_relaxed))
+        {
+            j = (j + 1) & names->mask;
+        }
+        names->slots[j].store(entry, std::memory_order_relaxed);
+    }
+
+    for (uint32 i = 0; i <= oldIds->mask; i++)
+    {
+        FEntry* entry = oldIds->slots[i].load(std::memory_order_relaxed);
+        if (!entry)
+        {
+            continue;
+        }
+        uint32 j = IdSlot(entry->index) & ids->mask;
+        while (ids->slots[j].load(std::memory_order_relaxed))
+        {
+            j = (j + 1) & ids->mask;
+        }
+        ids->slots[j].store(entry, std::memory_order_relaxed);
+    }
+
+    // readers holding old tables still find every name they could find before
+    nameTable.store(names, std::memory_order_release);
+    idTable.store(ids, std::memory_order_release);
+    retiredTables.Add(oldNames);
+    retiredTables.Add(oldIds);
+}
+
+void FProfileNameSet::TakeNewNames(TMap<uint32, FString>& outNames, bool bAll)
+{
+    FScopeLock lock(&mutex);
+    if (bAll)
+    {
+        const FTable* table = idTable.load(std::memory_order_relaxed);
+        for (uint32 i = 0; i <= table->mask; i++)
+        {
+            if (FEntry* entry = table->slots[i].load(std::memory_order_relaxed))
+            {
+                outNames.Emplace(entry->index, entry->name);
+            }
+        }
+    }
+    else
+    {
+        for (FEntry* entry : newEntries)
+        {
+            outNames.Emplace(entry->index, entry->name);
+        }
+    }
+    newEntries.Reset();
+}
+
+void FProfileNameSet::AddNames(const TMap<uint32, FString>& names)
+{
+    FScopeLock lock(&mutex);
+    for (auto iter = names.CreateConstIterator(); iter; ++iter)
+    {
+        FTCHARToUTF8 utf8(*iter.Value());
+        // same name at same index, e.g. file loaded twice, keep the entry
+        FEntry* existing = FindById(iter.Key());
+        if (existing && existing->utf8.Num() == utf8.Length() && FMemory::Memcmp(existing->utf8.GetData(), utf8.Get(), utf8.Length()) == 0)
+        {
+            continue;
+        }
+        AddEntry(iter.Key(), utf8.Get(), utf8.Length(), HashName(utf8.Get(), utf8.Length()), false);
+    }
+}
 FLuaFunctionDefine* FLuaFunctionDefine::Root = new FLuaFunctionDefine();
 FLuaFunctionDefine* FLuaFunctionDefine::Other = new FLuaFunctionDefine();
 
@@ -0,0 +1,105 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "SluaBenchmarkCommandlet.h"
+#include "LuaBenchmark.h"
+#include "LuaState.h"
+#include "Log.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace {
+    FString ScriptDir;
+
+    TArray<uint8> LoadScript(const char* fn, FString& filepath)
+    {
+        FString path = ScriptDir / FString(UTF8_TO_TCHAR(fn)).Replace(TEXT("."), TEXT("/"));
+        TArray<uint8> content;
+        for (const TCHAR* ext : { TEXT(".lua"), TEXT(".luac") })
+        {
+            FString fullPath = path + ext;
+            if (FFileHelper::LoadFileToArray(content, *fullPath, FILEREAD_Silent) && content.Num() > 0)
+            {
+                filepath = fullPath;
+                break;
+            }
+        }
+        return content;
+    }
+}
+
+USluaBenchmarkCommandlet::USluaBenchmarkCommandlet(const FObjectInitializer& ObjectInitializer)
+    : Super(ObjectInitializer)
+{
+    IsClient = false;
+    IsEditor = false;
+    IsServer = false;
+    LogToConsole = true;
+}
+
+int32 USluaBenchmarkCommandlet::Main(const FString& Params)
+{
+    NS_SLUA::LuaBenchmark::Options options;
+    if (!FParse::Value(*Params, TEXT("Module="), options.module))
+    {
+        UE_LOG(Slua, Error, TEXT("usage: -run=SluaBenchmark -Module=<module> [-ScriptDir=<Content/Lua>] [-Out=<json>] [-Runs=20] [-Warmup=3] [-Filter=<name>] [-Baseline=<json>] [-Threshold=0.1]"));
+        return 1;
+    }
+
+    ScriptDir = FPaths::ProjectContentDir() / TEXT("Lua");
+    FParse::Value(*Params, TEXT("ScriptDir="), ScriptDir);
+    FParse::Value(*Params, TEXT("Runs="), options.runs);
+    FParse::Value(*Params, TEXT("Warmup="), options.warmupRuns);
+    FParse::Value(*Params, TEXT("Filter="), options.filter);
+    options.runs = FMath::Max(options.runs, 1);
+    options.warmupRuns = FMath::Max(options.warmupRuns, 0);
+
+    NS_SLUA::LuaState* state = new NS_SLUA::LuaState("SluaBenchmark");
+    state->setLoadFileDelegate(LoadScript);
+    TArray<NS_SLUA::LuaBenchmark::CaseResult> results;
+    bool bOk = state->init() && NS_SLUA::LuaBenchmark::run(state, options, results);
+    state->close();
+    delete state;
+    if (!bOk)
+    {
+        return 1;
+    }
+
+    NS_SLUA::LuaBenchmark::print(results);
+
+    FString outPath;
+    if (FParse::Value(*Params, TEXT("Out="), outPath) && !NS_SLUA::LuaBenchmark::writeJson(outPath, options, results))
+    {
+        return 1;
+    }
+
+    FString baselinePath;
+    if (FParse::Value(*Params, TEXT("Baseline="), baselinePath))
+    {
+        TMap<FString, double> baseline;
+        if (!NS_SLUA::LuaBenchmark::readBaseline(baselinePath, baseline))
+        {
+            return 1;
+        }
+
+        double threshold = 0.1;
+        FParse::Value(*Params, TEXT("Threshold="), threshold);
+        int32 numRegressed = NS_SLUA::LuaBenchmark::compare(results, baseline, threshold);
+        if (numRegressed > 0)
+        {
+            UE_LOG(Slua, Error, TEXT("%d benchmark cases regressed over %.1f%%"), numRegressed, threshold * 100);
+            return 1;
+        }
+    }
+    return 0;
+}
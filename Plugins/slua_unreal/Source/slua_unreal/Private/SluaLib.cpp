@@ -39,6 +39,10 @@
 
 #if UE_BUILD_DEVELOPMENT
 #include "GenericPlatform/GenericPlatformMisc.h"
+#include "LuaScriptArchive.h"
+#include "LuaSmallBlockAllocator.h"
+#include "LuaModulePreloader.h"
+#include "lualib.h"
 #endif
 
 namespace NS_SLUA {
@@ -56,6 +60,10 @@ namespace NS_SLUA {
         RegMetaMethod(L, getMiliseconds);
         RegMetaMethod(L, getGStartTime);
         RegMetaMethod(L, setGCParam);
+        RegMetaMethod(L, getFrameBudget);
+        RegMetaMethod(L, preloadModules);
+        RegMetaMethod(L, prewarmClasses);
+        RegMetaMethod(L, prefetchImports);
         RegMetaMethod(L, dumpUObjects);
         RegMetaMethod(L, getAllWidgetObjects);
         RegMetaMethod(L, isValid);
@@ -67,6 +75,13 @@ namespace NS_SLUA {
         RegMetaMethod(L, getObjectTableMap);
         RegMetaMethod(L, getRefTraceback);
         RegMetaMethod(L, toggleRefTraceback);
+        RegMetaMethod(L, getDelegateSlots);
+        RegMetaMethod(L, buildScriptArchive);
+        RegMetaMethod(L, setScriptArchive);
+        RegMetaMethod(L, getAllocatorStats);
+        RegMetaMethod(L, runWithSmallBlockAllocator);
+        RegMetaMethod(L, findImported);
+        RegMetaMethod(L, getPreloadStats);
 #endif
         lua_setglobal(L,"slua");
     }
@@ -248,6 +263,96 @@ namespace NS_SLUA {
         return 0;
     }
 
+    static void pushBudgetCounter(lua_State* L, const LuaBudgetCounter& counter)
+    {
+        lua_createtable(L, 0, 2);
+        lua_pushnumber(L, counter.getMilliseconds());
+        lua_setfield(L, -2, "ms");
+        lua_pushinteger(L, counter.calls);
+        lua_setfield(L, -2, "calls");
+    }
+
+    int SluaUtil::getFrameBudget(lua_State* L)
+    {
+        LuaState* luaState = LuaState::get(L);
+        LuaFrameBudget& budget = luaState->getFrameBudget();
+        const LuaFrameBudgetStats& stats = lua_toboolean(L, 1) ? budget.getCurrentFrame() : budget.getLastFrame();
+
+        lua_createtable(L, 0, 7);
+        lua_pushinteger(L, (lua_Integer)stats.frameNumber);
+        lua_setfield(L, -2, "frame");
+        lua_pushinteger(L, LuaFrameBudget::getMode());
+        lua_setfield(L, -2, "mode");
+        lua_pushboolean(L, stats.bOverrun);
+        lua_setfield(L, -2, "overrun");
+        lua_pushinteger(L, budget.getOverrunFrames());
+        lua_setfield(L, -2, "overruns");
+        pushBudgetCounter(L, stats.total);
+        lua_setfield(L, -2, "total");
+
+        lua_createtable(L, 0, (int)ELuaEntryPoint::Num);
+        for (int i = 0; i < (int)ELuaEntryPoint::Num; i++) {
+            pushBudgetCounter(L, stats.entries[i]);
+            lua_setfield(L, -2, TCHAR_TO_UTF8(getEntryPointName((ELuaEntryPoint)i)));
+        }
+        lua_setfield(L, -2, "entries");
+
+        lua_createtable(L, stats.details.Num(), 0);
+        int index = 1;
+        for (auto& detail : stats.details) {
+            pushBudgetCounter(L, detail.counter);
+            lua_pushstring(L, TCHAR_TO_UTF8(*detail.name.ToString()));
+            lua_setfield(L, -2, "name");
+            lua_pushstring(L, TCHAR_TO_UTF8(getEntryPointName(detail.entry)));
+            lua_setfield(L, -2, "entry");
+            lua_seti(L, -2, index++);
+        }
+        lua_setfield(L, -2, "details");
+        return 1;
+    }
+
+    int SluaUtil::preloadModules(lua_State* L)
+    {
+        luaL_checktype(L, 1, LUA_TTABLE);
+        TArray<FString> modules;
+        int n = (int)lua_rawlen(L, 1);
+        for (int i = 1; i <= n; i++) {
+            lua_rawgeti(L, 1, i);
+            modules.Add(UTF8_TO_TCHAR(luaL_checkstring(L, -1)));
+            lua_pop(L, 1);
+        }
+        LuaState::get(L)->preloadModules(modules);
+        return 0;
+    }
+
+    int SluaUtil::prewarmClasses(lua_State* L)
+    {
+        luaL_checktype(L, 1, LUA_TTABLE);
+        TArray<UClass*> classes;
+        int n = (int)lua_rawlen(L, 1);
+        for (int i = 1; i <= n; i++) {
+            lua_rawgeti(L, 1, i);
+            classes.Add(LuaObject::checkValue<UClass*>(L, -1));
+            lua_pop(L, 1);
+        }
+        LuaState::get(L)->prewarmClasses(classes);
+        return 0;
+    }
+
+    int SluaUtil::prefetchImports(lua_State* L)
+    {
+        luaL_checktype(L, 1, LUA_TTABLE);
+        TArray<FString> names;
+        int n = (int)lua_rawlen(L, 1);
+        for (int i = 1; i <= n; i++) {
+            lua_rawgeti(L, 1, i);
+            names.Add(UTF8_TO_TCHAR(luaL_checkstring(L, -1)));
+            lua_pop(L, 1);
+        }
+        LuaState::get(L)->prefetchImports(names);
+        return 0;
+    }
+
     int SluaUtil::dumpUObjects(lua_State * L)
     {
         auto state = LuaState::get(L);
@@ -382,6 +487,111 @@ namespace NS_SLUA {
     }
 
 #if UE_BUILD_DEVELOPMENT
+    int SluaUtil::getDelegateSlots(lua_State* L)
+    {
+        int32 bound, free;
+        ULuaDelegateProxy::getSlotStats(L, bound, free);
+        lua_pushinteger(L, bound);
+        lua_pushinteger(L, free);
+        return 2;
+    }
+
+    int SluaUtil::buildScriptArchive(lua_State* L)
+    {
+        FString scriptDir = UTF8_TO_TCHAR(luaL_checkstring(L, 1));
+        FString outPath = UTF8_TO_TCHAR(luaL_checkstring(L, 2));
+        bool bStripDebugInfo = !!lua_toboolean(L, 3);
+        lua_pushboolean(L, LuaScriptArchive::build(scriptDir, outPath, bStripDebugInfo));
+        return 1;
+    }
+
+    int SluaUtil::setScriptArchive(lua_State* L)
+    {
+        FString path = UTF8_TO_TCHAR(luaL_checkstring(L, 1));
+        lua_pushboolean(L, LuaState::get(L)->setScriptArchive(path));
+        return 1;
+    }
+
+    static void pushAllocatorStats(lua_State* L, const LuaAllocatorStats& stats)
+    {
+        lua_createtable(L, 0, 9);
+        lua_pushinteger(L, stats.requestedBytes);
+        lua_setfield(L, -2, "requestedBytes");
+        lua_pushinteger(L, stats.smallBlockBytes);
+        lua_setfield(L, -2, "smallBlockBytes");
+        lua_pushinteger(L, stats.smallBlockCount);
+        lua_setfield(L, -2, "smallBlockCount");
+        lua_pushinteger(L, stats.largeBlockBytes);
+        lua_setfield(L, -2, "largeBlockBytes");
+        lua_pushinteger(L, stats.largeBlockCount);
+        lua_setfield(L, -2, "largeBlockCount");
+        lua_pushinteger(L, stats.pageBytes);
+        lua_setfield(L, -2, "pageBytes");
+        lua_pushinteger(L, stats.pageCount);
+        lua_setfield(L, -2, "pageCount");
+        lua_pushinteger(L, stats.cachedPageCount);
+        lua_setfield(L, -2, "cachedPageCount");
+        lua_pushinteger(L, stats.releasedPageCount);
+        lua_setfield(L, -2, "releasedPageCount");
+    }
+
+    int SluaUtil::getAllocatorStats(lua_State* L)
+    {
+        LuaSmallBlockAllocator* allocator = LuaState::get(L)->getAllocator();
+        if (!allocator)
+            return 0;
+        pushAllocatorStats(L, allocator->getStats());
+        return 1;
+    }
+
+    int SluaUtil::runWithSmallBlockAllocator(lua_State* L)
+    {
+        size_t len;
+        const char* source = luaL_checklstring(L, 1, &len);
+
+        // allocator must be destructed, so error is returned instead of raised
+        LuaSmallBlockAllocator allocator;
+        lua_State* L1 = lua_newstate(LuaSmallBlockAllocator::luaAlloc, &allocator);
+        if (!L1) {
+            lua_pushnil(L);
+            lua_pushstring(L, "can't create lua state");
+            return 2;
+        }
+        luaL_openlibs(L1);
+        if (luaL_loadbuffer(L1, source, len, "=runWithSmallBlockAllocator") || lua_pcall(L1, 0, 0, 0)) {
+            lua_pushnil(L);
+            lua_pushstring(L, lua_tostring(L1, -1));
+            lua_close(L1);
+            return 2;
+        }
+
+        pushAllocatorStats(L, allocator.getStats());
+        lua_close(L1);
+        pushAllocatorStats(L, allocator.getStats());
+        return 2;
+    }
+
+    int SluaUtil::findImported(lua_State* L)
+    {
+        FString path = UTF8_TO_TCHAR(luaL_checkstring(L, 1));
+        LuaState* state = LuaState::get(L);
+        LuaState::ImportedObjectCache imported;
+        if (state->findImported(path, imported))
+            LuaState::pushImported(L, imported);
+        else
+            lua_pushnil(L);
+        lua_pushboolean(L, state->pendingImports.Contains(path));
+        return 2;
+    }
+
+    int SluaUtil::getPreloadStats(lua_State* L)
+    {
+        LuaState* state = LuaState::get(L);
+        lua_pushinteger(L, state->preloader ? state->preloader->numReady() : 0);
+        lua_pushinteger(L, state->preloader ? state->preloader->numPending() : 0);
+        return 2;
+    }
+
     int SluaUtil::getObjectTableMap(lua_State* L)
     {
         lua_newtable(L);
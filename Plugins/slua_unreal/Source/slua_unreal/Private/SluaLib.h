@@ -36,6 +36,12 @@ namespace NS_SLUA {
         static int getGStartTime(lua_State* L);
 
         static int setGCParam(lua_State* L);
+        // lua cost of last frame(or current frame if arg 1 is true) by entry point
+        static int getFrameBudget(lua_State* L);
+        // compile modules in table on worker threads, require them later only loads bytecode
+        static int preloadModules(lua_State* L);
+        static int prewarmClasses(lua_State* L);
+        static int prefetchImports(lua_State* L);
 
         // dump all uobject that referenced by lua
         static int dumpUObjects(lua_State* L);
@@ -54,6 +60,21 @@ namespace NS_SLUA {
         static int getObjectTableMap(lua_State* L);
         static int getRefTraceback(lua_State* L);
         static int toggleRefTraceback(lua_State* L);
+        // return count of bound and free delegate proxies of lua state
+        static int getDelegateSlots(lua_State* L);
+        // build script archive from script dir, same as console command slua.BuildScriptArchive
+        static int buildScriptArchive(lua_State* L);
+        // load modules from script archive at path, empty path to stop using archive
+        static int setScriptArchive(lua_State* L);
+        // stats of small block allocator of lua state, nil if allocator is off
+        static int getAllocatorStats(lua_State* L);
+        // run source in a bare lua state with its own small block allocator,
+        // return allocator stats before and after the state is closed, or nil and error
+        static int runWithSmallBlockAllocator(lua_State* L);
+        // imported type of object path if it's loaded, and whether importAsync or prefetchImports is loading it
+        static int findImported(lua_State* L);
+        // count of preloaded modules compiled and not required yet, and modules still compiling
+        static int getPreloadStats(lua_State* L);
 #endif
     };
 
@@ -0,0 +1,147 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "SluaProfileAnalyzeCommandlet.h"
+#include "SluaProfileCapture.h"
+#include "Log.h"
+#include "Misc/FileHelper.h"
+
+namespace {
+    double ToMs(int64 nanoseconds)
+    {
+        return nanoseconds / 1000000.0;
+    }
+
+    void PrintTable(const FSluaProfileCapture& capture, const TArray<FSluaProfileFunctionStat>& stats, TArray<uint32>& order,
+        int32 top, int32 numFrames, bool bByInclusive)
+    {
+        order.Sort([&](uint32 a, uint32 b)
+            {
+                return bByInclusive ? stats[a].inclusiveTime > stats[b].inclusiveTime : stats[a].exclusiveTime > stats[b].exclusiveTime;
+            });
+
+        UE_LOG(Slua, Display, TEXT("Top %d by %s time:"), top, bByInclusive ? TEXT("inclusive") : TEXT("exclusive"));
+        UE_LOG(Slua, Display, TEXT("%12s %12s %12s %12s %8s  %s"), TEXT("Incl(ms)"), TEXT("Excl(ms)"), TEXT("Incl/f(ms)"), TEXT("Calls"), TEXT("Frames"), TEXT("Function"));
+        for (int32 i = 0; i < order.Num() && i < top; i++)
+        {
+            const FSluaProfileFunctionStat& stat = stats[order[i]];
+            if (stat.calls == 0)
+            {
+                break;
+            }
+            UE_LOG(Slua, Display, TEXT("%12.3f %12.3f %12.4f %12lld %8d  %s"),
+                ToMs(stat.inclusiveTime), ToMs(stat.exclusiveTime), ToMs(stat.inclusiveTime) / FMath::Max(numFrames, 1),
+                stat.calls, stat.frames, *capture.GetFullName(order[i]));
+        }
+    }
+}
+
+USluaProfileAnalyzeCommandlet::USluaProfileAnalyzeCommandlet(const FObjectInitializer& ObjectInitializer)
+    : Super(ObjectInitializer)
+{
+    IsClient = false;
+    IsEditor = false;
+    IsServer = false;
+    LogToConsole = true;
+}
+
+int32 USluaProfileAnalyzeCommandlet::Main(const FString& Params)
+{
+    FString filePath;
+    if (!FParse::Value(*Params, TEXT("File="), filePath))
+    {
+        UE_LOG(Slua, Error, TEXT("usage: -run=SluaProfileAnalyze -File=<capture> [-Top=30] [-First=0] [-Count=<all>] [-Csv=<output>]"));
+        return 1;
+    }
+
+    TUniquePtr<FSluaProfileCapture> capture(FSluaProfileCapture::Open(filePath));
+    if (!capture.IsValid())
+    {
+        UE_LOG(Slua, Error, TEXT("Can't open profile capture %s"), *filePath);
+        return 1;
+    }
+
+    int32 top = 30;
+    int32 first = 0;
+    int32 count = capture->NumFrames();
+    FParse::Value(*Params, TEXT("Top="), top);
+    FParse::Value(*Params, TEXT("First="), first);
+    FParse::Value(*Params, TEXT("Count="), count);
+    first = FMath::Clamp(first, 0, capture->NumFrames());
+    count = FMath::Clamp(count, 0, capture->NumFrames() - first);
+
+    TArray<FSluaProfileFunctionStat> stats;
+    capture->Aggregate(first, count, stats);
+
+    // lua time of a frame is sum of its roots
+    int64 totalTime = 0;
+    float minMemory = MAX_flt;
+    float maxMemory = 0;
+    for (int32 i = first; i < first + count; i++)
+    {
+        FSluaProfileCapture::FFrame frame;
+        if (!capture->GetFrame(i, frame))
+        {
+            continue;
+        }
+        for (int32 node = 0; node < frame.numNodes; node++)
+        {
+            if (frame.parent[node] < 0)
+            {
+                totalTime += frame.costTime[node];
+            }
+        }
+        minMemory = FMath::Min(minMemory, frame.memoryKB);
+        maxMemory = FMath::Max(maxMemory, frame.memoryKB);
+    }
+
+    UE_LOG(Slua, Display, TEXT("%s: frames %d-%d of %d, %d functions"), *filePath, first, first + count, capture->NumFrames(), capture->NumFunctions());
+    UE_LOG(Slua, Display, TEXT("lua time %.3f ms, %.4f ms per frame, memory %.1f-%.1f KB"),
+        ToMs(totalTime), ToMs(totalTime) / FMath::Max(count, 1), count > 0 ? minMemory : 0.0f, maxMemory);
+
+    TArray<uint32> order;
+    order.Reserve(stats.Num());
+    for (int32 i = 0; i < stats.Num(); i++)
+    {
+        order.Add(i);
+    }
+    PrintTable(*capture, stats, order, top, count, true);
+    PrintTable(*capture, stats, order, top, count, false);
+
+    FString csvPath;
+    if (FParse::Value(*Params, TEXT("Csv="), csvPath))
+    {
+        TArray<FString> lines;
+        lines.Reserve(stats.Num() + 1);
+        lines.Add(TEXT("Function,File,Line,InclusiveMs,ExclusiveMs,Calls,Frames"));
+        for (uint32 function : order)
+        {
+            const FSluaProfileFunctionStat& stat = stats[function];
+            if (stat.calls == 0)
+            {
+                continue;
+            }
+            lines.Add(FString::Printf(TEXT("\"%s\",\"%s\",%d,%.4f,%.4f,%lld,%d"),
+                *capture->GetFunctionName(function).Replace(TEXT("\""), TEXT("\"\"")),
+                *capture->GetFileName(function).Replace(TEXT("\""), TEXT("\"\"")),
+                capture->GetLineDefined(function), ToMs(stat.inclusiveTime), ToMs(stat.exclusiveTime), stat.calls, stat.frames));
+        }
+        if (!FFileHelper::SaveStringArrayToFile(lines, *csvPath))
+        {
+            UE_LOG(Slua, Error, TEXT("Can't write %s"), *csvPath);
+            return 1;
+        }
+        UE_LOG(Slua, Display, TEXT("Wrote %s"), *csvPath);
+    }
+    return 0;
+}
@@ -0,0 +1,480 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "SluaProfileCapture.h"
+#include "Log.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/FileManager.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/FileHelper.h"
+
+namespace {
+    const uint32 CaptureMagic = 0x43504C53; // "SLPC"
+    const uint32 CaptureVersion = 1;
+
+    struct FCaptureHeader
+    {
+        uint32 magic;
+        uint32 version;
+        uint32 reserved[2];
+    };
+
+    struct FFrameHeader
+    {
+        int64 tickTime;
+        float memoryKB;
+        uint32 numNodes;
+    };
+
+    // last bytes of file
+    struct FCaptureTrailer
+    {
+        uint64 footerOffset;
+        uint32 frameCount;
+        uint32 functionCount;
+        uint32 nameCount;
+        uint32 nameDataSize;
+        uint32 magic;
+        uint32 version;
+    };
+
+    int64 FrameBlockSize(uint32 numNodes)
+    {
+        int64 columnSize = (int64)numNodes * (sizeof(int64) + sizeof(int32) + sizeof(int32) + sizeof(uint32));
+        return Align(sizeof(FFrameHeader) + columnSize, 8);
+    }
+}
+
+struct FSluaProfileCapture::FFunctionEntry
+{
+    uint32 fileName;
+    uint32 functionName;
+    int32 lineDefined;
+};
+
+// utf8 name at offset of name data, not null terminated
+struct FSluaProfileCapture::FNameEntry
+{
+    uint32 offset;
+    uint32 length;
+};
+
+//////////////////// FSluaProfileCaptureWriter BEGIN //////////////////////////////////////////////
+FSluaProfileCaptureWriter::FSluaProfileCaptureWriter()
+    : ar(nullptr)
+{
+}
+
+FSluaProfileCaptureWriter::~FSluaProfileCaptureWriter()
+{
+    Close();
+}
+
+bool FSluaProfileCaptureWriter::Open(const FString& filePath)
+{
+    Close();
+    ar = IFileManager::Get().CreateFileWriter(*filePath);
+    if (!ar)
+    {
+        UE_LOG(Slua, Error, TEXT("Can't create profile capture %s"), *filePath);
+        return false;
+    }
+
+    frameOffsets.Empty();
+    functionIds.Empty();
+    functions.Empty();
+    nameIds.Empty();
+    names.Empty();
+
+    FCaptureHeader header = {CaptureMagic, CaptureVersion, {0, 0}};
+    ar->Serialize(&header, sizeof(header));
+    return true;
+}
+
+void FSluaProfileCaptureWriter::WriteFrame(int64 tickTime, const TArray<TSharedPtr<FunctionProfileNode>>& frameRootArr, float memoryKB)
+{
+    if (!ar)
+    {
+        return;
+    }
+
+    costTimeColumn.Reset();
+    callsColumn.Reset();
+    parentColumn.Reset();
+    functionColumn.Reset();
+    for (auto& node : frameRootArr)
+    {
+        if (node.IsValid())
+        {
+            AddNode(*node, -1);
+        }
+    }
+
+    frameOffsets.Add(ar->Tell());
+    FFrameHeader header = {tickTime, memoryKB, (uint32)costTimeColumn.Num()};
+    ar->Serialize(&header, sizeof(header));
+    ar->Serialize(costTimeColumn.GetData(), costTimeColumn.Num() * sizeof(int64));
+    ar->Serialize(callsColumn.GetData(), callsColumn.Num() * sizeof(int32));
+    ar->Serialize(parentColumn.GetData(), parentColumn.Num() * sizeof(int32));
+    ar->Serialize(functionColumn.GetData(), functionColumn.Num() * sizeof(uint32));
+    Pad();
+}
+
+void FSluaProfileCaptureWriter::AddNode(const FunctionProfileNode& node, int32 parent)
+{
+    int32 index = costTimeColumn.Add(node.costTime);
+    callsColumn.Add(node.countOfCalls);
+    parentColumn.Add(parent);
+    functionColumn.Add(InternFunction(node.functionDefine));
+
+    if (node.childNode.IsValid())
+    {
+        for (auto& child : *node.childNode)
+        {
+            if (child.Value.IsValid())
+            {
+                AddNode(*child.Value, index);
+            }
+        }
+    }
+}
+
+uint32 FSluaProfileCaptureWriter::InternFunction(const FLuaFunctionDefine& functionDefine)
+{
+    if (uint32* id = functionIds.Find(functionDefine))
+    {
+        return *id;
+    }
+
+    FLuaFunctionDefine entry;
+    entry.fileNameIndex = InternName(functionDefine.fileNameIndex);
+    entry.functionNameIndex = InternName(functionDefine.functionNameIndex);
+    entry.lineDefined = functionDefine.lineDefined;
+
+    uint32 id = functions.Add(entry);
+    functionIds.Add(functionDefine, id);
+    return id;
+}
+
+uint32 FSluaProfileCaptureWriter::InternName(uint32 nameIndex)
+{
+    if (uint32* id = nameIds.Find(nameIndex))
+    {
+        return *id;
+    }
+    uint32 id = names.Add(nameIndex);
+    nameIds.Add(nameIndex, id);
+    return id;
+}
+
+void FSluaProfileCaptureWriter::Pad()
+{
+    static const uint8 zeros[8] = {0};
+    int64 pos = ar->Tell();
+    int64 padding = Align(pos, 8) - pos;
+    if (padding > 0)
+    {
+        ar->Serialize((void*)zeros, padding);
+    }
+}
+
+void FSluaProfileCaptureWriter::Close()
+{
+    if (!ar)
+    {
+        return;
+    }
+
+    FCaptureTrailer trailer;
+    trailer.footerOffset = ar->Tell();
+    trailer.frameCount = frameOffsets.Num();
+    trailer.functionCount = functions.Num();
+    trailer.nameCount = names.Num();
+    trailer.magic = CaptureMagic;
+    trailer.version = CaptureVersion;
+
+    ar->Serialize(frameOffsets.GetData(), frameOffsets.Num() * sizeof(uint64));
+
+    for (auto& function : functions)
+    {
+        FSluaProfileCapture::FFunctionEntry entry = {function.fileNameIndex, function.functionNameIndex, function.lineDefined};
+        ar->Serialize(&entry, sizeof(entry));
+    }
+
+    TArray<uint8> nameData;
+    FProfileNameSet* nameSet = FProfileNameSet::GlobalProfileNameSet;
+    for (uint32 nameIndex : names)
+    {
+        FString name = nameSet ? nameSet->GetStringByIndex(nameIndex) : FString();
+        FTCHARToUTF8 utf8(*name);
+        FSluaProfileCapture::FNameEntry entry = {(uint32)nameData.Num(), (uint32)utf8.Length()};
+        nameData.Append((const uint8*)utf8.Get(), utf8.Length());
+        ar->Serialize(&entry, sizeof(entry));
+    }
+    ar->Serialize(nameData.GetData(), nameData.Num());
+    Pad();
+
+    trailer.nameDataSize = nameData.Num();
+    ar->Serialize(&trailer, sizeof(trailer));
+
+    bool bError = ar->IsError();
+    ar->Close();
+    delete ar;
+    ar = nullptr;
+
+    if (bError)
+    {
+        UE_LOG(Slua, Error, TEXT("Failed to write profile capture"));
+    }
+}
+//////////////////// FSluaProfileCaptureWriter END //////////////////////////////////////////////
+
+//////////////////// FSluaProfileCapture BEGIN //////////////////////////////////////////////
+FSluaProfileCapture::FSluaProfileCapture()
+    : mappedHandle(nullptr)
+    , mappedRegion(nullptr)
+    , data(nullptr)
+    , size(0)
+    , footerOffset(0)
+    , frameCount(0)
+    , functionCount(0)
+    , nameCount(0)
+    , frameOffsets(nullptr)
+    , functionEntries(nullptr)
+    , nameEntries(nullptr)
+    , nameData(nullptr)
+    , nameDataSize(0)
+{
+}
+
+FSluaProfileCapture::~FSluaProfileCapture()
+{
+    delete mappedRegion;
+    delete mappedHandle;
+}
+
+FSluaProfileCapture* FSluaProfileCapture::Open(const FString& filePath)
+{
+    FSluaProfileCapture* capture = new FSluaProfileCapture();
+    capture->path = filePath;
+
+    IMappedFileHandle* handle = FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*filePath);
+    if (handle)
+    {
+        capture->mappedHandle = handle;
+        capture->mappedRegion = handle->MapRegion(0, handle->GetFileSize());
+    }
+    if (capture->mappedRegion)
+    {
+        capture->data = capture->mappedRegion->GetMappedPtr();
+        capture->size = capture->mappedRegion->GetMappedSize();
+    }
+    else if (FFileHelper::LoadFileToArray(capture->fileData, *filePath, FILEREAD_Silent))
+    {
+        capture->data = capture->fileData.GetData();
+        capture->size = capture->fileData.Num();
+    }
+
+    if (!capture->data || !capture->Validate())
+    {
+        delete capture;
+        return nullptr;
+    }
+    return capture;
+}
+
+bool FSluaProfileCapture::Validate()
+{
+    if (size < (int64)(sizeof(FCaptureHeader) + sizeof(FCaptureTrailer)))
+    {
+        UE_LOG(Slua, Error, TEXT("Profile capture %s is broken"), *path);
+        return false;
+    }
+
+    const FCaptureHeader* header = (const FCaptureHeader*)data;
+    const FCaptureTrailer* trailer = (const FCaptureTrailer*)(data + size - sizeof(FCaptureTrailer));
+    if (header->magic != CaptureMagic || header->version != CaptureVersion
+        || trailer->magic != CaptureMagic || trailer->version != CaptureVersion)
+    {
+        UE_LOG(Slua, Error, TEXT("Profile capture %s isn't closed or is built with other version"), *path);
+        return false;
+    }
+
+    int64 footerSize = (int64)trailer->frameCount * sizeof(uint64)
+        + (int64)trailer->functionCount * sizeof(FFunctionEntry)
+        + (int64)trailer->nameCount * sizeof(FNameEntry)
+        + trailer->nameDataSize;
+    int64 footerEnd = size - sizeof(FCaptureTrailer);
+    if (trailer->footerOffset < sizeof(FCaptureHeader) || (trailer->footerOffset & 7) != 0
+        || (int64)trailer->footerOffset + footerSize > footerEnd
+        || trailer->frameCount > MAX_int32 || trailer->functionCount > MAX_int32 || trailer->nameCount > MAX_int32)
+    {
+        UE_LOG(Slua, Error, TEXT("Profile capture %s has broken footer"), *path);
+        return false;
+    }
+
+    footerOffset = trailer->footerOffset;
+    frameCount = trailer->frameCount;
+    functionCount = trailer->functionCount;
+    nameCount = trailer->nameCount;
+    nameDataSize = trailer->nameDataSize;
+
+    const uint8* p = data + footerOffset;
+    frameOffsets = (const uint64*)p;
+    p += frameCount * sizeof(uint64);
+    functionEntries = (const FFunctionEntry*)p;
+    p += functionCount * sizeof(FFunctionEntry);
+    nameEntries = (const FNameEntry*)p;
+    p += nameCount * sizeof(FNameEntry);
+    nameData = p;
+    return true;
+}
+
+bool FSluaProfileCapture::GetFrame(int32 index, FFrame& outFrame) const
+{
+    if (index < 0 || index >= frameCount)
+    {
+        return false;
+    }
+
+    // frame blocks are checked when they are read, so opening a large capture touches only its footer
+    uint64 offset = frameOffsets[index];
+    if (offset < sizeof(FCaptureHeader) || (offset & 7) != 0 || offset + sizeof(FFrameHeader) > (uint64)footerOffset)
+    {
+        return false;
+    }
+    const FFrameHeader* header = (const FFrameHeader*)(data + offset);
+    if (offset + FrameBlockSize(header->numNodes) > (uint64)footerOffset)
+    {
+        return false;
+    }
+
+    int32 numNodes = header->numNodes;
+    const uint8* p = data + offset + sizeof(FFrameHeader);
+    outFrame.tickTime = header->tickTime;
+    outFrame.memoryKB = header->memoryKB;
+    outFrame.numNodes = numNodes;
+    outFrame.costTime = (const int64*)p;
+    p += numNodes * sizeof(int64);
+    outFrame.calls = (const int32*)p;
+    p += numNodes * sizeof(int32);
+    outFrame.parent = (const int32*)p;
+    p += numNodes * sizeof(int32);
+    outFrame.function = (const uint32*)p;
+    return true;
+}
+
+FString FSluaProfileCapture::GetName(uint32 name) const
+{
+    if (name >= (uint32)nameCount)
+    {
+        return FString();
+    }
+    const FNameEntry& entry = nameEntries[name];
+    if ((uint64)entry.offset + entry.length > nameDataSize)
+    {
+        return FString();
+    }
+    FUTF8ToTCHAR converter((const ANSICHAR*)(nameData + entry.offset), entry.length);
+    return FString(converter.Length(), converter.Get());
+}
+
+FString FSluaProfileCapture::GetFileName(uint32 function) const
+{
+    return function < (uint32)functionCount ? GetName(functionEntries[function].fileName) : FString();
+}
+
+FString FSluaProfileCapture::GetFunctionName(uint32 function) const
+{
+    return function < (uint32)functionCount ? GetName(functionEntries[function].functionName) : FString();
+}
+
+int32 FSluaProfileCapture::GetLineDefined(uint32 function) const
+{
+    return function < (uint32)functionCount ? functionEntries[function].lineDefined : -1;
+}
+
+FString FSluaProfileCapture::GetFullName(uint32 function) const
+{
+    return FString::Printf(TEXT("%s:%d %s"), *GetFileName(function), GetLineDefined(function), *GetFunctionName(function));
+}
+
+void FSluaProfileCapture::Aggregate(int32 firstFrame, int32 numFrames, TArray<FSluaProfileFunctionStat>& outStats) const
+{
+    outStats.Reset();
+    outStats.SetNum(functionCount);
+
+    // depth of each function on current path, inclusive time of a recursive call is counted by its outermost call
+    TArray<int32> activeDepth;
+    activeDepth.SetNumZeroed(functionCount);
+    TArray<int32> lastFrame;
+    lastFrame.Init(INDEX_NONE, functionCount);
+    TArray<int32> nodeStack;
+
+    int32 endFrame = FMath::Min(frameCount, firstFrame + numFrames);
+    for (int32 frameIndex = FMath::Max(firstFrame, 0); frameIndex < endFrame; frameIndex++)
+    {
+        FFrame frame;
+        if (!GetFrame(frameIndex, frame))
+        {
+            UE_LOG(Slua, Warning, TEXT("Skip broken frame %d of profile capture %s"), frameIndex, *path);
+            continue;
+        }
+
+        for (int32 i = 0; i < frame.numNodes; i++)
+        {
+            uint32 function = frame.function[i];
+            int32 parent = frame.parent[i];
+            if (function >= (uint32)functionCount || parent >= i)
+            {
+                continue;
+            }
+
+            while (nodeStack.Num() > 0 && nodeStack.Top() != parent)
+            {
+#if UE_5_5_OR_LATER
+                activeDepth[frame.function[nodeStack.Pop(EAllowShrinking::No)]]--;
+#else
+                activeDepth[frame.function[nodeStack.Pop(false)]]--;
+#endif
+            }
+
+            FSluaProfileFunctionStat& stat = outStats[function];
+            stat.calls += frame.calls[i];
+            stat.exclusiveTime += frame.costTime[i];
+            if (nodeStack.Num() > 0)
+            {
+                outStats[frame.function[parent]].exclusiveTime -= frame.costTime[i];
+            }
+            if (activeDepth[function] == 0)
+            {
+                stat.inclusiveTime += frame.costTime[i];
+            }
+            if (lastFrame[function] != frameIndex)
+            {
+                lastFrame[function] = frameIndex;
+                stat.frames++;
+            }
+
+            nodeStack.Add(i);
+            activeDepth[function]++;
+        }
+
+        for (int32 node : nodeStack)
+        {
+            activeDepth[frame.function[node]]--;
+        }
+        nodeStack.Reset();
+    }
+}
+//////////////////// FSluaProfileCapture END //////////////////////////////////////////////
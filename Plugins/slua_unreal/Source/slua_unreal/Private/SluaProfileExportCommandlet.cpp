@@ -0,0 +1,52 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "SluaProfileExportCommandlet.h"
+#include "SluaProfileExporter.h"
+#include "Log.h"
+#include "Misc/Paths.h"
+
+USluaProfileExportCommandlet::USluaProfileExportCommandlet(const FObjectInitializer& ObjectInitializer)
+    : Super(ObjectInitializer)
+{
+    IsClient = false;
+    IsEditor = false;
+    IsServer = false;
+    LogToConsole = true;
+}
+
+int32 USluaProfileExportCommandlet::Main(const FString& Params)
+{
+    FString filePath;
+    FString formatName;
+    FSluaProfileExporter::EFormat format;
+    if (!FParse::Value(*Params, TEXT("File="), filePath) || !FParse::Value(*Params, TEXT("Format="), formatName)
+        || !FSluaProfileExporter::ParseFormat(formatName, format))
+    {
+        UE_LOG(Slua, Error, TEXT("usage: -run=SluaProfileExport -File=<capture> -Format=chrome|folded [-Out=<output>]"));
+        return 1;
+    }
+
+    FString outPath;
+    if (!FParse::Value(*Params, TEXT("Out="), outPath))
+    {
+        outPath = FPaths::ChangeExtension(filePath, format == FSluaProfileExporter::EFormat::ChromeTrace ? TEXT("json") : TEXT("folded"));
+    }
+
+    if (!FSluaProfileExporter::ExportFile(filePath, outPath, format))
+    {
+        UE_LOG(Slua, Error, TEXT("Failed to export %s"), *filePath);
+        return 1;
+    }
+    return 0;
+}
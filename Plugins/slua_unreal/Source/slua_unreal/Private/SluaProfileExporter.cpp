@@ -0,0 +1,411 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "SluaProfileExporter.h"
+#include "SluaProfilerDataManager.h"
+#include "Log.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Paths.h"
+
+namespace {
+    FString EscapeJson(const FString& text)
+    {
+        FString result;
+        result.Reserve(text.Len());
+        for (TCHAR c : text)
+        {
+            switch (c)
+            {
+            case '"': result += TEXT("\\\""); break;
+            case '\\': result += TEXT("\\\\"); break;
+            case '\n': result += TEXT("\\n"); break;
+            case '\r': result += TEXT("\\r"); break;
+            case '\t': result += TEXT("\\t"); break;
+            default:
+                if (c < 0x20)
+                {
+                    result += FString::Printf(TEXT("\\u%04x"), (uint32)c);
+                }
+                else
+                {
+                    result.AppendChar(c);
+                }
+                break;
+            }
+        }
+        return result;
+    }
+
+    // ';' separates frames of a folded stack, new line separates stacks
+    FString EscapeFolded(const FString& text)
+    {
+        FString result = text.Replace(TEXT(";"), TEXT(":"));
+        result.ReplaceCharInline('\n', ' ');
+        result.ReplaceCharInline('\r', ' ');
+        return result;
+    }
+
+    FString Microseconds(int64 nanoseconds)
+    {
+        return FString::Printf(TEXT("%.3f"), nanoseconds / 1000.0);
+    }
+}
+
+bool FSluaProfileExporter::ParseFormat(const FString& name, EFormat& outFormat)
+{
+    if (name == TEXT("chrome") || name == TEXT("json"))
+    {
+        outFormat = EFormat::ChromeTrace;
+        return true;
+    }
+    if (name == TEXT("folded"))
+    {
+        outFormat = EFormat::FoldedStack;
+        return true;
+    }
+    return false;
+}
+
+bool FSluaProfileExporter::ExportFile(const FString& filePath, const FString& outPath, EFormat format)
+{
+    FSluaProfileExporter exporter(format);
+    if (FPaths::GetExtension(filePath) == TEXT("sluacap"))
+    {
+        TUniquePtr<FSluaProfileCapture> capture(FSluaProfileCapture::Open(filePath));
+        if (!capture.IsValid() || !exporter.Open(outPath))
+        {
+            return false;
+        }
+        auto getName = [&capture](uint32 function) { return capture->GetFullName(function); };
+        for (int32 i = 0; i < capture->NumFrames(); i++)
+        {
+            FSluaProfileCapture::FFrame frame;
+            if (capture->GetFrame(i, frame))
+            {
+                exporter.AddFrame(frame, getName);
+            }
+        }
+    }
+    else
+    {
+        if (!exporter.Open(outPath))
+        {
+            return false;
+        }
+        bool bLoaded = SluaProfilerDataManager::LoadDataByFrame(filePath,
+            [&exporter](TArray<TSharedPtr<FunctionProfileNode>>& frameRootArr, const TSharedPtr<FProflierMemNode>& memNode)
+            {
+                exporter.AddFrame(frameRootArr, memNode.IsValid() ? (float)memNode->totalSize : 0.0f);
+            });
+        if (!bLoaded)
+        {
+            exporter.Close();
+            IFileManager::Get().Delete(*outPath);
+            return false;
+        }
+    }
+    exporter.Close();
+    UE_LOG(Slua, Log, TEXT("Exported %s to %s"), *filePath, *outPath);
+    return true;
+}
+
+bool FSluaProfileExporter::ExportFrames(const ProfileNodeArrayArray& profileData, const MemNodeInfoList& memNodeList, const FString& outPath, EFormat format)
+{
+    FSluaProfileExporter exporter(format);
+    if (!exporter.Open(outPath))
+    {
+        return false;
+    }
+    for (int32 i = 0; i < profileData.Num(); i++)
+    {
+        float memoryKB = memNodeList.IsValidIndex(i) && memNodeList[i].IsValid() ? (float)memNodeList[i]->totalSize : 0.0f;
+        exporter.AddFrame(profileData[i], memoryKB);
+    }
+    exporter.Close();
+    return true;
+}
+
+FSluaProfileExporter::FSluaProfileExporter(EFormat inFormat)
+    : format(inFormat)
+    , ar(nullptr)
+    , frameIndex(0)
+    , clock(0)
+{
+}
+
+FSluaProfileExporter::~FSluaProfileExporter()
+{
+    Close();
+}
+
+bool FSluaProfileExporter::Open(const FString& outPath)
+{
+    Close();
+    ar = IFileManager::Get().CreateFileWriter(*outPath);
+    if (!ar)
+    {
+        UE_LOG(Slua, Error, TEXT("Can't create %s"), *outPath);
+        return false;
+    }
+
+    frameIndex = 0;
+    clock = 0;
+    names.Reset();
+    nameResolved.Empty();
+    treeFunctionIds.Empty();
+    treeFunctions.Empty();
+    pathIds.Empty();
+    pathParent.Empty();
+    pathFunction.Empty();
+    pathSelfTime.Empty();
+
+    if (format == EFormat::ChromeTrace)
+    {
+        Write(TEXT("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+            "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"Lua\"}}"));
+    }
+    return true;
+}
+
+void FSluaProfileExporter::AddFrame(const FSluaProfileCapture::FFrame& frame, TFunctionRef<FString(uint32)> getName)
+{
+    if (!ar)
+    {
+        return;
+    }
+
+    ResolveNames(frame, getName);
+    if (format == EFormat::ChromeTrace)
+    {
+        WriteChromeFrame(frame);
+    }
+    else
+    {
+        AddFoldedFrame(frame);
+    }
+    frameIndex++;
+}
+
+void FSluaProfileExporter::AddFrame(const TArray<TSharedPtr<FunctionProfileNode>>& frameRootArr, float memoryKB, int64 tickTime)
+{
+    costTimeColumn.Reset();
+    callsColumn.Reset();
+    parentColumn.Reset();
+    functionColumn.Reset();
+    for (auto& node : frameRootArr)
+    {
+        if (node.IsValid())
+        {
+            FlattenNode(*node, -1);
+        }
+    }
+
+    FSluaProfileCapture::FFrame frame;
+    frame.tickTime = tickTime;
+    frame.memoryKB = memoryKB;
+    frame.numNodes = costTimeColumn.Num();
+    frame.costTime = costTimeColumn.GetData();
+    frame.calls = callsColumn.GetData();
+    frame.parent = parentColumn.GetData();
+    frame.function = functionColumn.GetData();
+    AddFrame(frame, [this](uint32 function) { return treeFunctions[function].GetFullName(); });
+}
+
+void FSluaProfileExporter::FlattenNode(const FunctionProfileNode& node, int32 parent)
+{
+    uint32* id = treeFunctionIds.Find(node.functionDefine);
+    uint32 function = id ? *id : treeFunctionIds.Add(node.functionDefine, treeFunctions.Add(node.functionDefine));
+
+    int32 index = costTimeColumn.Add(node.costTime);
+    callsColumn.Add(node.countOfCalls);
+    parentColumn.Add(parent);
+    functionColumn.Add(function);
+
+    if (node.childNode.IsValid())
+    {
+        for (auto& child : *node.childNode)
+        {
+            if (child.Value.IsValid())
+            {
+                FlattenNode(*child.Value, index);
+            }
+        }
+    }
+}
+
+void FSluaProfileExporter::ResolveNames(const FSluaProfileCapture::FFrame& frame, TFunctionRef<FString(uint32)> getName)
+{
+    for (int32 i = 0; i < frame.numNodes; i++)
+    {
+        uint32 function = frame.function[i];
+        if (function >= (uint32)names.Num())
+        {
+            names.SetNum(function + 1);
+            nameResolved.Add(false, function + 1 - nameResolved.Num());
+        }
+        if (!nameResolved[function])
+        {
+            FString name = getName(function);
+            names[function] = format == EFormat::ChromeTrace ? EscapeJson(name) : EscapeFolded(name);
+            nameResolved[function] = true;
+        }
+    }
+}
+
+void FSluaProfileExporter::WriteChromeFrame(const FSluaProfileCapture::FFrame& frame)
+{
+    int64 frameTime = 0;
+    for (int32 i = 0; i < frame.numNodes; i++)
+    {
+        if (frame.parent[i] < 0)
+        {
+            frameTime += frame.costTime[i];
+        }
+    }
+
+    // lua of a frame runs before its tick, calls are placed right before tick if tick time is known
+    int64 frameStart = frame.tickTime > 0 ? FMath::Max(frame.tickTime - frameTime, clock) : clock;
+
+    FString events = FString::Printf(TEXT(",\n{\"name\":\"Frame %d\",\"cat\":\"frame\",\"ph\":\"X\",\"ts\":%s,\"dur\":%s,\"pid\":1,\"tid\":1}")
+        TEXT(",\n{\"name\":\"Lua Memory\",\"ph\":\"C\",\"ts\":%s,\"pid\":1,\"args\":{\"KB\":%.1f}}"),
+        frameIndex, *Microseconds(frameStart), *Microseconds(frameTime), *Microseconds(frameStart), frame.memoryKB);
+
+    if (childCursor.Num() < frame.numNodes)
+    {
+        childCursor.SetNumUninitialized(frame.numNodes);
+    }
+    int64 rootCursor = frameStart;
+    for (int32 i = 0; i < frame.numNodes; i++)
+    {
+        int32 parent = frame.parent[i];
+        int64 cost = frame.costTime[i];
+        int64& cursor = parent >= 0 && parent < i ? childCursor[parent] : rootCursor;
+        int64 start = cursor;
+        cursor += cost;
+        childCursor[i] = start;
+
+        events += FString::Printf(TEXT(",\n{\"name\":\"%s\",\"cat\":\"lua\",\"ph\":\"X\",\"ts\":%s,\"dur\":%s,\"pid\":1,\"tid\":1,\"args\":{\"calls\":%d}}"),
+            *names[frame.function[i]], *Microseconds(start), *Microseconds(cost), frame.calls[i]);
+    }
+    Write(events);
+
+    clock = FMath::Max(frameStart + frameTime, frame.tickTime);
+}
+
+void FSluaProfileExporter::AddFoldedFrame(const FSluaProfileCapture::FFrame& frame)
+{
+    if (nodePath.Num() < frame.numNodes)
+    {
+        nodePath.SetNumUninitialized(frame.numNodes);
+    }
+    for (int32 i = 0; i < frame.numNodes; i++)
+    {
+        int32 parent = frame.parent[i] < i ? frame.parent[i] : INDEX_NONE;
+        int32 parentPath = parent >= 0 ? nodePath[parent] : INDEX_NONE;
+        uint32 function = frame.function[i];
+
+        TPair<int32, uint32> key(parentPath, function);
+        int32* pathPtr = pathIds.Find(key);
+        int32 path = pathPtr ? *pathPtr : INDEX_NONE;
+        if (!pathPtr)
+        {
+            path = pathParent.Add(parentPath);
+            pathFunction.Add(function);
+            pathSelfTime.Add(0);
+            pathIds.Add(key, path);
+        }
+        nodePath[i] = path;
+
+        // self time is cost minus cost of callees
+        pathSelfTime[path] += frame.costTime[i];
+        if (parentPath != INDEX_NONE)
+        {
+            pathSelfTime[parentPath] -= frame.costTime[i];
+        }
+    }
+}
+
+void FSluaProfileExporter::WriteFoldedStacks()
+{
+    TArray<uint32> stack;
+    for (int32 path = 0; path < pathParent.Num(); path++)
+    {
+        int64 selfTime = pathSelfTime[path] / 1000;
+        if (selfTime <= 0)
+        {
+            continue;
+        }
+
+        stack.Reset();
+        for (int32 p = path; p != INDEX_NONE; p = pathParent[p])
+        {
+            stack.Add(pathFunction[p]);
+        }
+
+        FString line;
+        for (int32 i = stack.Num() - 1; i >= 0; i--)
+        {
+            line += names[stack[i]];
+            line += i > 0 ? TEXT(";") : TEXT(" ");
+        }
+        line += FString::Printf(TEXT("%lld\n"), selfTime);
+        Write(line);
+    }
+}
+
+void FSluaProfileExporter::Write(const FString& text)
+{
+    FTCHARToUTF8 utf8(*text);
+    ar->Serialize((void*)utf8.Get(), utf8.Length());
+}
+
+void FSluaProfileExporter::Close()
+{
+    if (!ar)
+    {
+        return;
+    }
+
+    if (format == EFormat::ChromeTrace)
+    {
+        Write(TEXT("\n]}\n"));
+    }
+    else
+    {
+        WriteFoldedStacks();
+    }
+
+    ar->Close();
+    delete ar;
+    ar = nullptr;
+}
+
+#if !UE_BUILD_SHIPPING
+static void exportProfile(const TArray<FString>& args)
+{
+    FSluaProfileExporter::EFormat format;
+    if (args.Num() < 3 || !FSluaProfileExporter::ParseFormat(args[1], format))
+    {
+        UE_LOG(Slua, Error, TEXT("usage: slua.ExportProfile <.sluacap|.sluastat> chrome|folded OutPath"));
+        return;
+    }
+    FSluaProfileExporter::ExportFile(args[0], args[2], format);
+}
+
+static FAutoConsoleCommand CVarExportProfile(
+    TEXT("slua.ExportProfile"),
+    TEXT("Export a profiler capture to chrome trace json or folded stacks, slua.ExportProfile <.sluacap|.sluastat> chrome|folded OutPath"),
+    FConsoleCommandWithArgsDelegate::CreateStatic(exportProfile),
+    ECVF_Default);
+#endif
@@ -8,6 +8,8 @@
 #include "Misc/Paths.h"
 #include "Misc/ScopedSlowTask.h"
 #include <LuaState.h>
+#include "SluaProfileCapture.h"
+#include "HAL/IConsoleManager.h"
 
 #include "HAL/RunnableThread.h"
 #define ROOT_NAME "ROOT"
@@ -49,6 +51,14 @@ void SluaProfilerDataManager::ReceiveProfileData(int hookEvent, int64 time, int
     }
 }
 
+void SluaProfilerDataManager::ReceiveProfileData(int hookEvent, int64 time, int lineDefined, const char* funcName, const char* shortSrc)
+{
+    if (ProcessRunnable)
+    {
+        ProcessRunnable->ReceiveProfileData(hookEvent, time, lineDefined, funcName, shortSrc);
+    }
+}
+
 void SluaProfilerDataManager::ReceiveMemoryData(int hookEvent, const TArray<NS_SLUA::LuaMemInfo>& memInfoList)
 {
     if (ProcessRunnable)
@@ -130,6 +140,15 @@ void SluaProfilerDataManager::LoadData(const FString& filePath, int& inCpuViewBe
     }
 }
 
+bool SluaProfilerDataManager::LoadDataByFrame(const FString& filePath, FProfileFrameVisitor visitor)
+{
+    if (!ProcessRunnable)
+    {
+        ProcessRunnable = new FProfileDataProcessRunnable();
+    }
+    return ProcessRunnable->LoadDataByFrame(filePath, visitor);
+}
+
 void SluaProfilerDataManager::InitProfileNode(TSharedPtr<FunctionProfileNode>& funcNode, const FLuaFunctionDefine& funcDefine, int32 layerIdx)
 {
     funcNode = MakeShared<FunctionProfileNode>();
@@ -141,9 +160,14 @@ void SluaProfilerDataManager::InitProfileNode(TSharedPtr<FunctionProfileNode>& f
 }
 
 void SluaProfilerDataManager::WatchBegin(const FString& fileName, int32 lineDefined, const FString& funcName, double nanoseconds, ProfileNodePtr funcProfilerRoot, ProfileCallInfoArray& profilerStack)
+{
+    WatchBegin(FLuaFunctionDefine::MakeLuaFunctionDefine(fileName, funcName, lineDefined), nanoseconds, funcProfilerRoot, profilerStack);
+}
+
+void SluaProfilerDataManager::WatchBegin(const FLuaFunctionDefine& funcDefine, double nanoseconds, ProfileNodePtr funcProfilerRoot, ProfileCallInfoArray& profilerStack)
 {
     TSharedPtr<FunctionProfileCallInfo> funcInfo = MakeShared<FunctionProfileCallInfo>();
-    funcInfo->functionDefine = FLuaFunctionDefine::MakeLuaFunctionDefine(fileName, funcName, lineDefined);
+    funcInfo->functionDefine = funcDefine;
     funcInfo->begTime = nanoseconds;
     funcInfo->bIsCoroutineBegin = false;
     TSharedPtr<FunctionProfileNode> funcInfoNode = funcProfilerRoot;
@@ -155,13 +179,17 @@ void SluaProfilerDataManager::WatchBegin(const FString& fileName, int32 lineDefi
 }
 
 void SluaProfilerDataManager::WatchEnd(const FString& fileName, int32 lineDefined, const FString& functionName, double nanoseconds, ProfileCallInfoArray& profilerStack) {
+    WatchEnd(FLuaFunctionDefine::MakeLuaFunctionDefine(fileName, functionName, lineDefined), nanoseconds, profilerStack);
+}
+
+void SluaProfilerDataManager::WatchEnd(const FLuaFunctionDefine& funcDefine, double nanoseconds, ProfileCallInfoArray& profilerStack) {
     if (!profilerStack.Num())return;
     TSharedPtr<FunctionProfileCallInfo> callInfo = profilerStack.Top();
     if (callInfo->bIsCoroutineBegin)
     {
         //Return时候遇到协程不对称，可以插入到树的节点之间。
         TSharedPtr<FunctionProfileNode> funcNode = MakeShared<FunctionProfileNode>();
-        funcNode->functionDefine = FLuaFunctionDefine::MakeLuaFunctionDefine(fileName, functionName, lineDefined);;
+        funcNode->functionDefine = funcDefine;
         funcNode->costTime = nanoseconds - callInfo->begTime;
         funcNode->countOfCalls = 1;
         funcNode->layerIdx = callInfo->ProfileNode->layerIdx + 1;
@@ -182,10 +210,13 @@ void SluaProfilerDataManager::WatchEnd(const FString& fileName, int32 lineDefine
 
 void SluaProfilerDataManager::CoroutineBegin(int32 lineDefined, const FString& funcName, double nanoseconds, ProfileNodePtr funcProfilerRoot, ProfileCallInfoArray& profilerStack)
 {
-    FString functionName = TEXT("coroutine.resume");
-    functionName += funcName;
+    CoroutineBegin(FLuaFunctionDefine::MakeLuaFunctionDefine(TEXT(""), funcName, lineDefined), nanoseconds, funcProfilerRoot, profilerStack);
+}
+
+void SluaProfilerDataManager::CoroutineBegin(const FLuaFunctionDefine& funcDefine, double nanoseconds, ProfileNodePtr funcProfilerRoot, ProfileCallInfoArray& profilerStack)
+{
     TSharedPtr<FunctionProfileCallInfo> funcInfo = MakeShared<FunctionProfileCallInfo>();
-    funcInfo->functionDefine = FLuaFunctionDefine::MakeLuaFunctionDefine(TEXT(""), funcName, lineDefined);
+    funcInfo->functionDefine = funcDefine;
     funcInfo->begTime = nanoseconds;
     funcInfo->bIsCoroutineBegin = true;
     TSharedPtr<FunctionProfileNode> funcInfoNode = funcProfilerRoot;
@@ -230,6 +261,13 @@ void SluaProfilerDataManager::AddToParentNode(TSharedPtr<FunctionProfileNode> pa
 }
 
 //////////////////// FProfileDataProcessRunnable BEGIN //////////////////////////////////////////////
+static bool ProfileColumnarCapture = false;
+FAutoConsoleVariableRef CVarSluaProfileColumnarCapture(
+    TEXT("slua.ProfileColumnarCapture"),
+    ProfileColumnarCapture,
+    TEXT("Record profiler frames to a memory mapped .sluacap file, analyzed by -run=SluaProfileAnalyze.\n"),
+    ECVF_Default);
+
 FProfileDataProcessRunnable::FProfileDataProcessRunnable()
 {
     currentMemory = MakeShared<MemoryFrame>();
@@ -248,6 +286,11 @@ void FProfileDataProcessRunnable::StopStreamingRunnable()
         delete WorkerThread;
         WorkerThread = nullptr;
     }
+    if (captureWriter)
+    {
+        delete captureWriter;
+        captureWriter = nullptr;
+    }
 }
 
 bool FProfileDataProcessRunnable::Init()
@@ -261,13 +304,22 @@ uint32 FProfileDataProcessRunnable::Run()
     {
         ProcessCommands();
 
-        while (bCanStartFrameRecord && frameArchive && !funcProfilerNodeQueue.IsEmpty())
+        while (bCanStartFrameRecord && (frameArchive || captureWriter) && !funcProfilerNodeQueue.IsEmpty())
         {
             MemoryFramePtr memoryFrame;
             memoryQueue.Dequeue(memoryFrame);
             TSharedPtr<FunctionProfileNode> funcProfilerNode;
             funcProfilerNodeQueue.Dequeue(funcProfilerNode);
-            PreProcessData(funcProfilerNode, memoryInfo, memoryFrame);
+            int64 tickTime = 0;
+            frameTimeQueue.Dequeue(tickTime);
+            PreProcessData(funcProfilerNode, memoryInfo, memoryFrame, tickTime);
+        }
+
+        if (!bIsRecording && bCanStartFrameRecord && captureWriter)
+        {
+            captureWriter->Close();
+            delete captureWriter;
+            captureWriter = nullptr;
         }
 
         if (!bIsRecording && bCanStartFrameRecord && frameArchive)
@@ -291,11 +343,28 @@ uint32 FProfileDataProcessRunnable::Run()
 
 void FProfileDataProcessRunnable::ReceiveProfileData(int hookEvent, int64 time, int lineDefined, const FString& funcName, const FString& shortSrc)
 {
-    if (!bIsRecording)
+    ReceiveProfileData(hookEvent, time, lineDefined, TCHAR_TO_UTF8(*funcName), TCHAR_TO_UTF8(*shortSrc));
+}
+
+void FProfileDataProcessRunnable::ReceiveProfileData(int hookEvent, int64 time, int lineDefined, const char* funcName, const char* shortSrc)
+{
+    if (!bIsRecording || !FProfileNameSet::GlobalProfileNameSet)
+    {
+        return;
+    }
+    funcName = funcName ? funcName : "";
+    shortSrc = shortSrc ? shortSrc : "";
+    if ((hookEvent == NS_SLUA::ProfilerHookEvent::PHE_CALL || hookEvent == NS_SLUA::ProfilerHookEvent::PHE_RETURN)
+        && lineDefined == -1 && !funcName[0])
     {
         return;
     }
-    cpuCommandQueue.Enqueue({hookEvent, time, lineDefined, funcName, shortSrc});
+
+    // interning existing names is lock free, so worker thread gets indexes instead of strings
+    FProfileNameSet* nameSet = FProfileNameSet::GlobalProfileNameSet;
+    uint32 funcNameIndex = nameSet->GetOrCreateIndex(funcName);
+    uint32 shortSrcIndex = nameSet->GetOrCreateIndex(shortSrc);
+    cpuCommandQueue.Enqueue({hookEvent, time, lineDefined, funcNameIndex, shortSrcIndex});
     commandTypeQueue.Enqueue(FCommandType::ECPU);
 }
 
@@ -328,7 +397,7 @@ void FProfileDataProcessRunnable::ClearData()
 
 void FProfileDataProcessRunnable::StartRecord()
 {
-    if (bIsRecording || frameArchive)
+    if (bIsRecording || frameArchive || captureWriter)
     {
         return;
     }
@@ -340,6 +409,22 @@ void FProfileDataProcessRunnable::StartRecord()
     lastLuaMemNode.Reset();
     memoryQueue.Empty();
     funcProfilerNodeQueue.Empty();
+    frameTimeQueue.Empty();
+
+    if (ProfileColumnarCapture)
+    {
+        captureWriter = new FSluaProfileCaptureWriter();
+        FString capturePath = FPaths::ChangeExtension(GenerateStatFilePath(), TEXT("sluacap"));
+        if (!captureWriter->Open(capturePath))
+        {
+            delete captureWriter;
+            captureWriter = nullptr;
+            bIsRecording = false;
+            return;
+        }
+        bCanStartFrameRecord = true;
+        return;
+    }
     
     FString filePath = GenerateStatFilePath();
     frameArchive = IFileManager::Get().CreateFileWriter(*filePath);
@@ -395,38 +480,30 @@ void FProfileDataProcessRunnable::ProcessCPUCommand(const FCPUCommand& cpuComman
     auto hookEvent = cpuCommand.hookEvent;
     auto time = cpuCommand.time;
     auto lineDefined = cpuCommand.lineDefined;
-    auto& funcName = cpuCommand.funcName;
-    auto& shortSrc = cpuCommand.shortSrc;
+    FLuaFunctionDefine funcDefine = {cpuCommand.shortSrcIndex, cpuCommand.funcNameIndex, lineDefined};
 
+    // call and return of unknown functions are dropped by ReceiveProfileData
     if (hookEvent == NS_SLUA::ProfilerHookEvent::PHE_CALL)
     {
-        if (lineDefined == -1 && funcName.IsEmpty())
-        {
-            return;
-        }
-
-        SluaProfilerDataManager::WatchBegin(shortSrc, lineDefined, funcName, time, funcProfilerRoot, profilerStack);
+        SluaProfilerDataManager::WatchBegin(funcDefine, time, funcProfilerRoot, profilerStack);
     }
     else if (hookEvent == NS_SLUA::ProfilerHookEvent::PHE_RETURN)
     {
-        if (lineDefined == -1 && funcName.IsEmpty())
-        {
-            return;
-        }
-
-        SluaProfilerDataManager::WatchEnd(shortSrc, lineDefined, funcName, time, profilerStack);
+        SluaProfilerDataManager::WatchEnd(funcDefine, time, profilerStack);
     }
     else if (hookEvent == NS_SLUA::ProfilerHookEvent::PHE_TICK)
     {
         funcProfilerNodeQueue.Enqueue(funcProfilerRoot);
         memoryQueue.Enqueue(currentMemory);
+        frameTimeQueue.Enqueue(time);
 
         ClearCurProfiler();
     }
     else if (hookEvent == NS_SLUA::ProfilerHookEvent::PHE_ENTER_COROUTINE)
     {
         //UE_LOG(Slua, Log, TEXT("Profile CoBegin %s"), *functionName);
-        SluaProfilerDataManager::CoroutineBegin(lineDefined, funcName, time, funcProfilerRoot, profilerStack);
+        funcDefine.fileNameIndex = FProfileNameSet::GlobalProfileNameSet->GetOrCreateIndex("");
+        SluaProfilerDataManager::CoroutineBegin(funcDefine, time, funcProfilerRoot, profilerStack);
     }
     else if (hookEvent == NS_SLUA::ProfilerHookEvent::PHE_EXIT_COROUTINE)
     {
@@ -454,31 +531,18 @@ void FProfileDataProcessRunnable::SerializeFrameData(FArchive& ar, TArray<TShare
 {
     auto& profileNameSet = *FProfileNameSet::GlobalProfileNameSet;
     {
-        FScopeLock lock(&profileNameSet.mutex);
-        TMap<uint32, FString>& increaseString = profileNameSet.increaseString;
-        if (bFrameFirstRecord)
+        TMap<uint32, FString> increaseString;
+        if (ar.IsSaving())
         {
-            increaseString = profileNameSet.indexToString;
-            bFrameFirstRecord = false;
+            profileNameSet.TakeNewNames(increaseString, bFrameFirstRecord);
         }
+        bFrameFirstRecord = false;
         ar << increaseString;
         
         if (ar.IsLoading())
         {
-            auto& stringToIndex = profileNameSet.stringToIndex;
-            auto& indexToString = profileNameSet.indexToString;
-            auto& indexSet = profileNameSet.indexSet;
-            for (auto iter = increaseString.CreateConstIterator(); iter; ++iter)
-            {
-                uint32 key = iter.Key();
-                const FString& value = iter.Value();
-                stringToIndex.Emplace(value, key);
-                indexToString.Emplace(key, value);
-                indexSet.Add(key);
-            }
+            profileNameSet.AddNames(increaseString);
         }
-
-        increaseString.Empty();
     }
 
     int32 functionNodeNum = frameFuncRootArr.Num();
@@ -661,78 +725,100 @@ void FProfileDataProcessRunnable::LoadData(const FString& filePath, int& inCpuVi
     }
     if (RunnableStart)
     {
-        FArchive* ar = IFileManager::Get().CreateFileReader(*filePath);
+        inProfileData.Empty();
+        inLuaMemNodeList.Empty();
+        ReadStatFile(filePath, inCpuViewBeginIndex, inMemViewBeginIndex,
+            [&](TArray<TSharedPtr<FunctionProfileNode>>& frameRootArr, const TSharedPtr<FProflierMemNode>& memNode)
+            {
+                inProfileData.Add(MoveTemp(frameRootArr));
+                inLuaMemNodeList.Add(memNode);
+            });
+    }
+}
 
-        int32 version;
-        *ar << version;
-        if (version != ProfileVersion)
-        {
-            UE_LOG(Slua, Warning, TEXT("sluastat file version mismatch: %d, %d"), version, ProfileVersion);
-            return;
-        }
+bool FProfileDataProcessRunnable::LoadDataByFrame(const FString& filePath, FProfileFrameVisitor visitor)
+{
+    if (bIsRecording || !RunnableStart)
+    {
+        return false;
+    }
+    int cpuViewBeginIndex = 0;
+    int memViewBeginIndex = 0;
+    return ReadStatFile(filePath, cpuViewBeginIndex, memViewBeginIndex, visitor);
+}
 
-        *ar << inCpuViewBeginIndex << inMemViewBeginIndex;
+bool FProfileDataProcessRunnable::ReadStatFile(const FString& filePath, int& inCpuViewBeginIndex, int& inMemViewBeginIndex, FProfileFrameVisitor visitor)
+{
+    FArchive* ar = IFileManager::Get().CreateFileReader(*filePath);
+    if (!ar)
+    {
+        UE_LOG(Slua, Warning, TEXT("Can't open sluastat file %s"), *filePath);
+        return false;
+    }
 
-        inProfileData.Empty();
-        inLuaMemNodeList.Empty();
-        memoryFrameNum = -1;
+    int32 version;
+    *ar << version;
+    if (version != ProfileVersion)
+    {
+        UE_LOG(Slua, Warning, TEXT("sluastat file version mismatch: %d, %d"), version, ProfileVersion);
+        delete ar;
+        return false;
+    }
 
-        TArray<uint8> uncompressedBuffer;
-        FScopedSlowTask slowTask(ar->TotalSize());
-        slowTask.MakeDialogDelayed(1.0f);
-        int64 prePos = 0;
-        
-        while (!ar->AtEnd())
-        {
-            int32 uncompressedSize;
-            int32 compressedSize;
-            *ar << uncompressedSize;
-            *ar << compressedSize;
-            uncompressedBuffer.Reserve(uncompressedSize);
-            uncompressedBuffer.SetNum(uncompressedSize);
-
-            auto compressedBuffer = (uint8*)FMemory::Malloc(compressedSize);
-            ar->Serialize(compressedBuffer, compressedSize);
+    *ar << inCpuViewBeginIndex << inMemViewBeginIndex;
+
+    memoryFrameNum = -1;
+
+    TArray<uint8> uncompressedBuffer;
+    FScopedSlowTask slowTask(ar->TotalSize());
+    slowTask.MakeDialogDelayed(1.0f);
+    int64 prePos = 0;
+    
+    while (!ar->AtEnd())
+    {
+        int32 uncompressedSize;
+        int32 compressedSize;
+        *ar << uncompressedSize;
+        *ar << compressedSize;
+        uncompressedBuffer.Reserve(uncompressedSize);
+        uncompressedBuffer.SetNum(uncompressedSize);
+
+        auto compressedBuffer = (uint8*)FMemory::Malloc(compressedSize);
+        ar->Serialize(compressedBuffer, compressedSize);
 #if (ENGINE_MINOR_VERSION<=21) && (ENGINE_MAJOR_VERSION==4)
-            FCompression::UncompressMemory(COMPRESS_ZLIB, uncompressedBuffer.GetData(), uncompressedSize, compressedBuffer, compressedSize);
+        FCompression::UncompressMemory(COMPRESS_ZLIB, uncompressedBuffer.GetData(), uncompressedSize, compressedBuffer, compressedSize);
 #elif (ENGINE_MINOR_VERSION<=26) && (ENGINE_MAJOR_VERSION==4)
-            FCompression::UncompressMemory(NAME_Zlib, uncompressedBuffer.GetData(), uncompressedSize, compressedBuffer, compressedSize);
+        FCompression::UncompressMemory(NAME_Zlib, uncompressedBuffer.GetData(), uncompressedSize, compressedBuffer, compressedSize);
 #else
-            FCompression::UncompressMemory(NAME_Oodle, uncompressedBuffer.GetData(), uncompressedSize, compressedBuffer, compressedSize);
+        FCompression::UncompressMemory(NAME_Oodle, uncompressedBuffer.GetData(), uncompressedSize, compressedBuffer, compressedSize);
 #endif
-            FMemory::Free(compressedBuffer);
+        FMemory::Free(compressedBuffer);
 
-            FMemoryReader memoryReader(uncompressedBuffer);
-            SerializeLoad(memoryReader, inCpuViewBeginIndex, inMemViewBeginIndex, inProfileData, inLuaMemNodeList);
-            slowTask.EnterProgressFrame(ar->Tell() - prePos, FText::FromString(TEXT("Loading slua stat...")));
-            prePos = ar->Tell();
-        }
-        ar->Close();
-        delete ar;
+        FMemoryReader memoryReader(uncompressedBuffer);
+        SerializeLoad(memoryReader, visitor);
+        slowTask.EnterProgressFrame(ar->Tell() - prePos, FText::FromString(TEXT("Loading slua stat...")));
+        prePos = ar->Tell();
     }
+    ar->Close();
+    delete ar;
+    return true;
 }
 
-void FProfileDataProcessRunnable::SerializeLoad(FArchive& inAR, int& inCpuViewBeginIndex, int& inMemViewBeginIndex, ProfileNodeArrayArray& inProfileData, MemNodeInfoList& inLuaMemNodeList)
+void FProfileDataProcessRunnable::SerializeLoad(FArchive& inAR, FProfileFrameVisitor visitor)
 {
     uint8 saveMode;
     inAR << saveMode;
 
     if (saveMode == FSaveMode::Frame)
     {
-        TSharedPtr<FProflierMemNode> preNode;
         while (saveMode != FSaveMode::EndOfFrame && !inAR.AtEnd())
         {
             memoryFrameNum++;
             TArray<TSharedPtr<FunctionProfileNode>> arr;
             TSharedPtr<FProflierMemNode> node = MakeShareable(new FProflierMemNode());
-            if (inLuaMemNodeList.Num() > 0)
-            {
-                preNode = inLuaMemNodeList.Last();
-            }
-            SerializeFrameData(inAR, arr, node, preNode);
+            SerializeFrameData(inAR, arr, node, nullptr);
 
-            inProfileData.Add(MoveTemp(arr));
-            inLuaMemNodeList.Add(node);
+            visitor(arr, node);
             inAR << saveMode;
         }
     }
@@ -853,7 +939,7 @@ void FProfileDataProcessRunnable::CollectMemoryNode(TMap<int64, NS_SLUA::LuaMemI
 }
 
 //处理传过来的数据,Tick里调用
-void FProfileDataProcessRunnable::PreProcessData(TSharedPtr<FunctionProfileNode> funcInfoRoot, TMap<int64, NS_SLUA::LuaMemInfo>& memoryInfoMap, MemoryFramePtr memoryFrame)
+void FProfileDataProcessRunnable::PreProcessData(TSharedPtr<FunctionProfileNode> funcInfoRoot, TMap<int64, NS_SLUA::LuaMemInfo>& memoryInfoMap, MemoryFramePtr memoryFrame, int64 tickTime)
 {
     if (funcInfoRoot->childNode->Num() == 0)
     {
@@ -871,6 +957,12 @@ void FProfileDataProcessRunnable::PreProcessData(TSharedPtr<FunctionProfileNode>
             return lhs->costTime > rhs->costTime;
         });
 
+    if (captureWriter)
+    {
+        captureWriter->WriteFrame(tickTime, tempProfileRootArr, lastLuaMemNode.IsValid() ? lastLuaMemNode->totalSize : 0.0f);
+        return;
+    }
+
     uint8 saveMode = FSaveMode::Frame;
     FMemoryWriter memoryWriter(dataToCompress);
     memoryWriter.Seek(dataToCompress.Num());
@@ -0,0 +1,58 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "SluaAutomationTest.h"
+#include "LuaState.h"
+#include "LuaBlueprintLibrary.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSluaFunctionHandleTest, "Slua.Blueprint.LuaFunctionHandle", SLUA_AUTOMATION_TEST_FLAGS)
+
+bool FSluaFunctionHandleTest::RunTest(const FString& Parameters)
+{
+    const FString stateName = TEXT("SluaFunctionHandleTest");
+    TArray<FLuaBPVar> args = { ULuaBlueprintLibrary::CreateVarFromInt(1), ULuaBlueprintLibrary::CreateVarFromInt(2) };
+    FLuaFunctionHandle handle;
+    {
+        NS_SLUA::LuaState state(TCHAR_TO_UTF8(*stateName));
+        state.init();
+        state.doString("function SluaHandleAdd(a, b) return a + b end");
+
+        // named state is found without a game instance
+        handle = ULuaBlueprintLibrary::ResolveLuaFunction(nullptr, TEXT("SluaHandleAdd"), stateName);
+        TestTrue(TEXT("resolved handle is valid"), ULuaBlueprintLibrary::IsValidLuaHandle(handle));
+        TestEqual(TEXT("call handle"), ULuaBlueprintLibrary::CallLuaHandleReturnInt(handle, args), 3);
+        FLuaBPVar ret = ULuaBlueprintLibrary::CallLuaHandleReturnVar(handle, args);
+        TestEqual(TEXT("call handle again"), ULuaBlueprintLibrary::GetIntFromVar(ret, 1), 3);
+
+        // handle keeps function it resolved after global is released
+        state.doString("SluaHandleAdd = nil collectgarbage()");
+        TestTrue(TEXT("handle is valid after global released"), ULuaBlueprintLibrary::IsValidLuaHandle(handle));
+        TestEqual(TEXT("call handle after global released"), ULuaBlueprintLibrary::CallLuaHandleReturnInt(handle, args), 3);
+
+        // released function can't be resolved again
+        AddExpectedError(TEXT("Can't find lua member function named SluaHandleAdd"), EAutomationExpectedErrorFlags::Contains, 1);
+        FLuaFunctionHandle released = ULuaBlueprintLibrary::ResolveLuaFunction(nullptr, TEXT("SluaHandleAdd"), stateName);
+        TestFalse(TEXT("released function gives invalid handle"), ULuaBlueprintLibrary::IsValidLuaHandle(released));
+    }
+
+    // state is closed, calling handle only warns and returns default value
+    TestFalse(TEXT("handle is invalid after state closed"), ULuaBlueprintLibrary::IsValidLuaHandle(handle));
+    AddExpectedError(TEXT("invalid lua function handle"), EAutomationExpectedErrorFlags::Contains, 2);
+    TestEqual(TEXT("call handle after state closed"), ULuaBlueprintLibrary::CallLuaHandleReturnInt(handle, args), 0);
+    ULuaBlueprintLibrary::CallLuaHandle(handle, args);
+    return true;
+}
+
+#endif
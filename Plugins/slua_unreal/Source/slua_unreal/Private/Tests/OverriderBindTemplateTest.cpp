@@ -0,0 +1,121 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "SluaAutomationTest.h"
+#include "LuaState.h"
+#include "LuaOverrider.h"
+#include "LuaUEObject.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace {
+    const char* TemplateModuleName = "SluaBindTemplateTest";
+
+    TArray<uint8> LoadTemplateModule(const char* fn, FString& filepath)
+    {
+        static const char* Source =
+            "local M = {}\n"
+            "function M:ctor() self.count = 1 end\n"
+            "function M:Answer() return 42 end\n"
+            "return Class(nil, nil, M)\n";
+
+        TArray<uint8> content;
+        if (FCStringAnsi::Strcmp(fn, TemplateModuleName) == 0)
+        {
+            filepath = TEXT("SluaBindTemplateTest.lua");
+            content.Append((const uint8*)Source, FCStringAnsi::Strlen(Source));
+        }
+        return content;
+    }
+
+    // bind obj in state and keep its self table as global name
+    bool BindAs(FAutomationTestBase& test, NS_SLUA::LuaState& state, UObject* obj, const char* name)
+    {
+        NS_SLUA::LuaState::hookObject(&state, obj, true);
+        NS_SLUA::lua_State* L = state.getLuaState();
+        NS_SLUA::LuaVar* selfTable = ULuaOverrider::getObjectLuaTable(obj, L);
+        if (!selfTable)
+        {
+            test.AddError(FString::Printf(TEXT("%s isn't bound in state %d"), *obj->GetName(), state.stateIndex()));
+            return false;
+        }
+        selfTable->push(L);
+        NS_SLUA::lua_setglobal(L, name);
+        return true;
+    }
+
+    void Check(FAutomationTestBase& test, NS_SLUA::LuaState& state, const FString& what, const char* code)
+    {
+        NS_SLUA::LuaVar result = state.doString(code);
+        test.TestTrue(FString::Printf(TEXT("%s in state %d"), *what, state.stateIndex()), result.isBool() && result.asBool());
+    }
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSluaOverriderBindTemplateTest, "Slua.Overrider.BindTemplate", SLUA_AUTOMATION_TEST_FLAGS)
+
+bool FSluaOverriderBindTemplateTest::RunTest(const FString& Parameters)
+{
+    using namespace SluaTest;
+
+    UClass* cls = NewTransientClass(ULuaObject::StaticClass(), TEXT("SluaBindTemplateTestClass"));
+    SetLuaFilePath(cls, UTF8_TO_TCHAR(TemplateModuleName));
+    {
+        // every state has its own templates, objects are bound in both
+        NS_SLUA::LuaState stateA("SluaBindTemplateTestA");
+        NS_SLUA::LuaState stateB("SluaBindTemplateTestB");
+        NS_SLUA::LuaState* states[] = { &stateA, &stateB };
+        for (NS_SLUA::LuaState* state : states)
+        {
+            state->setLoadFileDelegate(LoadTemplateModule);
+            state->init();
+        }
+
+        UObject* first = NewObject<UObject>(GetTransientPackage(), cls);
+        UObject* second = NewObject<UObject>(GetTransientPackage(), cls);
+        for (NS_SLUA::LuaState* state : states)
+        {
+            if (!BindAs(*this, *state, first, "first") || !BindAs(*this, *state, second, "second"))
+            {
+                return false;
+            }
+
+            // objects of a template share wrapper metatable, which reaches class of module and keeps fields of ctor
+            Check(*this, *state, TEXT("shared wrapper"), "return getmetatable(first) == getmetatable(second)");
+            Check(*this, *state, TEXT("wrapper isn't instance metatable"),
+                "return getmetatable(first) ~= getmetatable(require('SluaBindTemplateTest')())");
+            Check(*this, *state, TEXT("class method"), "return first:Answer() == 42 and second:Answer() == 42");
+            Check(*this, *state, TEXT("ctor field"), "return rawget(first, 'count') == 1 and rawget(second, 'count') == 1");
+            Check(*this, *state, TEXT("own self table"), "second.count = 2 return first.count == 1 and first ~= second");
+        }
+
+        // module reloaded in A gets a new template there, template of B isn't affected
+        stateA.doString("package.loaded.SluaBindTemplateTest = nil");
+        UObject* third = NewObject<UObject>(GetTransientPackage(), cls);
+        for (NS_SLUA::LuaState* state : states)
+        {
+            if (!BindAs(*this, *state, third, "third"))
+            {
+                return false;
+            }
+            Check(*this, *state, TEXT("reloaded object method"), "return third:Answer() == 42 and rawget(third, 'count') == 1");
+        }
+        Check(*this, stateA, TEXT("new wrapper after reload"), "return getmetatable(third) ~= getmetatable(first)");
+        Check(*this, stateA, TEXT("reloaded module is required again"), "return package.loaded.SluaBindTemplateTest ~= nil");
+        Check(*this, stateB, TEXT("wrapper kept without reload"), "return getmetatable(third) == getmetatable(first)");
+    }
+
+    DeleteClasses({ cls });
+    return true;
+}
+
+#endif
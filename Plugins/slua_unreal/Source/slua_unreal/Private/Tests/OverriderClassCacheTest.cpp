@@ -0,0 +1,83 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "SluaAutomationTest.h"
+#include "LuaState.h"
+#include "LuaOverrider.h"
+#include "LuaUEObject.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSluaOverriderClassCacheTest, "Slua.Overrider.ClassCacheReuse", SLUA_AUTOMATION_TEST_FLAGS)
+
+bool FSluaOverriderClassCacheTest::RunTest(const FString& Parameters)
+{
+    using NS_SLUA::LuaOverrider;
+    using namespace SluaTest;
+
+    // overrider of this state listens for deleted classes
+    NS_SLUA::LuaState state("SluaOverriderClassCacheTest");
+    state.init();
+
+    // hookable class whose decision and lua path are cached
+    UClass* hooked = NewTransientClass(ULuaObject::StaticClass(), TEXT("SluaCacheTestHooked"));
+    SetLuaFilePath(hooked, TEXT("SluaCacheTestHooked"));
+    bool bHookInstancedObj = false;
+    TestTrue(TEXT("lua object class is hookable"), LuaOverrider::isHookable(hooked->GetDefaultObject()));
+    TestEqual(TEXT("lua path of CDO"), LuaOverrider::getLuaFilePath(hooked->GetDefaultObject(), hooked, true, bHookInstancedObj),
+        FString(TEXT("SluaCacheTestHooked")));
+
+    const void* deletedAddress = hooked;
+    int32 deletedIndex = hooked->GetUniqueID();
+    DeleteClasses({ hooked });
+    hooked = nullptr;
+
+    // memory and index of a deleted object are usually given to next object of same size,
+    // create plain classes until one takes the place of deleted class
+    TArray<UClass*> candidates;
+    UClass* reused = nullptr;
+    for (int32 i = 0; i < 64 && !reused; i++)
+    {
+        UClass* cls = NewTransientClass(UObject::StaticClass(), TEXT("SluaCacheTestPlain"));
+        cls->GetDefaultObject();
+        candidates.Add(cls);
+        if ((const void*)cls == deletedAddress || cls->GetUniqueID() == deletedIndex)
+        {
+            reused = cls;
+        }
+    }
+
+    if (reused)
+    {
+        AddInfo(FString::Printf(TEXT("new class reuses %s of deleted class"),
+            (const void*)reused == deletedAddress ? TEXT("address") : TEXT("object index")));
+    }
+    else
+    {
+        AddInfo(TEXT("no new class reused place of deleted class, checking all candidates"));
+    }
+
+    // none of the new classes gets the decision or lua path of the deleted one
+    for (UClass* cls : candidates)
+    {
+        UObject* defaultObject = cls->GetDefaultObject();
+        TestFalse(FString::Printf(TEXT("%s is not hookable"), *cls->GetName()), LuaOverrider::isHookable(defaultObject));
+        TestEqual(FString::Printf(TEXT("%s has no lua path"), *cls->GetName()),
+            LuaOverrider::getLuaFilePath(defaultObject, cls, true, bHookInstancedObj), FString());
+    }
+
+    DeleteClasses(candidates);
+    return true;
+}
+
+#endif
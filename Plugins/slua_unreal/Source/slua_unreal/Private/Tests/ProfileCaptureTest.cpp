@@ -0,0 +1,277 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "SluaAutomationTest.h"
+#include "SluaProfileCapture.h"
+#include "SluaProfileExporter.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace {
+    // profiler normally creates global name set on module startup, tests create it if profiler isn't started
+    struct FScopedGlobalNameSet
+    {
+        FScopedGlobalNameSet()
+            : created(nullptr)
+        {
+            if (!FProfileNameSet::GlobalProfileNameSet)
+            {
+                created = new FProfileNameSet();
+                FProfileNameSet::GlobalProfileNameSet = created;
+            }
+        }
+
+        ~FScopedGlobalNameSet()
+        {
+            if (created)
+            {
+                FProfileNameSet::GlobalProfileNameSet = nullptr;
+                delete created;
+            }
+        }
+
+        FProfileNameSet* created;
+    };
+
+    TSharedPtr<FunctionProfileNode> MakeNode(const FLuaFunctionDefine& functionDefine, int64 costTime, int32 calls,
+        const TSharedPtr<FunctionProfileNode>& child = nullptr)
+    {
+        TSharedPtr<FunctionProfileNode> node = MakeShareable(new FunctionProfileNode());
+        node->functionDefine = functionDefine;
+        node->costTime = costTime;
+        node->countOfCalls = calls;
+        if (child.IsValid())
+        {
+            node->childNode->Add(child->functionDefine, child);
+        }
+        return node;
+    }
+
+    // two frames of call trees in ns, names need escaping in both export formats:
+    //     frame 0: A(100us) -> B(60us, 2 calls) -> A(30us) -> C;x(10us), "D"(20us)
+    //     frame 1: A(50us) -> C;x(20us)
+    struct FSyntheticFrames
+    {
+        FSyntheticFrames()
+        {
+            FLuaFunctionDefine a = FLuaFunctionDefine::MakeLuaFunctionDefine(TEXT("a.lua"), TEXT("A"), 1);
+            FLuaFunctionDefine b = FLuaFunctionDefine::MakeLuaFunctionDefine(TEXT("b.lua"), TEXT("B"), 2);
+            FLuaFunctionDefine c = FLuaFunctionDefine::MakeLuaFunctionDefine(TEXT("c.lua"), TEXT("C;x"), 3);
+            FLuaFunctionDefine d = FLuaFunctionDefine::MakeLuaFunctionDefine(TEXT("d.lua"), TEXT("\"D\""), 4);
+
+            frames.SetNum(2);
+            frames[0].Add(MakeNode(a, 100000, 1, MakeNode(b, 60000, 2, MakeNode(a, 30000, 1, MakeNode(c, 10000, 1)))));
+            frames[0].Add(MakeNode(d, 20000, 1));
+            frames[1].Add(MakeNode(a, 50000, 1, MakeNode(c, 20000, 1)));
+            memoryKB = {1024.0f, 2048.5f};
+        }
+
+        ProfileNodeArrayArray frames;
+        TArray<float> memoryKB;
+    };
+
+    // frames are laid out one after another, callees of a node start at its start
+    const TCHAR* ChromeGolden =
+        TEXT("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n")
+        TEXT("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"Lua\"}},\n")
+        TEXT("{\"name\":\"Frame 0\",\"cat\":\"frame\",\"ph\":\"X\",\"ts\":0.000,\"dur\":120.000,\"pid\":1,\"tid\":1},\n")
+        TEXT("{\"name\":\"Lua Memory\",\"ph\":\"C\",\"ts\":0.000,\"pid\":1,\"args\":{\"KB\":1024.0}},\n")
+        TEXT("{\"name\":\"a.lua:1 A\",\"cat\":\"lua\",\"ph\":\"X\",\"ts\":0.000,\"dur\":100.000,\"pid\":1,\"tid\":1,\"args\":{\"calls\":1}},\n")
+        TEXT("{\"name\":\"b.lua:2 B\",\"cat\":\"lua\",\"ph\":\"X\",\"ts\":0.000,\"dur\":60.000,\"pid\":1,\"tid\":1,\"args\":{\"calls\":2}},\n")
+        TEXT("{\"name\":\"a.lua:1 A\",\"cat\":\"lua\",\"ph\":\"X\",\"ts\":0.000,\"dur\":30.000,\"pid\":1,\"tid\":1,\"args\":{\"calls\":1}},\n")
+        TEXT("{\"name\":\"c.lua:3 C;x\",\"cat\":\"lua\",\"ph\":\"X\",\"ts\":0.000,\"dur\":10.000,\"pid\":1,\"tid\":1,\"args\":{\"calls\":1}},\n")
+        TEXT("{\"name\":\"d.lua:4 \\\"D\\\"\",\"cat\":\"lua\",\"ph\":\"X\",\"ts\":100.000,\"dur\":20.000,\"pid\":1,\"tid\":1,\"args\":{\"calls\":1}},\n")
+        TEXT("{\"name\":\"Frame 1\",\"cat\":\"frame\",\"ph\":\"X\",\"ts\":120.000,\"dur\":50.000,\"pid\":1,\"tid\":1},\n")
+        TEXT("{\"name\":\"Lua Memory\",\"ph\":\"C\",\"ts\":120.000,\"pid\":1,\"args\":{\"KB\":2048.5}},\n")
+        TEXT("{\"name\":\"a.lua:1 A\",\"cat\":\"lua\",\"ph\":\"X\",\"ts\":120.000,\"dur\":50.000,\"pid\":1,\"tid\":1,\"args\":{\"calls\":1}},\n")
+        TEXT("{\"name\":\"c.lua:3 C;x\",\"cat\":\"lua\",\"ph\":\"X\",\"ts\":120.000,\"dur\":20.000,\"pid\":1,\"tid\":1,\"args\":{\"calls\":1}}\n")
+        TEXT("]}\n");
+
+    // stacks in order they first appear, self time in us merged over frames
+    const TCHAR* FoldedGolden =
+        TEXT("a.lua:1 A 70\n")
+        TEXT("a.lua:1 A;b.lua:2 B 30\n")
+        TEXT("a.lua:1 A;b.lua:2 B;a.lua:1 A 20\n")
+        TEXT("a.lua:1 A;b.lua:2 B;a.lua:1 A;c.lua:3 C:x 10\n")
+        TEXT("d.lua:4 \"D\" 20\n")
+        TEXT("a.lua:1 A;c.lua:3 C:x 20\n");
+
+    FString TestPath(const TCHAR* fileName)
+    {
+        return FPaths::Combine(FPaths::AutomationTransientDir(), TEXT("Slua"), fileName);
+    }
+
+    bool WriteCapture(const FSyntheticFrames& synthetic, const FString& path)
+    {
+        FSluaProfileCaptureWriter writer;
+        if (!writer.Open(path))
+        {
+            return false;
+        }
+        for (int32 i = 0; i < synthetic.frames.Num(); i++)
+        {
+            writer.WriteFrame(0, synthetic.frames[i], synthetic.memoryKB[i]);
+        }
+        writer.Close();
+        return true;
+    }
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSluaProfileCaptureRoundTripTest, "Slua.Profiler.CaptureRoundTrip", SLUA_AUTOMATION_TEST_FLAGS)
+
+bool FSluaProfileCaptureRoundTripTest::RunTest(const FString& Parameters)
+{
+    FScopedGlobalNameSet nameSet;
+    FSyntheticFrames synthetic;
+    FString path = TestPath(TEXT("RoundTrip.sluacap"));
+    if (!TestTrue(TEXT("write capture"), WriteCapture(synthetic, path)))
+    {
+        return false;
+    }
+
+    TUniquePtr<FSluaProfileCapture> capture(FSluaProfileCapture::Open(path));
+    if (!TestTrue(TEXT("open capture"), capture.IsValid()))
+    {
+        return false;
+    }
+    TestEqual(TEXT("frames"), capture->NumFrames(), 2);
+    TestEqual(TEXT("functions"), capture->NumFunctions(), 4);
+
+    // functions are interned in preorder of first frame
+    TArray<FString> fullNames = {TEXT("a.lua:1 A"), TEXT("b.lua:2 B"), TEXT("c.lua:3 C;x"), TEXT("d.lua:4 \"D\"")};
+    for (int32 i = 0; i < fullNames.Num(); i++)
+    {
+        TestEqual(TEXT("function name"), capture->GetFullName(i), fullNames[i]);
+    }
+    TestEqual(TEXT("file name"), capture->GetFileName(1), FString(TEXT("b.lua")));
+    TestEqual(TEXT("line defined"), capture->GetLineDefined(2), 3);
+
+    FSluaProfileCapture::FFrame frame;
+    if (!TestTrue(TEXT("frame 0"), capture->GetFrame(0, frame)))
+    {
+        return false;
+    }
+    const int64 costTime[] = {100000, 60000, 30000, 10000, 20000};
+    const int32 calls[] = {1, 2, 1, 1, 1};
+    const int32 parent[] = {-1, 0, 1, 2, -1};
+    const uint32 function[] = {0, 1, 0, 2, 3};
+    TestEqual(TEXT("frame 0 nodes"), frame.numNodes, 5);
+    TestEqual(TEXT("frame 0 memory"), frame.memoryKB, 1024.0f);
+    for (int32 i = 0; i < FMath::Min(frame.numNodes, 5); i++)
+    {
+        TestEqual(TEXT("cost time"), frame.costTime[i], costTime[i]);
+        TestEqual(TEXT("calls"), frame.calls[i], calls[i]);
+        TestEqual(TEXT("parent"), frame.parent[i], parent[i]);
+        TestEqual(TEXT("function"), frame.function[i], function[i]);
+    }
+    TestFalse(TEXT("frame out of range"), capture->GetFrame(2, frame));
+
+    // recursive A is counted once in inclusive time, its exclusive time excludes every callee
+    TArray<FSluaProfileFunctionStat> stats;
+    capture->Aggregate(0, capture->NumFrames(), stats);
+    if (!TestEqual(TEXT("stats"), stats.Num(), 4))
+    {
+        return false;
+    }
+    const int64 inclusiveTime[] = {150000, 60000, 30000, 20000};
+    const int64 exclusiveTime[] = {90000, 30000, 30000, 20000};
+    const int64 totalCalls[] = {3, 2, 2, 1};
+    const int32 frames[] = {2, 1, 2, 1};
+    for (int32 i = 0; i < 4; i++)
+    {
+        TestEqual(FString::Printf(TEXT("inclusive time of %s"), *fullNames[i]), stats[i].inclusiveTime, inclusiveTime[i]);
+        TestEqual(FString::Printf(TEXT("exclusive time of %s"), *fullNames[i]), stats[i].exclusiveTime, exclusiveTime[i]);
+        TestEqual(FString::Printf(TEXT("calls of %s"), *fullNames[i]), stats[i].calls, totalCalls[i]);
+        TestEqual(FString::Printf(TEXT("frames of %s"), *fullNames[i]), stats[i].frames, frames[i]);
+    }
+
+    // only second frame
+    capture->Aggregate(1, 1, stats);
+    TestEqual(TEXT("inclusive time of A in frame 1"), stats[0].inclusiveTime, (int64)50000);
+    TestEqual(TEXT("calls of B in frame 1"), stats[1].calls, (int64)0);
+    capture.Reset();
+
+    // capture cut anywhere misses its trailer and can't be opened
+    TArray<uint8> bytes;
+    if (!TestTrue(TEXT("read capture"), FFileHelper::LoadFileToArray(bytes, *path)))
+    {
+        return false;
+    }
+    AddExpectedError(TEXT("Profile capture"), EAutomationExpectedErrorFlags::Contains, 0);
+    FString truncatedPath = TestPath(TEXT("Truncated.sluacap"));
+    for (int32 cut : {4, bytes.Num() / 2, bytes.Num() - 8})
+    {
+        FFileHelper::SaveArrayToFile(TArrayView<const uint8>(bytes.GetData(), bytes.Num() - cut), *truncatedPath);
+        TUniquePtr<FSluaProfileCapture> truncated(FSluaProfileCapture::Open(truncatedPath));
+        TestFalse(FString::Printf(TEXT("open capture without last %d bytes"), cut), truncated.IsValid());
+    }
+
+    IFileManager::Get().Delete(*path);
+    IFileManager::Get().Delete(*truncatedPath);
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSluaProfileExportGoldenTest, "Slua.Profiler.ExportGolden", SLUA_AUTOMATION_TEST_FLAGS)
+
+bool FSluaProfileExportGoldenTest::RunTest(const FString& Parameters)
+{
+    FScopedGlobalNameSet nameSet;
+    FSyntheticFrames synthetic;
+    FString capturePath = TestPath(TEXT("Export.sluacap"));
+    if (!TestTrue(TEXT("write capture"), WriteCapture(synthetic, capturePath)))
+    {
+        return false;
+    }
+
+    struct FCase
+    {
+        FSluaProfileExporter::EFormat format;
+        const TCHAR* golden;
+    };
+    const FCase cases[] = {
+        {FSluaProfileExporter::EFormat::ChromeTrace, ChromeGolden},
+        {FSluaProfileExporter::EFormat::FoldedStack, FoldedGolden},
+    };
+
+    FString outPath = TestPath(TEXT("Export.out"));
+    for (const FCase& exportCase : cases)
+    {
+        const TCHAR* formatName = exportCase.format == FSluaProfileExporter::EFormat::ChromeTrace ? TEXT("chrome") : TEXT("folded");
+        FString output;
+
+        // frames read back from capture
+        TestTrue(TEXT("export capture"), FSluaProfileExporter::ExportFile(capturePath, outPath, exportCase.format));
+        FFileHelper::LoadFileToString(output, *outPath);
+        TestEqual(FString::Printf(TEXT("%s export of capture"), formatName), output, FString(exportCase.golden));
+
+        // call trees in memory
+        FSluaProfileExporter exporter(exportCase.format);
+        TestTrue(TEXT("open exporter"), exporter.Open(outPath));
+        for (int32 i = 0; i < synthetic.frames.Num(); i++)
+        {
+            exporter.AddFrame(synthetic.frames[i], synthetic.memoryKB[i]);
+        }
+        exporter.Close();
+        FFileHelper::LoadFileToString(output, *outPath);
+        TestEqual(FString::Printf(TEXT("%s export of call trees"), formatName), output, FString(exportCase.golden));
+    }
+
+    IFileManager::Get().Delete(*capturePath);
+    IFileManager::Get().Delete(*outPath);
+    return true;
+}
+
+#endif
@@ -0,0 +1,120 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "SluaAutomationTest.h"
+#include "ProfileDataDefine.h"
+#include "Async/ParallelFor.h"
+#include "Serialization/BufferArchive.h"
+#include "Serialization/MemoryReader.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSluaProfileNameSetTest, "Slua.Profiler.ProfileNameSet", SLUA_AUTOMATION_TEST_FLAGS)
+
+bool FSluaProfileNameSetTest::RunTest(const FString& Parameters)
+{
+    // far more names than initial table, so tables grow while other threads look up
+    const int32 NumNames = 20000;
+    const int32 NumThreads = 8;
+    TArray<FString> names;
+    for (int32 i = 0; i < NumNames; i++)
+    {
+        names.Add(FString::Printf(TEXT("Script/Module%d.lua:Function%d"), i % 97, i));
+    }
+
+    FProfileNameSet nameSet;
+    TArray<TArray<uint32>> threadIndexes;
+    threadIndexes.SetNum(NumThreads);
+    std::atomic<int32> lookupErrors(0);
+    ParallelFor(NumThreads, [&](int32 thread)
+    {
+        TArray<uint32>& indexes = threadIndexes[thread];
+        indexes.SetNumZeroed(NumNames);
+        // every thread interns all names in its own order and reads back names created by others
+        for (int32 n = 0; n < NumNames; n++)
+        {
+            int32 i = (n * (thread * 2 + 1) + thread * 977) % NumNames;
+            indexes[i] = nameSet.GetOrCreateIndex(names[i]);
+            if (nameSet.GetStringByIndex(indexes[i]) != names[i] || nameSet.GetIndex(names[i]) != indexes[i])
+            {
+                lookupErrors++;
+            }
+        }
+    });
+    TestEqual(TEXT("lookup during concurrent interning"), lookupErrors.load(), 0);
+
+    TSet<uint32> uniqueIndexes;
+    for (int32 i = 0; i < NumNames; i++)
+    {
+        uint32 index = threadIndexes[0][i];
+        for (int32 thread = 1; thread < NumThreads; thread++)
+        {
+            if (threadIndexes[thread][i] != index)
+            {
+                AddError(FString::Printf(TEXT("%s interned as %u and %u"), *names[i], index, threadIndexes[thread][i]));
+                return false;
+            }
+        }
+        TestNotEqual(TEXT("valid index"), index, FProfileNameSet::InvalidIndex);
+        uniqueIndexes.Add(index);
+    }
+    TestEqual(TEXT("one index per name"), uniqueIndexes.Num(), NumNames);
+    TestEqual(TEXT("one entry per name"), nameSet.Num(), NumNames);
+
+    // names created are taken once
+    TMap<uint32, FString> newNames;
+    nameSet.TakeNewNames(newNames, false);
+    TestEqual(TEXT("new names"), newNames.Num(), NumNames);
+    TMap<uint32, FString> noNames;
+    nameSet.TakeNewNames(noNames, false);
+    TestEqual(TEXT("new names taken"), noNames.Num(), 0);
+
+    // names loaded keep their indexes, aren't new, and loading them again adds no entry
+    FProfileNameSet loaded;
+    loaded.AddNames(newNames);
+    loaded.AddNames(newNames);
+    TestEqual(TEXT("names loaded twice"), loaded.Num(), NumNames);
+    for (auto& pair : newNames)
+    {
+        if (loaded.GetIndex(pair.Value) != pair.Key || loaded.GetStringByIndex(pair.Key) != pair.Value)
+        {
+            AddError(FString::Printf(TEXT("%s isn't loaded at %u"), *pair.Value, pair.Key));
+            return false;
+        }
+    }
+    loaded.TakeNewNames(noNames, false);
+    TestEqual(TEXT("loaded names aren't new"), noNames.Num(), 0);
+
+    // name created after loading doesn't take a loaded index
+    uint32 extra = loaded.GetOrCreateIndex(TEXT("Script/Extra.lua:Extra"));
+    TestFalse(TEXT("new index after load"), newNames.Contains(extra));
+
+    // archive round trip
+    FBufferArchive writer;
+    writer << nameSet;
+    FProfileNameSet read;
+    FMemoryReader reader(writer);
+    reader << read;
+    TestEqual(TEXT("names read"), read.Num(), NumNames);
+    TestEqual(TEXT("name read"), read.GetStringByIndex(threadIndexes[0][123]), names[123]);
+
+    // loaded name of existing index replaces it
+    TMap<uint32, FString> renamed;
+    renamed.Add(threadIndexes[0][0], TEXT("Script/Renamed.lua:Renamed"));
+    read.AddNames(renamed);
+    TestEqual(TEXT("renamed"), read.GetStringByIndex(threadIndexes[0][0]), FString(TEXT("Script/Renamed.lua:Renamed")));
+    TestEqual(TEXT("renamed index"), read.GetIndex(TEXT("Script/Renamed.lua:Renamed")), threadIndexes[0][0]);
+    return true;
+}
+
+#endif
@@ -0,0 +1,67 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "SluaMicro.h"
+#include "UObject/Package.h"
+#include "UObject/UObjectGlobals.h"
+
+// flags of slua automation tests, run by "Automation RunTests Slua" in editor or game
+#if UE_5_5_OR_LATER
+#define SLUA_AUTOMATION_TEST_FLAGS (EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+#else
+#define SLUA_AUTOMATION_TEST_FLAGS (EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+#endif
+
+namespace SluaTest {
+    // class created at runtime, so it can be deleted by gc while a test runs
+    inline UClass* NewTransientClass(UClass* super, const TCHAR* name)
+    {
+        UPackage* package = GetTransientPackage();
+        UClass* cls = NewObject<UClass>(package, MakeUniqueObjectName(package, UClass::StaticClass(), FName(name)), RF_Transient);
+        cls->SetSuperStruct(super);
+        cls->ClassFlags |= super->ClassFlags & CLASS_Inherit;
+        cls->ClassCastFlags |= super->ClassCastFlags;
+        cls->Bind();
+        cls->StaticLink(true);
+        cls->AssembleReferenceTokenStream();
+        return cls;
+    }
+
+    // set lua path returned by CDO of a subclass of ULuaObject, before the path is cached
+    inline void SetLuaFilePath(UClass* cls, const FString& path)
+    {
+        NS_SLUA::FProperty* prop = cls->FindPropertyByName(TEXT("LuaFilePath"));
+        *prop->ContainerPtrToValuePtr<FString>(cls->GetDefaultObject()) = path;
+    }
+
+    // delete classes and their CDOs by gc, overriders are notified by delete listener
+    inline void DeleteClasses(const TArray<UClass*>& classes)
+    {
+        for (UClass* cls : classes)
+        {
+            UObject* defaultObject = cls->GetDefaultObject(false);
+#if ENGINE_MAJOR_VERSION==5
+            if (defaultObject) defaultObject->MarkAsGarbage();
+            cls->MarkAsGarbage();
+#else
+            if (defaultObject) defaultObject->MarkPendingKill();
+            cls->MarkPendingKill();
+#endif
+        }
+        CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+    }
+}
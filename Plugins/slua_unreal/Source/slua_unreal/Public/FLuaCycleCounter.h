@@ -27,6 +27,11 @@ public:
     static void counterStart(const FString& counterName, int Type = 0, int Level = 0);
     static void counterStop(int Type = 0, int Level = 0, const FString& CouterName = "");
     static void clearCounter();
+
+    // create stat id once for counter name, handle can be cached and reused by caller
+    static int32 getCounterHandle(const FString& counterName);
+    static void counterStartByHandle(int32 handle, int Type = 0, int Level = 0);
+    static void counterStopByHandle(int32 handle, int Type = 0, int Level = 0);
 private:
     static bool bOpenLog;
 };
@@ -41,6 +46,10 @@ public:
     static void counterStart(const FString& couterName, int Type = 0, int Level = 0);
     static void counterStop(int Type = 0, int Level = 0, const FString& CouterName = "");
     static void clearCounter();
+
+    static int32 getCounterHandle(const FString& counterName) { return INDEX_NONE; }
+    static void counterStartByHandle(int32 handle, int Type = 0, int Level = 0) {}
+    static void counterStopByHandle(int32 handle, int Type = 0, int Level = 0) {}
 private:
     FString functionName;
 };
@@ -97,6 +97,11 @@ namespace NS_SLUA {
         static int IterateLessGCReverse(lua_State* L);
         static int PushElementLessGC(lua_State* L, LuaArray* UD, int32 index);
         static int CreateValueTypeObject(lua_State* L);
+        static int ToTable(lua_State* L);
+        static int FromTable(lua_State* L);
+        static int GetRange(lua_State* L);
+        static int SetRange(lua_State* L);
+        static int Project(lua_State* L);
 
     private:
         FProperty* inner;
@@ -111,7 +116,7 @@ namespace NS_SLUA {
         uint8* getRawPtr(int index) const;
         bool isValidIndex(int index) const;
         uint8* insert(int index);
-        uint8* add();
+        uint8* add(int count = 1);
         void remove(int index);
         int num() const;
         void constructItems(int index,int count);
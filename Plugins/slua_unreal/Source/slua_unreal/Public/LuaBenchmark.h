@@ -0,0 +1,79 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "lua.h"
+
+namespace NS_SLUA {
+
+    class LuaState;
+
+    // run benchmark cases defined by a lua module and report ns per operation.
+    // the module returns an array of cases:
+    //     { name = "...", iterations = 100000, setup = function() return ctx end, run = function(ctx, n) end }
+    // setup is optional and may return nil, reason to skip the case, e.g. when a needed object isn't alive.
+    // run must do its operation n times with the same argument types every time, so every run measures one path.
+    // each case runs warmupRuns times untimed and then runs times timed, stats are over timed runs.
+    class SLUA_UNREAL_API LuaBenchmark
+    {
+    public:
+        struct Options
+        {
+            FString module;
+            int32 warmupRuns = 3;
+            int32 runs = 20;
+            // run cases whose name contains filter, all cases if empty
+            FString filter;
+        };
+
+        struct CaseResult
+        {
+            FString name;
+            // not empty if case is skipped or failed
+            FString skipReason;
+            int64 iterations = 0;
+            int32 runs = 0;
+            // ns per operation
+            double minNs = 0;
+            double medianNs = 0;
+            double p99Ns = 0;
+            double meanNs = 0;
+        };
+
+        // register slua.Benchmark, native helpers used by cases, not available in shipping
+        static void reg(lua_State* L);
+
+        // register slua.Benchmark, require module and run its cases, false if module doesn't return a case array
+        static bool run(LuaState* state, const Options& options, TArray<CaseResult>& outResults);
+
+        static void print(const TArray<CaseResult>& results);
+
+        // write results as json, one case each line so output can be diffed and read back as baseline
+        static bool writeJson(const FString& path, const Options& options, const TArray<CaseResult>& results);
+
+        // read median ns of cases from json written by writeJson
+        static bool readBaseline(const FString& path, TMap<FString, double>& outMedians);
+
+        // log cases whose median is slower than baseline by more than threshold, e.g. 0.1 for 10%,
+        // return number of regressed cases
+        static int32 compare(const TArray<CaseResult>& results, const TMap<FString, double>& baseline, double threshold);
+
+#if !UE_BUILD_SHIPPING
+    private:
+        static int PrepareReplication(lua_State* L);
+        static int ProcessEvent(lua_State* L);
+#endif
+    };
+}
@@ -31,6 +31,15 @@ public:
     static void* checkValue(NS_SLUA::lua_State* L, NS_SLUA::FStructProperty* p, uint8* params, int i);
 };
 
+// lua function resolved by name once, keep it in a blueprint variable and call it by CallLuaHandle nodes
+USTRUCT(BlueprintType)
+struct SLUA_UNREAL_API FLuaFunctionHandle {
+    GENERATED_USTRUCT_BODY()
+public:
+    // invalid after its state is closed
+    NS_SLUA::LuaVar func;
+};
+
 UCLASS()
 class SLUA_UNREAL_API ULuaBlueprintLibrary : public UBlueprintFunctionLibrary
 {
@@ -45,6 +54,34 @@ public:
     UFUNCTION(BlueprintCallable, meta=( DisplayName="Call To Lua", WorldContext = "WorldContextObject"), Category="slua")
     static FLuaBPVar CallToLua(UObject* WorldContextObject, FString FunctionName,FString StateName);
 
+    /** Find a lua function by name once, call it later without looking up state and function */
+    UFUNCTION(BlueprintCallable, meta=( WorldContext = "WorldContextObject"), Category="slua")
+    static FLuaFunctionHandle ResolveLuaFunction(UObject* WorldContextObject, FString FunctionName, FString StateName);
+
+    UFUNCTION(BlueprintPure, Category="slua")
+    static bool IsValidLuaHandle(const FLuaFunctionHandle& Handle);
+
+    UFUNCTION(BlueprintCallable, meta=( AutoCreateRefTerm="Args"), Category="slua")
+    static void CallLuaHandle(const FLuaFunctionHandle& Handle, const TArray<FLuaBPVar>& Args);
+
+    UFUNCTION(BlueprintCallable, meta=( AutoCreateRefTerm="Args"), Category="slua")
+    static FLuaBPVar CallLuaHandleReturnVar(const FLuaFunctionHandle& Handle, const TArray<FLuaBPVar>& Args);
+
+    UFUNCTION(BlueprintCallable, meta=( AutoCreateRefTerm="Args"), Category="slua")
+    static int CallLuaHandleReturnInt(const FLuaFunctionHandle& Handle, const TArray<FLuaBPVar>& Args);
+
+    UFUNCTION(BlueprintCallable, meta=( AutoCreateRefTerm="Args"), Category="slua")
+    static float CallLuaHandleReturnNumber(const FLuaFunctionHandle& Handle, const TArray<FLuaBPVar>& Args);
+
+    UFUNCTION(BlueprintCallable, meta=( AutoCreateRefTerm="Args"), Category="slua")
+    static bool CallLuaHandleReturnBool(const FLuaFunctionHandle& Handle, const TArray<FLuaBPVar>& Args);
+
+    UFUNCTION(BlueprintCallable, meta=( AutoCreateRefTerm="Args"), Category="slua")
+    static FString CallLuaHandleReturnString(const FLuaFunctionHandle& Handle, const TArray<FLuaBPVar>& Args);
+
+    UFUNCTION(BlueprintCallable, meta=( AutoCreateRefTerm="Args"), Category="slua")
+    static UObject* CallLuaHandleReturnObject(const FLuaFunctionHandle& Handle, const TArray<FLuaBPVar>& Args);
+
     UFUNCTION(BlueprintCallable, Category="slua")
     static FLuaBPVar CreateVarFromInt(int Value);
 
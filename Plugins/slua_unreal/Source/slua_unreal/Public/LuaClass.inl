@@ -62,6 +62,13 @@ function Class(base, static, classImplement)
         end
     end
 
+    -- construct on table r given by caller, LuaOverrider passes a presized one
+    local function new(r, ...)
+        setmetatable(r, instance_metatable)
+        recursiveCtor(r, classImplement, ...)
+        return r
+    end
+
     setmetatable(class,
         {
             __index = class_index,
@@ -71,11 +78,10 @@ function Class(base, static, classImplement)
             end,
 
             __call = function(_, ...)
-                local r = {}
-                setmetatable(r, instance_metatable)
-                recursiveCtor(r, classImplement, ...)
-                return r
+                return new({}, ...)
             end,
+
+            __new = new,
         }
     )
     return class
@@ -0,0 +1,152 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "lua.h"
+#include "lauxlib.h"
+
+namespace NS_SLUA {
+
+    class LuaState;
+
+    // resume lua coroutines waiting for frames, seconds, delegates, async loading or latent actions.
+    // a wait is a waiter slot in a pooled array, its handle is slot index with a serial, so stale handles are ignored.
+    // timed waits are kept in intrusive min heaps, waiter knows its heap position and is removed in O(log n).
+    // threads of coroutines started by slua.Coroutine.Start are recycled when their function returns.
+    class SLUA_UNREAL_API LuaCoroutineScheduler
+    {
+    public:
+        explicit LuaCoroutineScheduler(LuaState* state);
+        ~LuaCoroutineScheduler();
+
+        // register slua.Coroutine
+        static void reg(lua_State* L);
+
+        // resume waiters of this frame, called by LuaState::Tick
+        void tick(float dtime);
+
+        // add a waiter resumed by resume(handle), used by latent UFunction and importAsync called from coroutine L,
+        // raise lua error if L is main thread
+        int32 waitHandle(lua_State* L);
+
+        // resume coroutine waiting on handle, nargs values on top of from are passed to coroutine
+        void resume(int32 handle, lua_State* from = nullptr, int nargs = 0);
+
+        // handle of a wait of thread, 0 if thread isn't waiting
+        int32 findHandle(lua_State* thread) const;
+
+        // remove waits of thread without resuming it, thread is released, false if it isn't waiting
+        bool cancel(lua_State* thread);
+
+        int32 numWaiting() const
+        {
+            return numWaiters;
+        }
+
+        int32 numPooledThreads() const
+        {
+            return pooledThreads.Num();
+        }
+
+    private:
+        enum class EWaitHeap : uint8
+        {
+            None,
+            Frame,
+            Time,
+        };
+
+        struct Waiter
+        {
+            lua_State* thread = nullptr;
+            // LUA_NOREF if thread belongs to pool, its ref is in runningThreads
+            int threadRef = LUA_NOREF;
+            EWaitHeap heap = EWaitHeap::None;
+            int32 heapIndex = INDEX_NONE;
+            // frame number or seconds
+            double wakeAt = 0;
+            // delegate bound by WaitDelegate, removed after it fires
+            int delegateRef = LUA_NOREF;
+            int64 delegateHandle = 0;
+            uint16 serial = 1;
+            int32 nextFree = INDEX_NONE;
+        };
+
+        // min heap of waiter indexes ordered by wakeAt
+        struct WaitHeap
+        {
+            TArray<int32> items;
+
+            void push(TArray<Waiter>& waiters, int32 index);
+            void remove(TArray<Waiter>& waiters, int32 index);
+            // pop waiters whose wakeAt <= now, their handles are added to out
+            void popDue(TArray<Waiter>& waiters, double now, TArray<int32>& out);
+
+        private:
+            void siftUp(TArray<Waiter>& waiters, int32 pos);
+            void siftDown(TArray<Waiter>& waiters, int32 pos);
+            void place(TArray<Waiter>& waiters, int32 pos, int32 index);
+        };
+
+        int32 addWaiter(lua_State* L);
+        void freeWaiter(int32 index);
+        Waiter* findWaiter(int32 handle, int32& outIndex);
+        WaitHeap& getHeap(EWaitHeap heap);
+
+        // run thread with nargs values on its stack, threadRef is LUA_NOREF for pooled thread,
+        // thread is released when it ends or yields without waiting on scheduler
+        void run(lua_State* thread, lua_State* from, int nargs, int threadRef);
+        void releasePooledThread(lua_State* thread, bool bRecycle);
+        void removeDelegates();
+
+        static LuaCoroutineScheduler* get(lua_State* L);
+        static int Start(lua_State* L);
+        static int Cancel(lua_State* L);
+        static int IsWaiting(lua_State* L);
+        static int WaitFrame(lua_State* L);
+        static int WaitSeconds(lua_State* L);
+        static int WaitDelegate(lua_State* L);
+        static int WaitAsyncLoad(lua_State* L);
+        static int onDelegateFired(lua_State* L);
+
+        LuaState* state;
+        lua_State* L;
+
+        TArray<Waiter> waiters;
+        int32 freeWaiterHead;
+        int32 numWaiters;
+        WaitHeap frameHeap;
+        WaitHeap timeHeap;
+        uint64 frame;
+        double time;
+        // reused by tick
+        TArray<int32> dueWaiters;
+
+        struct PooledThread
+        {
+            int ref;
+            // waits not resumed yet, thread yielded with no wait is released
+            int32 numWaits;
+            bool bRunning;
+        };
+        // pooled threads running or waiting
+        TMap<lua_State*, PooledThread> runningThreads;
+        // finished threads ready for reuse, with registry refs
+        TArray<TPair<lua_State*, int>> pooledThreads;
+
+        // delegate ref and binding handle removed on next tick
+        TArray<TPair<int, int64>> firedDelegates;
+    };
+}
@@ -61,6 +61,32 @@ protected:
 #endif
 };
 
+namespace NS_SLUA {
+    struct LuaDelegateSlot;
+}
+
+// target of a lua function bound by Add/Bind, proxies are pooled per lua state
+// and rebound after released instead of creating a new ULuaDelegate object every binding
+UCLASS()
+class SLUA_UNREAL_API ULuaDelegateProxy : public UObject {
+    GENERATED_UCLASS_BODY()
+public:
+    UFUNCTION()
+    void EventTrigger();
+
+    virtual void ProcessEvent( UFunction* Function, void* Parms ) override;
+
+    // release bindings and proxies of lua state before it closed
+    static void releaseState(NS_SLUA::lua_State* L);
+    // release bindings of delegates which are properties of deleted object
+    static void releaseParent(NS_SLUA::lua_State* L, const void* parent);
+    // number of bound and free proxies of lua state
+    static void getSlotStats(NS_SLUA::lua_State* L, int32& bound, int32& free);
+
+    // binding of this proxy, null after lua state closed
+    NS_SLUA::LuaDelegateSlot* slot;
+};
+
 namespace NS_SLUA {
 
     class SLUA_UNREAL_API LuaMultiDelegate {
@@ -151,8 +177,7 @@ namespace NS_SLUA {
             if (func.isValid() && func.isFunction())
             {
                 ud->delegate.BindLambda([=](ARGS ...args) {
-                    LuaVar result = func.call(std::forward<ARGS>(args) ...);
-                    return result.castTo<R>();
+                    return func.callTyped<R>(std::forward<ARGS>(args) ...);
                 });
             }
             return 0;
@@ -0,0 +1,148 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace NS_SLUA {
+
+    class LuaState;
+
+    // places where game thread enter lua
+    enum class ELuaEntryPoint : uint8
+    {
+        // tick function set by slua.setTickFunction
+        StateTick,
+        // LuaTick of actors registered by registLuaTick
+        ActorTick,
+        // UFunction overridden by lua
+        Override,
+        // delegate bound to lua function
+        Delegate,
+        // coroutine resumed by latent action or slua.Coroutine waits
+        Latent,
+        Num,
+    };
+
+    SLUA_UNREAL_API const TCHAR* getEntryPointName(ELuaEntryPoint entry);
+
+    struct LuaBudgetCounter
+    {
+        // exclusive cycles, lua entered again inside an entry point is counted by the inner one
+        uint64 cycles = 0;
+        int32 calls = 0;
+
+        double getMilliseconds() const;
+    };
+
+    struct LuaBudgetDetail
+    {
+        // path name of UFunction or UClass
+        FName name;
+        ELuaEntryPoint entry;
+        LuaBudgetCounter counter;
+    };
+
+    struct LuaFrameBudgetStats
+    {
+        uint64 frameNumber = 0;
+        // total is over slua.FrameBudgetWarnMs, set when frame is finished
+        bool bOverrun = false;
+        LuaBudgetCounter total;
+        LuaBudgetCounter entries[(int32)ELuaEntryPoint::Num];
+        // per class/function counters, only collected when slua.FrameBudget >= 2
+        TArray<LuaBudgetDetail> details;
+
+        void reset(uint64 inFrameNumber);
+    };
+
+    // per frame cost of lua on game thread, split by entry point, compiled out of shipping
+    class SLUA_UNREAL_API LuaFrameBudget
+    {
+    public:
+        LuaFrameBudget();
+
+        // 0 off, 1 entry point counters, 2 also per class/function counters, always 0 in shipping
+        static int32 getMode();
+
+        // count of finished frames over slua.FrameBudgetWarnMs
+        int32 getOverrunFrames() const
+        {
+            return overrunFrames;
+        }
+
+        // stats of last finished frame
+        const LuaFrameBudgetStats& getLastFrame();
+        // stats of current frame so far
+        const LuaFrameBudgetStats& getCurrentFrame();
+
+        void dump(FOutputDevice& Ar);
+        // UFunction/UClass may be freed by engine gc
+        void onEngineGC();
+
+    private:
+        friend class LuaFrameBudgetScope;
+
+        void advance(uint64 frameNumber);
+        void fillDetails(LuaFrameBudgetStats& stats) const;
+        void record(ELuaEntryPoint entry, const UObject* id, uint64 cycles);
+
+        struct DetailKey
+        {
+            FName name;
+            ELuaEntryPoint entry;
+
+            bool operator==(const DetailKey& other) const
+            {
+                return name == other.name && entry == other.entry;
+            }
+            friend uint32 GetTypeHash(const DetailKey& key)
+            {
+                return HashCombine(GetTypeHash(key.name), (uint32)key.entry);
+            }
+        };
+
+        LuaFrameBudgetStats current;
+        LuaFrameBudgetStats last;
+        TMap<DetailKey, LuaBudgetCounter> currentDetails;
+        // path name of id, cleared on engine gc
+        TMap<const UObject*, FName> idNames;
+        class LuaFrameBudgetScope* currentScope;
+        int32 overrunFrames;
+    };
+
+#if !UE_BUILD_SHIPPING
+    // measure one call into lua, put it on stack around the call
+    class SLUA_UNREAL_API LuaFrameBudgetScope
+    {
+    public:
+        LuaFrameBudgetScope(LuaState* state, ELuaEntryPoint inEntry, const UObject* inId = nullptr);
+        ~LuaFrameBudgetScope();
+
+    private:
+        LuaFrameBudget* budget;
+        LuaFrameBudgetScope* parent;
+        const UObject* id;
+        uint64 startCycles;
+        uint64 childCycles;
+        ELuaEntryPoint entry;
+    };
+#else
+    class LuaFrameBudgetScope
+    {
+    public:
+        LuaFrameBudgetScope(LuaState* state, ELuaEntryPoint inEntry, const UObject* inId = nullptr) {}
+    };
+#endif
+}
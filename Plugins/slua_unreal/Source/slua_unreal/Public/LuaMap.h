@@ -145,6 +145,8 @@ namespace NS_SLUA {
         static int GetKeys(lua_State* L);
         static int GetValues(lua_State* L);
         static int CreateValueTypeObject(lua_State* L);
+        static int ToTable(lua_State* L);
+        static int FromTable(lua_State* L);
 
     private:
         FScriptMap* map;
@@ -167,7 +169,7 @@ namespace NS_SLUA {
         void emptyValues(int32 Slack = 0);
         void destructItems(int32 Index, int32 Count);
         void destructItems(uint8* PairPtr, uint32 Stride, int32 Index, int32 Count, bool bDestroyKeys, bool bDestroyValues);
-        bool removePair(const void* KeyPtr);
+        bool removePair(const class LuaContainerKey& Key);
         void removeAt(int32 Index, int32 Count = 1);
 
         struct Enumerator {
@@ -39,15 +39,26 @@ namespace NS_SLUA {
 
     typedef TMap<void*, LuaMemInfo> MemoryDetail;
 
+    enum MemTrackMode {
+        MTM_NONE = 0,
+        // record stack of every allocation
+        MTM_FULL = 1,
+        // record stack about every sampleInterval bytes allocated
+        MTM_SAMPLED = 2,
+    };
+
     class SLUA_UNREAL_API LuaMemoryProfile { 
     public:
         static void* alloc (void *ud, void *ptr, size_t osize, size_t nsize);
         static size_t total();
 
-        static void start(lua_State* L);
+        // sampleInterval > 0 to track memory by sampling, size of sampled allocation will be scaled up
+        static void start(lua_State* L, int64 sampleInterval = 0);
         static void onStart(class LuaState* LS);
         static void stop(lua_State* L);
         static void tick(class LuaState* LS);
+        // free records and sampler of LS, called after lua state closed
+        static void clean(class LuaState* LS);
         static const MemoryDetail& memDetail(class LuaState* LS);
         static TArray<LuaMemInfo>& memIncreaceThisFrame(class LuaState* LS);
     };
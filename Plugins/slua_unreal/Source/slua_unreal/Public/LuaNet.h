@@ -42,6 +42,11 @@ namespace NS_SLUA
 
         static void onPropModify(lua_State* L, FLuaNetSerializationProxy* proxy, ReplicateIndexType index, PrepareParamCallback callback);
 
+        // compare lua replicated props of obj with last replicated values and serialize changes to data shared by connections,
+        // what replication does for obj once a frame before writing to each connection, false if nothing changed.
+        // replicationFrame must differ from last call, or obj is treated as compared already
+        static bool prepareReplication(UObject* obj, uint32 replicationFrame, class UPackageMap* map = nullptr);
+
     protected:
         friend class LuaOverrider;
         static const char* ADD_LISTENER_FUNC;
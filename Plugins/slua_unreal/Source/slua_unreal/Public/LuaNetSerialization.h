@@ -23,6 +23,8 @@
 
 namespace NS_SLUA
 {
+    class LuaNet;
+
     struct ClassLuaReplicated
     {
         static constexpr int32 MaxArrayLimit = 64;
@@ -197,6 +199,8 @@ struct SLUA_UNREAL_API FLuaNetSerialization
 {
     GENERATED_BODY()
 
+    friend class NS_SLUA::LuaNet;
+
 public:
     static int32 bEnableLuaNetReplicate;
 
@@ -217,6 +221,7 @@ protected:
     
     bool CompareProperties(UObject* obj, NS_SLUA::FLuaNetSerializationProxy& proxy, uint32 ReplicationFrame);
     bool UpdateChangeListMgr(NS_SLUA::FLuaNetSerializationProxy& proxy, uint32 ReplicationFrame);
+    bool PrepareReplication(NS_SLUA::FLuaNetSerializationProxy& proxy, class UPackageMap* map, uint32 ReplicationFrame);
     void BuildSharedSerialization(class UPackageMap* map, NS_SLUA::ClassLuaReplicated* classLuaReplicated,
         NS_SLUA::FLuaNetSerializationProxy* proxy, const LuaBitArray& changes,
                                      const TMap<int32, LuaBitArray>& arrayChanges);
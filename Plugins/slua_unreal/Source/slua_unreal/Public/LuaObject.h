@@ -154,6 +154,7 @@ namespace NS_SLUA {
     #define UD_VALUETYPE 1<<9 // flag it's a valuetype, don't cache value by ptr
     #define UD_NETTYPE 1<<10 // flag it's a net replicate property
     #define UD_CONST 1<<11 // flag it's a const struct
+    #define UD_INLINE 1<<12 // flag value is stored in userdata block, don't delete it
 
     struct UDBase {
         uint32 flag;
@@ -186,6 +187,17 @@ namespace NS_SLUA {
     DefTypeName(LuaMap);
     DefTypeName(LuaSet);
 
+    // small value types whose lua owned copy is stored in its userdata block, see LuaObject::pushInline
+    template<typename T>
+    struct LuaInlineValue : std::false_type {};
+    template<> struct LuaInlineValue<FVector> : std::true_type {};
+    template<> struct LuaInlineValue<FVector2D> : std::true_type {};
+    template<> struct LuaInlineValue<FRotator> : std::true_type {};
+    template<> struct LuaInlineValue<FQuat> : std::true_type {};
+    template<> struct LuaInlineValue<FLinearColor> : std::true_type {};
+    template<> struct LuaInlineValue<FIntPoint> : std::true_type {};
+    template<> struct LuaInlineValue<FTransform> : std::true_type {};
+
     template<typename T>
     struct LuaOwnedPtr {
         T* ptr;
@@ -420,6 +432,8 @@ namespace NS_SLUA {
         static ReferencePropertyFunction getReferencer(FFieldClass* cls);
         static ReferencePusherPropertyFunction getReferencePusher(FFieldClass* cls);
 
+        // push accessor table of cls, property accessors shared by all objects of cls
+        static int pushClassAccessors(lua_State* L, UStruct* cls);
         static int setUservalueMeta(lua_State* L, UStruct* cls);
         static int pushReferenceAndCache(const ReferencePusherPropertyFunction& pusher, lua_State* L, UStruct* cls,
                                         FProperty* prop, uint8* parms, void* parentAdrres, uint16 replicateIndex);
@@ -827,6 +841,10 @@ namespace NS_SLUA {
                 
                 return ret;
             }
+            // value newed and given to lua is moved into userdata block, only if its type is bound
+            if (flag == (UD_AUTOGC | UD_VALUETYPE) && !lua_isnil(L, -1) && pushOwnedInline(L, v)) {
+                return 1;
+            }
             NewUD(T, v, flag);
             lua_pushvalue(L, -2);
             lua_setmetatable(L, -2);
@@ -837,6 +855,57 @@ namespace NS_SLUA {
             return 1;
         }
 
+        // construct value type inside the userdata block, so no heap object to new and delete,
+        // userdata memory never moves, ud points to the value as usual
+        template<class T, class ...ARGS>
+        static T* pushInline(lua_State* L, const char* fn, ARGS&& ...args) {
+            luaL_getmetatable(L, fn);
+            if (lua_isnil(L, -1)) {
+                lua_pop(L, 1);
+                luaL_error(L, "can't push inline value of %s, type isn't bound", fn);
+                return nullptr;
+            }
+            return newInlineUD<T>(L, Forward<ARGS>(args)...);
+        }
+
+        template<class T>
+        static bool pushOwnedInline(lua_State* L, const T* v, typename std::enable_if<!LuaInlineValue<T>::value>::type* = nullptr) {
+            return false;
+        }
+
+        template<class T>
+        static bool pushOwnedInline(lua_State* L, const T* v, typename std::enable_if<LuaInlineValue<T>::value>::type* = nullptr) {
+            newInlineUD<T>(L, *v);
+            delete v;
+            return true;
+        }
+
+        // new userdata holding value, metatable of value type should be on top of stack and is replaced by userdata
+        template<class T, class ...ARGS>
+        static T* newInlineUD(lua_State* L, ARGS&& ...args) {
+            static_assert(std::is_trivially_destructible<T>::value, "inline value should be trivially destructible");
+            // lua only guarantees LUAI_MAXALIGN for userdata
+            const size_t headSize = sizeof(NetStructUserData<T*>);
+            const size_t size = headSize + sizeof(T) + alignof(T) - 1;
+#if LUA_VERSION_NUM > 503
+            auto ud = lua_newuserdatauv(L, size, 1);
+#else
+            auto ud = lua_newuserdata(L, size);
+#endif
+            if (!ud) luaL_error(L, "out of memory to new ud");
+            auto udptr = reinterpret_cast<NetStructUserData<T*>*>(ud);
+            T* v = new (Align((uint8*)ud + headSize, alignof(T))) T(Forward<ARGS>(args)...);
+            udptr->parent = nullptr;
+            udptr->ud = v;
+            udptr->flag = UD_AUTOGC | UD_VALUETYPE | UD_INLINE;
+            udptr->proxy = nullptr;
+            lua_pushvalue(L, -2);
+            lua_setmetatable(L, -2);
+            lua_remove(L, -2); // remove metatable of fn
+            addLink(L, v);
+            return v;
+        }
+
         static void addLink(lua_State* L, void* address);
         static void releaseLink(lua_State* L, void* address);
         static void linkProp(lua_State* L, void* parentAddress, void* prop);
@@ -102,6 +102,7 @@ namespace NS_SLUA
 #endif
         void NotifyUObjectDeleted(const UObjectBase* Object, int32 Index) override;
 
+        // decision is cached per class, reset when class is deleted
         static bool isHookable(const UObjectBaseUtility* obj);
         bool tryHook(const UObjectBaseUtility* obj, bool bHookImmediate = true, bool bPostLoad = false);
         static FString getLuaFilePath(UObject* obj, class UClass* cls, bool bCDOLua, bool& bHookInstancedObj);
@@ -115,6 +116,12 @@ namespace NS_SLUA
 #endif
         void removeOneOverride(UClass* cls, bool bObjectDeleted);
 
+        // require lua modules of classes and build their bind templates,
+        // call it while loading level to avoid hitch when objects of classes are spawned
+        void prewarmClasses(const TArray<UClass*>& classes);
+        // drop cached bind templates, a template is also dropped when its module is reloaded
+        void clearBindTemplates();
+
     protected:
         friend class LuaObject;
         friend class LuaNet;
@@ -127,8 +134,33 @@ namespace NS_SLUA
         void onAsyncLoadingFlushUpdate();
         void onEngineGC();
 
+        // resolved once for each lua file, objects after the first one are bound
+        // without require and without looking up constructor
+        struct BindTemplate
+        {
+            // key of module in package.loaded
+            SimpleString moduleName;
+            LuaVar module;
+            // __new of Class, or __call of other module table
+            LuaVar ctor;
+            // ctor takes a presized self table instead of module
+            bool bPresized = false;
+            // false if lua file returns a function, which is called for every object
+            bool bCacheable = true;
+            // metatable set by ctor, and the metatable replacing it in setmetatable
+            LuaVar instanceMeta;
+            LuaVar wrapperMeta;
+            // fields of the first self table
+            int32 numFields = 0;
+        };
+
         bool bindOverrideFuncs(const UObjectBase* objBase, UClass* cls);
-        void setmetatable(const LuaVar& luaSelfTable, void* objPtr, bool bNetReplicated);
+        // require lua file and find ctor, nullptr if lua file isn't a valid module
+        TSharedPtr<BindTemplate> resolveBindTemplate(const FString& luaFilePath, UObject* obj);
+        // false if module had been removed from package.loaded or replaced by reloading
+        bool isModuleLoaded(lua_State* L, const BindTemplate& bindTemplate);
+        LuaVar newSelfTable(lua_State* L, const BindTemplate& bindTemplate);
+        void setmetatable(const LuaVar& luaSelfTable, void* objPtr, bool bNetReplicated, BindTemplate* bindTemplate = nullptr);
 
         bool hookBpScript(UFunction* func, UClass* cls, FNativeFuncPtr hookFunc);
 
@@ -138,6 +170,19 @@ namespace NS_SLUA
         static TMap<TWeakObjectPtr<UClass>, UClass::ClassConstructorType> classConstructors;
         static TMap<UObject*, TArray<LuaOverrider*>> objectOverriders;
 
+        static bool isClassHookable(const UClass* cls);
+
+        struct ClassLuaFilePath
+        {
+            UFunction* func = nullptr;
+            // returned by CDO
+            FString path;
+        };
+        // guarded by classHookMutex, weak key never matches a new class reusing address of a deleted one
+        static TMap<TWeakObjectPtr<UClass>, ClassLuaFilePath> classLuaFilePaths;
+        // drop hook decisions and lua paths of classes deleted while no overrider listened
+        static void resetClassCaches();
+
         static int __index(lua_State* L);
         static int classIndex(lua_State* L);
         static int __newindex(lua_State* L);
@@ -168,6 +213,9 @@ namespace NS_SLUA
 #endif
         
         UFunction* animNotifyTemplate;
+
+        // shared because lua code run by binding can spawn objects and add templates
+        TMap<FString, TSharedPtr<BindTemplate>> bindTemplates;
         
     protected: // Input Overrides
         static const TCHAR* EInputEventNames[];
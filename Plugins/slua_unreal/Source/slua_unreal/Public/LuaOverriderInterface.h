@@ -132,27 +132,12 @@ private:
         }
 
         const NS_SLUA::LuaVar& Func = GetCachedLuaFunc(LS ? LS->getLuaState() : nullptr, selfTable, FunctionName);
-        if (!checkExist)
+        if (checkExist && !Func.isFunction())
         {
-            NS_SLUA::LuaVar ret = Func.call(selfTable, std::forward<ARGS>(Args)...);
-            if (ret.isValid())
-            {
-                return ret.castTo<RET>();
-            }
-        }
-        else
-        {
-            if (Func.isFunction())
-            {
-                NS_SLUA::LuaVar ret = Func.call(selfTable, std::forward<ARGS>(Args)...);
-                if (ret.isValid())
-                {
-                    return ret.castTo<RET>();
-                }
-            }
+            return RET();
         }
 
-        return RET();
+        return Func.callTyped<RET>(selfTable, std::forward<ARGS>(Args)...);
     }
 
 public:
@@ -0,0 +1,76 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "lua.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+namespace NS_SLUA {
+
+    // cooked scripts packed in one file, bytecode is precompiled by lua_dump.
+    // the file is memory mapped and chunks are loaded by lua directly from the mapping.
+    // module name "a.b" and "a/b" are same, built from file a/b.lua under script directory.
+    class SLUA_UNREAL_API LuaScriptArchive
+    {
+    public:
+        ~LuaScriptArchive();
+
+        // nullptr if file missing, broken or built for other lua version
+        static LuaScriptArchive* open(const FString& path);
+
+        // compile all .lua files under scriptDir and write archive to outPath, used at cook time,
+        // files failed to compile are skipped and will be loaded from source at runtime.
+        // chunk name is path relative to scriptDir, e.g. "@a/b.lua" for module a.b
+        static bool build(const FString& scriptDir, const FString& outPath, bool bStripDebugInfo = false);
+
+        // compile source with L to bytecode, L can be a scratch state without any library,
+        // it's safe to call on any thread with its own L
+        static bool compile(lua_State* L, const uint8* source, int32 len, const char* chunk, bool bStripDebugInfo, TArray<uint8>& outCode, FString* outError = nullptr);
+
+        // hash of source stored for each module, compare with source to detect stale bytecode
+        static uint32 hashSource(const uint8* buf, int32 len);
+
+        // bytecode of module fn, nullptr if not in archive
+        const uint8* find(const char* fn, uint32& outSize, uint32& outSourceHash) const;
+
+        int32 num() const
+        {
+            return count;
+        }
+
+        const FString& getPath() const
+        {
+            return path;
+        }
+
+    private:
+        LuaScriptArchive();
+        bool validate();
+
+        struct Entry;
+        const Entry* getEntries() const;
+
+        FString path;
+        IMappedFileHandle* mappedHandle;
+        IMappedFileRegion* mappedRegion;
+        // whole file if platform can't map file
+        TArray<uint8> fileData;
+        const uint8* data;
+        int64 size;
+        int32 count;
+    };
+}
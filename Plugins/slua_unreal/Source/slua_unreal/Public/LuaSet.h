@@ -94,6 +94,8 @@ namespace NS_SLUA {
         static int IterateReverse(lua_State* L);
         static int PushElement(lua_State* L, LuaSet* UD, int32 Index);
         static int CreateElementTypeObject(lua_State* L);
+        static int ToTable(lua_State* L);
+        static int FromTable(lua_State* L);
 
     private:
         FScriptSet* set;
@@ -113,6 +115,6 @@ namespace NS_SLUA {
         void clear();
         void emptyElements(int32 slack = 0);
         void removeAt(int32 index, int32 count = 1);
-        bool removeElement(const void* elementToRemove);
+        bool removeElement(const class LuaContainerKey& elementToRemove);
     };
 }
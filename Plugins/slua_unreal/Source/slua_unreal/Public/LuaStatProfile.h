@@ -50,18 +50,54 @@ namespace NS_SLUA {
             }
         };
 
+        // cached per function prototype(or c function), so hook don't build counter name every event
+        struct CounterInfo
+        {
+            // source and linedefined of prototype(or c function) the key was made from,
+            // a freed prototype's address may be reused by another one
+            const void* source;
+            int lineDefined;
+            int32 handle;
+            bool bCFunction;
+            bool bProfilerChunk;
+            // passed black list and hook level check, name of call site is checked per call
+            bool bHookable;
+        };
+
+        // counter of function by name of call site, name decides hook and counter above level 2
+        struct NamedCounter
+        {
+            const void* source = nullptr;
+            int lineDefined = 0;
+            // copy of name, name string may be freed and its address reused by another name
+            TArray<ANSICHAR> name;
+            int32 handle = INDEX_NONE;
+        };
+
         static TArray<FString> blackScripts;
         static TArray<LuaStackInfo> luaStateStack;
+        // lua_State -> index of luaStateStack
+        static TMap<lua_State*, int32> luaStateIndex;
+        static TMap<const void*, CounterInfo> counterCache;
+        static TMap<TPair<const void*, const char*>, NamedCounter> namedCounterCache;
         static int coroutineStack;
         static int mainStack;
         static int coroutine;
         static int level;
         static FDelegateHandle errorHandle;
+        static FDelegateHandle gcHandle;
 
         static void profile_coroutine_hook(lua_State* L, lua_Debug* ar);
         static void profile_hook(lua_State* L, lua_Debug* ar);
         static bool checkHookSuc(lua_Debug* ar);
         static FString generateCounterName(lua_Debug* ar);
+        static const void* getFunctionKey(lua_Debug* ar, const void*& source, int& lineDefined);
+        static void onEngineGC();
+        static CounterInfo getCounterInfo(lua_State* L, lua_Debug* ar);
+        static int32 getNamedCounterHandle(lua_State* L, lua_Debug* ar, const void* key, const CounterInfo& info);
+        static LuaStackInfo* findStackInfo(lua_State* L, int& index);
+        static LuaStackInfo* pushStackInfo(lua_State* L, int& index);
+        static void removeStackInfo(int index);
         static void checkCoroutine();
     };
 }
@@ -15,6 +15,7 @@
 #define LUA_LIB
 #include "SluaMicro.h"
 #include "LuaVar.h"
+#include "LuaFrameBudget.h"
 #include <string>
 #include <memory>
 #include <atomic>
@@ -34,6 +35,8 @@ class ULatentDelegate;
 namespace NS_SLUA {
     DECLARE_MULTICAST_DELEGATE_OneParam(FLuaStateInitEvent, lua_State*);
 
+    class LuaSmallBlockAllocator;
+
     struct ScriptTimeoutEvent {
         virtual void onTimeout() = 0;
     };
@@ -186,8 +189,24 @@ namespace NS_SLUA {
         // set field to _G, support "x.x.x.x" to create sub table recursive
         bool set(const char* key, LuaVar v);
 
-        // set load delegation function to load lua code
+        // set load delegation function to load lua code,
+        // it's also called on worker threads by preloadModules, so it must be thread safe if modules are preloaded
         void setLoadFileDelegate(LoadFileDelegate func);
+        // load required modules from precompiled archive first, see LuaScriptArchive,
+        // modules not in archive still use load delegation, return false if archive can't be opened
+        bool setScriptArchive(const FString& path);
+        // read and compile modules on worker threads, require of them later only loads bytecode,
+        // load delegation is called on worker threads so it must be thread safe
+        void preloadModules(const TArray<FString>& modules);
+        // preload modules listed in a text file, one module name each line
+        bool preloadManifest(const FString& path);
+        // require lua modules of classes and cache how their objects are bound,
+        // call it while loading level so spawning objects of classes doesn't hitch
+        void prewarmClasses(const TArray<UClass*>& classes);
+        // drop how objects are bound cached by prewarmClasses and binding, call it after reloading lua modules
+        void clearBindTemplates();
+        // load packages of object paths asynchronously, import of them later doesn't block on loading
+        void prefetchImports(const TArray<FString>& names);
         // get error delegation function to handle error
         ErrorDelegate* getErrorDelegate();
 
@@ -195,6 +214,16 @@ namespace NS_SLUA {
         {
             return L;
         }
+        // small block allocator used by lua vm, nullptr if slua.UseSmallBlockAllocator is off
+        LuaSmallBlockAllocator* getAllocator() const
+        {
+            return allocator;
+        }
+        // lua cost on game thread per frame, split by entry point
+        LuaFrameBudget& getFrameBudget()
+        {
+            return frameBudget;
+        }
         operator lua_State*() const
         {
             return L;
@@ -239,11 +268,24 @@ namespace NS_SLUA {
 
         static int pushErrorHandler(lua_State* L);
 
+        // pop value on top of l and keep it in registry, reuse slot released by unrefRegistry
+        int refRegistry(lua_State* l);
+        void unrefRegistry(int ref);
+
+        // resume coroutines waiting on frames, time, delegates, async loading or latent actions
+        class LuaCoroutineScheduler* getCoroutineScheduler() const
+        {
+            return coroutineScheduler;
+        }
+        ULatentDelegate* getLatentDelegate() const;
+
+        // deprecated, threads waiting for latent actions are kept by coroutine scheduler, these forward to it.
+        // use getCoroutineScheduler()->waitHandle, resume and findHandle instead,
+        // waiting threads are released by coroutine scheduler when state is closed
         int addThread(lua_State *thread);
         void resumeThread(int threadRef);
         int findThread(lua_State *thread);
         void cleanupThreads();
-        ULatentDelegate* getLatentDelegate() const;
 
         // call this function on script error
         void onError(const char* err);
@@ -266,12 +308,22 @@ namespace NS_SLUA {
         ErrorDelegate errorDelegate;
         TArray<uint8> loadFile(const char* fn,FString& filepath);
         static int loader(lua_State* L);
+        // load bytecode of fn from preloaded modules or script archive
+        bool loadPrecompiled(lua_State* l, const char* fn);
         static int import(lua_State *L);
+        // importAsync(path, callback) calls back with imported type after its package is loaded,
+        // importAsync(path) in coroutine waits and returns it
+        static int importAsync(lua_State *L);
         static int getStringFromMD5(lua_State* L);
 
     public:
         static FLuaStateInitEvent onInitEvent;
         int memTrack = 0;
+        // sampler of memory track in sampling mode, created by LuaMemoryProfile::start
+        struct LuaMemorySampler* getMemSampler() const
+        {
+            return memSampler;
+        }
 
     protected:
         friend class NewObjectRecorder;
@@ -285,7 +337,13 @@ namespace NS_SLUA {
         friend class SluaUtil;
         friend struct LuaEnums;
         friend class LuaScriptCallGuard;
+        friend class LuaMemoryProfile;
         lua_State* L;
+        LuaSmallBlockAllocator* allocator;
+        struct LuaMemorySampler* memSampler = nullptr;
+        class LuaScriptArchive* scriptArchive;
+        TSharedPtr<class LuaModulePreloader, ESPMode::ThreadSafe> preloader;
+        LuaFrameBudget frameBudget;
         int cacheObjRef;
         int cacheEnumRef;
         int cacheClassPropRef;
@@ -314,6 +372,7 @@ namespace NS_SLUA {
             typedef TMap<UStruct*, CachePropItem> CachePropMap;
             
             FProperty* findProp(UStruct* ustruct, const char* pname);
+            const CachePropItem& getProps(UStruct* ustruct);
             void clear() {
                 cachePropMap.Empty();
             }
@@ -334,6 +393,21 @@ namespace NS_SLUA {
         typedef TMap<FString, ImportedObjectCache> CacheImportedMap;
         CacheImportedMap cacheImportedMap;
 
+        // find loaded class, struct or enum of name and cache it
+        bool findImported(const FString& name, ImportedObjectCache& outImported);
+        static void pushImported(lua_State* L, const ImportedObjectCache& imported);
+
+        // requests of same path share one async loading
+        struct PendingImport {
+            // lua callbacks in registry
+            TArray<int> callbacks;
+            // handles of coroutines waiting on scheduler
+            TArray<int32> waits;
+        };
+        TMap<FString, PendingImport> pendingImports;
+        void requestImport(const FString& path, const FString& packageName);
+        void onImportLoaded(const FString& path);
+
         FDeadLoopCheck* deadLoopCheck;
 
         // hold UObjects pushed to lua
@@ -361,8 +435,7 @@ namespace NS_SLUA {
         TMap<FString, FString> debugStringMap;
 #endif
 
-        TMap<lua_State*, int> threadToRef;                                // coroutine -> ref
-        TMap<int, lua_State*> refToThread;                                // coroutine -> ref
+        class LuaCoroutineScheduler* coroutineScheduler;
 #if ENGINE_MAJOR_VERSION==5 && ENGINE_MINOR_VERSION >= 4
         TObjectPtr<ULatentDelegate> latentDelegate;
 #else
@@ -374,6 +447,10 @@ namespace NS_SLUA {
 
         TArray<struct LuaStruct*> deferGCStruct;
 
+        // registry slots released by LuaVar, filled with false to keep them out of luaL_ref,
+        // at most slua.MaxFreeRegistryRefs are kept, shrunk on engine gc
+        TArray<int> freeRegistryRefs;
+
 #if UE_BUILD_DEVELOPMENT
         bool bRefTraceEnable;
         TMap<int, FString> refTraceback;
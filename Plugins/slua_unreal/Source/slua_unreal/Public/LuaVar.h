@@ -263,6 +263,23 @@ namespace NS_SLUA {
             return ret.castTo<RET>();
         }
 
+        // call luavar if it's function, return first result as R,
+        // arguments are pushed and result is read on lua stack directly,
+        // no heap allocation, registry ref or std::function on this path
+        template<class R,class ...ARGS>
+        R callTyped(ARGS&& ...args) const {
+            auto L = prepareCall();
+            if (!L) {
+                return R();
+            }
+            int errhandle = lua_gettop(L) - 1;
+            int argn = pushTypedArg(L, std::forward<ARGS>(args)...);
+            if (!pcall(L, argn, errhandle)) {
+                return R();
+            }
+            return TypedReturn<R>::read(L, errhandle);
+        }
+
         template<class ...ARGS>
         LuaVar callField(const char* field, ARGS&& ...args) const {
             if (!isTable()) {
@@ -307,48 +324,34 @@ namespace NS_SLUA {
 
         void alloc(int n);
 
-        struct Ref {
-            Ref():refCount(1) {}
-            virtual ~Ref() {}
+        // ref blocks come from fixed size pools, no vtable needed
+        struct RefStr {
+            static RefStr* create(const char* s, size_t len);
             void addRef() {
                 refCount++;
             }
-            void release() {
-                ensure(refCount >0);
-                if(--refCount ==0) {
-                    delete this;
-                }
-            }
-            int refCount;
-        };
+            void release();
 
-        struct RefStr : public Ref {
-            RefStr(const char* s, size_t len)
-                :Ref()
-            {
-                if (len == 0) len = strlen(s);
-                // alloc extra space for '\0'
-                buf = (char*) FMemory::Malloc(len+1);
-                FMemory::Memcpy(buf, s, len);
-                buf[len] = 0;
-                length = len;
-            }
-            virtual ~RefStr() {
-                FMemory::Free(buf);
-            }
+            int refCount;
             char* buf;
             size_t length;
         };
 
-        struct RefRef: public Ref {
-            RefRef(lua_State* l);
-            virtual ~RefRef();
+        struct RefRef {
+            // pop value on top of l and keep it in registry
+            static RefRef* create(lua_State* l);
+            void addRef() {
+                refCount++;
+            }
+            void release();
             bool isValid() {
                 return ref != LUA_NOREF;
             }
             void push(lua_State* l) {
                 lua_geti(l,LUA_REGISTRYINDEX,ref);
             }
+
+            int refCount;
             int ref;
             int stateIndex;
         };
@@ -367,8 +370,18 @@ namespace NS_SLUA {
             Type luatype;
         } lua_var;
 
+        // single value is stored inline, only tuple allocates vars,
+        // no pointer to inlineVar is kept since TArray relocates LuaVar by memcpy
+        lua_var inlineVar;
         lua_var* vars;
         size_t numOfVar;
+
+        lua_var& getVar(size_t n) {
+            return numOfVar == 1 ? inlineVar : vars[n];
+        }
+        const lua_var& getVar(size_t n) const {
+            return numOfVar == 1 ? inlineVar : vars[n];
+        }
     
         template<class F,class ...ARGS>
         int pushArg(F f,ARGS&& ...args) const {
@@ -381,6 +394,37 @@ namespace NS_SLUA {
             return 0;
         }
 
+        template<class F,class ...ARGS>
+        static int pushTypedArg(lua_State* L,F&& f,ARGS&& ...args) {
+            LuaObject::push(L,f);
+            return 1+pushTypedArg(L,std::forward<ARGS>(args)...);
+        }
+
+        static int pushTypedArg(lua_State* L) {
+            return 0;
+        }
+
+        template<class R,bool IsVoid=std::is_void<R>::value>
+        struct TypedReturn {
+            static R read(lua_State* L,int errhandle) {
+                R r = ArgOperatorOpt::readArg<typename remove_cr<R>::type>(L,-1);
+                lua_settop(L,errhandle-1);
+                return r;
+            }
+        };
+
+        template<class R>
+        struct TypedReturn<R,true> {
+            static void read(lua_State* L,int errhandle) {
+                lua_settop(L,errhandle-1);
+            }
+        };
+
+        // push error handler and function, return nullptr if luavar can't be called
+        lua_State* prepareCall() const;
+        // call function with one result, stack is restored if failed
+        bool pcall(lua_State* L,int argn,int errhandle) const;
+
         static LuaVar wrapReturn(lua_State* L,int n) {
             ensure(n>=0);
             if(n==0)
@@ -4,6 +4,7 @@
 #include "CoreMinimal.h"
 #include "LuaMemoryProfile.h"
 #include "Containers/Queue.h"
+#include <atomic>
 #include "ProfileDataDefine.generated.h"
 
 struct FileMemInfo;
@@ -33,86 +34,119 @@ enum SLUA_UNREAL_API FSaveMode
     EndOfFrame,
 };
 
+// interned names of profiler, an index never changes once it's created.
+// lookup of existing names is lock free, only creating a name takes the lock.
+// names are keyed by utf8 bytes, so lua names can be looked up without FString.
 struct SLUA_UNREAL_API FProfileNameSet
 {
     static constexpr uint32 InvalidIndex = 0;
     static FProfileNameSet* GlobalProfileNameSet;
 
-    TMap<uint32, FString> indexToString;
+    FProfileNameSet();
+    ~FProfileNameSet();
 
-    TMap<FString, uint32> stringToIndex;
-
-    TSet<uint32> indexSet;
-
-    TMap<uint32, FString> increaseString;
-
-    FCriticalSection mutex;
-
-    uint32 GetOrCreateIndex(const FString& content)
+    static uint32 HashName(const ANSICHAR* utf8, int32 len)
     {
-        FScopeLock lock(&mutex);
-        uint32* indexPtr = stringToIndex.Find(content);
-        if (indexPtr)
+        // FNV-1a
+        uint32 hash = 2166136261u;
+        for (int32 i = 0; i < len; i++)
         {
-            return *indexPtr;
+            hash = (hash ^ (uint8)utf8[i]) * 16777619u;
         }
+        return hash;
+    }
 
-        uint32 hashKey = GetTypeHash(content);
-        while (indexSet.Contains(hashKey) && hashKey != InvalidIndex)
-        {
-            hashKey++;
-        }
-
-        stringToIndex.Emplace(content, hashKey);
-        indexToString.Emplace(hashKey, content);
-        indexSet.Add(hashKey);
-
-        increaseString.Emplace(hashKey, content);
+    uint32 GetOrCreateIndex(const ANSICHAR* utf8, int32 len, uint32 hash);
 
-        return hashKey;
+    uint32 GetOrCreateIndex(const ANSICHAR* utf8)
+    {
+        int32 len = FCStringAnsi::Strlen(utf8);
+        return GetOrCreateIndex(utf8, len, HashName(utf8, len));
     }
 
-    uint32 GetIndex(const FString& content)
+    uint32 GetOrCreateIndex(const FString& content)
     {
-        FScopeLock lock(&mutex);
-        uint32* indexPtr = stringToIndex.Find(content);
-        if (indexPtr)
-        {
-            return *indexPtr;
-        }
-
-        return InvalidIndex;
+        FTCHARToUTF8 utf8(*content);
+        return GetOrCreateIndex(utf8.Get(), utf8.Length(), HashName(utf8.Get(), utf8.Length()));
     }
 
-    FString GetStringByIndex(uint32 index)
+    uint32 GetIndex(const ANSICHAR* utf8, int32 len, uint32 hash) const;
+
+    uint32 GetIndex(const FString& content) const
     {
-        FScopeLock lock(&mutex);
-        FString* content = indexToString.Find(index);
-        if (content)
-        {
-            return *content;
-        }
+        FTCHARToUTF8 utf8(*content);
+        return GetIndex(utf8.Get(), utf8.Length(), HashName(utf8.Get(), utf8.Length()));
+    }
 
-        return TEXT("");
+    FString GetStringByIndex(uint32 index) const;
+
+    // move out names created since last call, or all names if bAll
+    void TakeNewNames(TMap<uint32, FString>& outNames, bool bAll);
+
+    // add names loaded from file with their indexes, replace existing names of same index or content,
+    // a name already at its index is kept
+    void AddNames(const TMap<uint32, FString>& names);
+
+    // count of entries created, replaced entries included
+    int32 Num() const
+    {
+        return numNames;
     }
 
     friend FArchive& operator<<(FArchive& Ar, FProfileNameSet& profileNameSet)
     {
-        FScopeLock lock(&profileNameSet.mutex);
-
-        Ar << profileNameSet.indexToString;
-        Ar << profileNameSet.indexSet;
-        if (Ar.IsLoading())
+        TMap<uint32, FString> indexToString;
+        TSet<uint32> indexSet;
+        if (Ar.IsSaving())
         {
-            auto& strToIndex = profileNameSet.stringToIndex;
-            for (auto iter = profileNameSet.indexToString.CreateConstIterator(); iter; ++iter)
+            profileNameSet.TakeNewNames(indexToString, true);
+            for (auto iter = indexToString.CreateConstIterator(); iter; ++iter)
             {
-                strToIndex.Emplace(iter.Value(), iter.Key());
+                indexSet.Add(iter.Key());
             }
         }
-        profileNameSet.increaseString.Empty();
+        else
+        {
+            TMap<uint32, FString> newNames;
+            profileNameSet.TakeNewNames(newNames, false);
+        }
+
+        Ar << indexToString;
+        Ar << indexSet;
+        if (Ar.IsLoading())
+        {
+            profileNameSet.AddNames(indexToString);
+        }
         return Ar;
     }
+
+private:
+    struct FEntry;
+
+    // open addressing table, slots are published with release store and never removed
+    struct FTable
+    {
+        uint32 mask;
+        std::atomic<FEntry*>* slots;
+    };
+
+    FEntry* FindByName(const ANSICHAR* utf8, int32 len, uint32 hash) const;
+    FEntry* FindById(uint32 index) const;
+    // caller holds mutex, bNew if it should be returned by TakeNewNames
+    FEntry* AddEntry(uint32 index, const ANSICHAR* utf8, int32 len, uint32 hash, bool bNew);
+    void Grow();
+    static FTable* NewTable(uint32 capacity);
+
+    std::atomic<FTable*> nameTable;
+    std::atomic<FTable*> idTable;
+
+    // guard creating names, readers never take it
+    FCriticalSection mutex;
+    // all entries and tables replaced by Grow, freed with the set since readers may still use them
+    TArray<FEntry*> entries;
+    TArray<FTable*> retiredTables;
+    int32 numNames;
+    TArray<FEntry*> newEntries;
 };
 
 USTRUCT()
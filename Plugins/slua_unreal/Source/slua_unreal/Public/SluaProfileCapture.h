@@ -0,0 +1,161 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProfileDataDefine.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+// .sluacap is a columnar capture of profiler frames, written as a stream and read through a memory mapping.
+// each frame is a block of fixed width columns over its call tree nodes in preorder:
+//     costTime(int64, inclusive ns) | calls(int32) | parent(int32, -1 for roots) | function(uint32)
+// function ids index a function table, whose file and function names are interned once from FProfileNameSet.
+// frame offsets, function table and names are written as a footer by Close, a capture without footer can't be read.
+// data is in native byte order.
+
+// write frames of SluaProfilerDataManager to a .sluacap file
+class SLUA_UNREAL_API FSluaProfileCaptureWriter
+{
+public:
+    FSluaProfileCaptureWriter();
+    ~FSluaProfileCaptureWriter();
+
+    bool Open(const FString& filePath);
+
+    // write children of a frame root, tickTime is time of PHE_TICK in ns
+    void WriteFrame(int64 tickTime, const TArray<TSharedPtr<FunctionProfileNode>>& frameRootArr, float memoryKB);
+
+    // write footer and close file
+    void Close();
+
+    bool IsOpen() const
+    {
+        return ar != nullptr;
+    }
+
+    int32 NumFrames() const
+    {
+        return frameOffsets.Num();
+    }
+
+private:
+    void AddNode(const FunctionProfileNode& node, int32 parent);
+    uint32 InternFunction(const FLuaFunctionDefine& functionDefine);
+    uint32 InternName(uint32 nameIndex);
+    void Pad();
+
+    FArchive* ar;
+    TArray<uint64> frameOffsets;
+
+    TMap<FLuaFunctionDefine, uint32> functionIds;
+    TArray<FLuaFunctionDefine> functions;
+    // FProfileNameSet index to name id of capture
+    TMap<uint32, uint32> nameIds;
+    TArray<uint32> names;
+
+    // columns of current frame, reused by every frame
+    TArray<int64> costTimeColumn;
+    TArray<int32> callsColumn;
+    TArray<int32> parentColumn;
+    TArray<uint32> functionColumn;
+};
+
+struct SLUA_UNREAL_API FSluaProfileFunctionStat
+{
+    // time of outermost calls, recursive calls are not counted twice
+    int64 inclusiveTime = 0;
+    // inclusive time minus time of callees
+    int64 exclusiveTime = 0;
+    int64 calls = 0;
+    // frames this function is called in
+    int32 frames = 0;
+};
+
+// memory mapped .sluacap, frames are read on demand
+class SLUA_UNREAL_API FSluaProfileCapture
+{
+public:
+    struct FFrame
+    {
+        int64 tickTime;
+        float memoryKB;
+        int32 numNodes;
+        const int64* costTime;
+        const int32* calls;
+        const int32* parent;
+        const uint32* function;
+    };
+
+    ~FSluaProfileCapture();
+
+    // nullptr if file is missing, broken or not closed by writer
+    static FSluaProfileCapture* Open(const FString& filePath);
+
+    int32 NumFrames() const
+    {
+        return frameCount;
+    }
+
+    int32 NumFunctions() const
+    {
+        return functionCount;
+    }
+
+    // false if frame block is broken
+    bool GetFrame(int32 index, FFrame& outFrame) const;
+
+    FString GetFileName(uint32 function) const;
+    FString GetFunctionName(uint32 function) const;
+    int32 GetLineDefined(uint32 function) const;
+    // same format as FLuaFunctionDefine::GetFullName
+    FString GetFullName(uint32 function) const;
+
+    // stats of frames [firstFrame, firstFrame + numFrames), outStats is indexed by function id
+    void Aggregate(int32 firstFrame, int32 numFrames, TArray<FSluaProfileFunctionStat>& outStats) const;
+
+    const FString& GetPath() const
+    {
+        return path;
+    }
+
+private:
+    friend class FSluaProfileCaptureWriter;
+
+    FSluaProfileCapture();
+    bool Validate();
+    FString GetName(uint32 name) const;
+
+    struct FFunctionEntry;
+    struct FNameEntry;
+
+    FString path;
+    IMappedFileHandle* mappedHandle;
+    IMappedFileRegion* mappedRegion;
+    // whole file if platform can't map file
+    TArray<uint8> fileData;
+    const uint8* data;
+    int64 size;
+
+    int64 footerOffset;
+    int32 frameCount;
+    int32 functionCount;
+    int32 nameCount;
+    const uint64* frameOffsets;
+    const FFunctionEntry* functionEntries;
+    const FNameEntry* nameEntries;
+    const uint8* nameData;
+    uint32 nameDataSize;
+};
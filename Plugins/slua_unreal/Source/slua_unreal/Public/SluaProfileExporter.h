@@ -0,0 +1,92 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProfileDataDefine.h"
+#include "SluaProfileCapture.h"
+
+// export profiler frames to other tools, frames are written as they are added and not kept.
+// ChromeTrace: Trace Event JSON for chrome://tracing or Perfetto, a frame's calls are laid out one after another
+//     from the frame start since call trees are aggregated, lua memory is a counter track.
+// FoldedStack: "root;caller;callee self_us" lines for flamegraph.pl or speedscope, stacks are merged over all
+//     frames, memory holds one entry per distinct stack.
+class SLUA_UNREAL_API FSluaProfileExporter
+{
+public:
+    enum class EFormat : uint8
+    {
+        ChromeTrace,
+        FoldedStack,
+    };
+
+    // "chrome" or "folded"
+    static bool ParseFormat(const FString& name, EFormat& outFormat);
+
+    // export a .sluacap or .sluastat file frame by frame
+    static bool ExportFile(const FString& filePath, const FString& outPath, EFormat format);
+
+    // export frames in memory, e.g. frames shown by profiler window
+    static bool ExportFrames(const ProfileNodeArrayArray& profileData, const MemNodeInfoList& memNodeList, const FString& outPath, EFormat format);
+
+    explicit FSluaProfileExporter(EFormat inFormat);
+    ~FSluaProfileExporter();
+
+    bool Open(const FString& outPath);
+
+    // function ids must mean same function in all frames, getName is called once for each id
+    void AddFrame(const FSluaProfileCapture::FFrame& frame, TFunctionRef<FString(uint32)> getName);
+
+    // frame of profiler call trees, tickTime is 0 if unknown
+    void AddFrame(const TArray<TSharedPtr<FunctionProfileNode>>& frameRootArr, float memoryKB, int64 tickTime = 0);
+
+    void Close();
+
+private:
+    void WriteChromeFrame(const FSluaProfileCapture::FFrame& frame);
+    void AddFoldedFrame(const FSluaProfileCapture::FFrame& frame);
+    void WriteFoldedStacks();
+    void FlattenNode(const FunctionProfileNode& node, int32 parent);
+    void ResolveNames(const FSluaProfileCapture::FFrame& frame, TFunctionRef<FString(uint32)> getName);
+    void Write(const FString& text);
+
+    EFormat format;
+    FArchive* ar;
+    int32 frameIndex;
+    // end of last frame in ns, used when frame has no tick time
+    int64 clock;
+
+    // names by function id, escaped for output format
+    TArray<FString> names;
+    TBitArray<> nameResolved;
+
+    // call trees added by AddFrame are flattened to columns
+    TMap<FLuaFunctionDefine, uint32> treeFunctionIds;
+    TArray<FLuaFunctionDefine> treeFunctions;
+    TArray<int64> costTimeColumn;
+    TArray<int32> callsColumn;
+    TArray<int32> parentColumn;
+    TArray<uint32> functionColumn;
+
+    // start time of next callee of each node in current frame
+    TArray<int64> childCursor;
+
+    // stack trie of folded format, path is parent path and function
+    TMap<TPair<int32, uint32>, int32> pathIds;
+    TArray<int32> pathParent;
+    TArray<uint32> pathFunction;
+    TArray<int64> pathSelfTime;
+    // path of each node in current frame
+    TArray<int32> nodePath;
+};
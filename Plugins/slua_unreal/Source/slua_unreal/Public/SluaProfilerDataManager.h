@@ -10,6 +10,11 @@
 #include "Serialization/BufferArchive.h"
 #include "HAL/Runnable.h"
 
+class FSluaProfileCaptureWriter;
+
+// called for each frame read from .sluastat file
+typedef TFunctionRef<void(TArray<TSharedPtr<FunctionProfileNode>>& frameRootArr, const TSharedPtr<FProflierMemNode>& memNode)> FProfileFrameVisitor;
+
 class SLUA_UNREAL_API FProfileDataProcessRunnable : public FRunnable
 {
 public:
@@ -23,6 +28,8 @@ public:
 
     //接收性能数据
     void ReceiveProfileData(int hookEvent, int64 time, int lineDefined, const FString& funcName, const FString& shortSrc);
+    //接收性能数据,名字为utf8,在调用线程转换为名字索引
+    void ReceiveProfileData(int hookEvent, int64 time, int lineDefined, const char* funcName, const char* shortSrc);
 
     //接收内存数据
     void ReceiveMemoryData(int hookEvent, const TArray<NS_SLUA::LuaMemInfo>& memInfoList);
@@ -35,6 +42,9 @@ public:
     //解压数据
     void LoadData(const FString& filePath, int& inCpuViewBeginIndex, int& inMemViewBeginIndex, ProfileNodeArrayArray& inProfileData, MemNodeInfoList& inLuaMemNodeList);
 
+    //逐帧读取数据,不保留已读取的帧
+    bool LoadDataByFrame(const FString& filePath, FProfileFrameVisitor visitor);
+
     //清除数据
     void OnClearDataWithCallBack(TFunction<void()>&& Callback);
 
@@ -55,8 +65,9 @@ private:
         int hookEvent;
         int64 time;
         int lineDefined;
-        FString funcName;
-        FString shortSrc;
+        // index of FProfileNameSet
+        uint32 funcNameIndex;
+        uint32 shortSrcIndex;
     };
     TQueue<FCPUCommand, EQueueMode::Mpsc> cpuCommandQueue;
 
@@ -86,6 +97,8 @@ private:
     ProfileNodeArrayArray allProfileData;
     TArray<TSharedPtr<FunctionProfileNode>> profileRootArr;
     TQueue<TSharedPtr<FunctionProfileNode>, EQueueMode::Mpsc> funcProfilerNodeQueue;
+    // time of PHE_TICK for each frame in funcProfilerNodeQueue
+    TQueue<int64, EQueueMode::Mpsc> frameTimeQueue;
     TSharedPtr<FProflierMemNode> lastLuaMemNode;
 
     MemoryFrameQueue memoryQueue;
@@ -96,11 +109,13 @@ private:
     int32 memoryFrameNum = -1;
 
     FArchive* frameArchive = nullptr;
+    // used instead of frameArchive if slua.ProfileColumnarCapture is set when record starts
+    FSluaProfileCaptureWriter* captureWriter = nullptr;
     bool bCanStartFrameRecord = false;
     bool bFrameFirstRecord = false;
     TArray<uint8> dataToCompress;
 
-    void PreProcessData(TSharedPtr<FunctionProfileNode> funcInfoRoot, TMap<int64, NS_SLUA::LuaMemInfo>& memoryInfoMap, MemoryFramePtr memoryFrame);
+    void PreProcessData(TSharedPtr<FunctionProfileNode> funcInfoRoot, TMap<int64, NS_SLUA::LuaMemInfo>& memoryInfoMap, MemoryFramePtr memoryFrame, int64 tickTime);
     void SerializeCompreesedDataToFile(FArchive& ar);
 
     void CollectMemoryNode(TMap<int64, NS_SLUA::LuaMemInfo>& memoryInfoMap, MemoryFramePtr memoryFrame);
@@ -108,7 +123,8 @@ private:
     void RestartMemoryStatistis();
     void ClearCurProfiler();
 
-    void SerializeLoad(FArchive& inAR, int& inCpuViewBeginIndex, int& inMemViewBeginIndex, ProfileNodeArrayArray& inProfileData, MemNodeInfoList& inLuaMemNodeList);
+    bool ReadStatFile(const FString& filePath, int& inCpuViewBeginIndex, int& inMemViewBeginIndex, FProfileFrameVisitor visitor);
+    void SerializeLoad(FArchive& inAR, FProfileFrameVisitor visitor);
 };
 
 class SLUA_UNREAL_API SluaProfilerDataManager
@@ -120,6 +136,7 @@ public:
 
     //接收性能数据
     static void ReceiveProfileData(int hookEvent, int64 time, int lineDefined, const FString& funcName, const FString& shortSrc);
+    static void ReceiveProfileData(int hookEvent, int64 time, int lineDefined, const char* funcName, const char* shortSrc);
     //接收内存数据
 	static void ReceiveMemoryData(int hookEvent, const TArray<NS_SLUA::LuaMemInfo>& memInfoList);
 
@@ -137,6 +154,9 @@ public:
     //解压数据
     static void LoadData(const FString& filePath, int& inCpuViewBeginIndex, int& inMemViewBeginIndex, ProfileNodeArrayArray& inProfileData, MemNodeInfoList& inLuaMemNodeList);
 
+    //逐帧读取数据,用于导出大文件
+    static bool LoadDataByFrame(const FString& filePath, FProfileFrameVisitor visitor);
+
     //清除数据
     static void OnClearDataWithCallBack(TFunction<void()>&& Callback);
 
@@ -147,6 +167,10 @@ public:
     static void CoroutineBegin(int32 lineDefined, const FString& funcName, double nanoseconds, ProfileNodePtr funcProfilerRoot, ProfileCallInfoArray& profilerStack);
     static void CoroutineEnd(double nanoseconds, ProfileCallInfoArray& profilerStack);
 
+    static void WatchBegin(const FLuaFunctionDefine& funcDefine, double nanoseconds, ProfileNodePtr funcProfilerRoot, ProfileCallInfoArray& profilerStack);
+    static void WatchEnd(const FLuaFunctionDefine& funcDefine, double nanoseconds, ProfileCallInfoArray& profilerStack);
+    static void CoroutineBegin(const FLuaFunctionDefine& funcDefine, double nanoseconds, ProfileNodePtr funcProfilerRoot, ProfileCallInfoArray& profilerStack);
+
     static void InitProfileNode(TSharedPtr<FunctionProfileNode>& funcNode, const FLuaFunctionDefine& funcDefine, int32 layerIdx);
     static void AddToParentNode(TSharedPtr<FunctionProfileNode> patentNode, TSharedPtr<FunctionProfileCallInfo> callInfo);
     
@@ -0,0 +1,26 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License"); 
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing, 
+// software distributed under the License is distributed on an "AS IS" BASIS, 
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. 
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "SluaBenchmarkObject.h"
+#include "LuaNet.h"
+
+USluaBenchmarkObject::USluaBenchmarkObject(const FObjectInitializer& ObjectInitializer)
+    : Super(ObjectInitializer)
+{
+    LuaFilePath = TEXT("BenchmarkObject");
+    if (HasAnyFlags(RF_ClassDefaultObject))
+    {
+        // not an actor or component, lua replicated props are only assigned to registered classes
+        NS_SLUA::LuaNet::addLuaRepilcateClass(GetClass());
+    }
+}
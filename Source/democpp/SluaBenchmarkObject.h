@@ -0,0 +1,35 @@
+// Tencent is pleased to support the open source community by making sluaunreal available.
+
+// Copyright (C) 2018 THL A29 Limited, a Tencent company. All rights reserved.
+// Licensed under the BSD 3-Clause License (the "License"); 
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+
+// https://opensource.org/licenses/BSD-3-Clause
+
+// Unless required by applicable law or agreed to in writing, 
+// software distributed under the License is distributed on an "AS IS" BASIS, 
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. 
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "LuaUEObject.h"
+#include "LuaNetSerialization.h"
+#include "SluaBenchmarkObject.generated.h"
+
+// bound to BenchmarkObject.lua, Override.ProcessEvent of TestBenchmark calls its lua override from c++,
+// Replication.PrepareReplication compares and serializes its lua replicated props
+UCLASS()
+class USluaBenchmarkObject : public ULuaObject
+{
+    GENERATED_BODY()
+public:
+    USluaBenchmarkObject(const FObjectInitializer& ObjectInitializer);
+
+    UFUNCTION(BlueprintImplementableEvent)
+    void OnBenchmarkEvent();
+
+    UPROPERTY()
+    FLuaNetSerialization LuaNetSerialization;
+};
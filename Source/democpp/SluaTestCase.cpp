@@ -277,6 +277,43 @@ namespace NS_SLUA {
         DefLuaMethod(FuncWithStr,&PerfTest::FuncWithStr)
     EndDef(PerfTest,&PerfTest::create)
 
+    // keep lua values in LuaVar, to test pooled ref blocks and registry slots
+    class RefHolder {
+    public:
+        static LuaOwnedPtr<RefHolder> create() {
+            return new RefHolder();
+        }
+
+        void set(int i, LuaVar v) {
+            if (i >= values.Num())
+                values.SetNum(i + 1);
+            values[i] = v;
+        }
+
+        LuaVar get(int i) {
+            return values.IsValidIndex(i) ? values[i] : LuaVar();
+        }
+
+        void clear(int i) {
+            if (values.IsValidIndex(i))
+                values[i].free();
+        }
+
+        int num() const {
+            return values.Num();
+        }
+
+    private:
+        TArray<LuaVar> values;
+    };
+
+    DefLuaClass(RefHolder)
+        DefLuaMethod(set,&RefHolder::set)
+        DefLuaMethod(get,&RefHolder::get)
+        DefLuaMethod(clear,&RefHolder::clear)
+        DefLuaMethod(num,&RefHolder::num)
+    EndDef(RefHolder,&RefHolder::create)
+
 	enum TestEnum {
 		TE_OK,
 		TE_BAD,
@@ -208,6 +208,21 @@ public:
 		OnTestAAA.Broadcast(str);
 	}
 
+	// copy of OnTestAAA keeps the bindings it had when copied
+	UFUNCTION(BlueprintCallable, Category = "Lua|TestCase")
+		void CopyTestAAA()
+	{
+		CopiedTestAAA = OnTestAAA;
+	}
+
+	UFUNCTION(BlueprintCallable, Category = "Lua|TestCase")
+		void TestCopiedAAA(FString str)
+	{
+		CopiedTestAAA.Broadcast(str);
+	}
+
+	FOnTestAAA CopiedTestAAA;
+
 	UFUNCTION()
 	void TestLuaCallback(FLuaBPVar callback) {
 		if (callback.value.isFunction())